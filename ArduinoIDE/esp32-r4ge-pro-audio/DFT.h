@@ -2,13 +2,17 @@
 #define _DFT_
 
 #include "WAV_audio.h"
-#include "complex.h"
+#include "WAV_fft.h"
 
 #define DFT_FRAME_SIZE  512
 #define DFT_NFFT        512
 
 
 
+#if DFT_FRAME_SIZE != WAV_FFT_SIZE
+#error DFT_FRAME_SIZE must match WAV_FFT_SIZE
+#endif
+
 class DFT
 {
   public:
@@ -17,12 +21,13 @@ class DFT
     bool    calculateDFT();
     double  getPowerCoef(uint16_t index);
     double  findMaxRealOutput();
-    Complex dft_input[DFT_FRAME_SIZE];
-    Complex dft_output[DFT_FRAME_SIZE];
+    float   dft_real[DFT_FRAME_SIZE];  // Input before calculateDFT(), output after
+    float   dft_imag[DFT_FRAME_SIZE];
     
   private:
     bool    _success = false;
     const double  _inverse = 1.0 / (double)DFT_FRAME_SIZE;
+    WAV_fft _fft;
 
 };
 
@@ -3,11 +3,13 @@
 
 #include "esp32_r4ge_pro.h"
 
+#define WAV_SAMPLE_RATE  11025  // Rate of the sample buffer, files at other rates are converted
 #define WAV_MAX_SAMPLES  11025
 
 #define WAV_HDR_RIFF     0x46464952  // "RIFF" big endian
 #define WAV_HDR_WAVE     0x45564157  // "WAVE" big endian
 #define WAV_HDR_FMT      0x20746D66  // "fmt " big endian (with trailing space)
+#define WAV_HDR_DATA     0x61746164  // "data" big endian
 #define WAV_FMT_PCM      1
 #define WAV_SILENCE      0
 #define WAV_SILENCE_8BIT 64  // should be 128(?)
@@ -48,7 +50,7 @@ typedef struct wav_header_t {
     uint16_t bits_per_sample = 16;
     
     // Data sub-chunk
-    uint32_t data_header = 0x61746164;  // "data" big endian
+    uint32_t data_header = WAV_HDR_DATA;  // "data" big endian
     uint32_t data_bytes; //  = sample count * num_channels * sample byte size
     // uint8_t bytes[]; // Remainder of wav file is sample data bytes
 };
@@ -0,0 +1,147 @@
+#include "WAV_capture.h"
+
+WAV_capture::WAV_capture()
+{
+  for (uint8_t i = 0; i < WAV_CAPTURE_MAX_SUBS; i++)
+  {
+    _sub[i].callback = NULL;
+    _sub[i].context = NULL;
+  }
+}
+
+/*
+ * Drops any blocks waiting in the ring.  Call while the source is stopped.
+ */
+void WAV_capture::reset()
+{
+  _write_cnt = 0;
+  _read_cnt = 0;
+  _overruns = 0;
+  _sample_cnt = 0;
+  _discarding = false;
+}
+
+/*
+ * Adds a callback that is passed every captured block.
+ * Returns false if there are already WAV_CAPTURE_MAX_SUBS subscribers.
+ */
+bool WAV_capture::subscribe(wav_capture_callback_t callback, void *context)
+{
+  for (uint8_t i = 0; i < WAV_CAPTURE_MAX_SUBS; i++)
+  {
+    if (_sub[i].callback == callback && _sub[i].context == context) return true;  // already subscribed
+  }
+  
+  for (uint8_t i = 0; i < WAV_CAPTURE_MAX_SUBS; i++)
+  {
+    if (_sub[i].callback == NULL)
+    {
+      _sub[i].context = context;
+      _sub[i].callback = callback;
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+ * Removes a callback.  Safe to call from inside the callback itself.
+ */
+void WAV_capture::unsubscribe(wav_capture_callback_t callback, void *context)
+{
+  for (uint8_t i = 0; i < WAV_CAPTURE_MAX_SUBS; i++)
+  {
+    if (_sub[i].callback == callback && _sub[i].context == context)
+    {
+      _sub[i].callback = NULL;
+      _sub[i].context = NULL;
+    }
+  }
+}
+
+/*
+ * Source side.  Returns the block to fill with WAV_CAPTURE_BLOCK samples.
+ */
+int16_t *WAV_capture::getWriteBlock()
+{
+  _discarding = (_write_cnt - _read_cnt >= WAV_CAPTURE_BLOCKS);
+  if (_discarding) return _discard;
+  
+  return _block[_write_cnt & (WAV_CAPTURE_BLOCKS - 1)];
+}
+
+/*
+ * Source side.  Publishes the block returned by getWriteBlock().
+ * time_us is when its last sample was captured, in the source's microsecond clock.
+ */
+void WAV_capture::commitBlock(uint32_t time_us)
+{
+  if (_discarding)
+  {
+    _overruns++;
+    return;
+  }
+  _time_us[_write_cnt & (WAV_CAPTURE_BLOCKS - 1)] = time_us;
+  _write_cnt++;
+}
+
+/*
+ * App side.  Passes every finished block to the subscribers.  Call from loop().
+ * Returns the number of blocks passed on.
+ */
+uint16_t WAV_capture::poll()
+{
+  uint16_t blocks = 0;
+
+  while (_read_cnt != _write_cnt)
+  {
+    const int16_t *block = _block[_read_cnt & (WAV_CAPTURE_BLOCKS - 1)];
+    _read_time_us = _time_us[_read_cnt & (WAV_CAPTURE_BLOCKS - 1)];
+    
+    for (uint8_t i = 0; i < WAV_CAPTURE_MAX_SUBS; i++)
+    {
+      if (_sub[i].callback != NULL)
+        _sub[i].callback(block, WAV_CAPTURE_BLOCK, _sub[i].context);
+    }
+    
+    _sample_cnt += WAV_CAPTURE_BLOCK;
+    _read_cnt++;
+    blocks++;
+  }
+  return blocks;
+}
+
+/*
+ * From a subscriber, the capture time of the last sample of the block it was passed,
+ * as given to commitBlock().
+ */
+uint32_t WAV_capture::getBlockTime()
+{
+  return _read_time_us;
+}
+
+void WAV_capture::setSampleRate(uint32_t sample_rate)
+{
+  _sample_rate = sample_rate;
+}
+
+uint32_t WAV_capture::getSampleRate()
+{
+  return _sample_rate;
+}
+
+/*
+ * Returns the number of samples passed to the subscribers since reset()
+ */
+uint32_t WAV_capture::getSampleCount()
+{
+  return _sample_cnt;
+}
+
+/*
+ * Returns the number of blocks dropped because the ring was full
+ */
+uint32_t WAV_capture::getOverruns()
+{
+  return _overruns;
+}
@@ -0,0 +1,61 @@
+#ifndef _WAV_CAPTURE_
+#define _WAV_CAPTURE_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define WAV_CAPTURE_BLOCK      256  // Samples per block (~23 msec at 11025 Hz)
+#define WAV_CAPTURE_BLOCKS      16  // Blocks in the ring (~370 msec).  Must be power of 2
+#define WAV_CAPTURE_MAX_SUBS     4
+
+typedef void (*wav_capture_callback_t)(const int16_t *samples, uint16_t count, void *context);
+
+/*
+ * Continuous audio capture shared by the recorder, analyzer and level meter.
+ * A source (WAV_capture_i2s on the badge, tools/wav_capture_file on the host) fills 
+ * blocks from its own task or thread with getWriteBlock() and commitBlock().  
+ * The app calls poll() from loop(), which passes each finished block to every 
+ * subscriber, so subscribers run in the loop() context and can draw to the screen.
+ * One producer and one consumer, so the ring needs no locks.
+ * If the ring is full the block is dropped and counted as an overrun.
+ * The source can stamp each block with its capture time, so subscribers can time
+ * events in the audio however late loop() gets to them.
+ * No Arduino dependencies.
+ */
+class WAV_capture
+{
+  public:
+    WAV_capture();
+    void     reset();
+    bool     subscribe(wav_capture_callback_t callback, void *context);
+    void     unsubscribe(wav_capture_callback_t callback, void *context);
+    int16_t *getWriteBlock();
+    void     commitBlock(uint32_t time_us = 0);
+    uint16_t poll();
+    uint32_t getBlockTime();
+    void     setSampleRate(uint32_t sample_rate);
+    uint32_t getSampleRate();
+    uint32_t getSampleCount();
+    uint32_t getOverruns();
+
+  private:
+    typedef struct
+    {
+      wav_capture_callback_t callback;
+      void *context;
+    } wav_capture_sub_t;
+
+    int16_t  _block[WAV_CAPTURE_BLOCKS][WAV_CAPTURE_BLOCK];
+    int16_t  _discard[WAV_CAPTURE_BLOCK];  // Written instead of the ring when it is full
+    wav_capture_sub_t _sub[WAV_CAPTURE_MAX_SUBS];
+    volatile uint32_t _write_cnt = 0;  // Blocks committed by the source
+    volatile uint32_t _read_cnt = 0;   // Blocks passed to the subscribers
+    volatile uint32_t _overruns = 0;
+    uint32_t _time_us[WAV_CAPTURE_BLOCKS];  // Capture time of each block's last sample
+    uint32_t _read_time_us = 0;             // Capture time of the block being passed on
+    bool     _discarding = false;
+    uint32_t _sample_rate = 11025;
+    uint32_t _sample_cnt = 0;
+};
+
+#endif // _WAV_CAPTURE_
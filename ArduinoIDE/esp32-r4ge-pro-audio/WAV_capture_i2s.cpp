@@ -0,0 +1,137 @@
+#include "WAV_capture_i2s.h"
+
+WAV_capture_i2s::WAV_capture_i2s()
+{
+
+}
+
+/*
+ * Installs the I2S ADC driver and starts capturing into the WAV_capture ring.
+ * Returns true on success, false on failure.
+ */
+bool WAV_capture_i2s::begin(WAV_capture *capture, uint32_t sample_rate)
+{
+  esp_err_t err;
+
+  if (_running) return true;
+  _capture = capture;
+  
+  i2s_config_t adc_config = {
+    .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX | I2S_MODE_ADC_BUILT_IN),
+    .sample_rate = sample_rate,
+    .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
+    .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT,
+    .communication_format = I2S_COMM_FORMAT_I2S_MSB,
+    .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
+    .dma_buf_count = WAV_CAPTURE_DMA_BUFS,
+    .dma_buf_len = WAV_CAPTURE_BLOCK,
+    .use_apll = false,
+    .tx_desc_auto_clear = 0,
+    .fixed_mclk = 0
+  };
+
+  err = i2s_driver_install(WAV_CAPTURE_I2S_PORT, &adc_config, 0, NULL);
+  if (err != ESP_OK)
+  {
+    Serial.print(F("I2S ADC driver install fail: "));
+    Serial.println(err);
+    return false;
+  }
+  
+  adc1_config_width(ADC_WIDTH_BIT_12);
+  adc1_config_channel_atten(WAV_CAPTURE_ADC_CHANNEL, ADC_ATTEN_DB_11);  // Same range as analogRead()
+  i2s_set_adc_mode(ADC_UNIT_1, WAV_CAPTURE_ADC_CHANNEL);
+  i2s_adc_enable(WAV_CAPTURE_I2S_PORT);
+
+  _capture->reset();
+  _capture->setSampleRate(sample_rate);
+  _running = true;
+  
+  if (_task == NULL)
+  {
+    if (xTaskCreatePinnedToCore(captureTask, "capture", WAV_CAPTURE_TASK_STACK, this, 2, &_task, WAV_CAPTURE_TASK_CORE) != pdPASS)
+    {
+      Serial.println(F("Unable to start capture task!"));
+      _task = NULL;
+      end();
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * Stops capturing and releases I2S0 so it can be used for playback.
+ */
+void WAV_capture_i2s::end()
+{
+  if (!_running) return;
+  
+  _running = false;
+  while (_busy) delay(1);  // Let the task finish its current read
+
+  i2s_adc_disable(WAV_CAPTURE_I2S_PORT);
+  i2s_driver_uninstall(WAV_CAPTURE_I2S_PORT);
+}
+
+bool WAV_capture_i2s::getRunning()
+{
+  return _running;
+}
+
+/*
+ * Reads DMA blocks while capture is running.  The task is kept when capture 
+ * stops so playback does not have to recreate it.
+ */
+void WAV_capture_i2s::captureTask(void *param)
+{
+  WAV_capture_i2s *source = (WAV_capture_i2s *)param;
+
+  while (true)
+  {
+    source->_busy = true;
+    if (source->_running)
+    {
+      source->readBlock();
+      source->_busy = false;
+    }
+    else
+    {
+      source->_busy = false;
+      vTaskDelay(10 / portTICK_PERIOD_MS);
+    }
+  }
+}
+
+/*
+ * Fills one WAV_capture block from the DMA buffers and converts the raw ADC words.
+ */
+void WAV_capture_i2s::readBlock()
+{
+  int16_t *block = _capture->getWriteBlock();
+  uint8_t *dest = (uint8_t *)block;
+  size_t   block_bytes = WAV_CAPTURE_BLOCK * sizeof(int16_t);
+  size_t   total = 0;
+  size_t   bytes_read;
+
+  while (total < block_bytes)
+  {
+    bytes_read = 0;
+    i2s_read(WAV_CAPTURE_I2S_PORT, dest + total, block_bytes - total, &bytes_read, WAV_CAPTURE_TIMEOUT_MS / portTICK_PERIOD_MS);
+    total += bytes_read;
+    if (!_running) return;  // Stopped part way through, the block is not committed
+  }
+  uint32_t time_us = micros();  // The DMA has just delivered the last sample
+
+  // Each 32-bit DMA word holds two 16-bit samples in swapped order.
+  // The upper 4 bits of each sample are the ADC channel number.
+  for (uint16_t i = 0; i < WAV_CAPTURE_BLOCK; i += 2)
+  {
+    uint16_t first  = (uint16_t)block[i + 1] & 0x0FFF;
+    uint16_t second = (uint16_t)block[i] & 0x0FFF;
+    block[i]     = (int16_t)first - MIC_OFFSET;
+    block[i + 1] = (int16_t)second - MIC_OFFSET;
+  }
+  
+  _capture->commitBlock(time_us);
+}
@@ -0,0 +1,42 @@
+#ifndef _WAV_CAPTURE_I2S_
+#define _WAV_CAPTURE_I2S_
+
+#include <Arduino.h>
+#include "driver/i2s.h"
+#include "driver/adc.h"
+#include "esp32_r4ge_pro.h"
+#include "WAV_capture.h"
+
+#define WAV_CAPTURE_I2S_PORT    I2S_NUM_0       // Built-in ADC mode only works on I2S0
+#define WAV_CAPTURE_ADC_CHANNEL ADC1_CHANNEL_7  // GPIO 35 (MIC)
+#define WAV_CAPTURE_DMA_BUFS    4
+#define WAV_CAPTURE_TASK_STACK  2048
+#define WAV_CAPTURE_TASK_CORE   0               // Arduino loop() runs on core 1
+#define WAV_CAPTURE_TIMEOUT_MS  100
+
+/*
+ * Microphone source for WAV_capture using the I2S peripheral in built-in ADC mode.
+ * The ADC is clocked by the I2S sample clock and DMA'd into memory, so the 
+ * sample rate is exact and capture never stops for the UI.
+ * A task on core 0 waits for DMA blocks and commits them to the WAV_capture ring.
+ * I2S0 is also used for the speaker, so end() must be called before playing audio.
+ */
+class WAV_capture_i2s
+{
+  public:
+    WAV_capture_i2s();
+    bool begin(WAV_capture *capture, uint32_t sample_rate);
+    void end();
+    bool getRunning();
+
+  private:
+    static void captureTask(void *param);
+    void readBlock();
+
+    WAV_capture  *_capture = NULL;
+    TaskHandle_t  _task = NULL;
+    volatile bool _running = false;
+    volatile bool _busy = false;  // Task is reading from the I2S driver
+};
+
+#endif // _WAV_CAPTURE_I2S_
@@ -0,0 +1,222 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "WAV_conv.h"
+
+WAV_conv::WAV_conv()
+{
+  reset();
+}
+
+WAV_conv::~WAV_conv()
+{
+  unload();
+}
+
+/*
+ * Allocates the partitions for an IR of up to taps taps (at most WAV_CONV_MAX_TAPS),
+ * ready for addTaps().  Any previous IR is unloaded.
+ * Returns false if the IR is too long or there is not enough memory.
+ */
+bool WAV_conv::beginIR(uint32_t taps)
+{
+  unload();
+  if (taps == 0 || taps > WAV_CONV_MAX_TAPS) return false;
+
+  uint16_t parts = (taps + WAV_CONV_BLOCK - 1) / WAV_CONV_BLOCK;
+  size_t   bytes = sizeof(float) * WAV_FFT_BINS * parts;
+
+  _ir_real  = (float *)malloc(bytes);
+  _ir_imag  = (float *)malloc(bytes);
+  _fdl_real = (float *)malloc(bytes);
+  _fdl_imag = (float *)malloc(bytes);
+  if (_ir_real == NULL || _ir_imag == NULL || _fdl_real == NULL || _fdl_imag == NULL)
+  {
+    unload();
+    return false;
+  }
+
+  _parts = parts;
+  _taps = 0;
+  _energy = 0;
+  return true;
+}
+
+/*
+ * Adds the next taps of the IR, for example as they are read from the SD card.
+ * Each full partition is transformed as soon as it is complete.
+ * Returns false if there are more taps than beginIR() allowed for.
+ */
+bool WAV_conv::addTaps(const float *taps, uint16_t count)
+{
+  if (_parts == 0 || _loaded) return false;
+
+  for (uint16_t i = 0; i < count; i++)
+  {
+    if (_taps >= (uint32_t)_parts * WAV_CONV_BLOCK) return false;
+
+    _frame[_taps % WAV_CONV_BLOCK] = taps[i];
+    _energy += taps[i] * taps[i];
+    _taps++;
+    if (_taps % WAV_CONV_BLOCK == 0) transformPart();
+  }
+  return true;
+}
+
+/*
+ * Transforms the last partial partition and starts convolving.  With normalize
+ * the IR is scaled to unit energy, so white noise comes out at the level it went in.
+ */
+void WAV_conv::endIR(bool normalize)
+{
+  if (_parts == 0 || _taps == 0 || _loaded) return;
+
+  if (_taps % WAV_CONV_BLOCK != 0)
+  {
+    for (uint16_t i = _taps % WAV_CONV_BLOCK; i < WAV_CONV_BLOCK; i++) _frame[i] = 0;
+    transformPart();
+  }
+  _parts = (_taps + WAV_CONV_BLOCK - 1) / WAV_CONV_BLOCK;
+
+  if (normalize && _energy > 0)
+  {
+    float gain = 1.0f / sqrtf(_energy);
+    for (uint32_t i = 0; i < (uint32_t)WAV_FFT_BINS * _parts; i++)
+    {
+      _ir_real[i] *= gain;
+      _ir_imag[i] *= gain;
+    }
+  }
+
+  reset();
+  _loaded = true;
+}
+
+/*
+ * Frees the IR.  process() passes audio through unchanged until another is loaded.
+ */
+void WAV_conv::unload()
+{
+  _loaded = false;
+  free(_ir_real);
+  free(_ir_imag);
+  free(_fdl_real);
+  free(_fdl_imag);
+  _ir_real = _ir_imag = _fdl_real = _fdl_imag = NULL;
+  _parts = 0;
+  _taps = 0;
+}
+
+/*
+ * Clears the delay line and the block being filled, e.g. before playing another file.
+ */
+void WAV_conv::reset()
+{
+  memset(_input, 0, sizeof(_input));
+  memset(_output, 0, sizeof(_output));
+  if (_fdl_real != NULL)
+  {
+    memset(_fdl_real, 0, sizeof(float) * WAV_FFT_BINS * _parts);
+    memset(_fdl_imag, 0, sizeof(float) * WAV_FFT_BINS * _parts);
+  }
+  _fdl_pos = 0;
+  _fill = 0;
+}
+
+/*
+ * Sets the share of the convolved signal, 0 (dry) to 1 (wet only).
+ * The dry signal is delayed to line up with the wet one.
+ */
+void WAV_conv::setMix(float wet)
+{
+  _wet = (wet < 0 ? 0 : (wet > 1 ? 1 : wet));
+}
+
+/*
+ * Convolves samples in place.  Any count can be passed, the output is one
+ * WAV_CONV_BLOCK behind the input.  Passes samples through if no IR is loaded.
+ */
+void WAV_conv::process(int16_t *samples, uint16_t count)
+{
+  if (!_loaded) return;
+
+  for (uint16_t i = 0; i < count; i++)
+  {
+    // _input[_fill] is the dry sample of the previous block, which _output[_fill] belongs to
+    float out = _output[_fill] * _wet + _input[_fill] * (1 - _wet);
+    _input[WAV_CONV_BLOCK + _fill] = samples[i];
+    samples[i] = (out >= 32767 ? 32767 : (out <= -32768 ? -32768 : (int16_t)lrintf(out)));
+
+    if (++_fill >= WAV_CONV_BLOCK)
+    {
+      processBlock();
+      _fill = 0;
+    }
+  }
+}
+
+bool WAV_conv::getLoaded()
+{
+  return _loaded;
+}
+
+uint32_t WAV_conv::getTapCount()
+{
+  return _taps;
+}
+
+uint16_t WAV_conv::getPartCount()
+{
+  return _parts;
+}
+
+//----- PRIVATE METHODS -----//
+
+/*
+ * Convolves the last two input blocks with the whole IR, and keeps the second
+ * half of the circular result, which has no wrap around.
+ */
+void WAV_conv::processBlock()
+{
+  float *new_real = &_fdl_real[_fdl_pos * WAV_FFT_BINS];
+  float *new_imag = &_fdl_imag[_fdl_pos * WAV_FFT_BINS];
+
+  _fft.realForward(_input, new_real, new_imag);
+  memset(_acc_real, 0, sizeof(_acc_real));
+  memset(_acc_imag, 0, sizeof(_acc_imag));
+
+  // Partition k meets the input spectrum from k blocks ago
+  uint16_t slot = _fdl_pos;
+  for (uint16_t k = 0; k < _parts; k++)
+  {
+    const float *xr = &_fdl_real[slot * WAV_FFT_BINS];
+    const float *xi = &_fdl_imag[slot * WAV_FFT_BINS];
+    const float *hr = &_ir_real[k * WAV_FFT_BINS];
+    const float *hi = &_ir_imag[k * WAV_FFT_BINS];
+
+    for (uint16_t b = 0; b < WAV_FFT_BINS; b++)
+    {
+      _acc_real[b] += xr[b] * hr[b] - xi[b] * hi[b];
+      _acc_imag[b] += xr[b] * hi[b] + xi[b] * hr[b];
+    }
+    slot = (slot == 0 ? _parts - 1 : slot - 1);
+  }
+  _fdl_pos = (_fdl_pos + 1 == _parts ? 0 : _fdl_pos + 1);
+
+  _fft.realInverse(_acc_real, _acc_imag, _frame);
+  memcpy(_output, &_frame[WAV_CONV_BLOCK], sizeof(_output));
+
+  // This block is the previous one next time
+  memcpy(_input, &_input[WAV_CONV_BLOCK], sizeof(float) * WAV_CONV_BLOCK);
+}
+
+/*
+ * Zero pads the partition in the first half of _frame and stores its spectrum.
+ */
+void WAV_conv::transformPart()
+{
+  uint16_t part = (_taps - 1) / WAV_CONV_BLOCK;
+
+  memset(&_frame[WAV_CONV_BLOCK], 0, sizeof(float) * WAV_CONV_BLOCK);
+  _fft.realForward(_frame, &_ir_real[part * WAV_FFT_BINS], &_ir_imag[part * WAV_FFT_BINS]);
+}
@@ -0,0 +1,65 @@
+#ifndef _WAV_CONV_
+#define _WAV_CONV_
+
+#include <stdint.h>
+#include "WAV_fft.h"
+
+#define WAV_CONV_BLOCK       (WAV_FFT_SIZE / 2)  // Samples per partition and per processed block
+#define WAV_CONV_MAX_PARTS   16  // Longest IR, 4096 taps (~370 msec at 11025 Hz, ~93 msec at 44100 Hz)
+#define WAV_CONV_MAX_TAPS    (WAV_CONV_BLOCK * WAV_CONV_MAX_PARTS)
+
+/*
+ * Uniformly partitioned overlap-save convolution, for applying an impulse
+ * response (room reverb, speaker cabinet) to audio as it plays.
+ * The IR is cut into WAV_CONV_BLOCK tap partitions, and each is kept as the
+ * spectrum of a zero padded WAV_FFT_SIZE frame.  Every WAV_CONV_BLOCK input
+ * samples, the last two blocks are transformed once and put in a frequency
+ * domain delay line.  Each IR partition is multiplied with the input spectrum
+ * from that many blocks ago, the products are summed and one inverse transform
+ * gives the next output block.  So the cost of a block is two FFTs plus one
+ * complex multiply-add per bin per partition, however long the IR is, and
+ * there is one block of latency.
+ * The IR and delay line are allocated by beginIR().  Do not change the IR while
+ * another task is calling process().
+ * No Arduino dependencies, so it also builds on the host for benchmarking.
+ */
+class WAV_conv
+{
+  public:
+    WAV_conv();
+    ~WAV_conv();
+    bool     beginIR(uint32_t taps);
+    bool     addTaps(const float *taps, uint16_t count);
+    void     endIR(bool normalize);
+    void     unload();
+    void     reset();
+    void     setMix(float wet);
+    void     process(int16_t *samples, uint16_t count);
+    bool     getLoaded();
+    uint32_t getTapCount();
+    uint16_t getPartCount();
+
+  private:
+    void     processBlock();
+    void     transformPart();
+
+    WAV_fft  _fft;
+    float   *_ir_real = NULL;        // IR partition spectra, WAV_FFT_BINS per partition
+    float   *_ir_imag = NULL;
+    float   *_fdl_real = NULL;       // Frequency domain delay line of input spectra
+    float   *_fdl_imag = NULL;
+    float    _input[WAV_FFT_SIZE];   // Previous block, then the block being filled
+    float    _frame[WAV_FFT_SIZE];   // Transform input and output
+    float    _acc_real[WAV_FFT_BINS];
+    float    _acc_imag[WAV_FFT_BINS];
+    float    _output[WAV_CONV_BLOCK];
+    float    _energy = 0;            // Sum of the squared taps, for normalizing
+    float    _wet = 1.0;
+    uint32_t _taps = 0;              // Taps added so far
+    uint16_t _parts = 0;             // Partitions allocated
+    uint16_t _fdl_pos = 0;           // Newest spectrum in the delay line
+    uint16_t _fill = 0;              // Samples in the current input block
+    volatile bool _loaded = false;
+};
+
+#endif // _WAV_CONV_
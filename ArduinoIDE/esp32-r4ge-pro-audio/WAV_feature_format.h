@@ -0,0 +1,71 @@
+#ifndef _WAV_FEATURE_FORMAT_
+#define _WAV_FEATURE_FORMAT_
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Binary feature file:  a 32 byte header, then fixed size frame records.
+ * Frame n is at WAV_FEAT_HEADER_SIZE + n * record_bytes, so files can be appended
+ * to while recording and read on the host by mapping the file and indexing it,
+ * with no parsing.  All values are little endian, as on the ESP32 and x86/ARM hosts.
+ * frame_cnt is patched in when the file is closed.  If it is 0 (the badge was
+ * reset while recording) the frames are counted from the file size.
+ * No Arduino dependencies, so the host tools use the same definitions.
+ */
+
+#define WAV_FEAT_MAGIC        "WFEA"
+#define WAV_FEAT_VERSION           1
+#define WAV_FEAT_HEADER_SIZE      32  // sizeof(wav_feature_header_t)
+#define WAV_FEAT_MAX_COEFS       512  // Largest record, e.g. 256 DFT bins as re, im pairs
+
+enum wav_feat_kind
+{
+  WAV_FEAT_KIND_MFCC,     // WAV_MFCC_COEF_CNT cepstral coefficients, c0 first
+  WAV_FEAT_KIND_POWER,    // Power spectrum bins, DC first
+  WAV_FEAT_KIND_DFT       // Complex spectrum bins as re, im pairs, DC first
+};
+
+enum wav_feat_dtype
+{
+  WAV_FEAT_FLOAT32,       // 4 bytes per coefficient
+  WAV_FEAT_INT16          // 2 bytes per coefficient, value = q * scale
+};
+
+typedef struct
+{
+  char     magic[4];      // WAV_FEAT_MAGIC
+  uint16_t version;       // WAV_FEAT_VERSION
+  uint8_t  kind;          // wav_feat_kind
+  uint8_t  dtype;         // wav_feat_dtype
+  uint32_t sample_rate;   // Of the audio the features were taken from
+  uint32_t frame_size;    // Samples per frame
+  uint32_t frame_stride;  // Samples between the starts of frames
+  uint16_t coef_cnt;      // Coefficients per frame record
+  uint16_t record_bytes;  // coef_cnt * 4 for WAV_FEAT_FLOAT32, coef_cnt * 2 for WAV_FEAT_INT16
+  float    scale;         // WAV_FEAT_INT16 step size, 1 for WAV_FEAT_FLOAT32
+  uint32_t frame_cnt;     // Frame records in the file, 0 if it was not closed
+} wav_feature_header_t;
+
+static_assert(sizeof(wav_feature_header_t) == WAV_FEAT_HEADER_SIZE, "Feature header must be packed");
+
+/*
+ * Checks a header read from the start of a file of file_bytes bytes, and
+ * returns the number of complete frame records in it.
+ * Returns false if it is not a feature file this version can read.
+ */
+inline bool wavFeatureCheck(const wav_feature_header_t *header, uint32_t file_bytes, uint32_t *frame_cnt)
+{
+  uint16_t coef_bytes = (header->dtype == WAV_FEAT_INT16 ? 2 : 4);
+
+  if (file_bytes < WAV_FEAT_HEADER_SIZE || memcmp(header->magic, WAV_FEAT_MAGIC, 4) != 0) return false;
+  if (header->version != WAV_FEAT_VERSION || header->dtype > WAV_FEAT_INT16) return false;
+  if (header->coef_cnt == 0 || header->coef_cnt > WAV_FEAT_MAX_COEFS) return false;
+  if (header->record_bytes != header->coef_cnt * coef_bytes) return false;
+
+  uint32_t records = (file_bytes - WAV_FEAT_HEADER_SIZE) / header->record_bytes;
+  *frame_cnt = (header->frame_cnt > 0 && header->frame_cnt <= records ? header->frame_cnt : records);
+  return true;
+}
+
+#endif // _WAV_FEATURE_FORMAT_
@@ -0,0 +1,198 @@
+#include "WAV_features.h"
+
+WAV_features::WAV_features()
+{
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+/*
+ * Creates the feature file and writes the header into the first buffer.
+ * scale is the step size of WAV_FEAT_INT16 values, and is ignored for WAV_FEAT_FLOAT32.
+ * Returns true on success, false on failure.
+ */
+bool WAV_features::begin(const char *filename, wav_feat_kind kind, wav_feat_dtype dtype, uint32_t sample_rate,
+                         uint32_t frame_size, uint32_t frame_stride, uint16_t coef_cnt, float scale)
+{
+  if (_writing) end();
+
+  if (coef_cnt == 0 || coef_cnt > WAV_FEAT_MAX_COEFS || (dtype == WAV_FEAT_INT16 && scale <= 0))
+  {
+    Serial.println(F("Invalid feature file settings!"));
+    return false; // failure
+  }
+
+  _file = SD.open(filename, FILE_WRITE);
+  if (!_file)
+  {
+    Serial.println(F("Error creating feature file!"));
+    return false; // failure
+  }
+
+  memset(&_stats, 0, sizeof(_stats));
+  for (uint8_t i = 0; i < WAV_FEAT_BUFFERS; i++)
+  {
+    _full[i] = false;
+  }
+  _fill_idx = 0;
+  _write_idx = 0;
+  _added = 0;
+
+  memset(&_header, 0, sizeof(_header));
+  memcpy(_header.magic, WAV_FEAT_MAGIC, 4);
+  _header.version = WAV_FEAT_VERSION;
+  _header.kind = kind;
+  _header.dtype = dtype;
+  _header.sample_rate = sample_rate;
+  _header.frame_size = frame_size;
+  _header.frame_stride = frame_stride;
+  _header.coef_cnt = coef_cnt;
+  _header.record_bytes = coef_cnt * (dtype == WAV_FEAT_INT16 ? 2 : 4);
+  _header.scale = (dtype == WAV_FEAT_INT16 ? scale : 1.0);
+  _header.frame_cnt = 0;  // Patched by end()
+
+  memcpy(_buffer[0], &_header, WAV_FEAT_HEADER_SIZE);
+  _fill_len = WAV_FEAT_HEADER_SIZE;
+
+  _writing = true;
+  return true;
+}
+
+/*
+ * Adds a frame of coef_cnt values to the buffers.  Does not touch the card, so it can
+ * be called from a capture subscriber.  If there is no room for the whole record the
+ * frame is dropped and counted as an overrun, so later records stay aligned.
+ * Returns true if the frame was added.
+ */
+bool WAV_features::addFrame(const float *coefs)
+{
+  if (!_writing) return false;
+
+  uint16_t next_idx = (_fill_idx + 1) & (WAV_FEAT_BUFFERS - 1);
+  uint32_t room = (_full[_fill_idx] ? 0 : WAV_FEAT_BUFFER_SIZE - _fill_len);
+  if (room > 0 && !_full[next_idx] && next_idx != _fill_idx) room += WAV_FEAT_BUFFER_SIZE;
+
+  if (room < _header.record_bytes)
+  {
+    _stats.overruns++;
+    return false;
+  }
+
+  for (uint16_t c = 0; c < _header.coef_cnt; c++)
+  {
+    uint8_t bytes[4];
+    uint8_t len;
+
+    if (_header.dtype == WAV_FEAT_INT16)
+    {
+      float   q = coefs[c] / _header.scale;
+      int16_t value = (q >= 32767 ? 32767 : (q <= -32768 ? -32768 : (int16_t)lroundf(q)));
+      memcpy(bytes, &value, 2);
+      len = 2;
+    }
+    else
+    {
+      memcpy(bytes, &coefs[c], 4);
+      len = 4;
+    }
+
+    for (uint8_t i = 0; i < len; i++)
+    {
+      _buffer[_fill_idx][_fill_len++] = bytes[i];
+      if (_fill_len >= WAV_FEAT_BUFFER_SIZE)
+      {
+        _full[_fill_idx] = true;
+        _fill_idx = (_fill_idx + 1) & (WAV_FEAT_BUFFERS - 1);
+        _fill_len = 0;
+      }
+    }
+  }
+  _added++;
+  return true;
+}
+
+/*
+ * Writes any full buffers to the card.  Call from loop().
+ * Returns false if a write failed (usually a full card) and the file was closed.
+ */
+bool WAV_features::update()
+{
+  if (!_writing) return true;
+
+  while (_full[_write_idx])
+  {
+    if (!writeBuffer(_write_idx, WAV_FEAT_BUFFER_SIZE))
+    {
+      Serial.println(F("Feature file stopped, SD write failed!"));
+      end();
+      return false;
+    }
+    _full[_write_idx] = false;
+    _write_idx = (_write_idx + 1) & (WAV_FEAT_BUFFERS - 1);
+  }
+  return true;
+}
+
+/*
+ * Writes the remaining frames, patches the frame count and closes the file.
+ * Returns true on success, false on failure.
+ */
+bool WAV_features::end()
+{
+  bool success = true;
+
+  if (!_writing) return false;
+  _writing = false;
+
+  // Any full buffers first, then the partial fill buffer
+  while (_full[_write_idx] && success)
+  {
+    success = writeBuffer(_write_idx, WAV_FEAT_BUFFER_SIZE);
+    _full[_write_idx] = false;
+    _write_idx = (_write_idx + 1) & (WAV_FEAT_BUFFERS - 1);
+  }
+  if (success && _fill_len > 0)
+  {
+    success = writeBuffer(_fill_idx, _fill_len);
+  }
+
+  success = patchHeader() && success;
+  _file.close();
+  return success;
+}
+
+bool WAV_features::getWriting()
+{
+  return _writing;
+}
+
+void WAV_features::getStats(wav_features_stats_t *stats)
+{
+  *stats = _stats;
+}
+
+bool WAV_features::writeBuffer(uint8_t idx, uint16_t len)
+{
+  uint32_t start_us = micros();
+  size_t   bytes_written = _file.write(_buffer[idx], len);
+  uint32_t elapsed_us = micros() - start_us;
+
+  _stats.writes++;
+  if (elapsed_us > _stats.max_write_us) _stats.max_write_us = elapsed_us;
+
+  if (bytes_written != len) return false;
+
+  _stats.bytes += len;
+  _stats.frames = (_stats.bytes - WAV_FEAT_HEADER_SIZE) / _header.record_bytes;
+  return true;
+}
+
+/*
+ * Writes the number of complete frame records into the header.
+ */
+bool WAV_features::patchHeader()
+{
+  _header.frame_cnt = _stats.frames;
+
+  if (!_file.seek(0)) return false;
+  return _file.write((uint8_t *)&_header, WAV_FEAT_HEADER_SIZE) == WAV_FEAT_HEADER_SIZE;
+}
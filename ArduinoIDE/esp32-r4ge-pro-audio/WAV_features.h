@@ -0,0 +1,55 @@
+#ifndef _WAV_FEATURES_
+#define _WAV_FEATURES_
+
+#include <SD.h>
+#include "WAV_feature_format.h"
+
+#define WAV_FEAT_BUFFER_SIZE  4096  // Bytes per buffer.  A multiple of the 512 byte SD sector
+#define WAV_FEAT_BUFFERS         2  // Must be power of 2
+
+typedef struct
+{
+  uint32_t frames;        // Frame records written to the file
+  uint32_t bytes;         // Bytes written, including the header
+  uint32_t writes;        // Buffer writes
+  uint32_t max_write_us;  // Slowest buffer write
+  uint32_t overruns;      // Frames dropped because every buffer was waiting to be written
+} wav_features_stats_t;
+
+/*
+ * Streams feature frames to a binary feature file (see WAV_feature_format.h) on the SD card.
+ * Works like WAV_recorder:  frames are added to one buffer while the other waits for
+ * update() to write it, so the live pipeline never waits on the card, and every
+ * write is a full WAV_FEAT_BUFFER_SIZE.  Records may straddle two buffers.
+ * int16 files quantize each value to the nearest step of the scale.
+ * The frame count is patched into the header by end().
+ */
+class WAV_features
+{
+  public:
+    WAV_features();
+    bool begin(const char *filename, wav_feat_kind kind, wav_feat_dtype dtype, uint32_t sample_rate,
+               uint32_t frame_size, uint32_t frame_stride, uint16_t coef_cnt, float scale = 1.0);
+    bool addFrame(const float *coefs);
+    bool update();
+    bool end();
+    bool getWriting();
+    void getStats(wav_features_stats_t *stats);
+
+  private:
+    bool writeBuffer(uint8_t idx, uint16_t len);
+    bool patchHeader();
+
+    File     _file;
+    uint8_t  _buffer[WAV_FEAT_BUFFERS][WAV_FEAT_BUFFER_SIZE];
+    bool     _full[WAV_FEAT_BUFFERS];
+    uint8_t  _fill_idx = 0;   // Buffer frames are being added to
+    uint8_t  _write_idx = 0;  // Next buffer to write to the card
+    uint16_t _fill_len = 0;   // Bytes in the fill buffer
+    uint32_t _added = 0;      // Frames added to the buffers
+    bool     _writing = false;
+    wav_feature_header_t _header;
+    wav_features_stats_t _stats;
+};
+
+#endif // _WAV_FEATURES_
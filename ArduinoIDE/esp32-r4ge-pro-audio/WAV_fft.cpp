@@ -0,0 +1,179 @@
+#include <math.h>
+#include "WAV_fft.h"
+
+float WAV_fft::_cos[WAV_FFT_SIZE / 2];
+float WAV_fft::_sin[WAV_FFT_SIZE / 2];
+float WAV_fft::_hann[WAV_FFT_SIZE];
+bool  WAV_fft::_tables_ready = false;
+
+WAV_fft::WAV_fft()
+{
+  initTables();
+}
+
+/*
+ * Forward FFT of WAV_FFT_SIZE real samples.
+ * Packs the even/odd samples into a half size complex transform, then splits 
+ * the result, so it costs about half of a complex FFT of the same size.
+ * Writes WAV_FFT_BINS outputs (DC through Nyquist).  The upper bins of a real 
+ * input are the complex conjugates of these.
+ */
+void WAV_fft::realForward(const float *input, float *out_real, float *out_imag)
+{
+  const uint16_t half = WAV_FFT_SIZE / 2;
+
+  for (uint16_t k = 0; k < half; k++)
+  {
+    _work_real[k] = input[2 * k];
+    _work_imag[k] = input[2 * k + 1];
+  }
+
+  transform(_work_real, _work_imag, half);
+
+  // DC and Nyquist are purely real
+  out_real[0]    = _work_real[0] + _work_imag[0];
+  out_imag[0]    = 0;
+  out_real[half] = _work_real[0] - _work_imag[0];
+  out_imag[half] = 0;
+
+  for (uint16_t k = 1; k < half; k++)
+  {
+    float ar = _work_real[k],        ai = _work_imag[k];
+    float br = _work_real[half - k], bi = _work_imag[half - k];
+
+    // Even and odd sample spectra
+    float even_r = (ar + br) * 0.5f;
+    float even_i = (ai - bi) * 0.5f;
+    float odd_r  = (ai + bi) * 0.5f;
+    float odd_i  = (br - ar) * 0.5f;
+
+    // X[k] = even + W^k * odd, W = exp(-2*pi*i/N)
+    out_real[k] = even_r + _cos[k] * odd_r + _sin[k] * odd_i;
+    out_imag[k] = even_i + _cos[k] * odd_i - _sin[k] * odd_r;
+  }
+}
+
+/*
+ * Inverse of realForward().  Takes WAV_FFT_BINS bins (DC through Nyquist) of a 
+ * real signal and writes its WAV_FFT_SIZE samples, scaled by 1/N so that 
+ * forward then inverse returns the input.
+ * Rebuilds the even/odd sample spectra and runs one half size complex transform.
+ */
+void WAV_fft::realInverse(const float *in_real, const float *in_imag, float *output)
+{
+  const uint16_t half = WAV_FFT_SIZE / 2;
+  const float scale = 1.0f / half;
+
+  for (uint16_t k = 0; k < half; k++)
+  {
+    float ar = in_real[k],        ai = in_imag[k];
+    float br = in_real[half - k], bi = -in_imag[half - k];  // conj(X[N/2 - k])
+
+    // even = (X[k] + conj(X[N/2 - k])) / 2,  odd = (X[k] - conj(X[N/2 - k])) / (2 W^k)
+    float even_r = (ar + br) * 0.5f;
+    float even_i = (ai + bi) * 0.5f;
+    float diff_r = (ar - br) * 0.5f;
+    float diff_i = (ai - bi) * 0.5f;
+    float odd_r  = diff_r * _cos[k] - diff_i * _sin[k];
+    float odd_i  = diff_r * _sin[k] + diff_i * _cos[k];
+
+    // z = even + i * odd, conjugated so the forward transform runs the inverse
+    _work_real[k] =  (even_r - odd_i);
+    _work_imag[k] = -(even_i + odd_r);
+  }
+
+  transform(_work_real, _work_imag, half);
+
+  for (uint16_t n = 0; n < half; n++)
+  {
+    output[2 * n]     =  _work_real[n] * scale;
+    output[2 * n + 1] = -_work_imag[n] * scale;
+  }
+}
+
+/*
+ * In-place forward FFT of WAV_FFT_SIZE complex samples.
+ */
+void WAV_fft::complexForward(float *real, float *imag)
+{
+  transform(real, imag, WAV_FFT_SIZE);
+}
+
+/*
+ * Returns the WAV_FFT_SIZE point Hann window table.
+ */
+const float *WAV_fft::getHannWindow()
+{
+  initTables();
+  return _hann;
+}
+
+/*
+ * Calculates the shared twiddle and window tables on first use.
+ */
+void WAV_fft::initTables()
+{
+  if (_tables_ready) return;
+
+  for (uint16_t k = 0; k < WAV_FFT_SIZE / 2; k++)
+  {
+    double angle = 2.0 * M_PI * k / WAV_FFT_SIZE;
+    _cos[k] = (float)cos(angle);
+    _sin[k] = (float)sin(angle);
+  }
+
+  for (uint16_t i = 0; i < WAV_FFT_SIZE; i++)
+  {
+    _hann[i] = (float)(0.5 - 0.5 * cos(2.0 * M_PI * i / WAV_FFT_SIZE));
+  }
+
+  _tables_ready = true;
+}
+
+/*
+ * Iterative radix-2 decimation in time FFT.
+ * n must be a power of 2 no larger than WAV_FFT_SIZE, the twiddle table is 
+ * strided for smaller sizes.
+ */
+void WAV_fft::transform(float *real, float *imag, uint16_t n)
+{
+  // Bit reversal permutation
+  for (uint16_t i = 1, j = 0; i < n; i++)
+  {
+    uint16_t bit = n >> 1;
+    for (; j & bit; bit >>= 1) j ^= bit;
+    j ^= bit;
+
+    if (i < j)
+    {
+      float temp = real[i]; real[i] = real[j]; real[j] = temp;
+      temp = imag[i]; imag[i] = imag[j]; imag[j] = temp;
+    }
+  }
+
+  // Butterflies
+  for (uint16_t len = 2; len <= n; len <<= 1)
+  {
+    uint16_t half_len = len >> 1;
+    uint16_t stride = WAV_FFT_SIZE / len;
+
+    for (uint16_t start = 0; start < n; start += len)
+    {
+      for (uint16_t k = 0; k < half_len; k++)
+      {
+        float wr =  _cos[k * stride];
+        float wi = -_sin[k * stride];
+        uint16_t a = start + k;
+        uint16_t b = a + half_len;
+
+        float tr = real[b] * wr - imag[b] * wi;
+        float ti = real[b] * wi + imag[b] * wr;
+
+        real[b] = real[a] - tr;
+        imag[b] = imag[a] - ti;
+        real[a] += tr;
+        imag[a] += ti;
+      }
+    }
+  }
+}
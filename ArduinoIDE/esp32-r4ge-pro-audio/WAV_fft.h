@@ -0,0 +1,37 @@
+#ifndef _WAV_FFT_
+#define _WAV_FFT_
+
+#include <stdint.h>
+
+#define WAV_FFT_SIZE   512  // Must be a power of 2, matches WAV_FRAME_SIZE and DFT_FRAME_SIZE
+#define WAV_FFT_BINS   (WAV_FFT_SIZE / 2 + 1)  // Real input bins, DC through Nyquist
+
+/*
+ * Radix-2 FFT in single precision float.
+ * The twiddle and Hann window tables are static, so they are calculated once 
+ * and shared by every WAV_fft instance (WAV_frame and DFT).
+ * No Arduino dependencies, so it also builds on the host for benchmarking.
+ */
+class WAV_fft
+{
+  public:
+    WAV_fft();
+    void  realForward(const float *input, float *out_real, float *out_imag);
+    void  realInverse(const float *in_real, const float *in_imag, float *output);
+    void  complexForward(float *real, float *imag);
+    static const float *getHannWindow();
+
+  private:
+    static void  initTables();
+    static void  transform(float *real, float *imag, uint16_t n);
+
+    static float _cos[WAV_FFT_SIZE / 2];   // cos(2*pi*k/N)
+    static float _sin[WAV_FFT_SIZE / 2];   // sin(2*pi*k/N)
+    static float _hann[WAV_FFT_SIZE];
+    static bool  _tables_ready;
+
+    float _work_real[WAV_FFT_SIZE / 2];    // Packed even/odd samples for the half size transform
+    float _work_imag[WAV_FFT_SIZE / 2];
+};
+
+#endif // _WAV_FFT_
@@ -0,0 +1,250 @@
+#include <math.h>
+#include <stdlib.h>
+#include "WAV_fft_q15.h"
+
+int16_t  WAV_fft_q15::_cos[WAV_FFT_SIZE / 2];
+int16_t  WAV_fft_q15::_sin[WAV_FFT_SIZE / 2];
+int16_t  WAV_fft_q15::_hann[WAV_FFT_SIZE];
+uint16_t WAV_fft_q15::_bitrev[WAV_FFT_SIZE / 2];
+bool     WAV_fft_q15::_tables_ready = false;
+
+// Q15 multiply with rounding
+#define Q15_MUL(a, b)  ((int16_t)(((int32_t)(a) * (b) + 16384) >> 15))
+
+WAV_fft_q15::WAV_fft_q15()
+{
+  initTables();
+}
+
+/*
+ * Hann windows and transforms WAV_FFT_SIZE real samples.
+ * Writes WAV_FFT_BINS outputs (DC through Nyquist).
+ * Returns the block exponent: the true spectrum is out * 2^exponent, 
+ * in the same units as the unwindowed float FFT of the windowed input.
+ */
+int8_t WAV_fft_q15::realForward(const int16_t *input, int16_t *out_real, int16_t *out_imag)
+{
+  const uint16_t half = WAV_FFT_SIZE / 2;
+  int32_t peak = 0;
+  int8_t  shift = 15;
+
+  // Normalize the windowed input (x * w in Q15) so the block uses the available headroom
+  for (uint16_t i = 0; i < WAV_FFT_SIZE; i++)
+  {
+    int32_t value = abs((int32_t)input[i] * _hann[i]);
+    if (value > peak) peak = value;
+  }
+  if (peak > 0)
+  {
+    while ((peak >> shift) >= WAV_FFT_Q15_HEADROOM) shift++;
+    while (shift > 0 && (peak >> (shift - 1)) < WAV_FFT_Q15_HEADROOM) shift--;
+  }
+
+  for (uint16_t k = 0; k < half; k++)
+  {
+    _work_real[k] = (int16_t)(((int32_t)input[2 * k] * _hann[2 * k]) >> shift);
+    _work_imag[k] = (int16_t)(((int32_t)input[2 * k + 1] * _hann[2 * k + 1]) >> shift);
+  }
+
+  int8_t exponent = transform(_work_real, _work_imag, half) + shift - 15;
+
+  // Keep the split below overflow: even + W * odd can reach (1 + sqrt(2)) times the input
+  exponent += scaleToHeadroom(_work_real, _work_imag, half);
+
+  out_real[0]    = _work_real[0] + _work_imag[0];
+  out_imag[0]    = 0;
+  out_real[half] = _work_real[0] - _work_imag[0];
+  out_imag[half] = 0;
+
+  for (uint16_t k = 1; k < half; k++)
+  {
+    int16_t ar = _work_real[k],        ai = _work_imag[k];
+    int16_t br = _work_real[half - k], bi = _work_imag[half - k];
+
+    int16_t even_r = (ar + br) >> 1;
+    int16_t even_i = (ai - bi) >> 1;
+    int16_t odd_r  = (ai + bi) >> 1;
+    int16_t odd_i  = (br - ar) >> 1;
+
+    out_real[k] = even_r + Q15_MUL(_cos[k], odd_r) + Q15_MUL(_sin[k], odd_i);
+    out_imag[k] = even_i + Q15_MUL(_cos[k], odd_i) - Q15_MUL(_sin[k], odd_r);
+  }
+
+  return exponent;
+}
+
+/*
+ * Transforms WAV_FFT_SIZE complex values in place, with no window, like 
+ * WAV_fft::complexForward().  The block is shifted left first to use the 
+ * headroom, so quiet input keeps its precision.
+ * Returns the block exponent: the true spectrum is real/imag * 2^exponent.
+ */
+int8_t WAV_fft_q15::complexForward(int16_t *real, int16_t *imag)
+{
+  int32_t peak = findPeak(real, imag, WAV_FFT_SIZE);
+  int8_t  shift = 0;
+
+  if (peak == 0) return 0;
+  while ((peak << (shift + 1)) < WAV_FFT_Q15_HEADROOM) shift++;
+  if (shift > 0)
+  {
+    for (uint16_t i = 0; i < WAV_FFT_SIZE; i++)
+    {
+      real[i] <<= shift;
+      imag[i] <<= shift;
+    }
+  }
+
+  return transform(real, imag, WAV_FFT_SIZE) - shift;
+}
+
+/*
+ * Approximates sqrt(real^2 + imag^2) with alpha * max + beta * min.
+ * Largest error is about 4%, with no multiplies wider than 32 bits and no sqrt.
+ */
+uint16_t WAV_fft_q15::magnitude(int16_t real, int16_t imag)
+{
+  const int32_t alpha = 31470;  // 0.96043 in Q15
+  const int32_t beta  = 13036;  // 0.39782 in Q15
+  int32_t a = abs((int32_t)real);
+  int32_t b = abs((int32_t)imag);
+
+  if (a < b)
+  {
+    int32_t temp = a; a = b; b = temp;
+  }
+  return (uint16_t)((alpha * a + beta * b + 16384) >> 15);
+}
+
+/*
+ * Returns the Q15 Hann window table.
+ */
+const int16_t *WAV_fft_q15::getHannWindow()
+{
+  initTables();
+  return _hann;
+}
+
+/*
+ * Calculates the shared twiddle, window, and bit reversal tables on first use.
+ */
+void WAV_fft_q15::initTables()
+{
+  if (_tables_ready) return;
+
+  const uint16_t half = WAV_FFT_SIZE / 2;
+
+  for (uint16_t k = 0; k < half; k++)
+  {
+    double angle = 2.0 * M_PI * k / WAV_FFT_SIZE;
+    _cos[k] = (int16_t)lround(cos(angle) * 32767.0);
+    _sin[k] = (int16_t)lround(sin(angle) * 32767.0);
+  }
+
+  for (uint16_t i = 0; i < WAV_FFT_SIZE; i++)
+  {
+    _hann[i] = (int16_t)lround((0.5 - 0.5 * cos(2.0 * M_PI * i / WAV_FFT_SIZE)) * 32767.0);
+  }
+
+  uint8_t bits = 0;
+  while ((1 << bits) < half) bits++;
+  for (uint16_t i = 0; i < half; i++)
+  {
+    uint16_t rev = 0;
+    for (uint8_t b = 0; b < bits; b++)
+    {
+      if (i & (1 << b)) rev |= 1 << (bits - 1 - b);
+    }
+    _bitrev[i] = rev;
+  }
+
+  _tables_ready = true;
+}
+
+/*
+ * In-place block floating point FFT of n complex values, WAV_FFT_SIZE / 2 or WAV_FFT_SIZE.
+ * Returns the number of right shifts applied to the block.
+ */
+int8_t WAV_fft_q15::transform(int16_t *real, int16_t *imag, uint16_t n)
+{
+  const uint16_t half = WAV_FFT_SIZE / 2;
+  int8_t exponent = 0;
+
+  for (uint16_t i = 0; i < n; i++)
+  {
+    // The full size permutation is the half size one of i / 2, with the low bit of i on top
+    uint16_t j = (n == half ? _bitrev[i] : _bitrev[i >> 1] + ((i & 1) ? half : 0));
+    if (i < j)
+    {
+      int16_t temp = real[i]; real[i] = real[j]; real[j] = temp;
+      temp = imag[i]; imag[i] = imag[j]; imag[j] = temp;
+    }
+  }
+
+  for (uint16_t len = 2; len <= n; len <<= 1)
+  {
+    uint16_t half_len = len >> 1;
+    uint16_t stride = WAV_FFT_SIZE / len;
+
+    exponent += scaleToHeadroom(real, imag, n);
+
+    for (uint16_t start = 0; start < n; start += len)
+    {
+      for (uint16_t k = 0; k < half_len; k++)
+      {
+        int16_t wr =  _cos[k * stride];
+        int16_t wi = -_sin[k * stride];
+        uint16_t a = start + k;
+        uint16_t b = a + half_len;
+
+        int16_t tr = (int16_t)(((int32_t)real[b] * wr - (int32_t)imag[b] * wi + 16384) >> 15);
+        int16_t ti = (int16_t)(((int32_t)real[b] * wi + (int32_t)imag[b] * wr + 16384) >> 15);
+
+        real[b] = real[a] - tr;
+        imag[b] = imag[a] - ti;
+        real[a] += tr;
+        imag[a] += ti;
+      }
+    }
+  }
+
+  return exponent;
+}
+
+/*
+ * Shifts the block right until every value is below WAV_FFT_Q15_HEADROOM.
+ * Returns the number of shifts.
+ */
+int8_t WAV_fft_q15::scaleToHeadroom(int16_t *real, int16_t *imag, uint16_t n)
+{
+  int32_t peak = findPeak(real, imag, n);
+  int8_t  shift = 0;
+
+  while ((peak >> shift) >= WAV_FFT_Q15_HEADROOM) shift++;
+
+  if (shift > 0)
+  {
+    for (uint16_t i = 0; i < n; i++)
+    {
+      real[i] >>= shift;
+      imag[i] >>= shift;
+    }
+  }
+  return shift;
+}
+
+/*
+ * Returns the largest absolute real or imaginary value in the block.
+ */
+int32_t WAV_fft_q15::findPeak(const int16_t *real, const int16_t *imag, uint16_t n)
+{
+  int32_t peak = 0;
+
+  for (uint16_t i = 0; i < n; i++)
+  {
+    int32_t r = abs((int32_t)real[i]), m = abs((int32_t)imag[i]);
+    if (r > peak) peak = r;
+    if (m > peak) peak = m;
+  }
+  return peak;
+}
@@ -0,0 +1,48 @@
+#ifndef _WAV_FFT_Q15_
+#define _WAV_FFT_Q15_
+
+#include <stdint.h>
+#include "WAV_fft.h"
+
+#define WAV_FFT_Q15_HEADROOM  8192  // Values must stay below this before a butterfly stage to avoid overflow
+
+#ifndef WAV_FFT_USE_Q15
+#define WAV_FFT_USE_Q15          0  // 1 = the analysis pipelines (WAV_frame, WAV_stft, WAV_mfcc, WAV_pitch, WAV_onset) use WAV_fft_q15, 0 = float WAV_fft
+#endif
+
+/*
+ * Radix-2 FFT in Q15 fixed point for 16-bit (or narrower ADC) samples.
+ * Uses block floating point: the whole block is shifted right only when a stage 
+ * could overflow, and the shifts are returned as a block exponent, so quiet 
+ * signals keep their precision.  Output values are out * 2^exponent.
+ * Twiddle, Hann window and bit reversal tables are static and shared.
+ * Uses about half the memory of the float WAV_fft and no floating point math.
+ * Set WAV_FFT_USE_Q15 to have the analysis pipelines use it in place of WAV_fft.
+ * They keep its output in Q15 until the levels, magnitudes or power they need.
+ */
+class WAV_fft_q15
+{
+  public:
+    WAV_fft_q15();
+    int8_t   realForward(const int16_t *input, int16_t *out_real, int16_t *out_imag);
+    int8_t   complexForward(int16_t *real, int16_t *imag);
+    static uint16_t magnitude(int16_t real, int16_t imag);
+    static const int16_t *getHannWindow();
+
+  private:
+    static void   initTables();
+    static int8_t transform(int16_t *real, int16_t *imag, uint16_t n);
+    static int8_t scaleToHeadroom(int16_t *real, int16_t *imag, uint16_t n);
+    static int32_t findPeak(const int16_t *real, const int16_t *imag, uint16_t n);
+
+    static int16_t  _cos[WAV_FFT_SIZE / 2];     // Q15 cos(2*pi*k/N)
+    static int16_t  _sin[WAV_FFT_SIZE / 2];     // Q15 sin(2*pi*k/N)
+    static int16_t  _hann[WAV_FFT_SIZE];        // Q15 Hann window
+    static uint16_t _bitrev[WAV_FFT_SIZE / 2];  // Bit reversal permutation of the half size transform
+    static bool     _tables_ready;
+
+    int16_t _work_real[WAV_FFT_SIZE / 2];
+    int16_t _work_imag[WAV_FFT_SIZE / 2];
+};
+
+#endif // _WAV_FFT_Q15_
@@ -23,18 +23,45 @@ bool WAV_file::saveFile(const char *filepath, WAV_audio *wav)
   }
   Serial.println("WAV file started.");
   
+  // The buffer holds one channel of 16-bit samples
+  wav->header.num_channels = 1;
+  wav->header.bits_per_sample = 16;
+  wav->header.sample_alignment = 2;
+  wav->header.byte_rate = wav->header.sample_rate * 2;
+  wav->header.data_bytes = WAV_MAX_SAMPLES * 2;
+  wav->header.wav_size = wav->header.data_bytes + sizeof(wav_header_t) - 8;
+  
   size_t   bytes_written;
   bytes_written = file.write((uint8_t *)&wav->header, sizeof(wav_header_t));
   
   if (bytes_written < sizeof(wav_header_t))
   {
     Serial.println("Error writing to WAV file!");
+    file.close();
     return false;  // failure
   }
   
+  // Write little endian samples a block at a time rather than a byte per call
+  uint8_t  block[WAV_FILE_BLOCK_SIZE];
+  uint16_t len = 0;
+  
   for (uint16_t i = 0; i < WAV_MAX_SAMPLES; i++)
   {
-    file.write(wav->getSample(i, 0));
+    int16_t sample = wav->getSample(i, 0);
+    block[len++] = (uint8_t)(sample & 0xFF);
+    block[len++] = (uint8_t)((uint16_t)sample >> 8);
+    
+    if (len >= WAV_FILE_BLOCK_SIZE || i == WAV_MAX_SAMPLES - 1)
+    {
+      bytes_written = file.write(block, len);
+      if (bytes_written < len)
+      {
+        Serial.println("Error writing to WAV file!");
+        file.close();
+        return false;  // failure
+      }
+      len = 0;
+    }
   }
   file.close();
   Serial.println(F("WAV file successfully created."));
@@ -43,6 +70,8 @@ bool WAV_file::saveFile(const char *filepath, WAV_audio *wav)
 
 /*
  * Loads the specified WAV file from the SD card.
+ * Any 8 or 16-bit, mono or stereo PCM file is converted to 16-bit mono at WAV_SAMPLE_RATE.
+ * Only the first WAV_MAX_SAMPLES are loaded.  Use WAV_player to play a whole file.
  * Returns true on success, false on failure.
  */
 bool WAV_file::loadFile(const char *filepath, WAV_audio *wav)
@@ -50,83 +79,208 @@ bool WAV_file::loadFile(const char *filepath, WAV_audio *wav)
   Serial.print(F("Loading WAV file: "));
   Serial.println(filepath);
 
-  int  bytes_read;
-  File file;
-  
-  file = SD.open(filepath, FILE_READ);
-  if (!file)
+  WAV_reader reader;
+  if (!reader.open(filepath))
   {
-    Serial.println("Error opening WAV file!");
-    Serial.println(filepath);
     return false; // failure
   }
   
-  bytes_read = file.read((uint8_t *)&wav->header, sizeof(wav_header_t));  
+  Serial.print(F("# Channels:   ")); Serial.println(reader.getChannels());
+  Serial.print(F("Sample rate:  ")); Serial.println(reader.getSampleRate());
+  Serial.print(F("Bits/sample:  ")); Serial.println(reader.getBitsPerSample());
+  Serial.print(F("Frames:       ")); Serial.println(reader.getFrameCount());
+
+  if (!reader.setOutputRate(WAV_SAMPLE_RATE, &_resampler))
+  {
+    reader.close();
+    return false; // failure
+  }
+
+  // The buffer is always 16-bit mono
+  wav->header = wav_header_t();
+  wav->header.num_channels = 1;
+  wav->header.sample_rate = WAV_SAMPLE_RATE;
+  wav->header.byte_rate = WAV_SAMPLE_RATE * 2;
+
+  int16_t  block[WAV_FILE_BLOCK_SIZE / 2];
+  uint32_t pos = 0;
   
-  if (bytes_read < sizeof(wav_header_t))
+  while (pos < WAV_MAX_SAMPLES)
   {
-    Serial.println(F("Error reading from WAV file!"));
-    return false;  // failure
+    uint32_t count = WAV_MAX_SAMPLES - pos;
+    if (count > WAV_FILE_BLOCK_SIZE / 2) count = WAV_FILE_BLOCK_SIZE / 2;
+    
+    count = reader.readMono(block, count);
+    if (count == 0) break;
+    
+    for (uint32_t i = 0; i < count; i++)
+    {
+      wav->setSample(pos + i, WAV_CHNL_LEFT, block[i]);
+    }
+    pos += count;
   }
+
+  wav->header.data_bytes = pos * 2;
+  wav->header.wav_size = wav->header.data_bytes + sizeof(wav_header_t) - 8;
   
-  if (wav->header.riff_header != WAV_HDR_RIFF)
+  // Clear the rest of the buffer if the file is short
+  for (uint32_t i = pos; i < WAV_MAX_SAMPLES; i++)
   {
-    Serial.print(F("Invalid file format. Must be RIFF. Found: "));
-    Serial.println(wav->header.riff_header);
-    return false;  // failure
+    wav->setSample(i, WAV_CHNL_LEFT, WAV_SILENCE);
   }
+
+  if (reader.getOutputCount() > WAV_MAX_SAMPLES)
+  {
+    Serial.println(F("File is longer than the buffer, only the start was loaded."));
+  }
+  reader.close();
   
-  if (wav->header.wave_header != WAV_HDR_WAVE)
+  Serial.println(F("\nWAV file successfully read."));
+  return true; // success!
+}
+
+/*
+ * Saves a frame spectrum as CSV text, one bin per line:  frequency,real,imag,power
+ * Only bins DC through Nyquist are saved, the rest mirror them.
+ * Returns true on success, false on failure.
+ */
+bool WAV_file::saveDFT(const char* filename, double deltaFreq, WAV_spectrum *spectrum)
+{
+  Serial.print(F("Saving DFT file: "));
+  Serial.println(filename);
+
+  File file = SD.open(filename, FILE_WRITE);
+  if (!file)
   {
-    Serial.print("Invalid data format. Must be WAVE. Found: ");
-    Serial.println(wav->header.wave_header);
-    return false;  // failure
+    Serial.println(F("Error creating DFT file!"));
+    return false; // failure
   }
 
-  if (wav->header.fmt_chunk_size != 16)
+  file.print(F("# bins=")); file.print(WAV_FFT_BINS);
+  file.print(F(" delta=")); file.println(deltaFreq, 3);
+
+  for (uint16_t i = 0; i < WAV_FFT_BINS; i++)
   {
-    Serial.print("Invalid format size: ");
-    Serial.println(wav->header.fmt_chunk_size);
-    return false;  // failure
+    file.print(i * deltaFreq, 2);         file.print(',');
+    file.print(spectrum->re[i], 4);       file.print(',');
+    file.print(spectrum->im[i], 4);       file.print(',');
+    file.println(spectrum->getPower(i), 4);
   }
+  file.close();
+
+  Serial.println(F("DFT file successfully created."));
+  return true; // success!
+}
+
+/*
+ * Saves MFCC features as CSV text, one frame per line.
+ * The first line is a # comment with the frame settings.  Same format as tools/mfcc_cli.
+ * Returns true on success, false on failure.
+ */
+bool WAV_file::saveMFCC(const char* filename, uint32_t frameCount, uint32_t frameSize, uint32_t frameStride, 
+                        uint32_t cepstra, float mfcc[][WAV_FRAME_MFCC_CNT])
+{
+  Serial.print(F("Saving MFCC file: "));
+  Serial.println(filename);
 
-  if (wav->header.audio_format != WAV_FMT_PCM)
+  File file = SD.open(filename, FILE_WRITE);
+  if (!file)
   {
-    Serial.println("Invalid format - must be PCM!");
-    return false;  // failure
+    Serial.println(F("Error creating MFCC file!"));
+    return false; // failure
   }
-  
-  Serial.print(F("# Channels:   ")); Serial.println(wav->header.num_channels);
-  Serial.print(F("Sample rate:  ")); Serial.println(wav->header.sample_rate);
-  Serial.print(F("Byte rate:    ")); Serial.println(wav->header.byte_rate);
-  Serial.print(F("Sample align: ")); Serial.println(wav->header.sample_alignment);
-  Serial.print(F("Bits/sample:  ")); Serial.println(wav->header.bits_per_sample);
-  Serial.print(F("Data bytes:   ")); Serial.println(wav->header.data_bytes);
-
-  uint8_t sample;
-  uint16_t num_channels = wav->header.num_channels;
-  
-  for(uint16_t i = 0; i < wav->header.data_bytes && i < WAV_MAX_SAMPLES; i++)
+
+  if (cepstra > WAV_FRAME_MFCC_CNT) cepstra = WAV_FRAME_MFCC_CNT;
+
+  file.print(F("# frames=")); file.print(frameCount);
+  file.print(F(" size="));    file.print(frameSize);
+  file.print(F(" stride="));  file.print(frameStride);
+  file.print(F(" cepstra=")); file.println(cepstra);
+
+  for (uint32_t frame = 0; frame < frameCount; frame++)
   {
-    for (uint16_t channel = 0; channel < num_channels; channel++)
+    for (uint32_t c = 0; c < cepstra; c++)
     {
-      file.read(&sample, 1); 
-      wav->setSample(i, channel, sample);
+      if (c > 0) file.print(',');
+      file.print(mfcc[frame][c], 4);
     }
+    file.println();
   }
   file.close();
-  
-  Serial.println(F("\nWAV file successfully read."));
+
+  Serial.println(F("MFCC file successfully created."));
   return true; // success!
 }
 
-bool WAV_file::saveDFT(const char* filename, int binCount, double deltaFreq, Complex dft[])
+/*
+ * Saves a keyword template as binary:  WAV_FILE_KWS_MAGIC, uint16 frame count, 
+ * uint16 coefficients per frame, then the little endian float frames.
+ * Returns true on success, false on failure.
+ */
+bool WAV_file::saveKeyword(const char* filename, const wav_kws_template_t *tmpl)
 {
+  Serial.print(F("Saving keyword file: "));
+  Serial.println(filename);
+
+  File file = SD.open(filename, FILE_WRITE);
+  if (!file)
+  {
+    Serial.println(F("Error creating keyword file!"));
+    return false; // failure
+  }
+
+  uint16_t header[2] = { tmpl->frame_cnt, WAV_KWS_COEF_CNT };
+  size_t   frame_bytes = sizeof(float) * WAV_KWS_COEF_CNT * tmpl->frame_cnt;
   
+  if (file.write((const uint8_t *)WAV_FILE_KWS_MAGIC, 4) < 4 ||
+      file.write((const uint8_t *)header, sizeof(header)) < sizeof(header) ||
+      file.write((const uint8_t *)tmpl->frames, frame_bytes) < frame_bytes)
+  {
+    Serial.println(F("Error writing to keyword file!"));
+    file.close();
+    return false; // failure
+  }
+  file.close();
+  return true; // success!
 }
 
-bool     saveMFCC(const char* filename, uint32_t frameCount, uint32_t frameSize, uint32_t frameStride, 
-            uint32_t cepstra, double mfcc[][WAV_FRAME_MFCC_CNT])
+/*
+ * Loads a keyword template saved by saveKeyword().  The template is left empty
+ * if the file is missing or was saved with a different number of coefficients.
+ * Returns true on success, false on failure.
+ */
+bool WAV_file::loadKeyword(const char* filename, wav_kws_template_t *tmpl)
 {
-              
+  tmpl->frame_cnt = 0;
+  
+  File file = SD.open(filename);
+  if (!file)
+  {
+    return false; // failure, the slot was never recorded
+  }
+
+  char     magic[4];
+  uint16_t header[2];
+  
+  if (file.read((uint8_t *)magic, 4) < 4 || memcmp(magic, WAV_FILE_KWS_MAGIC, 4) != 0 ||
+      file.read((uint8_t *)header, sizeof(header)) < (int)sizeof(header) ||
+      header[0] < WAV_KWS_MIN_FRAMES || header[0] > WAV_KWS_MAX_FRAMES || header[1] != WAV_KWS_COEF_CNT)
+  {
+    Serial.print(F("Invalid keyword file: "));
+    Serial.println(filename);
+    file.close();
+    return false; // failure
+  }
+
+  int frame_bytes = sizeof(float) * WAV_KWS_COEF_CNT * header[0];
+  if (file.read((uint8_t *)tmpl->frames, frame_bytes) < frame_bytes)
+  {
+    Serial.println(F("Error reading keyword file!"));
+    file.close();
+    return false; // failure
+  }
+  file.close();
+  
+  tmpl->frame_cnt = header[0];
+  return true; // success!
 }
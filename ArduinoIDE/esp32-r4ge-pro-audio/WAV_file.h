@@ -4,7 +4,13 @@
 #include <SD.h>
 #include "WAV_audio.h"
 #include "WAV_frame.h"
-#include "complex.h"
+#include "WAV_kws.h"
+#include "WAV_reader.h"
+#include "WAV_resample_q15.h"
+#include "WAV_spectrum.h"
+
+#define WAV_FILE_BLOCK_SIZE  512  // Bytes per SD read or write, one sector
+#define WAV_FILE_KWS_MAGIC   "KWS1"  // Keyword template:  magic, uint16 frames, uint16 coefs, float frames
 
 class WAV_file
 {
@@ -12,12 +18,15 @@ class WAV_file
     WAV_file();
     bool  loadFile(const char* filename, WAV_audio* wav_audio);
     bool  saveFile(const char* filename, WAV_audio* wav_audio);
-    bool  saveDFT(const char* filename, int binCount, double deltaFreq, Complex dft[]);
+    bool  saveDFT(const char* filename, double deltaFreq, WAV_spectrum *spectrum);
     bool  saveMFCC(const char* filename, uint32_t frameCount, uint32_t frameSize, uint32_t frameStride, 
-                   uint32_t cepstra, double mfcc[][WAV_FRAME_MFCC_CNT]);
+                   uint32_t cepstra, float mfcc[][WAV_FRAME_MFCC_CNT]);
+    bool  saveKeyword(const char* filename, const wav_kws_template_t *tmpl);
+    bool  loadKeyword(const char* filename, wav_kws_template_t *tmpl);
     
   private:
     char     _last_error[20];
+    WAV_resampler_q15 _resampler;  // Converts loaded files to WAV_SAMPLE_RATE
 };
 
 #endif // _WAV_AUDIO_
@@ -1,3 +1,4 @@
+#include <math.h>
 #include "WAV_frame.h"
 
 WAV_frame::WAV_frame()
@@ -6,44 +7,32 @@ WAV_frame::WAV_frame()
 }
 
 /*
- * Calculates the Discrete Fourier Transform of the frame.
+ * Calculates the Discrete Fourier Transform of the frame using a real input FFT.
  */
 bool WAV_frame::calcDFT(WAV_audio *wav)
 {
-  // Windowing
-  double window = .5;
-  _fft_in[0].set(wav->getSample(0, 0) * window, 0); 
-  for (uint16_t i = 1; i < WAV_FRAME_SIZE; i++) 
+#if WAV_FFT_USE_Q15
+  // Fixed point FFT applies the Hann window itself
+  for (uint16_t i = 0; i < WAV_FRAME_SIZE; i++) 
   {
-    window = -.5 * cos(2.0 * PI * (double)i / (double)WAV_FRAME_SIZE) + .5;
-    _fft_in[i].set((float)(wav->getSample(i, 0) * window), 0);
-    //_fft_in[i].set((float)(wav->getSample(i, 0) - 0.97 * wav->getSample(i - 1, 0) * window), 0);
+    _fft_in[i] = wav->getSample(i, 0);
   }
   
-  // DFT
-  double pi2 = -2.0 * PI;
-  double angleTerm, cosineA, sineA;
-  double invs = 1.0 / WAV_FRAME_SIZE;
-  
-  for(uint16_t y = 0;y < WAV_FRAME_SIZE; y++) 
-  {
-        dft_output[y] = 0;
-        for(uint16_t x = 0; x < WAV_FRAME_SIZE; x++) 
-    {
-            angleTerm = pi2 * y * x * invs;
-            cosineA = cos(angleTerm);
-            sineA = sin(angleTerm);
-            dft_output[y].addReal(_fft_in[x].real() * cosineA - _fft_in[x].imag() * sineA);
-            dft_output[y].addImag(_fft_in[x].real() * sineA + _fft_in[x].imag() * cosineA);
-        }
-    }
-  
-  // Compute the Periodogram
+  // The output stays in Q15.  Power and magnitude are scaled when asked for.
+  _fft_exponent = _fft.realForward(_fft_in, _fft_real, _fft_imag);
+#else
+  // Windowing
+  const float *window = WAV_fft::getHannWindow();
   for (uint16_t i = 0; i < WAV_FRAME_SIZE; i++) 
   {
-    power_spectrum[i] = invs * pow(dft_output[i].c_abs(), 2);
+    _fft_in[i] = (float)wav->getSample(i, 0) * window[i];
+    //_fft_in[i] = (float)(wav->getSample(i, 0) - 0.97 * wav->getSample(i - 1, 0)) * window[i];
   }
   
+  // FFT straight into the spectrum.  Power is calculated from it when needed.
+  _fft.realForward(_fft_in, spectrum.re, spectrum.im);
+#endif
+  
   return true;
 }
 
@@ -52,8 +41,15 @@ bool WAV_frame::calcDFT(WAV_audio *wav)
  */
 bool   WAV_frame::calcMelFilterbank()
 {
-  // TODO
-  return false;
+#if WAV_FFT_USE_Q15
+  WAV_mfcc::applyFilterbank(_fft_real, _fft_imag, _fft_exponent, _mel_log);
+#else
+  float power[WAV_FFT_BINS];
+
+  spectrum.calcPower(power);
+  WAV_mfcc::applyFilterbank(power, _mel_log);
+#endif
+  return true;
 }
 
 /*
@@ -61,8 +57,8 @@ bool   WAV_frame::calcMelFilterbank()
  */
 bool   WAV_frame::calcDCT()
 {
-  // TODO
-  return false;
+  WAV_mfcc::applyDCT(_mel_log, _mfcc);
+  return true;
 }
 
 /*
@@ -86,31 +82,94 @@ bool   WAV_frame::calcMFCC(WAV_audio *wav)
  */
 double WAV_frame::findMaxRealOutput()
 {
-  double max_value = 0;
-
   // Skip first bin (DC offset)
-  for (int i = 1; i < WAV_FRAME_SIZE / 2; i++)
+#if WAV_FFT_USE_Q15
+  int16_t max_value = 0;
+  for (uint16_t i = 1; i < WAV_FFT_BINS; i++)
   {
-    if (dft_output[i].real() > max_value)
-      max_value = dft_output[i].real();
+    if (_fft_real[i] > max_value) max_value = _fft_real[i];
   }
-  return max_value;
+  return ldexpf(max_value, _fft_exponent);
+#else
+  return spectrum.findMaxReal(1);
+#endif
 }
 
 /*
- * Finds the maximum real value of the DFT output
+ * Finds the maximum power value of the DFT output
  */
 double WAV_frame::findMaxPowerOutput()
 {
-  double max_value = 0;
+  // Skip first bins (DC offset)
+#if WAV_FFT_USE_Q15
+  uint32_t max_value = 0;
+  for (uint16_t i = 2; i < WAV_FFT_BINS; i++)
+  {
+    uint32_t value = (uint32_t)((int32_t)_fft_real[i] * _fft_real[i]) + (uint32_t)((int32_t)_fft_imag[i] * _fft_imag[i]);
+    if (value > max_value) max_value = value;
+  }
+  return ldexpf((float)max_value, 2 * _fft_exponent) * (1.0f / WAV_FFT_SIZE);
+#else
+  return spectrum.getPower(spectrum.findMaxPowerBin(2));
+#endif
+}
 
-  // Skip first bin (DC offset)
-  for (int i = 2; i < WAV_FRAME_SIZE / 2; i++)
+/*
+ * Finds the maximum magnitude of the DFT output
+ */
+float WAV_frame::findMaxMagnitudeOutput()
+{
+  // Skip first bins (DC offset)
+#if WAV_FFT_USE_Q15
+  uint16_t max_value = 0;
+  for (uint16_t i = 2; i < WAV_FFT_BINS; i++)
+  {
+    uint16_t value = WAV_fft_q15::magnitude(_fft_real[i], _fft_imag[i]);
+    if (value > max_value) max_value = value;
+  }
+  return ldexpf(max_value, _fft_exponent);
+#else
+  return spectrum.getMagnitude(spectrum.findMaxPowerBin(2));
+#endif
+}
+
+/*
+ * Returns |X| of a bin from 0 to WAV_FFT_BINS - 1.  The Q15 path uses the 
+ * alpha max plus beta min approximation, good enough for drawing.
+ */
+float WAV_frame::getMagnitude(uint16_t bin)
+{
+  if (bin >= WAV_FFT_BINS) return 0;
+#if WAV_FFT_USE_Q15
+  return ldexpf(WAV_fft_q15::magnitude(_fft_real[bin], _fft_imag[bin]), _fft_exponent);
+#else
+  return spectrum.getMagnitude(bin);
+#endif
+}
+
+/*
+ * Fills power with WAV_FFT_BINS periodogram values, |X|^2 / N
+ */
+void WAV_frame::calcPower(float *power)
+{
+#if WAV_FFT_USE_Q15
+  float scale = ldexpf(1.0f / WAV_FFT_SIZE, 2 * _fft_exponent);
+  for (uint16_t i = 0; i < WAV_FFT_BINS; i++)
   {
-    if (power_spectrum[i] > max_value)
-      max_value = power_spectrum[i];
+    int32_t re = _fft_real[i], im = _fft_imag[i];
+    power[i] = (float)((uint32_t)(re * re) + (uint32_t)(im * im)) * scale;
   }
-  return max_value;
+#else
+  spectrum.calcPower(power);
+#endif
+}
+
+/*
+ * Returns the coefficients calculated by calcMFCC()
+ */
+const float *WAV_frame::getMFCC()
+{
+  return _mfcc;
 }
 
 /*
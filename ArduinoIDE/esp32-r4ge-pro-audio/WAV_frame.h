@@ -2,7 +2,10 @@
 #define _WAV_FRAME_
 
 #include "WAV_audio.h"
-#include "complex.h"
+#include "WAV_fft.h"
+#include "WAV_fft_q15.h"
+#include "WAV_mfcc.h"
+#include "WAV_spectrum.h"
 
 #define WAV_FRAME_SIZE      512  // # of samples in 25 msec @ 11025 Hz sample rate
 #define WAV_FRAME_STRIDE   110  // # of samples in 10 msec @ 11025 Hz sample rate 
@@ -10,6 +13,13 @@
 #define WAV_FRAMES_NFFT    512  // N for FFT size
 #define WAV_FRAME_MFCC_CNT  12  // # of Mel Frequency Cepstrum Coefficients to be calculated for each frame
 
+#if WAV_FRAME_SIZE != WAV_FFT_SIZE
+#error WAV_FRAME_SIZE must match WAV_FFT_SIZE
+#endif
+#if WAV_FRAME_STRIDE != WAV_MFCC_STRIDE || WAV_FRAME_MFCC_CNT != WAV_MFCC_COEF_CNT
+#error WAV_frame and WAV_mfcc settings must match
+#endif
+
 class WAV_frame
 {
   public:
@@ -21,11 +31,26 @@ class WAV_frame
     bool    calcMFCC(WAV_audio *wav);
     double  findMaxRealOutput();
     double  findMaxPowerOutput();
-    Complex dft_output[WAV_FRAME_SIZE];
-    double  power_spectrum[WAV_FRAME_SIZE];
+    float   findMaxMagnitudeOutput();
+    float   getMagnitude(uint16_t bin);
+    void    calcPower(float *power);
+    const float *getMFCC();
+#if !WAV_FFT_USE_Q15
+    WAV_spectrum spectrum;
+#endif
   
   private:
-    Complex  _fft_in[WAV_FRAME_SIZE];  
+#if WAV_FFT_USE_Q15
+    WAV_fft_q15 _fft;
+    int16_t  _fft_in[WAV_FRAME_SIZE];  
+    int16_t  _fft_real[WAV_FFT_BINS];  // The spectrum is kept in Q15, it is _fft_real * 2^_fft_exponent
+    int16_t  _fft_imag[WAV_FFT_BINS];
+    int8_t   _fft_exponent = 0;
+#else
+    WAV_fft  _fft;
+    float    _fft_in[WAV_FRAME_SIZE];  
+#endif
+    float    _mel_log[WAV_MFCC_FILTER_CNT];
     float    _mfcc[WAV_FRAME_MFCC_CNT];
     uint8_t  _frame_idx = 0;
 };
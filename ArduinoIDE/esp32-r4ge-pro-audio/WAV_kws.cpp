@@ -0,0 +1,244 @@
+#include <math.h>
+#include <string.h>
+#include "WAV_kws.h"
+
+WAV_kws::WAV_kws()
+{
+  clear();
+}
+
+/*
+ * Removes all of the templates.
+ */
+void WAV_kws::clear()
+{
+  for (uint8_t word = 0; word < WAV_KWS_WORDS; word++)
+  {
+    clearWord(word);
+  }
+  beginUtterance();
+}
+
+void WAV_kws::clearWord(uint8_t word)
+{
+  if (word >= WAV_KWS_WORDS) return;
+  for (uint8_t slot = 0; slot < WAV_KWS_TEMPLATES; slot++)
+  {
+    _template[word][slot].frame_cnt = 0;
+  }
+}
+
+/*
+ * Returns a template slot so it can be filled, for example from the SD card.  
+ * Set frame_cnt to 0 to leave it empty.
+ */
+wav_kws_template_t *WAV_kws::getTemplate(uint8_t word, uint8_t slot)
+{
+  if (word >= WAV_KWS_WORDS || slot >= WAV_KWS_TEMPLATES) return NULL;
+  return &_template[word][slot];
+}
+
+uint8_t WAV_kws::getTemplateCount(uint8_t word)
+{
+  uint8_t count = 0;
+  
+  if (word >= WAV_KWS_WORDS) return 0;
+  for (uint8_t slot = 0; slot < WAV_KWS_TEMPLATES; slot++)
+  {
+    if (_template[word][slot].frame_cnt > 0) count++;
+  }
+  return count;
+}
+
+/*
+ * Sets the largest distance per path step that is accepted as a match.
+ */
+void WAV_kws::setThreshold(float threshold)
+{
+  _threshold = threshold;
+}
+
+/*
+ * Starts matching a new utterance, for example when the voice activity gate opens.
+ */
+void WAV_kws::beginUtterance()
+{
+  for (uint8_t word = 0; word < WAV_KWS_WORDS; word++)
+  {
+    for (uint8_t slot = 0; slot < WAV_KWS_TEMPLATES; slot++)
+    {
+      _alive[word][slot] = (_template[word][slot].frame_cnt > 0);
+    }
+  }
+  _frame_cnt = 0;
+  _pushed = 0;
+  _cells = 0;
+  _abandoned = 0;
+}
+
+/*
+ * Adds the next WAV_MFCC_COEF_CNT coefficients of the utterance.  Every 
+ * WAV_KWS_DECIMATE frame is kept and scored against all of the live templates.
+ */
+void WAV_kws::pushFrame(const float *mfcc)
+{
+  if (_pushed++ % WAV_KWS_DECIMATE != 0) return;
+  
+  if (_frame_cnt >= WAV_KWS_UTTER_MAX)
+  {
+    // Longer than any template can stretch to
+    if (_frame_cnt == WAV_KWS_UTTER_MAX)
+    {
+      for (uint8_t word = 0; word < WAV_KWS_WORDS; word++)
+        for (uint8_t slot = 0; slot < WAV_KWS_TEMPLATES; slot++)
+          _alive[word][slot] = false;
+      _frame_cnt++;
+    }
+    return;
+  }
+
+  float *frame = _utter[_frame_cnt];
+  memcpy(frame, &mfcc[WAV_KWS_FIRST_COEF], sizeof(float) * WAV_KWS_COEF_CNT);
+  _frame_cnt++;
+  
+  for (uint8_t word = 0; word < WAV_KWS_WORDS; word++)
+  {
+    for (uint8_t slot = 0; slot < WAV_KWS_TEMPLATES; slot++)
+    {
+      if (_alive[word][slot]) calcRow(word, slot, frame);
+    }
+  }
+}
+
+/*
+ * Finishes the utterance and finds the closest template.  
+ * Returns true if it is under the threshold.
+ */
+bool WAV_kws::endUtterance(wav_kws_result_t *result)
+{
+  uint16_t n = _frame_cnt;
+  
+  result->word = -1;
+  result->slot = -1;
+  result->score = WAV_KWS_INFINITY;
+  result->frames = n;
+  result->cells = _cells;
+  result->abandoned = _abandoned;
+  if (n < WAV_KWS_MIN_FRAMES || n > WAV_KWS_UTTER_MAX) return false;
+
+  for (uint8_t word = 0; word < WAV_KWS_WORDS; word++)
+  {
+    for (uint8_t slot = 0; slot < WAV_KWS_TEMPLATES; slot++)
+    {
+      uint16_t m = _template[word][slot].frame_cnt;
+      if (!_alive[word][slot] || n > m + WAV_KWS_BAND || m > n + WAV_KWS_BAND) continue;
+
+      float score = _row[word][slot][(n - 1) & 1][m - 1] / (n + m);
+      if (score < result->score)
+      {
+        result->word = word;
+        result->slot = slot;
+        result->score = score;
+      }
+    }
+  }
+  return result->score <= _threshold;
+}
+
+/*
+ * Returns the number of frames kept from the utterance so far.
+ */
+uint16_t WAV_kws::getFrameCount()
+{
+  return _frame_cnt;
+}
+
+/*
+ * Copies the utterance into a template, to record a keyword.  
+ * Returns false if it is too short or too long.
+ */
+bool WAV_kws::copyUtterance(wav_kws_template_t *dest)
+{
+  if (_frame_cnt < WAV_KWS_MIN_FRAMES || _frame_cnt > WAV_KWS_MAX_FRAMES) return false;
+
+  memcpy(dest->frames, _utter, sizeof(float) * WAV_KWS_COEF_CNT * _frame_cnt);
+  dest->frame_cnt = _frame_cnt;
+  return true;
+}
+
+//----- PRIVATE METHODS -----//
+
+/*
+ * Fills the DTW row of the newest utterance frame for one template, within the band.
+ * Cells outside the band of the previous row are treated as infinite.
+ */
+void WAV_kws::calcRow(uint8_t word, uint8_t slot, const float *frame)
+{
+  const wav_kws_template_t *tmpl = &_template[word][slot];
+  int16_t i = _frame_cnt - 1;
+  int16_t m = tmpl->frame_cnt;
+  float  *prev = _row[word][slot][(i + 1) & 1];
+  float  *cur  = _row[word][slot][i & 1];
+
+  if (i > m - 1 + WAV_KWS_BAND)
+  {
+    _alive[word][slot] = false;  // Too long to still end on the template's last frame
+    _abandoned++;
+    return;
+  }
+
+  int16_t lo = (i > WAV_KWS_BAND ? i - WAV_KWS_BAND : 0);
+  int16_t hi = (i + WAV_KWS_BAND < m - 1 ? i + WAV_KWS_BAND : m - 1);
+  int16_t prev_lo = (i - 1 > WAV_KWS_BAND ? i - 1 - WAV_KWS_BAND : 0);
+  int16_t prev_hi = i - 1 + WAV_KWS_BAND;
+  float   row_min = WAV_KWS_INFINITY;
+  float   left = WAV_KWS_INFINITY;  // Cell before j in this row
+
+  for (int16_t j = lo; j <= hi; j++)
+  {
+    float dist = calcDistance(frame, tmpl->frames[j]);
+    float cost;
+
+    if (i == 0)
+    {
+      cost = (j == 0 ? 2 * dist : left + dist);
+    }
+    else
+    {
+      float up   = (j >= prev_lo && j <= prev_hi ? prev[j] : WAV_KWS_INFINITY);
+      float diag = (j > prev_lo && j - 1 <= prev_hi ? prev[j - 1] : WAV_KWS_INFINITY);
+      cost = diag + 2 * dist;
+      if (up + dist < cost) cost = up + dist;
+      if (left + dist < cost) cost = left + dist;
+    }
+    
+    cur[j] = cost;
+    left = cost;
+    if (cost < row_min) row_min = cost;
+  }
+  _cells += hi - lo + 1;
+
+  // Every cell of the final path is at least row_min, and a match can only be 
+  // WAV_KWS_BAND frames longer than the template, so a match needs 
+  // row_min <= threshold * (n + m) <= threshold * (2m + band).
+  if (row_min > _threshold * (2 * m + WAV_KWS_BAND))
+  {
+    _alive[word][slot] = false;
+    _abandoned++;
+  }
+}
+
+/*
+ * Euclidean distance between two frames of WAV_KWS_COEF_CNT coefficients.
+ */
+float WAV_kws::calcDistance(const float *a, const float *b)
+{
+  float sum = 0;
+
+  for (uint8_t c = 0; c < WAV_KWS_COEF_CNT; c++)
+  {
+    float diff = a[c] - b[c];
+    sum += diff * diff;
+  }
+  return sqrtf(sum);
+}
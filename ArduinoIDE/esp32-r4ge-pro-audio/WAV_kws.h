@@ -0,0 +1,76 @@
+#ifndef _WAV_KWS_
+#define _WAV_KWS_
+
+#include <stdint.h>
+#include "WAV_mfcc.h"
+
+#define WAV_KWS_WORDS           4  // Keywords
+#define WAV_KWS_TEMPLATES       3  // Recordings of each keyword
+#define WAV_KWS_DECIMATE        2  // Every 2nd MFCC frame is used, 20 msec apart
+#define WAV_KWS_MAX_FRAMES     60  // Longest template, 1.2 sec
+#define WAV_KWS_MIN_FRAMES      8  // Shorter utterances are clicks or bumps
+#define WAV_KWS_BAND            8  // Sakoe-Chiba band, frames either side of the diagonal
+#define WAV_KWS_UTTER_MAX     (WAV_KWS_MAX_FRAMES + WAV_KWS_BAND)
+#define WAV_KWS_FIRST_COEF      1  // c0 is the frame energy, which depends on the distance to the mic
+#define WAV_KWS_COEF_CNT      (WAV_MFCC_COEF_CNT - WAV_KWS_FIRST_COEF)
+#define WAV_KWS_THRESHOLD     3.4  // Accepted distance per step along the warping path, see tools/kws_bench.cpp
+#define WAV_KWS_INFINITY     1e30f
+
+typedef struct
+{
+  uint16_t frame_cnt;  // 0 if the slot is empty
+  float    frames[WAV_KWS_MAX_FRAMES][WAV_KWS_COEF_CNT];
+} wav_kws_template_t;
+
+typedef struct
+{
+  int8_t   word;       // Best matching keyword, -1 if none is under the threshold
+  int8_t   slot;       // Template of that keyword
+  float    score;      // Its distance per step, lower is closer
+  uint16_t frames;     // Utterance length
+  uint32_t cells;      // DTW cells calculated for the utterance, over all templates
+  uint8_t  abandoned;  // Templates dropped before the end of the utterance
+} wav_kws_result_t;
+
+/*
+ * Keyword spotter that matches spoken words against recorded MFCC templates.
+ * Frames of an utterance are pushed as they arrive, and each one fills the next 
+ * row of a dynamic time warping table for every template, so the work is spread 
+ * over the utterance and the result is ready as soon as it ends.
+ * Only cells within WAV_KWS_BAND frames of the diagonal are calculated, and a template 
+ * is abandoned as soon as the smallest cell in its row is already too far to end 
+ * under the threshold.  Steps use the symmetric weights (diagonal counts twice), so 
+ * every full path has a weight of the two lengths added and scores can be compared.
+ * No Arduino dependencies.
+ */
+class WAV_kws
+{
+  public:
+    WAV_kws();
+    void     clear();
+    void     clearWord(uint8_t word);
+    wav_kws_template_t *getTemplate(uint8_t word, uint8_t slot);
+    uint8_t  getTemplateCount(uint8_t word);
+    void     setThreshold(float threshold);
+    void     beginUtterance();
+    void     pushFrame(const float *mfcc);
+    bool     endUtterance(wav_kws_result_t *result);
+    uint16_t getFrameCount();
+    bool     copyUtterance(wav_kws_template_t *dest);
+
+  private:
+    void     calcRow(uint8_t word, uint8_t slot, const float *frame);
+    static float calcDistance(const float *a, const float *b);
+
+    wav_kws_template_t _template[WAV_KWS_WORDS][WAV_KWS_TEMPLATES];
+    float    _row[WAV_KWS_WORDS][WAV_KWS_TEMPLATES][2][WAV_KWS_MAX_FRAMES];  // Previous and current DTW rows
+    bool     _alive[WAV_KWS_WORDS][WAV_KWS_TEMPLATES];
+    float    _utter[WAV_KWS_UTTER_MAX][WAV_KWS_COEF_CNT];
+    float    _threshold = WAV_KWS_THRESHOLD;
+    uint16_t _frame_cnt = 0;     // Decimated frames in the utterance
+    uint16_t _pushed = 0;        // MFCC frames pushed, before decimation
+    uint32_t _cells = 0;
+    uint8_t  _abandoned = 0;
+};
+
+#endif // _WAV_KWS_
@@ -0,0 +1,296 @@
+#include <math.h>
+#include <string.h>
+#include "WAV_mfcc.h"
+
+wav_mel_filter_t WAV_mfcc::_filter[WAV_MFCC_FILTER_CNT];
+float WAV_mfcc::_weight[WAV_MFCC_WEIGHT_MAX];
+float WAV_mfcc::_dct[WAV_MFCC_COEF_CNT][WAV_MFCC_FILTER_CNT];
+float WAV_mfcc::_silence[WAV_MFCC_COEF_CNT];
+bool  WAV_mfcc::_tables_ready = false;
+
+WAV_mfcc::WAV_mfcc()
+{
+  initTables();
+  reset();
+}
+
+/*
+ * Clears the sample history to start a new stream.
+ */
+void WAV_mfcc::reset()
+{
+  for (uint16_t i = 0; i < WAV_MFCC_FRAME_SIZE; i++)
+  {
+    _history[i] = 0;
+  }
+  _prev_sample = 0;
+  _write_idx = 0;
+  _sample_cnt = 0;
+  _frame_cnt = 0;
+  _silent = false;
+  _silent_cnt = 0;
+  if (_gate != NULL) _gate->reset();
+}
+
+/*
+ * Adds the next audio sample to the stream.
+ * Returns true when a new set of coefficients is ready from getCoefficients().
+ */
+bool WAV_mfcc::pushSample(int16_t sample)
+{
+#if WAV_FFT_USE_Q15
+  float emphasized = lrintf((float)sample - WAV_MFCC_PREEMPHASIS * _prev_sample);
+  _history[_write_idx] = (int16_t)(emphasized > 32767 ? 32767 : (emphasized < -32768 ? -32768 : emphasized));
+#else
+  _history[_write_idx] = (float)sample - WAV_MFCC_PREEMPHASIS * _prev_sample;
+#endif
+  _prev_sample = sample;
+  _write_idx = (_write_idx + 1) % WAV_MFCC_FRAME_SIZE;
+  _sample_cnt++;
+  if (_gate != NULL) _gate->pushSample(sample);
+
+  if (_sample_cnt < WAV_MFCC_FRAME_SIZE) return false;
+  if ((_sample_cnt - WAV_MFCC_FRAME_SIZE) % WAV_MFCC_STRIDE != 0) return false;
+
+  _frame_cnt++;
+  _silent = (_gate != NULL && !_gate->getActive());
+  if (_silent)
+  {
+    memcpy(_mfcc, _silence, sizeof(_mfcc));
+    _silent_cnt++;
+    return true;
+  }
+
+  // Unroll the circular history, oldest sample first
+  for (uint16_t i = 0; i < WAV_MFCC_FRAME_SIZE; i++)
+  {
+    _frame[i] = _history[(_write_idx + i) % WAV_MFCC_FRAME_SIZE];
+  }
+
+  calcFrame(_frame, _mfcc);
+  return true;
+}
+
+/*
+ * Returns the coefficients of the most recent frame.
+ */
+const float *WAV_mfcc::getCoefficients()
+{
+  return _mfcc;
+}
+
+/*
+ * Returns the number of frames calculated since the last reset.
+ */
+uint32_t WAV_mfcc::getFrameCount()
+{
+  return _frame_cnt;
+}
+
+/*
+ * Sets a voice activity gate, or NULL to calculate every frame.  
+ * The gate is fed by pushSample(), so it should not be fed anywhere else.
+ */
+void WAV_mfcc::setGate(WAV_vad *gate)
+{
+  _gate = gate;
+  if (_gate != NULL) _gate->reset();
+  _silent = false;
+}
+
+/*
+ * Returns true if the most recent frame was skipped as silent.
+ */
+bool WAV_mfcc::getSilent()
+{
+  return _silent;
+}
+
+/*
+ * Returns the number of frames skipped as silent since the last reset.
+ */
+uint32_t WAV_mfcc::getSilentCount()
+{
+  return _silent_cnt;
+}
+
+#if WAV_FFT_USE_Q15
+/*
+ * Calculates the coefficients for one pre-emphasized frame of WAV_MFCC_FRAME_SIZE samples.
+ * The Q15 FFT applies the window.
+ */
+void WAV_mfcc::calcFrame(const int16_t *frame, float *mfcc)
+{
+  int8_t exponent = _fft.realForward(frame, _real, _imag);
+
+  applyFilterbank(_real, _imag, exponent, _mel_log);
+  applyDCT(_mel_log, mfcc);
+}
+#else
+/*
+ * Calculates the coefficients for one pre-emphasized frame of WAV_MFCC_FRAME_SIZE samples.
+ * The frame is windowed in place.
+ */
+void WAV_mfcc::calcFrame(float *frame, float *mfcc)
+{
+  const float *window = WAV_fft::getHannWindow();
+
+  for (uint16_t i = 0; i < WAV_MFCC_FRAME_SIZE; i++)
+  {
+    frame[i] *= window[i];
+  }
+
+  _fft.realForward(frame, _real, _imag);
+
+  // Periodogram, stored over the real output
+  for (uint16_t i = 0; i < WAV_FFT_BINS; i++)
+  {
+    _real[i] = (_real[i] * _real[i] + _imag[i] * _imag[i]) / WAV_MFCC_FRAME_SIZE;
+  }
+
+  applyFilterbank(_real, _mel_log);
+  applyDCT(_mel_log, mfcc);
+}
+#endif
+
+/*
+ * Applies the sparse triangular mel filterbank to a WAV_FFT_BINS power spectrum
+ * and takes the log of each filter energy.
+ */
+void WAV_mfcc::applyFilterbank(const float *power, float *mel_log)
+{
+  initTables();
+
+  for (uint8_t m = 0; m < WAV_MFCC_FILTER_CNT; m++)
+  {
+    const float *weight = &_weight[_filter[m].offset];
+    const float *bin = &power[_filter[m].start];
+    float energy = 0;
+
+    for (uint16_t i = 0; i < _filter[m].length; i++)
+    {
+      energy += weight[i] * bin[i];
+    }
+    mel_log[m] = logf(energy > WAV_MFCC_LOG_FLOOR ? energy : WAV_MFCC_LOG_FLOOR);
+  }
+}
+
+/*
+ * Applies the mel filterbank to a Q15 spectrum of WAV_FFT_BINS bins, whose true 
+ * values are real/imag * 2^exponent.  The periodogram |X|^2 / N is summed from 
+ * the integer squares, and the exponent and 1/N are added after the log.
+ */
+void WAV_mfcc::applyFilterbank(const int16_t *real, const int16_t *imag, int8_t exponent, float *mel_log)
+{
+  const float offset = 2 * exponent * logf(2.0f) - logf((float)WAV_MFCC_FRAME_SIZE);
+  const float log_floor = logf(WAV_MFCC_LOG_FLOOR);
+
+  initTables();
+
+  for (uint8_t m = 0; m < WAV_MFCC_FILTER_CNT; m++)
+  {
+    const float *weight = &_weight[_filter[m].offset];
+    uint16_t start = _filter[m].start;
+    float energy = 0;
+
+    for (uint16_t i = 0; i < _filter[m].length; i++)
+    {
+      int32_t re = real[start + i], im = imag[start + i];
+      energy += weight[i] * (float)((uint32_t)(re * re) + (uint32_t)(im * im));
+    }
+    float log_energy = (energy > 0 ? logf(energy) + offset : log_floor);
+    mel_log[m] = (log_energy > log_floor ? log_energy : log_floor);
+  }
+}
+
+/*
+ * DCT-II of the log filter energies using the precomputed cosine table.
+ */
+void WAV_mfcc::applyDCT(const float *mel_log, float *mfcc)
+{
+  initTables();
+
+  for (uint8_t n = 0; n < WAV_MFCC_COEF_CNT; n++)
+  {
+    float sum = 0;
+    for (uint8_t m = 0; m < WAV_MFCC_FILTER_CNT; m++)
+    {
+      sum += _dct[n][m] * mel_log[m];
+    }
+    mfcc[n] = sum;
+  }
+}
+
+/*
+ * Calculates the shared filterbank and DCT tables on first use.
+ */
+void WAV_mfcc::initTables()
+{
+  if (_tables_ready) return;
+
+  // Filter edges are evenly spaced on the mel scale, then snapped to FFT bins
+  float    low_mel  = hzToMel(WAV_MFCC_LOW_HZ);
+  float    high_mel = hzToMel(WAV_MFCC_HIGH_HZ);
+  float    bin_hz   = (float)WAV_MFCC_SAMPLE_RATE / WAV_MFCC_FRAME_SIZE;
+  uint16_t edge[WAV_MFCC_FILTER_CNT + 2];
+
+  for (uint8_t i = 0; i < WAV_MFCC_FILTER_CNT + 2; i++)
+  {
+    float hz = melToHz(low_mel + (high_mel - low_mel) * i / (WAV_MFCC_FILTER_CNT + 1));
+    edge[i] = (uint16_t)floorf(hz / bin_hz + 0.5f);
+    if (edge[i] > WAV_FFT_BINS - 1) edge[i] = WAV_FFT_BINS - 1;
+  }
+
+  uint16_t offset = 0;
+  for (uint8_t m = 0; m < WAV_MFCC_FILTER_CNT; m++)
+  {
+    uint16_t left = edge[m], center = edge[m + 1], right = edge[m + 2];
+    if (center <= left) center = left + 1;     // Narrow low filters still need a peak bin
+    if (right <= center) right = center + 1;
+
+    _filter[m].start  = left + 1;
+    _filter[m].length = 0;
+    _filter[m].offset = offset;
+
+    for (uint16_t k = left + 1; k < right && k < WAV_FFT_BINS && offset < WAV_MFCC_WEIGHT_MAX; k++)
+    {
+      float weight = (k <= center) ? (float)(k - left) / (center - left) 
+                                   : (float)(right - k) / (right - center);
+      _weight[offset++] = weight;
+      _filter[m].length++;
+    }
+  }
+
+  // Orthonormal DCT-II
+  for (uint8_t n = 0; n < WAV_MFCC_COEF_CNT; n++)
+  {
+    float scale = sqrtf((n == 0 ? 1.0f : 2.0f) / WAV_MFCC_FILTER_CNT);
+    for (uint8_t m = 0; m < WAV_MFCC_FILTER_CNT; m++)
+    {
+      _dct[n][m] = scale * cosf(M_PI * n * (m + 0.5f) / WAV_MFCC_FILTER_CNT);
+    }
+  }
+
+  // Every filter of a silent frame is at the log floor
+  for (uint8_t n = 0; n < WAV_MFCC_COEF_CNT; n++)
+  {
+    float sum = 0;
+    for (uint8_t m = 0; m < WAV_MFCC_FILTER_CNT; m++)
+    {
+      sum += _dct[n][m];
+    }
+    _silence[n] = sum * logf(WAV_MFCC_LOG_FLOOR);
+  }
+
+  _tables_ready = true;
+}
+
+float WAV_mfcc::hzToMel(float hz)
+{
+  return 2595.0f * log10f(1.0f + hz / 700.0f);
+}
+
+float WAV_mfcc::melToHz(float mel)
+{
+  return 700.0f * (powf(10.0f, mel / 2595.0f) - 1.0f);
+}
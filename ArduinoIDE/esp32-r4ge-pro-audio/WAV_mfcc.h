@@ -0,0 +1,95 @@
+#ifndef _WAV_MFCC_
+#define _WAV_MFCC_
+
+#include <stdint.h>
+#include "WAV_fft_q15.h"
+#include "WAV_vad.h"
+
+#define WAV_MFCC_SAMPLE_RATE  11025
+#define WAV_MFCC_FRAME_SIZE   WAV_FFT_SIZE  // Same as WAV_FRAME_SIZE
+#define WAV_MFCC_STRIDE       110           // Same as WAV_FRAME_STRIDE
+#define WAV_MFCC_COEF_CNT     12            // Same as WAV_FRAME_MFCC_CNT
+#define WAV_MFCC_FILTER_CNT   26            // Triangular mel filters
+#define WAV_MFCC_LOW_HZ       64.0
+#define WAV_MFCC_HIGH_HZ      (WAV_MFCC_SAMPLE_RATE / 2.0)
+#define WAV_MFCC_PREEMPHASIS  0.97
+#define WAV_MFCC_LOG_FLOOR    1e-10         // Avoids log(0) on silent frames
+#define WAV_MFCC_WEIGHT_MAX   (WAV_FFT_BINS * 2)  // Each bin is in at most two filters
+
+typedef struct 
+{
+  uint16_t start;   // First FFT bin with a non-zero weight
+  uint16_t length;  // Number of non-zero weights
+  uint16_t offset;  // Index of the first weight in the shared weight table
+} wav_mel_filter_t;
+
+/*
+ * Streaming Mel Frequency Cepstral Coefficient extractor.
+ * Samples are pushed one at a time; every WAV_MFCC_STRIDE samples once the 
+ * first full frame is buffered, a frame is pre-emphasized, Hann windowed, 
+ * transformed, passed through the sparse mel filterbank, logged, and 
+ * converted to WAV_MFCC_COEF_CNT coefficients with a DCT-II.
+ * The filterbank and DCT tables are static and shared, so memory use is fixed.
+ * With WAV_FFT_USE_Q15 the history holds int16 samples, the Q15 FFT windows and 
+ * transforms the frame, and the filterbank sums the power straight from the Q15 
+ * bins, adding the block exponent after the log.
+ * With a WAV_vad gate set, frames that end while the gate is inactive skip the 
+ * transform and return the coefficients of a silent frame, flagged by getSilent().
+ * No Arduino dependencies, so the host tools produce identical features.
+ */
+class WAV_mfcc
+{
+  public:
+    WAV_mfcc();
+    void  reset();
+    bool  pushSample(int16_t sample);
+    const float *getCoefficients();
+    uint32_t     getFrameCount();
+    void  setGate(WAV_vad *gate);
+    bool  getSilent();
+    uint32_t     getSilentCount();
+#if WAV_FFT_USE_Q15
+    void  calcFrame(const int16_t *frame, float *mfcc);
+#else
+    void  calcFrame(float *frame, float *mfcc);
+#endif
+    static void  applyFilterbank(const float *power, float *mel_log);
+    static void  applyFilterbank(const int16_t *real, const int16_t *imag, int8_t exponent, float *mel_log);
+    static void  applyDCT(const float *mel_log, float *mfcc);
+
+  private:
+    static void  initTables();
+    static float hzToMel(float hz);
+    static float melToHz(float mel);
+
+    static wav_mel_filter_t _filter[WAV_MFCC_FILTER_CNT];
+    static float _weight[WAV_MFCC_WEIGHT_MAX];
+    static float _dct[WAV_MFCC_COEF_CNT][WAV_MFCC_FILTER_CNT];
+    static float _silence[WAV_MFCC_COEF_CNT];  // Coefficients of an all zero frame
+    static bool  _tables_ready;
+
+#if WAV_FFT_USE_Q15
+    WAV_fft_q15 _fft;
+    int16_t  _history[WAV_MFCC_FRAME_SIZE];  // Circular buffer of pre-emphasized samples
+    int16_t  _frame[WAV_MFCC_FRAME_SIZE];
+    int16_t  _real[WAV_FFT_BINS];
+    int16_t  _imag[WAV_FFT_BINS];
+#else
+    WAV_fft  _fft;
+    float    _history[WAV_MFCC_FRAME_SIZE];  // Circular buffer of pre-emphasized samples
+    float    _frame[WAV_MFCC_FRAME_SIZE];
+    float    _real[WAV_FFT_BINS];
+    float    _imag[WAV_FFT_BINS];
+#endif
+    float    _mel_log[WAV_MFCC_FILTER_CNT];
+    float    _mfcc[WAV_MFCC_COEF_CNT];
+    float    _prev_sample = 0;
+    uint16_t _write_idx = 0;
+    uint32_t _sample_cnt = 0;
+    uint32_t _frame_cnt = 0;
+    WAV_vad *_gate = NULL;
+    bool     _silent = false;
+    uint32_t _silent_cnt = 0;
+};
+
+#endif // _WAV_MFCC_
@@ -0,0 +1,118 @@
+#include "WAV_midi_clock.h"
+
+WAV_midi_clock::WAV_midi_clock()
+{
+
+}
+
+/*
+ * Opens the MIDI port and starts the clock task.
+ * Returns true on success, false on failure.
+ */
+bool WAV_midi_clock::begin(HardwareSerial *port)
+{
+  _port = port;
+  _port->begin(WAV_CLOCK_BAUD);
+
+  if (_task == NULL)
+  {
+    if (xTaskCreatePinnedToCore(clockTask, "midiclock", WAV_CLOCK_TASK_STACK, this, 2, &_task, WAV_CLOCK_TASK_CORE) != pdPASS)
+    {
+      Serial.println(F("Unable to start MIDI clock task!"));
+      _task = NULL;
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * Moves the clock grid to a beat at micros() time beat_us.  The first beat
+ * after begin() or stop() sends Start.
+ */
+void WAV_midi_clock::beat(uint32_t beat_us, float bpm)
+{
+  if (_task == NULL || bpm <= 0) return;
+
+  portENTER_CRITICAL(&_mux);
+  if (!_running && !_stop_pending)
+  {
+    _beat_cnt = 0;
+    _tick_cnt = 0;
+    _start_pending = true;
+    _running = true;
+  }
+  else
+  {
+    _beat_cnt++;
+  }
+  _anchor_us = beat_us;
+  _anchor_tick = _beat_cnt * WAV_CLOCK_PPQN;
+  _tick_us = 60000000.0 / (bpm * WAV_CLOCK_PPQN);
+  portEXIT_CRITICAL(&_mux);
+}
+
+/*
+ * Sends Stop, e.g. when the tempo is lost.
+ */
+void WAV_midi_clock::stop()
+{
+  if (_running) _stop_pending = true;
+}
+
+bool WAV_midi_clock::getRunning()
+{
+  return _running;
+}
+
+uint32_t WAV_midi_clock::getTickCount()
+{
+  return _tick_cnt;
+}
+
+//----- PRIVATE METHODS -----//
+
+void WAV_midi_clock::clockTask(void *param)
+{
+  WAV_midi_clock *clock = (WAV_midi_clock *)param;
+
+  while (true)
+  {
+    clock->sendDue();
+    vTaskDelay(WAV_CLOCK_TASK_MS / portTICK_PERIOD_MS);
+  }
+}
+
+/*
+ * Sends Start or Stop if pending, and any ticks that are due on the grid.
+ */
+void WAV_midi_clock::sendDue()
+{
+  if (_stop_pending)
+  {
+    _port->write(MIDI_STOP);
+    _running = false;
+    _stop_pending = false;
+    return;
+  }
+  if (!_running) return;
+
+  if (_start_pending)
+  {
+    _port->write(MIDI_START);
+    _start_pending = false;
+  }
+
+  while (true)
+  {
+    portENTER_CRITICAL(&_mux);
+    uint32_t tick = _tick_cnt;
+    bool     ahead = (tick >= _anchor_tick + WAV_CLOCK_MAX_AHEAD);
+    uint32_t due_us = _anchor_us + (int32_t)((int32_t)(tick - _anchor_tick) * _tick_us);
+    portEXIT_CRITICAL(&_mux);
+
+    if (ahead || (int32_t)(micros() - due_us) < 0) break;
+    _port->write(MIDI_TIMING_CLOCK);
+    _tick_cnt = tick + 1;
+  }
+}
@@ -0,0 +1,56 @@
+#ifndef _WAV_MIDI_CLOCK_
+#define _WAV_MIDI_CLOCK_
+
+#include <Arduino.h>
+
+#define WAV_CLOCK_BAUD        31250
+#define WAV_CLOCK_PPQN           24  // MIDI clocks per beat
+#define WAV_CLOCK_MAX_AHEAD      24  // Clocks sent past the last beat before waiting for the next one
+#define WAV_CLOCK_TASK_STACK   2048
+#define WAV_CLOCK_TASK_CORE       0  // Arduino loop() runs on core 1
+#define WAV_CLOCK_TASK_MS         1  // How often the task sends due clocks
+
+#define MIDI_TIMING_CLOCK      0xF8
+#define MIDI_START             0xFA
+#define MIDI_STOP              0xFC
+
+/*
+ * Sends MIDI beat clock from tracked beats, so a drum machine or the R4ge Pro
+ * synth on the MIDI out (TX2) can play along.
+ * loop() passes each beat with beat(), as a micros() time and a tempo.  The clock
+ * is a grid of WAV_CLOCK_PPQN ticks per beat anchored on the latest beat, and a
+ * task on core 0 sends each tick when it is due, so the clock does not jitter
+ * with drawing in loop().  Beats usually arrive after their time (the capture
+ * block and analysis), but the ticks up to then were already sent on the grid
+ * of the previous beat, so a steady tempo needs no correction.  If the grid
+ * moves later the clock waits, if it moves earlier the missed ticks are sent at once.
+ * The first beat sends Start, stop() sends Stop.
+ */
+class WAV_midi_clock
+{
+  public:
+    WAV_midi_clock();
+    bool     begin(HardwareSerial *port);
+    void     beat(uint32_t beat_us, float bpm);
+    void     stop();
+    bool     getRunning();
+    uint32_t getTickCount();
+
+  private:
+    static void clockTask(void *param);
+    void     sendDue();
+
+    HardwareSerial *_port = NULL;
+    TaskHandle_t _task = NULL;
+    portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+    uint32_t _anchor_us = 0;             // Time of the latest beat
+    uint32_t _anchor_tick = 0;           // Tick of the latest beat
+    float    _tick_us = 20833;           // Time between ticks
+    uint32_t _beat_cnt = 0;              // Beats since Start
+    volatile uint32_t _tick_cnt = 0;     // Ticks sent since Start
+    volatile bool _running = false;
+    volatile bool _start_pending = false;
+    volatile bool _stop_pending = false;
+};
+
+#endif // _WAV_MIDI_CLOCK_
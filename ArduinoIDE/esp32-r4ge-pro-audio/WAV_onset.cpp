@@ -0,0 +1,189 @@
+#include <math.h>
+#include <string.h>
+#include "WAV_onset.h"
+
+WAV_onset::WAV_onset()
+{
+  begin(_sample_rate);
+}
+
+void WAV_onset::begin(uint32_t sample_rate)
+{
+  _sample_rate = sample_rate;
+  reset();
+}
+
+/*
+ * Clears the sample ring, the previous spectrum and the threshold history.
+ */
+void WAV_onset::reset()
+{
+  memset(_ring, 0, sizeof(_ring));
+  memset(_prev_mag, 0, sizeof(_prev_mag));
+  memset(_history, 0, sizeof(_history));
+  memset(_flux, 0, sizeof(_flux));
+  _history_sum = 0;
+  _novelty = 0;
+  _strength = 0;
+  _write_idx = 0;
+  _hop_cnt = 0;
+  _sample_cnt = 0;
+  _frame_cnt = 0;
+  _last_onset = 0;
+  _onset_cnt = 0;
+  _onset = false;
+}
+
+/*
+ * Adds a sample.  Returns true when a new frame has been analysed, then
+ * getOnset() and getNovelty() are up to date.
+ */
+bool WAV_onset::pushSample(int16_t sample)
+{
+  _ring[_write_idx] = sample;
+  _write_idx = (_write_idx + 1) & (WAV_FFT_SIZE - 1);
+  _sample_cnt++;
+
+  if (++_hop_cnt < WAV_ONSET_HOP) return false;
+  _hop_cnt = 0;
+
+  analyse();
+  _frame_cnt++;
+  return true;
+}
+
+/*
+ * Sets how far over the local mean flux a peak has to be to count as an onset.
+ */
+void WAV_onset::setThreshold(float ratio, float delta)
+{
+  _ratio = ratio;
+  _delta = delta;
+}
+
+/*
+ * True if the frame before the last one was an onset.
+ */
+bool WAV_onset::getOnset()
+{
+  return _onset;
+}
+
+/*
+ * Flux of the last onset over its threshold, 1 is just detected.
+ */
+float WAV_onset::getStrength()
+{
+  return _strength;
+}
+
+/*
+ * Flux of the last frame above the local mean, the onset envelope for the tempo tracker.
+ */
+float WAV_onset::getNovelty()
+{
+  return _novelty;
+}
+
+/*
+ * Sample position of the last onset, counted from begin().
+ */
+uint32_t WAV_onset::getOnsetSample()
+{
+  int32_t sample = frameToSample(_last_onset);
+  return (sample > 0 ? sample : 0);
+}
+
+/*
+ * Sample position of an onset whose flux peaks in frame (counted from 0), 
+ * allowing for the window.  Can be a fraction of a frame.
+ */
+int32_t WAV_onset::frameToSample(float frame)
+{
+  return (int32_t)lrintf((frame + 1) * WAV_ONSET_HOP) - WAV_ONSET_LATENCY;
+}
+
+uint32_t WAV_onset::getSampleCount()
+{
+  return _sample_cnt;
+}
+
+uint32_t WAV_onset::getFrameCount()
+{
+  return _frame_cnt;
+}
+
+uint32_t WAV_onset::getOnsetCount()
+{
+  return _onset_cnt;
+}
+
+float WAV_onset::getFrameRate()
+{
+  return (float)_sample_rate / WAV_ONSET_HOP;
+}
+
+//----- PRIVATE METHODS -----//
+
+/*
+ * Works out the flux of the newest frame, then checks if the previous frame
+ * was a peak over the threshold.
+ */
+void WAV_onset::analyse()
+{
+#if WAV_FFT_USE_Q15
+  // Oldest sample first.  The Q15 FFT applies the window itself
+  for (uint16_t i = 0; i < WAV_FFT_SIZE; i++)
+  {
+    _frame[i] = _ring[(_write_idx + i) & (WAV_FFT_SIZE - 1)];
+  }
+  float gain = ldexpf(WAV_ONSET_LOG_GAIN, _fft.realForward(_frame, _real, _imag));
+#else
+  const float *hann = WAV_fft::getHannWindow();
+
+  // Oldest sample first
+  for (uint16_t i = 0; i < WAV_FFT_SIZE; i++)
+  {
+    _frame[i] = _ring[(_write_idx + i) & (WAV_FFT_SIZE - 1)] * hann[i];
+  }
+  _fft.realForward(_frame, _real, _imag);
+#endif
+
+  float flux = 0;
+  for (uint16_t b = WAV_ONSET_FIRST_BIN; b < WAV_FFT_BINS; b++)
+  {
+#if WAV_FFT_USE_Q15
+    float mag = logf(1.0f + gain * WAV_fft_q15::magnitude(_real[b], _imag[b]));
+#else
+    float mag = logf(1.0f + WAV_ONSET_LOG_GAIN * sqrtf(_real[b] * _real[b] + _imag[b] * _imag[b]));
+#endif
+    float rise = mag - _prev_mag[b];
+    if (rise > 0) flux += rise;
+    _prev_mag[b] = mag;
+  }
+  flux /= (WAV_FFT_BINS - WAV_ONSET_FIRST_BIN);
+  if (_sample_cnt < WAV_FFT_SIZE) flux = 0;  // The ring is still filling
+
+  _flux[0] = _flux[1];
+  _flux[1] = _flux[2];
+  _flux[2] = flux;
+
+  // Threshold for the previous frame, from the frames before it
+  float mean = _history_sum / WAV_ONSET_MEAN_FRAMES;
+  float threshold = mean * _ratio + _delta;
+
+  _onset = (_flux[1] > threshold && _flux[1] >= _flux[0] && _flux[1] > _flux[2] &&
+            (_onset_cnt == 0 || _frame_cnt - 1 - _last_onset >= WAV_ONSET_MIN_GAP));
+  if (_onset)
+  {
+    _last_onset = _frame_cnt - 1;
+    _strength = _flux[1] / threshold;
+    _onset_cnt++;
+  }
+
+  _novelty = (flux > mean ? flux - mean : 0);
+
+  uint16_t h = _frame_cnt & (WAV_ONSET_MEAN_FRAMES - 1);
+  _history_sum += _flux[1] - _history[h];
+  _history[h] = _flux[1];
+}
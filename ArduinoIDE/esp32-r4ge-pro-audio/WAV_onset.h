@@ -0,0 +1,81 @@
+#ifndef _WAV_ONSET_
+#define _WAV_ONSET_
+
+#include <stdint.h>
+#include "WAV_fft_q15.h"
+
+#define WAV_ONSET_HOP          128    // New samples per frame, ~86 frames per second at 11025 Hz
+#define WAV_ONSET_FIRST_BIN      2    // Skips DC and the lowest rumble
+#define WAV_ONSET_LOG_GAIN    0.01    // Magnitudes are compressed as log(1 + gain * mag)
+#define WAV_ONSET_MEAN_FRAMES   16    // Frames averaged for the adaptive threshold (~190 msec).  Must be power of 2
+#define WAV_ONSET_RATIO        1.5    // A peak has to be this many times the local mean flux
+#define WAV_ONSET_DELTA       0.02    // plus this much, so steady noise does not trigger
+#define WAV_ONSET_MIN_GAP        4    // Frames between onsets (~46 msec)
+#define WAV_ONSET_LATENCY      176    // Samples from an onset to the end of the frame where the flux peaks
+
+/*
+ * Onset detector using half-wave rectified spectral flux.
+ * Every WAV_ONSET_HOP samples the last WAV_FFT_SIZE samples are windowed and
+ * transformed, and the log magnitude of each bin is compared with the previous
+ * frame.  Only rises are summed, so the flux jumps when a note or drum hit starts
+ * and stays low as it decays.  A frame is an onset when its flux is a local peak
+ * above an adaptive threshold of the recent mean, so it follows the level of
+ * the music.  Onsets are reported one frame late, when the peak is known.
+ * The novelty (flux above the local mean) is also kept for the tempo tracker.
+ * With WAV_FFT_USE_Q15 the frame is transformed in Q15, and the magnitudes come 
+ * from WAV_fft_q15::magnitude() and the block exponent.
+ * No Arduino dependencies.
+ */
+class WAV_onset
+{
+  public:
+    WAV_onset();
+    void     begin(uint32_t sample_rate);
+    void     reset();
+    bool     pushSample(int16_t sample);
+    void     setThreshold(float ratio, float delta);
+    bool     getOnset();
+    float    getStrength();
+    float    getNovelty();
+    uint32_t getOnsetSample();
+    static int32_t frameToSample(float frame);
+    uint32_t getSampleCount();
+    uint32_t getFrameCount();
+    uint32_t getOnsetCount();
+    float    getFrameRate();
+
+  private:
+    void     analyse();
+
+#if WAV_FFT_USE_Q15
+    WAV_fft_q15 _fft;
+    int16_t  _ring[WAV_FFT_SIZE];
+    int16_t  _frame[WAV_FFT_SIZE];
+    int16_t  _real[WAV_FFT_BINS];
+    int16_t  _imag[WAV_FFT_BINS];
+#else
+    WAV_fft  _fft;
+    float    _ring[WAV_FFT_SIZE];
+    float    _frame[WAV_FFT_SIZE];
+    float    _real[WAV_FFT_BINS];
+    float    _imag[WAV_FFT_BINS];
+#endif
+    float    _prev_mag[WAV_FFT_BINS];       // Log magnitudes of the previous frame
+    float    _history[WAV_ONSET_MEAN_FRAMES];
+    float    _history_sum = 0;
+    float    _flux[3];                      // Frames n-2, n-1 and n
+    float    _novelty = 0;
+    float    _strength = 0;
+    float    _ratio = WAV_ONSET_RATIO;
+    float    _delta = WAV_ONSET_DELTA;
+    uint32_t _sample_rate = 11025;
+    uint16_t _write_idx = 0;
+    uint16_t _hop_cnt = 0;
+    uint32_t _sample_cnt = 0;
+    uint32_t _frame_cnt = 0;
+    uint32_t _last_onset = 0;               // Frame of the last onset
+    uint32_t _onset_cnt = 0;
+    bool     _onset = false;
+};
+
+#endif // _WAV_ONSET_
@@ -0,0 +1,183 @@
+#include "WAV_peaks.h"
+
+WAV_peaks::WAV_peaks()
+{
+  uint16_t offset = 0;
+  for (uint8_t level = 0; level < WAV_PEAKS_LEVELS; level++)
+  {
+    _offset[level] = offset;
+    offset += WAV_PEAKS_BASE_CNT >> level;
+  }
+  reset();
+}
+
+/*
+ * Clears the cache to start a new waveform.
+ */
+void WAV_peaks::reset()
+{
+  for (uint8_t level = 0; level < WAV_PEAKS_LEVELS; level++)
+  {
+    _count[level] = 0;
+  }
+  _pending_cnt = 0;
+  _block = WAV_PEAKS_BLOCK;
+  _sample_cnt = 0;
+}
+
+/*
+ * Adds the next sample of the waveform.
+ */
+void WAV_peaks::pushSample(int16_t sample)
+{
+  if (_pending_cnt == 0)
+  {
+    _pending.lo = sample;
+    _pending.hi = sample;
+  }
+  else if (sample < _pending.lo)
+    _pending.lo = sample;
+  else if (sample > _pending.hi)
+    _pending.hi = sample;
+
+  _sample_cnt++;
+  if (++_pending_cnt < _block) return;
+
+  addEntry(0, &_pending);
+  _pending_cnt = 0;
+  if (_count[0] >= WAV_PEAKS_BASE_CNT) dropLevel();
+}
+
+void WAV_peaks::pushBlock(const int16_t *samples, uint16_t count)
+{
+  for (uint16_t i = 0; i < count; i++)
+  {
+    pushSample(samples[i]);
+  }
+}
+
+uint32_t WAV_peaks::getSampleCount()
+{
+  return _sample_cnt;
+}
+
+/*
+ * Returns the samples per level 0 entry.  Zooming in further than this needs the samples themselves.
+ */
+uint32_t WAV_peaks::getBlockSize()
+{
+  return _block;
+}
+
+/*
+ * Returns the coarsest level whose entries are no wider than samples_per_col, 
+ * so each column reads two or three entries.
+ */
+uint8_t WAV_peaks::findLevel(uint32_t samples_per_col)
+{
+  uint8_t level = 0;
+  while (level < WAV_PEAKS_LEVELS - 1 && (_block << (level + 1)) <= samples_per_col)
+  {
+    level++;
+  }
+  return level;
+}
+
+/*
+ * Fills count columns of samples_per_col samples each, starting at sample start.
+ * Columns past the end of the waveform are set to 0.  Entries that straddle the 
+ * edge of a column are included whole, so a peak may show one entry early or late.
+ */
+void WAV_peaks::getPeaks(uint32_t start, uint32_t samples_per_col, uint16_t count, wav_peak_t *peaks)
+{
+  if (samples_per_col == 0) samples_per_col = 1;
+  
+  uint8_t  level = findLevel(samples_per_col);
+  uint32_t size = _block << level;
+  uint32_t last = (_sample_cnt + size - 1) / size;  // Entries, counting a partial one
+
+  for (uint16_t col = 0; col < count; col++)
+  {
+    uint32_t first_sample = start + col * samples_per_col;
+    peaks[col].lo = 0;
+    peaks[col].hi = 0;
+    if (first_sample >= _sample_cnt) continue;
+
+    uint32_t first = first_sample / size;
+    uint32_t end = (first_sample + samples_per_col + size - 1) / size;
+    if (end > last) end = last;
+
+    peaks[col] = getEntry(level, first);
+    for (uint32_t i = first + 1; i < end; i++)
+    {
+      wav_peak_t entry = getEntry(level, i);
+      addPeak(&peaks[col], &entry);
+    }
+  }
+}
+
+/*
+ * Widens peak to also cover other.
+ */
+void WAV_peaks::addPeak(wav_peak_t *peak, const wav_peak_t *other)
+{
+  if (other->lo < peak->lo) peak->lo = other->lo;
+  if (other->hi > peak->hi) peak->hi = other->hi;
+}
+
+//----- PRIVATE METHODS -----//
+
+/*
+ * Appends an entry to a level, and every second entry combines the last two into the level above.
+ */
+void WAV_peaks::addEntry(uint8_t level, const wav_peak_t *peak)
+{
+  wav_peak_t pair = *peak;
+
+  while (true)
+  {
+    uint16_t index = _count[level]++;
+    _peak[_offset[level] + index] = pair;
+
+    if ((index & 1) == 0 || level == WAV_PEAKS_LEVELS - 1) return;
+
+    addPeak(&pair, &_peak[_offset[level] + index - 1]);
+    level++;
+  }
+}
+
+/*
+ * Returns an entry, including the partial one at the end of the waveform, 
+ * which is combined from the levels below.
+ */
+wav_peak_t WAV_peaks::getEntry(uint8_t level, uint32_t index)
+{
+  if (index < _count[level]) return _peak[_offset[level] + index];
+  if (level == 0) return _pending;
+
+  wav_peak_t peak = getEntry(level - 1, index * 2);
+  if ((index * 2 + 1) * (_block << (level - 1)) < _sample_cnt)
+  {
+    wav_peak_t next = getEntry(level - 1, index * 2 + 1);
+    addPeak(&peak, &next);
+  }
+  return peak;
+}
+
+/*
+ * Level 0 is full.  Each level takes the place of the one below, which is exactly 
+ * half its size, and the block size doubles.
+ */
+void WAV_peaks::dropLevel()
+{
+  for (uint8_t level = 0; level < WAV_PEAKS_LEVELS - 1; level++)
+  {
+    for (uint16_t i = 0; i < _count[level + 1]; i++)
+    {
+      _peak[_offset[level] + i] = _peak[_offset[level + 1] + i];
+    }
+    _count[level] = _count[level + 1];
+  }
+  _count[WAV_PEAKS_LEVELS - 1] = 0;
+  _block <<= 1;
+}
@@ -0,0 +1,55 @@
+#ifndef _WAV_PEAKS_
+#define _WAV_PEAKS_
+
+#include <stdint.h>
+
+#define WAV_PEAKS_BLOCK       16  // Samples per finest entry to start with.  Must be a power of 2
+#define WAV_PEAKS_BASE_CNT  1024  // Entries in the finest level.  Must be a power of 2
+#define WAV_PEAKS_LEVELS      11  // log2(WAV_PEAKS_BASE_CNT) + 1, down to a single entry
+#define WAV_PEAKS_TOTAL     (WAV_PEAKS_BASE_CNT * 2 - 1)
+
+typedef struct 
+{
+  int16_t lo;
+  int16_t hi;
+} wav_peak_t;
+
+/*
+ * Multi-resolution min/max cache of a waveform, for drawing it at any zoom.
+ * Level 0 holds the lowest and highest sample of each block of getBlockSize() 
+ * samples, and each level above combines two entries of the one below.
+ * Samples are pushed as they are recorded or loaded.  When level 0 is full it 
+ * is dropped, the other levels move down one and the block size doubles, so 
+ * a recording of any length fits in the same 8 KB.
+ * getPeaks() reads from the one level that matches the zoom, so drawing costs 
+ * about the same for any zoom, pan position or recording length.
+ * No Arduino dependencies.
+ */
+class WAV_peaks
+{
+  public:
+    WAV_peaks();
+    void     reset();
+    void     pushSample(int16_t sample);
+    void     pushBlock(const int16_t *samples, uint16_t count);
+    uint32_t getSampleCount();
+    uint32_t getBlockSize();
+    uint8_t  findLevel(uint32_t samples_per_col);
+    void     getPeaks(uint32_t start, uint32_t samples_per_col, uint16_t count, wav_peak_t *peaks);
+    static void    addPeak(wav_peak_t *peak, const wav_peak_t *other);
+
+  private:
+    void       addEntry(uint8_t level, const wav_peak_t *peak);
+    wav_peak_t getEntry(uint8_t level, uint32_t index);
+    void       dropLevel();
+
+    wav_peak_t _peak[WAV_PEAKS_TOTAL];      // All levels, finest first
+    uint16_t   _offset[WAV_PEAKS_LEVELS];   // Index of each level's first entry in _peak
+    uint16_t   _count[WAV_PEAKS_LEVELS];    // Complete entries in each level
+    wav_peak_t _pending;                    // Block in progress
+    uint32_t   _pending_cnt = 0;
+    uint32_t   _block = WAV_PEAKS_BLOCK;
+    uint32_t   _sample_cnt = 0;
+};
+
+#endif // _WAV_PEAKS_
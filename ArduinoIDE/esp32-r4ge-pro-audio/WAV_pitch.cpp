@@ -0,0 +1,264 @@
+#include <math.h>
+#include <string.h>
+#include "WAV_pitch.h"
+
+WAV_pitch::WAV_pitch()
+{
+  begin(_sample_rate);
+}
+
+/*
+ * Sets the sample rate, which sets the range of lags searched.
+ */
+void WAV_pitch::begin(uint32_t sample_rate)
+{
+  _sample_rate = sample_rate;
+  _min_lag = (uint16_t)(sample_rate / WAV_PITCH_MAX_HZ);
+  _max_lag = (uint16_t)(sample_rate / WAV_PITCH_MIN_HZ) + 1;
+  if (_min_lag < 2) _min_lag = 2;
+  if (_max_lag > WAV_PITCH_WINDOW - 2) _max_lag = WAV_PITCH_WINDOW - 2;  // Room for the interpolation
+  reset();
+}
+
+/*
+ * Clears the ring buffer, filter state and last estimate.
+ */
+void WAV_pitch::reset()
+{
+  for (uint16_t i = 0; i < WAV_FFT_SIZE; i++)
+  {
+    _ring[i] = 0;
+  }
+  _prev_in = 0;
+  _prev_out = 0;
+  _write_idx = 0;
+  _hop_cnt = 0;
+  _sample_cnt = 0;
+  _estimate_cnt = 0;
+  _pitch.freq = 0;
+  _pitch.clarity = 0;
+  _pitch.rms = 0;
+}
+
+/*
+ * Adds a sample.  Returns true when a new estimate is ready for getPitch().
+ */
+bool WAV_pitch::pushSample(int16_t sample)
+{
+  // DC blocking filter:  y[n] = x[n] - x[n-1] + pole * y[n-1]
+  float in = (float)sample;
+  _prev_out = in - _prev_in + WAV_PITCH_DC_POLE * _prev_out;
+  _prev_in = in;
+
+#if WAV_FFT_USE_Q15
+  _ring[_write_idx] = (int16_t)(_prev_out > 32767 ? 32767 : (_prev_out < -32768 ? -32768 : _prev_out));
+#else
+  _ring[_write_idx] = _prev_out;
+#endif
+  _write_idx = (_write_idx + 1) % WAV_FFT_SIZE;
+  _sample_cnt++;
+
+  if (++_hop_cnt < WAV_PITCH_HOP || _sample_cnt < WAV_FFT_SIZE) return false;
+  _hop_cnt = 0;
+
+  estimate();
+  _estimate_cnt++;
+  return true;
+}
+
+/*
+ * Sets the normalized difference a period has to dip below, and the level 
+ * below which frames are treated as unvoiced.
+ */
+void WAV_pitch::setThreshold(float threshold, float min_rms)
+{
+  _threshold = threshold;
+  _min_rms = min_rms;
+}
+
+void WAV_pitch::getPitch(wav_pitch_t *pitch)
+{
+  *pitch = _pitch;
+}
+
+uint32_t WAV_pitch::getEstimateCount()
+{
+  return _estimate_cnt;
+}
+
+/*
+ * Converts a frequency to a MIDI note number with a fraction, A4 (440 Hz) = 69.0
+ */
+float WAV_pitch::freqToNote(float freq)
+{
+  if (freq <= 0) return 0;
+  return 69.0 + 12.0 * log2f(freq / 440.0);
+}
+
+/*
+ * Finds the period of the frame in the ring buffer.
+ */
+void WAV_pitch::estimate()
+{
+  const uint16_t n = WAV_FFT_SIZE;
+  const uint16_t w = WAV_PITCH_WINDOW;
+  
+  // Unwrap the ring so the oldest sample is first.  The imaginary part is the 
+  // whole frame, the real part only the first window, so both transform at once.
+  uint16_t tail = n - _write_idx;
+  memcpy(_imag, &_ring[_write_idx], tail * sizeof(_ring[0]));
+  memcpy(&_imag[tail], _ring, _write_idx * sizeof(_ring[0]));
+  memcpy(_real, _imag, w * sizeof(_ring[0]));
+  memset(&_real[w], 0, (n - w) * sizeof(_ring[0]));
+
+  // Energy of the window, and of the frame from the start of the window to the last lag
+  float energy = 0;
+  for (uint16_t i = 0; i < w; i++)
+  {
+    energy += (float)_real[i] * _real[i];
+  }
+  _pitch.rms = sqrtf(energy / w);
+  _pitch.freq = 0;
+  _pitch.clarity = 0;
+  if (_pitch.rms < _min_rms) return;
+
+  _lag_energy[0] = energy;
+  for (uint16_t lag = 1; lag <= _max_lag + 1; lag++)
+  {
+    _lag_energy[lag] = _lag_energy[lag - 1] - (float)_imag[lag - 1] * _imag[lag - 1] + (float)_imag[lag + w - 1] * _imag[lag + w - 1];
+  }
+
+#if WAV_FFT_USE_Q15
+  float scale = crossSpectrum();
+#else
+  const float scale = 1.0f / n;
+
+  _fft.complexForward(_real, _imag);
+
+  // Split the two spectra, window A and frame B, and form conj(A) * B.
+  // The cross correlation is real, so conj(conj(A) * B) is transformed 
+  // forward again in place of an inverse transform.
+  for (uint16_t k = 0; k <= n / 2; k++)
+  {
+    uint16_t m = (n - k) % n;
+    float zr = _real[k], zi = _imag[k];
+    float wr = _real[m], wi = _imag[m];
+    float ar = (zr + wr) * 0.5, ai = (zi - wi) * 0.5;
+    float br = (zi + wi) * 0.5, bi = (wr - zr) * 0.5;
+    float pr = ar * br + ai * bi;
+    float pi = ar * bi - ai * br;
+    
+    _real[k] = pr;
+    _imag[k] = -pi;
+    _real[m] = pr;
+    _imag[m] = pi;
+  }
+  _fft.complexForward(_real, _imag);
+#endif
+
+  // Difference d(lag) = E(window) + E(window at lag) - 2 * correlation(lag), 
+  // then the cumulative mean normalization d'(lag) = d(lag) * lag / sum(d(1..lag))
+  float sum = 0;
+  _diff[0] = 1;
+  for (uint16_t lag = 1; lag <= _max_lag + 1; lag++)
+  {
+    float diff = energy + _lag_energy[lag] - 2 * _real[lag] * scale;
+    if (diff < 0) diff = 0;  // Rounding
+    sum += diff;
+    _diff[lag] = (sum > 0 ? diff * lag / sum : 1);
+  }
+
+  // First dip below the threshold.  Each local minimum is tested at its 
+  // interpolated depth, as high pitches have only a few samples per period 
+  // and the true minimum can fall between two lags.
+  float lowest = 1;
+  for (uint16_t lag = _min_lag; lag <= _max_lag; lag++)
+  {
+    if (_diff[lag] >= _diff[lag - 1] || _diff[lag] > _diff[lag + 1]) continue;
+
+    float depth;
+    float shift = interpolate(lag, &depth);
+    if (depth < lowest) lowest = depth;
+    if (depth < _threshold)
+    {
+      _pitch.freq = _sample_rate / (lag + shift);
+      _pitch.clarity = 1 - depth;
+      return;
+    }
+  }
+  _pitch.clarity = 1 - lowest;  // Unvoiced
+}
+
+/*
+ * Fits a parabola through a minimum and its neighbours.
+ * Returns the offset of the true minimum from lag, and its depth in value.
+ */
+float WAV_pitch::interpolate(uint16_t lag, float *value)
+{
+  float prev = _diff[lag - 1], next = _diff[lag + 1];
+  float curve = prev - 2 * _diff[lag] + next;
+  
+  if (curve <= 0)
+  {
+    *value = _diff[lag];
+    return 0;
+  }
+  
+  float shift = 0.5 * (prev - next) / curve;
+  if (shift > 0.5) shift = 0.5;
+  if (shift < -0.5) shift = -0.5;
+  *value = _diff[lag] - 0.25 * (prev - next) * shift;
+  if (*value < 0) *value = 0;
+  return shift;
+}
+
+#if WAV_FFT_USE_Q15
+/*
+ * Q15 version of the cross correlation in estimate():  transforms the window 
+ * and frame, forms conj(A) * B, and transforms that again.  The products are 
+ * shifted so the largest fits the FFT headroom, in a first pass that only finds 
+ * the peak.  Returns the scale from _real[lag] to the correlation at lag.
+ */
+float WAV_pitch::crossSpectrum()
+{
+  const uint16_t n = WAV_FFT_SIZE;
+  int     exponent = 2 * _fft.complexForward(_real, _imag);
+  int32_t peak = 0;
+  int8_t  shift = 0;
+
+  // A and B are exact to half a unit, and each product is halved so the sums fit 32 bits:
+  // conj(A) * B is (pr, pi) * 2^(2 * exponent + 1)
+  for (uint8_t pass = 0; pass < 2; pass++)
+  {
+    int32_t round = (shift > 0 ? 1 << (shift - 1) : 0);
+
+    for (uint16_t k = 0; k <= n / 2; k++)
+    {
+      uint16_t m = (n - k) % n;
+      int32_t zr = _real[k], zi = _imag[k];
+      int32_t wr = _real[m], wi = _imag[m];
+      int32_t ar = (zr + wr) >> 1, ai = (zi - wi) >> 1;
+      int32_t br = (zi + wi) >> 1, bi = (wr - zr) >> 1;
+      int32_t pr = ((ar * br) >> 1) + ((ai * bi) >> 1);
+      int32_t pi = ((ar * bi) >> 1) - ((ai * br) >> 1);
+
+      if (pass == 0)
+      {
+        if (abs(pr) > peak) peak = abs(pr);
+        if (abs(pi) > peak) peak = abs(pi);
+        continue;
+      }
+      pr = (pr + round) >> shift;
+      pi = (pi + round) >> shift;
+      _real[k] = (int16_t)pr;
+      _imag[k] = (int16_t)-pi;
+      _real[m] = (int16_t)pr;
+      _imag[m] = (int16_t)pi;
+    }
+    while ((peak >> shift) >= WAV_FFT_Q15_HEADROOM) shift++;
+  }
+
+  exponent += 1 + shift + _fft.complexForward(_real, _imag);
+  return ldexpf(1.0f / n, exponent);
+}
+#endif
@@ -0,0 +1,80 @@
+#ifndef _WAV_PITCH_
+#define _WAV_PITCH_
+
+#include <stdint.h>
+#include "WAV_fft_q15.h"
+
+#define WAV_PITCH_WINDOW     (WAV_FFT_SIZE / 2)  // Samples compared at each lag.  Lags up to this use the rest of the frame
+#define WAV_PITCH_HOP        256    // New samples per estimate, ~43 per second at 11025 Hz
+#define WAV_PITCH_MIN_HZ     60.0   // Lowest pitch, must be above sample_rate / WAV_PITCH_WINDOW
+#define WAV_PITCH_MAX_HZ     1500.0
+#define WAV_PITCH_THRESHOLD  0.15   // First dip in the normalized difference below this is the period
+#define WAV_PITCH_MIN_RMS    40.0   // Quieter frames are unvoiced
+#define WAV_PITCH_DC_POLE    0.995  // DC blocking filter pole, removes the microphone bias
+
+typedef struct
+{
+  float freq;     // Hz, 0 if unvoiced
+  float clarity;  // 1 - normalized difference at the period.  1 is perfectly periodic
+  float rms;      // Level of the frame
+} wav_pitch_t;
+
+/*
+ * YIN pitch detector for a live sample stream.
+ * Every WAV_PITCH_HOP samples the last WAV_FFT_SIZE samples are analysed.  The 
+ * difference function for every lag comes from one FFT cross correlation of the 
+ * first half of the frame with the whole frame, instead of a multiply per lag and 
+ * sample.  Taking the first lag that dips below the threshold, rather than the 
+ * largest peak, avoids the octave errors of picking the strongest FFT bin, and 
+ * parabolic interpolation gives a fraction of a sample (under a cent at A4).
+ * With WAV_FFT_USE_Q15 the ring holds int16 samples and both transforms are Q15.
+ * The cross spectrum is renormalized between them, and the block exponents are 
+ * applied to the correlation at each lag as the difference is taken.
+ * No Arduino dependencies.
+ */
+class WAV_pitch
+{
+  public:
+    WAV_pitch();
+    void     begin(uint32_t sample_rate);
+    void     reset();
+    bool     pushSample(int16_t sample);
+    void     setThreshold(float threshold, float min_rms);
+    void     getPitch(wav_pitch_t *pitch);
+    uint32_t getEstimateCount();
+    static float freqToNote(float freq);
+
+  private:
+    void     estimate();
+    float    interpolate(uint16_t lag, float *value);
+    
+#if WAV_FFT_USE_Q15
+    float    crossSpectrum();
+
+    WAV_fft_q15 _fft;
+    int16_t  _ring[WAV_FFT_SIZE];
+    int16_t  _real[WAV_FFT_SIZE];
+    int16_t  _imag[WAV_FFT_SIZE];
+#else
+    WAV_fft  _fft;
+    float    _ring[WAV_FFT_SIZE];
+    float    _real[WAV_FFT_SIZE];
+    float    _imag[WAV_FFT_SIZE];
+#endif
+    float    _diff[WAV_PITCH_WINDOW];        // Cumulative mean normalized difference by lag
+    float    _lag_energy[WAV_PITCH_WINDOW];  // Energy of the window shifted by lag
+    float    _prev_in = 0;
+    float    _prev_out = 0;
+    float    _threshold = WAV_PITCH_THRESHOLD;
+    float    _min_rms = WAV_PITCH_MIN_RMS;
+    uint32_t _sample_rate = 11025;
+    uint16_t _min_lag = 7;
+    uint16_t _max_lag = 183;
+    uint16_t _write_idx = 0;
+    uint16_t _hop_cnt = 0;
+    uint32_t _sample_cnt = 0;
+    uint32_t _estimate_cnt = 0;
+    wav_pitch_t _pitch;
+};
+
+#endif // _WAV_PITCH_
@@ -0,0 +1,181 @@
+#include "WAV_player.h"
+
+WAV_player::WAV_player()
+{
+
+}
+
+/*
+ * Opens the file, prefills the ring and starts the I2S output at the file's sample rate.
+ * I2S must not be in use by anything else (see WAV_capture_i2s::end()).
+ * Returns true on success, false on failure.
+ */
+bool WAV_player::begin(const char *filename, const i2s_config_t *config, const i2s_pin_config_t *pins, i2s_port_t port)
+{
+  esp_err_t err;
+
+  if (_playing) end();
+  if (!_reader.open(filename)) return false;
+
+  _port = port;
+  _write_pos = 0;
+  _read_pos = 0;
+  _underruns = 0;
+  _eof = false;
+  _done = false;
+  _tail = 0;
+  if (_conv != NULL && _conv->getLoaded())
+  {
+    _conv->reset();
+    _tail = _conv->getTapCount() + WAV_CONV_BLOCK;  // Latency plus the IR
+  }
+  update();
+
+  err = i2s_driver_install(_port, config, 0, NULL);
+  if (err != ESP_OK)
+  {
+    Serial.print(F("I2S driver install fail: "));
+    Serial.println(err);
+    _reader.close();
+    return false;
+  }
+  i2s_set_pin(_port, pins);
+  i2s_set_clk(_port, _reader.getSampleRate(), I2S_BITS_PER_SAMPLE_16BIT, I2S_CHANNEL_MONO);
+
+  _playing = true;
+  if (_task == NULL)
+  {
+    if (xTaskCreatePinnedToCore(playTask, "player", WAV_PLAY_TASK_STACK, this, 2, &_task, WAV_PLAY_TASK_CORE) != pdPASS)
+    {
+      Serial.println(F("Unable to start player task!"));
+      _task = NULL;
+      end();
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * Tops up the prefetch ring from the SD card.  Call from loop().
+ * Returns false once the whole file has been played.
+ */
+bool WAV_player::update()
+{
+  if (_done) return false;
+
+  while (!_eof && WAV_PLAY_RING_LEN - (_write_pos - _read_pos) >= WAV_READ_BLOCK_SIZE / 2)
+  {
+    // Read straight into the ring.  WAV_READ_BLOCK_SIZE / 2 divides the ring, so a read never wraps
+    uint32_t count = _reader.readMono(&_ring[_write_pos & (WAV_PLAY_RING_LEN - 1)], WAV_READ_BLOCK_SIZE / 2);
+    _write_pos += count;
+    if (count < WAV_READ_BLOCK_SIZE / 2) _eof = true;
+  }
+  return true;
+}
+
+/*
+ * Stops playback and releases the I2S port.
+ */
+void WAV_player::end()
+{
+  if (!_playing) return;
+
+  _playing = false;
+  while (_busy) delay(1);  // Let the task finish its current write
+
+  i2s_driver_uninstall(_port);
+  _reader.close();
+  _done = true;
+}
+
+/*
+ * Sets the convolver the output is run through, or NULL for none.
+ * Only change it, or its IR, while nothing is playing.
+ */
+void WAV_player::setConvolver(WAV_conv *conv)
+{
+  _conv = conv;
+}
+
+bool WAV_player::getPlaying()
+{
+  return _playing && !_done;
+}
+
+/*
+ * Returns the number of blocks played as silence because the ring was empty.
+ */
+uint32_t WAV_player::getUnderruns()
+{
+  return _underruns;
+}
+
+/*
+ * Writes ring blocks to I2S while playing.  The task is kept between files.
+ */
+void WAV_player::playTask(void *param)
+{
+  WAV_player *player = (WAV_player *)param;
+
+  while (true)
+  {
+    player->_busy = true;
+    if (player->_playing && !player->_done)
+    {
+      player->writeBlock();
+      player->_busy = false;
+    }
+    else
+    {
+      player->_busy = false;
+      vTaskDelay(10 / portTICK_PERIOD_MS);
+    }
+  }
+}
+
+void WAV_player::writeBlock()
+{
+  int16_t  block[WAV_PLAY_BLOCK];
+  uint32_t available = _write_pos - _read_pos;
+  uint32_t count = (available < WAV_PLAY_BLOCK ? available : WAV_PLAY_BLOCK);
+  size_t   bytes_out;
+
+  if (count < WAV_PLAY_BLOCK && !_eof)
+  {
+    // Ring ran dry, keep the DMA fed with silence rather than repeating old data
+    count = 0;
+    _underruns++;
+  }
+  else if (count == 0 && _tail == 0)
+  {
+    _done = true;  // Everything has been played
+    return;
+  }
+
+  for (uint32_t i = 0; i < count; i++)
+  {
+    block[i] = _ring[(_read_pos + i) & (WAV_PLAY_RING_LEN - 1)];
+  }
+  for (uint32_t i = count; i < WAV_PLAY_BLOCK; i++)
+  {
+    block[i] = WAV_SILENCE;
+  }
+  _read_pos += count;
+
+  if (_conv != NULL && _conv->getLoaded())
+  {
+    if (_eof && count < WAV_PLAY_BLOCK)
+    {
+      uint32_t silent = WAV_PLAY_BLOCK - count;
+      _tail = (_tail > silent ? _tail - silent : 0);
+    }
+    _conv->process(block, WAV_PLAY_BLOCK);
+  }
+  else
+  {
+    _tail = 0;
+  }
+
+  i2s_write(_port, block, sizeof(block), &bytes_out, WAV_PLAY_TIMEOUT_MS / portTICK_PERIOD_MS);
+}
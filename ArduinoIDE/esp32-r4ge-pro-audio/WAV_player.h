@@ -0,0 +1,54 @@
+#ifndef _WAV_PLAYER_
+#define _WAV_PLAYER_
+
+#include <Arduino.h>
+#include "driver/i2s.h"
+#include "WAV_reader.h"
+#include "WAV_conv.h"
+
+#define WAV_PLAY_RING_LEN    8192  // Prefetched samples (~740 msec at 11025 Hz).  Must be power of 2
+#define WAV_PLAY_BLOCK        256  // Samples per I2S write
+#define WAV_PLAY_TASK_STACK  2048
+#define WAV_PLAY_TASK_CORE      0  // Arduino loop() runs on core 1
+#define WAV_PLAY_TIMEOUT_MS   100
+
+/*
+ * Streams a WAV file of any length from the SD card to the I2S output.
+ * update() is called from loop() and tops up a prefetch ring from the card, so 
+ * all SPI use stays on the loop() core with the screen.  A task on core 0 
+ * feeds the ring to I2S.  If the ring runs dry the task plays silence and 
+ * counts an underrun.  Stereo files are mixed to mono for the single speaker.
+ * With setConvolver(), each block is convolved with an impulse response on the 
+ * way to I2S, and silence is played after the file until the IR has rung out.
+ */
+class WAV_player
+{
+  public:
+    WAV_player();
+    bool     begin(const char *filename, const i2s_config_t *config, const i2s_pin_config_t *pins, i2s_port_t port);
+    bool     update();
+    void     end();
+    void     setConvolver(WAV_conv *conv);
+    bool     getPlaying();
+    uint32_t getUnderruns();
+
+  private:
+    static void playTask(void *param);
+    void     writeBlock();
+
+    WAV_reader   _reader;
+    int16_t      _ring[WAV_PLAY_RING_LEN];
+    volatile uint32_t _write_pos = 0;  // Samples added by update()
+    volatile uint32_t _read_pos = 0;   // Samples sent to I2S
+    volatile bool _playing = false;
+    volatile bool _eof = false;        // All samples are in the ring
+    volatile bool _done = false;       // All samples have been sent to I2S
+    volatile bool _busy = false;       // Task is writing to the I2S driver
+    uint32_t     _underruns = 0;
+    WAV_conv    *_conv = NULL;
+    uint32_t     _tail = 0;            // Silent samples still to play through the IR after the file
+    i2s_port_t   _port;
+    TaskHandle_t _task = NULL;
+};
+
+#endif // _WAV_PLAYER_
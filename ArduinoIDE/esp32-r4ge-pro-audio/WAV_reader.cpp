@@ -0,0 +1,315 @@
+#include <string.h>
+#include "WAV_reader.h"
+
+WAV_reader::WAV_reader()
+{
+
+}
+
+/*
+ * Opens a WAV file and finds the fmt and data chunks.
+ * Returns true on success, false on failure.
+ */
+bool WAV_reader::open(const char *filename)
+{
+  wav_riff_t riff;
+  uint32_t   chunk[2];  // ID and size
+  uint8_t    fmt[16];
+  bool       fmt_found = false;
+
+  close();
+  
+  _file = SD.open(filename, FILE_READ);
+  if (!_file)
+  {
+    Serial.println(F("Error opening WAV file!"));
+    Serial.println(filename);
+    return false; // failure
+  }
+
+  if (_file.read((uint8_t *)&riff, sizeof(riff)) < sizeof(riff) || riff.chunkID != WAV_HDR_RIFF || riff.format != WAV_HDR_WAVE)
+  {
+    Serial.println(F("Invalid file format. Must be RIFF WAVE."));
+    close();
+    return false;  // failure
+  }
+
+  while (_file.read((uint8_t *)chunk, sizeof(chunk)) == sizeof(chunk))
+  {
+    uint32_t next_pos = _file.position() + chunk[1] + (chunk[1] & 1);  // Chunks are word aligned
+    
+    if (chunk[0] == WAV_HDR_FMT)
+    {
+      if (chunk[1] < 16 || _file.read(fmt, 16) < 16)
+      {
+        Serial.println(F("Invalid fmt chunk!"));
+        break;
+      }
+      
+      uint16_t audio_format = fmt[0] | (fmt[1] << 8);
+      _channels    = fmt[2] | (fmt[3] << 8);
+      _sample_rate = fmt[4] | (fmt[5] << 8) | ((uint32_t)fmt[6] << 16) | ((uint32_t)fmt[7] << 24);
+      _bits        = fmt[14] | (fmt[15] << 8);
+      
+      if (audio_format != WAV_FMT_PCM || _channels < 1 || _channels > 2 || (_bits != 8 && _bits != 16))
+      {
+        Serial.println(F("Invalid format - must be 8 or 16-bit PCM, mono or stereo!"));
+        break;
+      }
+      _frame_bytes = _channels * (_bits / 8);
+      fmt_found = true;
+    }
+    else if (chunk[0] == WAV_HDR_DATA)
+    {
+      if (!fmt_found)
+      {
+        Serial.println(F("Missing fmt chunk!"));
+        break;
+      }
+      
+      _data_pos = _file.position();
+      _data_bytes = chunk[1];
+      if (_data_pos + _data_bytes > _file.size()) _data_bytes = _file.size() - _data_pos;  // Truncated recording
+      _frame_cnt = _data_bytes / _frame_bytes;
+      _out_rate = _sample_rate;
+      _out_cnt = _frame_cnt;
+      return seekFrame(0);
+    }
+
+    if (!_file.seek(next_pos)) break;
+  }
+
+  if (fmt_found) Serial.println(F("Missing data chunk!"));
+  close();
+  return false;  // failure
+}
+
+void WAV_reader::close()
+{
+  if (_file) _file.close();
+  _frame_cnt = 0;
+  _frame_pos = 0;
+  _block_len = 0;
+  _block_idx = 0;
+  _resampler = NULL;
+}
+
+/*
+ * Reads up to frame_cnt frames of getChannels() interleaved samples.
+ * Returns the number of frames read, 0 at the end of the data.
+ */
+uint32_t WAV_reader::readFrames(int16_t *dest, uint32_t frame_cnt)
+{
+  uint32_t frames = 0;
+
+  while (frames < frame_cnt && _frame_pos < _frame_cnt)
+  {
+    if (_block_idx >= _block_len && !fillBlock()) break;
+    
+    // Blocks hold whole frames, as 1, 2 and 4 byte frames divide the block size
+    for (uint16_t c = 0; c < _channels; c++)
+    {
+      *dest++ = decodeSample(&_block[_block_idx]);
+      _block_idx += _bits / 8;
+    }
+    _frame_pos++;
+    frames++;
+  }
+  return frames;
+}
+
+/*
+ * Reads up to frame_cnt mono samples at the output rate, averaging stereo.
+ * When resampling, the end of the file is followed by silence to flush the 
+ * filter, so all of the file is returned.
+ * Returns the number of samples read, 0 at the end of the data.
+ */
+uint32_t WAV_reader::readMono(int16_t *dest, uint32_t frame_cnt)
+{
+  if (_resampler == NULL) return readSource(dest, frame_cnt);
+
+  uint32_t frames = 0;
+  
+  while (frames < frame_cnt && _out_pos < _out_cnt)
+  {
+    if (_src_idx >= _src_len)
+    {
+      _src_len = readSource(_src, WAV_READ_RESAMPLE_LEN);
+      _src_idx = 0;
+      if (_src_len == 0)
+      {
+        memset(_src, 0, sizeof(_src));
+        _src_len = WAV_READ_RESAMPLE_LEN;
+      }
+    }
+
+    uint32_t count = frame_cnt - frames;
+    if (count > _out_cnt - _out_pos) count = _out_cnt - _out_pos;
+    
+    uint32_t used;
+    count = _resampler->process(&_src[_src_idx], _src_len - _src_idx, &dest[frames], count, &used);
+    _src_idx += used;
+    frames += count;
+    _out_pos += count;
+  }
+  return frames;
+}
+
+/*
+ * Reads up to frame_cnt frames at the file rate, averaging stereo to mono.
+ */
+uint32_t WAV_reader::readSource(int16_t *dest, uint32_t frame_cnt)
+{
+  if (_channels == 1) return readFrames(dest, frame_cnt);
+
+  int16_t  stereo[WAV_READ_BLOCK_SIZE / WAV_READ_MAX_FRAME * 2];
+  uint32_t frames = 0;
+
+  while (frames < frame_cnt)
+  {
+    uint32_t count = frame_cnt - frames;
+    if (count > WAV_READ_BLOCK_SIZE / WAV_READ_MAX_FRAME) count = WAV_READ_BLOCK_SIZE / WAV_READ_MAX_FRAME;
+    
+    count = readFrames(stereo, count);
+    if (count == 0) break;
+    
+    for (uint32_t i = 0; i < count; i++)
+    {
+      *dest++ = (int16_t)(((int32_t)stereo[i * 2] + stereo[i * 2 + 1]) / 2);
+    }
+    frames += count;
+  }
+  return frames;
+}
+
+/*
+ * Moves to the specified frame, for rewinding or looping.
+ */
+bool WAV_reader::seekFrame(uint32_t frame)
+{
+  if (!_file) return false;
+  if (frame > _frame_cnt) frame = _frame_cnt;
+
+  // Keep reads aligned to blocks from the start of the data
+  uint32_t offset = frame * _frame_bytes;
+  uint32_t block_start = offset - (offset % WAV_READ_BLOCK_SIZE);
+  
+  if (!_file.seek(_data_pos + block_start)) return false;
+  _read_bytes = block_start;
+  _block_len = 0;
+  _block_idx = 0;
+  _frame_pos = frame;
+  if (_resampler != NULL) resetResampler();
+
+  if (offset > block_start)
+  {
+    if (!fillBlock()) return false;
+    _block_idx = offset - block_start;
+  }
+  return true;
+}
+
+/*
+ * Sets the rate readMono() returns samples at.  Call after open().
+ * The resampler is rebuilt for the file, and can be shared by readers that 
+ * are not open at the same time.  It is not needed if the rates match.
+ * Returns false if the resampler cannot handle the rates.
+ */
+bool WAV_reader::setOutputRate(uint32_t rate, WAV_resampler_q15 *resampler)
+{
+  _resampler = NULL;
+  _out_rate = _sample_rate;
+  _out_cnt = _frame_cnt;
+  if (rate == _sample_rate) return true;
+
+  if (resampler == NULL || !resampler->begin(_sample_rate, rate))
+  {
+    Serial.println(F("Unable to resample WAV file!"));
+    return false;
+  }
+  
+  _resampler = resampler;
+  _out_rate = rate;
+  _out_cnt = (uint32_t)(((uint64_t)_frame_cnt * rate) / _sample_rate);
+  resetResampler();
+  return true;
+}
+
+uint16_t WAV_reader::getChannels()
+{
+  return _channels;
+}
+
+uint16_t WAV_reader::getBitsPerSample()
+{
+  return _bits;
+}
+
+uint32_t WAV_reader::getSampleRate()
+{
+  return _sample_rate;
+}
+
+uint32_t WAV_reader::getFrameCount()
+{
+  return _frame_cnt;
+}
+
+uint32_t WAV_reader::getFramePos()
+{
+  return _frame_pos;
+}
+
+/*
+ * Samples read by readMono() at the output rate
+ */
+uint32_t WAV_reader::getOutputRate()
+{
+  return _out_rate;
+}
+
+uint32_t WAV_reader::getOutputCount()
+{
+  return _out_cnt;
+}
+
+/*
+ * Restarts the filter at the current frame.  The filter history is silence, 
+ * so the first few msec after a seek fade in.
+ */
+void WAV_reader::resetResampler()
+{
+  _resampler->reset();
+  _src_len = 0;
+  _src_idx = 0;
+  _out_pos = (uint32_t)(((uint64_t)_frame_pos * _out_rate) / _sample_rate);
+}
+
+/*
+ * Reads the next block of sample data, stopping at the end of the data chunk.
+ */
+bool WAV_reader::fillBlock()
+{
+  uint32_t len = _data_bytes - _read_bytes;
+  if (len > WAV_READ_BLOCK_SIZE) len = WAV_READ_BLOCK_SIZE;
+  if (len == 0) return false;
+
+  int bytes_read = _file.read(_block, len);
+  if (bytes_read <= 0) return false;
+
+  _read_bytes += bytes_read;
+  _block_len = bytes_read - (bytes_read % _frame_bytes);
+  _block_idx = 0;
+  return _block_len > 0;
+}
+
+/*
+ * 8-bit WAV samples are unsigned, 16-bit are signed little endian.
+ */
+int16_t WAV_reader::decodeSample(const uint8_t *src)
+{
+  if (_bits == 8)
+    return (int16_t)(((int16_t)src[0] - 128) << 8);
+  
+  return (int16_t)(src[0] | (src[1] << 8));
+}
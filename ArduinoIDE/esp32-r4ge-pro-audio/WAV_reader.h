@@ -0,0 +1,67 @@
+#ifndef _WAV_READER_
+#define _WAV_READER_
+
+#include <SD.h>
+#include "WAV_audio.h"
+#include "WAV_resample_q15.h"
+
+#define WAV_READ_BLOCK_SIZE  512  // Bytes per SD read, one sector
+#define WAV_READ_MAX_FRAME     4  // 16-bit stereo
+#define WAV_READ_RESAMPLE_LEN 128  // Source samples buffered for the resampler
+
+/*
+ * Reads PCM WAV files from the SD card a block at a time.
+ * The RIFF chunks are walked, so fmt chunks longer than 16 bytes and unknown 
+ * chunks (LIST, smpl, ...) before or after the data are skipped.
+ * 8 and 16-bit, mono and stereo are decoded to signed 16-bit samples.
+ * Files of any length can be read, the file is never loaded all at once.
+ * With setOutputRate(), readMono() converts files recorded at other rates.
+ */
+class WAV_reader
+{
+  public:
+    WAV_reader();
+    bool     open(const char *filename);
+    void     close();
+    uint32_t readFrames(int16_t *dest, uint32_t frame_cnt);
+    uint32_t readMono(int16_t *dest, uint32_t frame_cnt);
+    bool     seekFrame(uint32_t frame);
+    bool     setOutputRate(uint32_t rate, WAV_resampler_q15 *resampler);
+    uint16_t getChannels();
+    uint16_t getBitsPerSample();
+    uint32_t getSampleRate();
+    uint32_t getFrameCount();
+    uint32_t getFramePos();
+    uint32_t getOutputRate();
+    uint32_t getOutputCount();
+
+  private:
+    uint32_t readSource(int16_t *dest, uint32_t frame_cnt);
+    void     resetResampler();
+    bool     fillBlock();
+    int16_t  decodeSample(const uint8_t *src);
+
+    File     _file;
+    uint8_t  _block[WAV_READ_BLOCK_SIZE];
+    uint16_t _block_len = 0;
+    uint16_t _block_idx = 0;
+    uint32_t _data_pos = 0;    // File offset of the first frame
+    uint32_t _data_bytes = 0;
+    uint32_t _read_bytes = 0;  // Data bytes loaded into the block so far
+    uint32_t _frame_cnt = 0;
+    uint32_t _frame_pos = 0;
+    uint32_t _sample_rate = 11025;
+    uint16_t _channels = 1;
+    uint16_t _bits = 16;
+    uint16_t _frame_bytes = 2;
+
+    WAV_resampler_q15 *_resampler = NULL;  // Only used when the output rate differs from the file
+    int16_t  _src[WAV_READ_RESAMPLE_LEN];
+    uint16_t _src_len = 0;
+    uint16_t _src_idx = 0;
+    uint32_t _out_rate = 11025;
+    uint32_t _out_cnt = 0;                 // Output samples in the whole file
+    uint32_t _out_pos = 0;
+};
+
+#endif // _WAV_READER_
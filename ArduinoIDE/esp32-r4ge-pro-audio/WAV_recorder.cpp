@@ -0,0 +1,190 @@
+#include "WAV_recorder.h"
+
+WAV_recorder::WAV_recorder()
+{
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+/*
+ * Creates the WAV file and starts recording.  
+ * Returns true on success, false on failure.
+ */
+bool WAV_recorder::begin(const char *filename, uint32_t sample_rate)
+{
+  if (_recording) end();
+
+  Serial.print(F("Recording WAV file: "));
+  Serial.println(filename);
+  
+  _file = SD.open(filename, FILE_WRITE);
+  if (!_file)
+  {
+    Serial.println(F("Error creating WAV file!"));
+    return false; // failure
+  }
+
+  memset(&_stats, 0, sizeof(_stats));
+  for (uint8_t i = 0; i < WAV_REC_BUFFERS; i++)
+  {
+    _full[i] = false;
+  }
+  _fill_idx = 0;
+  _write_idx = 0;
+
+  // Sizes are left at zero until end() patches them
+  _header = wav_header_t();
+  _header.num_channels = 1;
+  _header.sample_rate = sample_rate;
+  _header.bits_per_sample = 16;
+  _header.sample_alignment = 2;
+  _header.byte_rate = sample_rate * 2;
+  _header.wav_size = WAV_REC_HEADER_SIZE - 8;
+  _header.data_bytes = 0;
+  
+  memcpy(_buffer[0], &_header, WAV_REC_HEADER_SIZE);
+  _fill_len = WAV_REC_HEADER_SIZE;
+
+  _recording = true;
+  return true;
+}
+
+/*
+ * Adds samples to the fill buffer.  If every buffer is waiting to be written 
+ * the samples are dropped and counted as overruns.
+ */
+void WAV_recorder::addSamples(const int16_t *samples, uint16_t count)
+{
+  if (!_recording) return;
+
+  for (uint16_t i = 0; i < count; i++)
+  {
+    if (_full[_fill_idx])
+    {
+      _stats.overruns += count - i;
+      return;
+    }
+    
+    // WAV is little endian
+    _buffer[_fill_idx][_fill_len++] = (uint8_t)(samples[i] & 0xFF);
+    _buffer[_fill_idx][_fill_len++] = (uint8_t)((uint16_t)samples[i] >> 8);
+
+    if (_fill_len >= WAV_REC_BUFFER_SIZE)
+    {
+      _full[_fill_idx] = true;
+      _fill_idx = (_fill_idx + 1) & (WAV_REC_BUFFERS - 1);
+      _fill_len = 0;
+    }
+  }
+}
+
+/*
+ * Writes any full buffers to the card.  Call from loop().
+ * Returns false if a write failed (usually a full card) and recording was stopped.
+ */
+bool WAV_recorder::update()
+{
+  if (!_recording) return true;
+
+  while (_full[_write_idx])
+  {
+    if (!writeBuffer(_write_idx, WAV_REC_BUFFER_SIZE))
+    {
+      Serial.println(F("WAV recording stopped, SD write failed!"));
+      end();
+      return false;
+    }
+    _full[_write_idx] = false;
+    _write_idx = (_write_idx + 1) & (WAV_REC_BUFFERS - 1);
+  }
+  return true;
+}
+
+/*
+ * Writes the remaining samples, patches the header sizes and closes the file.
+ * Returns true on success, false on failure.
+ */
+bool WAV_recorder::end()
+{
+  bool success = true;
+  
+  if (!_recording) return false;
+  _recording = false;
+
+  // Any full buffers first, then the partial fill buffer
+  while (_full[_write_idx] && success)
+  {
+    success = writeBuffer(_write_idx, WAV_REC_BUFFER_SIZE);
+    _full[_write_idx] = false;
+    _write_idx = (_write_idx + 1) & (WAV_REC_BUFFERS - 1);
+  }
+  if (success && _fill_len > 0)
+  {
+    success = writeBuffer(_fill_idx, _fill_len);
+  }
+
+  success = patchHeader() && success;
+  _file.close();
+
+  if (success)
+    Serial.println(F("WAV file successfully recorded."));
+  return success;
+}
+
+bool WAV_recorder::getRecording()
+{
+  return _recording;
+}
+
+void WAV_recorder::getStats(wav_recorder_stats_t *stats)
+{
+  *stats = _stats;
+}
+
+/*
+ * Returns the SD write rate in bytes per second of write time.
+ * Recording needs sample_rate * 2 bytes per second.
+ */
+uint32_t WAV_recorder::getThroughput()
+{
+  if (_stats.write_us == 0) return 0;
+  return (uint32_t)((uint64_t)_stats.bytes * 1000000 / _stats.write_us);
+}
+
+/*
+ * WAV_capture subscriber.  Pass the recorder as the context.
+ */
+void WAV_recorder::captureBlock(const int16_t *samples, uint16_t count, void *context)
+{
+  ((WAV_recorder *)context)->addSamples(samples, count);
+}
+
+bool WAV_recorder::writeBuffer(uint8_t idx, uint16_t len)
+{
+  uint32_t start_us = micros();
+  size_t   bytes_written = _file.write(_buffer[idx], len);
+  uint32_t elapsed_us = micros() - start_us;
+
+  _stats.writes++;
+  _stats.write_us += elapsed_us;
+  if (elapsed_us > _stats.max_write_us) _stats.max_write_us = elapsed_us;
+  
+  if (bytes_written != len) return false;
+  
+  _stats.bytes += len;
+  _stats.samples = (_stats.bytes - WAV_REC_HEADER_SIZE) / 2;
+  return true;
+}
+
+/*
+ * Writes the final RIFF and data chunk sizes into the header.
+ */
+bool WAV_recorder::patchHeader()
+{
+  uint32_t data_bytes = (_stats.bytes > WAV_REC_HEADER_SIZE ? _stats.bytes - WAV_REC_HEADER_SIZE : 0);
+  
+  _header.data_bytes = data_bytes;
+  _header.wav_size = data_bytes + WAV_REC_HEADER_SIZE - 8;
+  
+  if (!_file.seek(0)) return false;
+  return _file.write((uint8_t *)&_header, WAV_REC_HEADER_SIZE) == WAV_REC_HEADER_SIZE;
+}
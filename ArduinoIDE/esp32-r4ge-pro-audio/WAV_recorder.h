@@ -0,0 +1,58 @@
+#ifndef _WAV_RECORDER_
+#define _WAV_RECORDER_
+
+#include <SD.h>
+#include "WAV_audio.h"
+
+#define WAV_REC_BUFFER_SIZE  4096  // Bytes per buffer.  A multiple of the 512 byte SD sector
+#define WAV_REC_BUFFERS         2  // Must be power of 2
+#define WAV_REC_HEADER_SIZE    44  // sizeof(wav_header_t)
+
+typedef struct 
+{
+  uint32_t samples;       // Samples written to the file
+  uint32_t bytes;         // Bytes written, including the header
+  uint32_t writes;        // Buffer writes
+  uint32_t write_us;      // Total time spent in SD writes
+  uint32_t max_write_us;  // Slowest buffer write
+  uint32_t overruns;      // Samples dropped because every buffer was waiting to be written
+} wav_recorder_stats_t;
+
+/*
+ * Streams 16-bit mono audio to a WAV file on the SD card, with no length limit 
+ * other than the card.
+ * Samples are added to one buffer while the other waits for update() to write it, 
+ * so the SD card only ever sees full WAV_REC_BUFFER_SIZE writes.  The header is 
+ * at the start of the first buffer, so every write starts on a sector boundary.
+ * The RIFF and data sizes are patched into the header by end().
+ * Subscribe captureBlock() to a WAV_capture with the recorder as the context.
+ */
+class WAV_recorder
+{
+  public:
+    WAV_recorder();
+    bool begin(const char *filename, uint32_t sample_rate);
+    void addSamples(const int16_t *samples, uint16_t count);
+    bool update();
+    bool end();
+    bool getRecording();
+    void getStats(wav_recorder_stats_t *stats);
+    uint32_t getThroughput();
+    static void captureBlock(const int16_t *samples, uint16_t count, void *context);
+
+  private:
+    bool writeBuffer(uint8_t idx, uint16_t len);
+    bool patchHeader();
+
+    File     _file;
+    uint8_t  _buffer[WAV_REC_BUFFERS][WAV_REC_BUFFER_SIZE];
+    bool     _full[WAV_REC_BUFFERS];
+    uint8_t  _fill_idx = 0;   // Buffer samples are being added to
+    uint8_t  _write_idx = 0;  // Next buffer to write to the card
+    uint16_t _fill_len = 0;   // Bytes in the fill buffer
+    bool     _recording = false;
+    wav_header_t _header;
+    wav_recorder_stats_t _stats;
+};
+
+#endif // _WAV_RECORDER_
@@ -0,0 +1,205 @@
+#include <math.h>
+#include "WAV_resample.h"
+
+WAV_resampler::WAV_resampler()
+{
+
+}
+
+/*
+ * Builds the filter for the specified rates.  
+ * Returns false if either rate is zero.
+ */
+bool WAV_resampler::begin(uint32_t in_rate, uint32_t out_rate)
+{
+  wav_resample_plan_t plan;
+  if (!calcPlan(in_rate, out_rate, &plan))
+  {
+    _ready = false;
+    return false;
+  }
+
+  // The table only depends on the ratio, so files at the same rate reuse it
+  if (!_ready || plan.up != _plan.up || plan.down != _plan.down)
+  {
+    _plan = plan;
+    for (uint16_t row = 0; row < _plan.rows; row++)
+    {
+      calcRow(&_plan, row, &_coef[row * _plan.taps]);
+    }
+    _ready = true;
+  }
+  
+  reset();
+  return true;
+}
+
+/*
+ * Clears the sample history, for example before a new file.
+ */
+void WAV_resampler::reset()
+{
+  for (uint16_t i = 0; i < WAV_RESAMPLE_MAX_TAPS * 2; i++)
+  {
+    _hist[i] = 0;
+  }
+  _hist_idx = 0;
+  
+  // The first output is centred on the first input sample, so it waits for half the filter
+  _phase = _plan.up * (_plan.taps / 2 + 1);
+}
+
+/*
+ * Resamples a block.  Stops when the input is used up or out_max samples have 
+ * been written, and carries on from there on the next call.
+ * Returns the number of output samples, and the input samples used in in_used.
+ */
+uint32_t WAV_resampler::process(const float *in, uint32_t in_cnt, float *out, uint32_t out_max, uint32_t *in_used)
+{
+  uint32_t in_idx = 0;
+  uint32_t out_cnt = 0;
+  bool     out_full = false;
+
+  if (_ready)
+  {
+    while (!out_full)
+    {
+      // Every output position before the next input sample
+      while (_phase < _plan.up)
+      {
+        if (out_cnt >= out_max) 
+        {
+          out_full = true;
+          break;
+        }
+        out[out_cnt++] = calcOutput();
+        _phase += _plan.down;
+      }
+      if (out_full || in_idx >= in_cnt) break;
+
+      _phase -= _plan.up;
+      _hist_idx = (_hist_idx + _plan.taps - 1) % _plan.taps;
+      _hist[_hist_idx] = in[in_idx];
+      _hist[_hist_idx + _plan.taps] = in[in_idx];
+      in_idx++;
+    }
+  }
+  
+  *in_used = in_idx;
+  return out_cnt;
+}
+
+/*
+ * Returns the input samples held back by the filter.  Follow the last block 
+ * with this many zeros to get all of the output.
+ */
+uint32_t WAV_resampler::getDelay()
+{
+  return _plan.taps / 2;
+}
+
+const wav_resample_plan_t *WAV_resampler::getPlan()
+{
+  return &_plan;
+}
+
+/*
+ * Works out the filter phases and taps for a pair of rates.
+ */
+bool WAV_resampler::calcPlan(uint32_t in_rate, uint32_t out_rate, wav_resample_plan_t *plan)
+{
+  if (in_rate == 0 || out_rate == 0) return false;
+
+  uint32_t a = in_rate, b = out_rate;
+  while (b != 0)
+  {
+    uint32_t t = a % b;
+    a = b;
+    b = t;
+  }
+  plan->up = out_rate / a;
+  plan->down = in_rate / a;
+  plan->exact = (plan->up <= WAV_RESAMPLE_MAX_EXACT);
+  plan->phases = (plan->exact ? plan->up : WAV_RESAMPLE_PHASES);
+  plan->rows = (plan->exact ? plan->phases : plan->phases + 1);
+
+  // Downsampling needs a longer filter for the same transition band at the output rate
+  double ratio = (double)plan->down / plan->up;
+  uint32_t taps = (uint32_t)ceil(WAV_RESAMPLE_TAPS * (ratio > 1 ? ratio : 1));
+  if (taps > WAV_RESAMPLE_MAX_TAPS) taps = WAV_RESAMPLE_MAX_TAPS;
+  if (taps > WAV_RESAMPLE_MAX_COEFS / plan->rows) taps = WAV_RESAMPLE_MAX_COEFS / plan->rows;
+  plan->taps = taps & ~1;  // Even, so the filter is centred between taps
+  
+  plan->cutoff = 0.5 * (ratio > 1 ? 1.0 / ratio : 1.0);
+  return plan->taps >= 2;
+}
+
+/*
+ * Bessel function I0 for the Kaiser window.
+ */
+static double besselI0(double x)
+{
+  double sum = 1, term = 1;
+  for (int k = 1; k < 32; k++)
+  {
+    term *= (x / (2 * k)) * (x / (2 * k));
+    sum += term;
+  }
+  return sum;
+}
+
+/*
+ * Coefficients of the output row row/phases of an input sample past the newest 
+ * sample.  coef[tap] is applied to the sample tap samples before the newest.
+ * Each row is scaled to unity gain at DC.
+ */
+void WAV_resampler::calcRow(const wav_resample_plan_t *plan, uint16_t row, float *coef)
+{
+  double frac = (double)row / plan->phases;
+  double half = plan->taps / 2.0;
+  double window_scale = 1 / besselI0(WAV_RESAMPLE_KAISER_BETA);
+  double sum = 0;
+
+  for (uint16_t k = 0; k < plan->taps; k++)
+  {
+    double t = k + frac - half;  // Distance from the filter centre, in input samples
+    double x = 2 * plan->cutoff * t;
+    double sinc = (fabs(x) < 1e-9 ? 1.0 : sin(M_PI * x) / (M_PI * x));
+    double r = t / half;
+    double window = (fabs(r) >= 1 ? 0 : besselI0(WAV_RESAMPLE_KAISER_BETA * sqrt(1 - r * r)) * window_scale);
+    
+    coef[k] = (float)(sinc * window);
+    sum += coef[k];
+  }
+
+  for (uint16_t k = 0; k < plan->taps && sum != 0; k++)
+  {
+    coef[k] = (float)(coef[k] / sum);
+  }
+}
+
+float WAV_resampler::calcOutput()
+{
+  const float *window = &_hist[_hist_idx];
+
+  if (_plan.exact) return dotRow(_phase, window);
+
+  // Interpolate between the two nearest phases
+  uint32_t pos = _phase * _plan.phases;
+  uint16_t row = pos / _plan.up;
+  float    frac = (float)(pos % _plan.up) / _plan.up;
+  
+  return dotRow(row, window) * (1 - frac) + dotRow(row + 1, window) * frac;
+}
+
+float WAV_resampler::dotRow(uint16_t row, const float *window)
+{
+  const float *coef = &_coef[row * _plan.taps];
+  float sum = 0;
+  
+  for (uint16_t k = 0; k < _plan.taps; k++)
+  {
+    sum += coef[k] * window[k];
+  }
+  return sum;
+}
@@ -0,0 +1,60 @@
+#ifndef _WAV_RESAMPLE_
+#define _WAV_RESAMPLE_
+
+#include <stdint.h>
+
+#define WAV_RESAMPLE_TAPS         32  // Input taps per output at 1:1 or when upsampling.  Scaled up when downsampling
+#define WAV_RESAMPLE_MAX_TAPS    192
+#define WAV_RESAMPLE_MAX_EXACT    16  // Largest up factor that gets one filter phase per output position
+#define WAV_RESAMPLE_PHASES       32  // Interpolated filter phases for other ratios
+#define WAV_RESAMPLE_MAX_COEFS  4800  // Coefficient table limit.  Taps are reduced to fit
+#define WAV_RESAMPLE_KAISER_BETA 7.857  // ~80 dB stopband
+
+typedef struct
+{
+  uint32_t up;      // L, after dividing the rates by their GCD
+  uint32_t down;    // M
+  uint16_t phases;  // Filter phases.  up for exact ratios, WAV_RESAMPLE_PHASES otherwise
+  uint16_t rows;    // Coefficient rows.  Interpolated tables have an extra row
+  uint16_t taps;    // Input samples used for each output
+  bool     exact;   // One row per output position, no interpolation between rows
+  double   cutoff;  // Cutoff in cycles per input sample
+} wav_resample_plan_t;
+
+/*
+ * Streaming polyphase FIR resampler in float.
+ * Ratios with a small up factor after reducing by the GCD (44100 -> 11025 or 22050 
+ * and back) use a table with one Kaiser windowed sinc phase per output position.
+ * Other ratios (48000 -> 11025) keep exact L/M timing but interpolate between 
+ * WAV_RESAMPLE_PHASES phases.
+ * The cutoff is the lower of the two Nyquist frequencies, so aliases only fall
+ * in the transition band above ~0.42 of the output rate.
+ * Output n is at input time n * in_rate / out_rate, with no delay, but the last
+ * getDelay() input samples are held back until more input (or silence) follows.
+ * No Arduino dependencies.  See WAV_resample_q15 for the fixed point version.
+ */
+class WAV_resampler
+{
+  public:
+    WAV_resampler();
+    bool     begin(uint32_t in_rate, uint32_t out_rate);
+    void     reset();
+    uint32_t process(const float *in, uint32_t in_cnt, float *out, uint32_t out_max, uint32_t *in_used);
+    uint32_t getDelay();
+    const wav_resample_plan_t *getPlan();
+    static bool   calcPlan(uint32_t in_rate, uint32_t out_rate, wav_resample_plan_t *plan);
+    static void   calcRow(const wav_resample_plan_t *plan, uint16_t row, float *coef);
+
+  private:
+    float    calcOutput();
+    float    dotRow(uint16_t row, const float *window);
+    
+    wav_resample_plan_t _plan;
+    float    _coef[WAV_RESAMPLE_MAX_COEFS];
+    float    _hist[WAV_RESAMPLE_MAX_TAPS * 2];  // Each sample is stored twice so the window is contiguous
+    uint16_t _hist_idx = 0;                     // Newest sample
+    uint32_t _phase = 0;                        // Next output position past the newest sample, in 1/up input samples
+    bool     _ready = false;
+};
+
+#endif // _WAV_RESAMPLE_
@@ -0,0 +1,168 @@
+#include <math.h>
+#include "WAV_resample_q15.h"
+
+WAV_resampler_q15::WAV_resampler_q15()
+{
+
+}
+
+/*
+ * Builds the filter for the specified rates.  
+ * Returns false if either rate is zero.
+ */
+bool WAV_resampler_q15::begin(uint32_t in_rate, uint32_t out_rate)
+{
+  wav_resample_plan_t plan;
+  float row_coef[WAV_RESAMPLE_MAX_TAPS];
+  
+  if (!WAV_resampler::calcPlan(in_rate, out_rate, &plan))
+  {
+    _ready = false;
+    return false;
+  }
+  if (_ready && plan.up == _plan.up && plan.down == _plan.down)
+  {
+    reset();
+    return true;
+  }
+  _plan = plan;
+
+  // Pick the scale from the row with the largest absolute sum, which sets the accumulator peak.
+  // Sums are a little over 1, so this is normally 14 bits.
+  double max_sum = 0;
+  double max_coef = 0;
+  for (uint16_t row = 0; row < _plan.rows; row++)
+  {
+    double sum = 0;
+    WAV_resampler::calcRow(&_plan, row, row_coef);
+    for (uint16_t tap = 0; tap < _plan.taps; tap++)
+    {
+      double coef = fabs(row_coef[tap]);
+      sum += coef;
+      if (coef > max_coef) max_coef = coef;
+    }
+    if (sum > max_sum) max_sum = sum;
+  }
+  
+  _shift = 15;
+  while (_shift > 1 && (max_sum * 32768.0 * (1L << _shift) >= 2147483647.0 || max_coef * (1L << _shift) >= 32767.0))
+  {
+    _shift--;
+  }
+  
+  for (uint16_t row = 0; row < _plan.rows; row++)
+  {
+    WAV_resampler::calcRow(&_plan, row, row_coef);
+    for (uint16_t tap = 0; tap < _plan.taps; tap++)
+    {
+      _coef[row * _plan.taps + tap] = (int16_t)lroundf(row_coef[tap] * (1L << _shift));
+    }
+  }
+
+  _ready = true;
+  reset();
+  return true;
+}
+
+/*
+ * Clears the sample history, for example before a new file.
+ */
+void WAV_resampler_q15::reset()
+{
+  for (uint16_t i = 0; i < WAV_RESAMPLE_MAX_TAPS * 2; i++)
+  {
+    _hist[i] = 0;
+  }
+  _hist_idx = 0;
+  _phase = _plan.up * (_plan.taps / 2 + 1);
+}
+
+/*
+ * Resamples a block.  Stops when the input is used up or out_max samples have 
+ * been written, and carries on from there on the next call.
+ * Returns the number of output samples, and the input samples used in in_used.
+ */
+uint32_t WAV_resampler_q15::process(const int16_t *in, uint32_t in_cnt, int16_t *out, uint32_t out_max, uint32_t *in_used)
+{
+  uint32_t in_idx = 0;
+  uint32_t out_cnt = 0;
+  bool     out_full = false;
+
+  if (_ready)
+  {
+    while (!out_full)
+    {
+      while (_phase < _plan.up)
+      {
+        if (out_cnt >= out_max) 
+        {
+          out_full = true;
+          break;
+        }
+        out[out_cnt++] = calcOutput();
+        _phase += _plan.down;
+      }
+      if (out_full || in_idx >= in_cnt) break;
+
+      _phase -= _plan.up;
+      _hist_idx = (_hist_idx + _plan.taps - 1) % _plan.taps;
+      _hist[_hist_idx] = in[in_idx];
+      _hist[_hist_idx + _plan.taps] = in[in_idx];
+      in_idx++;
+    }
+  }
+  
+  *in_used = in_idx;
+  return out_cnt;
+}
+
+/*
+ * Returns the input samples held back by the filter.  Follow the last block 
+ * with this many zeros to get all of the output.
+ */
+uint32_t WAV_resampler_q15::getDelay()
+{
+  return _plan.taps / 2;
+}
+
+const wav_resample_plan_t *WAV_resampler_q15::getPlan()
+{
+  return &_plan;
+}
+
+int16_t WAV_resampler_q15::calcOutput()
+{
+  const int16_t *window = &_hist[_hist_idx];
+  int64_t acc;
+
+  if (_plan.exact)
+  {
+    acc = dotRow(_phase, window);
+  }
+  else
+  {
+    // Interpolate between the two nearest phases with a Q15 weight
+    uint32_t pos = _phase * _plan.phases;
+    uint16_t row = pos / _plan.up;
+    int32_t  frac = (int32_t)(((uint64_t)(pos % _plan.up) << 15) / _plan.up);
+    
+    acc = ((int64_t)dotRow(row, window) * (32768 - frac) + (int64_t)dotRow(row + 1, window) * frac) >> 15;
+  }
+
+  int32_t value = (int32_t)((acc + (1L << (_shift - 1))) >> _shift);
+  if (value > 32767) value = 32767;
+  if (value < -32768) value = -32768;
+  return (int16_t)value;
+}
+
+int32_t WAV_resampler_q15::dotRow(uint16_t row, const int16_t *window)
+{
+  const int16_t *coef = &_coef[row * _plan.taps];
+  int32_t sum = 0;
+  
+  for (uint16_t k = 0; k < _plan.taps; k++)
+  {
+    sum += (int32_t)coef[k] * window[k];
+  }
+  return sum;
+}
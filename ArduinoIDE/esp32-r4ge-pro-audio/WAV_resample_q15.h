@@ -0,0 +1,36 @@
+#ifndef _WAV_RESAMPLE_Q15_
+#define _WAV_RESAMPLE_Q15_
+
+#include <stdint.h>
+#include "WAV_resample.h"
+
+/*
+ * Fixed point version of WAV_resampler for 16-bit samples.
+ * Uses the same filter plan and coefficients, quantized to 16 bits with the 
+ * largest scale that cannot overflow the 32-bit accumulator for any input.
+ * Half the table memory of the float version and no floating point math per sample.
+ */
+class WAV_resampler_q15
+{
+  public:
+    WAV_resampler_q15();
+    bool     begin(uint32_t in_rate, uint32_t out_rate);
+    void     reset();
+    uint32_t process(const int16_t *in, uint32_t in_cnt, int16_t *out, uint32_t out_max, uint32_t *in_used);
+    uint32_t getDelay();
+    const wav_resample_plan_t *getPlan();
+
+  private:
+    int16_t  calcOutput();
+    int32_t  dotRow(uint16_t row, const int16_t *window);
+    
+    wav_resample_plan_t _plan;
+    int16_t  _coef[WAV_RESAMPLE_MAX_COEFS];
+    int16_t  _hist[WAV_RESAMPLE_MAX_TAPS * 2];  // Each sample is stored twice so the window is contiguous
+    uint16_t _hist_idx = 0;                     // Newest sample
+    uint32_t _phase = 0;                        // Next output position past the newest sample, in 1/up input samples
+    uint8_t  _shift = 15;                       // Coefficients are value * 2^_shift
+    bool     _ready = false;
+};
+
+#endif // _WAV_RESAMPLE_Q15_
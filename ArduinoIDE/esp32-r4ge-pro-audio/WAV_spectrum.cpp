@@ -0,0 +1,107 @@
+#include <math.h>
+#include "WAV_spectrum.h"
+
+WAV_spectrum::WAV_spectrum()
+{
+  clear();
+}
+
+/*
+ * Zeros all bins.
+ */
+void WAV_spectrum::clear()
+{
+  for (uint16_t i = 0; i < WAV_FFT_BINS; i++)
+  {
+    re[i] = 0;
+    im[i] = 0;
+  }
+}
+
+/*
+ * Returns the real part of any bin from 0 to WAV_FFT_SIZE - 1.
+ */
+float WAV_spectrum::getReal(uint16_t bin)
+{
+  return re[foldBin(bin)];
+}
+
+/*
+ * Returns the imaginary part of any bin from 0 to WAV_FFT_SIZE - 1.
+ * Upper bins are conjugates, so the sign is flipped.
+ */
+float WAV_spectrum::getImag(uint16_t bin)
+{
+  bin %= WAV_FFT_SIZE;
+  return (bin < WAV_FFT_BINS ? im[bin] : -im[WAV_FFT_SIZE - bin]);
+}
+
+float WAV_spectrum::getMagnitude(uint16_t bin)
+{
+  return sqrtf(getPower(bin) * WAV_FFT_SIZE);
+}
+
+/*
+ * Returns the periodogram estimate of the power in a bin, |X|^2 / N
+ */
+float WAV_spectrum::getPower(uint16_t bin)
+{
+  bin = foldBin(bin);
+  return (re[bin] * re[bin] + im[bin] * im[bin]) * (1.0f / WAV_FFT_SIZE);
+}
+
+/*
+ * Fills power with WAV_FFT_BINS periodogram values, for the mel filterbank.
+ */
+void WAV_spectrum::calcPower(float *power)
+{
+  for (uint16_t i = 0; i < WAV_FFT_BINS; i++)
+  {
+    power[i] = (re[i] * re[i] + im[i] * im[i]) * (1.0f / WAV_FFT_SIZE);
+  }
+}
+
+/*
+ * Finds the bin with the most power, from first_bin up to Nyquist.
+ */
+uint16_t WAV_spectrum::findMaxPowerBin(uint16_t first_bin)
+{
+  uint16_t max_bin = first_bin;
+  float    max_value = 0;
+
+  for (uint16_t i = first_bin; i < WAV_FFT_BINS; i++)
+  {
+    // Compare unscaled power, the 1/N is the same for every bin
+    float value = re[i] * re[i] + im[i] * im[i];
+    if (value > max_value)
+    {
+      max_value = value;
+      max_bin = i;
+    }
+  }
+  return max_bin;
+}
+
+/*
+ * Finds the largest real value, from first_bin up to Nyquist.
+ */
+float WAV_spectrum::findMaxReal(uint16_t first_bin)
+{
+  float max_value = 0;
+
+  for (uint16_t i = first_bin; i < WAV_FFT_BINS; i++)
+  {
+    if (re[i] > max_value)
+      max_value = re[i];
+  }
+  return max_value;
+}
+
+/*
+ * Maps an upper half bin to the lower half bin it mirrors.
+ */
+uint16_t WAV_spectrum::foldBin(uint16_t bin)
+{
+  bin %= WAV_FFT_SIZE;
+  return (bin < WAV_FFT_BINS ? bin : WAV_FFT_SIZE - bin);
+}
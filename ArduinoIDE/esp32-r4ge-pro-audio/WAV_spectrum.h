@@ -0,0 +1,35 @@
+#ifndef _WAV_SPECTRUM_
+#define _WAV_SPECTRUM_
+
+#include <stdint.h>
+#include "WAV_fft.h"
+
+/*
+ * Spectrum of a real input frame, stored as separate float real and imaginary arrays.
+ * Only bins DC through Nyquist are stored.  The upper half of a real input 
+ * spectrum is the complex conjugate of the lower half, so getReal() and getImag()
+ * mirror any bin up to WAV_FFT_SIZE - 1.
+ * Power and magnitude are calculated when asked for rather than stored.
+ * 2 KB, compared to 16 KB for the old Complex + double power arrays.
+ * No Arduino dependencies.
+ */
+class WAV_spectrum
+{
+  public:
+    WAV_spectrum();
+    void     clear();
+    float    getReal(uint16_t bin);
+    float    getImag(uint16_t bin);
+    float    getMagnitude(uint16_t bin);
+    float    getPower(uint16_t bin);
+    void     calcPower(float *power);
+    uint16_t findMaxPowerBin(uint16_t first_bin);
+    float    findMaxReal(uint16_t first_bin);
+    float    re[WAV_FFT_BINS];  // Written directly by WAV_fft::realForward()
+    float    im[WAV_FFT_BINS];
+
+  private:
+    uint16_t foldBin(uint16_t bin);
+};
+
+#endif // _WAV_SPECTRUM_
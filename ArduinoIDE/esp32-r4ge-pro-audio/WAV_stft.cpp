@@ -0,0 +1,162 @@
+#include <math.h>
+#include <string.h>
+#include "WAV_stft.h"
+
+WAV_stft::WAV_stft()
+{
+  reset();
+}
+
+/*
+ * Clears the ring buffer and filter state, for example when the spectrogram is restarted.
+ */
+void WAV_stft::reset()
+{
+  for (uint16_t i = 0; i < WAV_FFT_SIZE; i++)
+  {
+    _ring[i] = 0;
+  }
+#if WAV_FFT_USE_Q15
+  memset(_real, 0, sizeof(_real));
+  memset(_imag, 0, sizeof(_imag));
+  _exponent = 0;
+#else
+  spectrum.clear();
+#endif
+  _prev_in = 0;
+  _prev_out = 0;
+  _write_idx = 0;
+  _hop_cnt = 0;
+  _sample_cnt = 0;
+  _column_cnt = 0;
+  _silent = false;
+  _silent_cnt = 0;
+  if (_gate != NULL) _gate->reset();
+}
+
+/*
+ * Adds a sample to the ring buffer.  Returns true when a new column has been 
+ * transformed and is ready for calcLevels().
+ */
+bool WAV_stft::pushSample(int16_t sample)
+{
+  // DC blocking filter:  y[n] = x[n] - x[n-1] + pole * y[n-1]
+  float in = (float)sample;
+  _prev_out = in - _prev_in + WAV_STFT_DC_POLE * _prev_out;
+  _prev_in = in;
+  if (_gate != NULL) _gate->pushSample(sample);
+
+#if WAV_FFT_USE_Q15
+  _ring[_write_idx] = (int16_t)(_prev_out > 32767 ? 32767 : (_prev_out < -32768 ? -32768 : _prev_out));
+#else
+  _ring[_write_idx] = _prev_out;
+#endif
+  _write_idx = (_write_idx + 1) % WAV_FFT_SIZE;
+  _sample_cnt++;
+
+  if (++_hop_cnt < WAV_STFT_HOP || _sample_cnt < WAV_FFT_SIZE) return false;
+  _hop_cnt = 0;
+  _column_cnt++;
+
+  _silent = (_gate != NULL && !_gate->getActive());
+  if (_silent)
+  {
+    _silent_cnt++;
+    return true;
+  }
+
+  // Unwrap the ring so the oldest sample is first
+  uint16_t tail = WAV_FFT_SIZE - _write_idx;
+  memcpy(_frame, &_ring[_write_idx], tail * sizeof(_ring[0]));
+  memcpy(&_frame[tail], _ring, _write_idx * sizeof(_ring[0]));
+
+#if WAV_FFT_USE_Q15
+  _exponent = _fft.realForward(_frame, _real, _imag);
+#else
+  _fft.realForward(_frame, spectrum.re, spectrum.im);
+#endif
+  return true;
+}
+
+/*
+ * Sets the power in dB mapped to level 0, and the dB range mapped to levels 0 - 255.
+ */
+void WAV_stft::setRange(float floor_db, float range_db)
+{
+  if (range_db < 1) range_db = 1;
+  _floor_db = floor_db;
+  _level_scale = 255.0 / range_db;
+}
+
+/*
+ * Applies the Hann window to the latest column and converts count bins, 
+ * starting at first_bin, to levels from 0 to 255 for a colour map.
+ * A silent column is all level 0.
+ */
+void WAV_stft::calcLevels(uint8_t *levels, uint16_t first_bin, uint16_t count)
+{
+#if WAV_FFT_USE_Q15
+  // Power in dB is 20 * log10(|X| * 2^exponent) - 10 * log10(N), the log of the magnitude plus a block offset
+  float offset_db = 20.0f * log10f(2.0f) * _exponent - 10.0f * log10f((float)WAV_FFT_SIZE) - _floor_db;
+#endif
+
+  for (uint16_t i = 0; i < count; i++)
+  {
+    uint16_t bin = first_bin + i;
+    if (_silent || bin >= WAV_FFT_BINS)
+    {
+      levels[i] = 0;
+      continue;
+    }
+
+#if WAV_FFT_USE_Q15
+    uint16_t mag = WAV_fft_q15::magnitude(_real[bin], _imag[bin]);
+    float level = (mag > 0 ? (20.0f * log10f(mag) + offset_db) * _level_scale : 0);
+#else
+    // Hann window in the frequency domain.  getReal()/getImag() mirror the neighbours past DC and Nyquist.
+    float re = 0.5f * spectrum.re[bin] - 0.25f * (spectrum.getReal(bin + WAV_FFT_SIZE - 1) + spectrum.getReal(bin + 1));
+    float im = 0.5f * spectrum.im[bin] - 0.25f * (spectrum.getImag(bin + WAV_FFT_SIZE - 1) + spectrum.getImag(bin + 1));
+    float power = (re * re + im * im) * (1.0f / WAV_FFT_SIZE);
+
+    float level = (10.0f * log10f(power + 1e-10f) - _floor_db) * _level_scale;
+#endif
+    if (level < 0) level = 0;
+    if (level > 255) level = 255;
+    levels[i] = (uint8_t)level;
+  }
+}
+
+/*
+ * Returns the number of columns transformed since reset()
+ */
+uint32_t WAV_stft::getColumnCount()
+{
+  return _column_cnt;
+}
+
+/*
+ * Sets a voice activity gate, or NULL to transform every column.
+ * The gate is fed by pushSample(), so it should not be fed anywhere else.
+ */
+void WAV_stft::setGate(WAV_vad *gate)
+{
+  _gate = gate;
+  if (_gate != NULL) _gate->reset();
+  _silent = false;
+}
+
+/*
+ * Returns true if the latest column was skipped as silent.
+ */
+bool WAV_stft::getSilent()
+{
+  return _silent;
+}
+
+/*
+ * Returns the number of columns skipped as silent since reset()
+ */
+uint32_t WAV_stft::getSilentCount()
+{
+  return _silent_cnt;
+}
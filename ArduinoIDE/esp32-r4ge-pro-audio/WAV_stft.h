@@ -0,0 +1,70 @@
+#ifndef _WAV_STFT_
+#define _WAV_STFT_
+
+#include <stdint.h>
+#include "WAV_fft_q15.h"
+#include "WAV_spectrum.h"
+#include "WAV_vad.h"
+
+#define WAV_STFT_HOP          256    // New samples per column.  50% overlap with WAV_FFT_SIZE frames
+#define WAV_STFT_DC_POLE      0.995  // DC blocking filter pole, removes the microphone bias
+#define WAV_STFT_FLOOR_DB     30.0   // Power mapped to level 0
+#define WAV_STFT_RANGE_DB     60.0   // Power range mapped to levels 0 - 255
+
+/*
+ * Sliding window Short Time Fourier Transform for a live spectrogram.
+ * Samples are pushed into a ring buffer one at a time.  Each sample is DC filtered 
+ * once as it arrives, and every WAV_STFT_HOP samples the last WAV_FFT_SIZE samples 
+ * are transformed.  The frame itself is not windowed.  The Hann window is applied to 
+ * the bins instead, as the 3 tap kernel -1/4, 1/2, -1/4, so the overlapping 
+ * samples are never touched again.
+ * With WAV_FFT_USE_Q15 the ring holds int16 samples and the Q15 FFT windows the 
+ * frame itself.  The column stays in Q15, and calcLevels() takes the levels from 
+ * WAV_fft_q15::magnitude() and the block exponent.
+ * With a WAV_vad gate set, columns that end while the gate is inactive are not 
+ * transformed, getSilent() is true, and calcLevels() returns level 0.
+ * No Arduino dependencies.
+ */
+class WAV_stft
+{
+  public:
+    WAV_stft();
+    void     reset();
+    bool     pushSample(int16_t sample);
+    void     setRange(float floor_db, float range_db);
+    void     calcLevels(uint8_t *levels, uint16_t first_bin, uint16_t count);
+    uint32_t getColumnCount();
+    void     setGate(WAV_vad *gate);
+    bool     getSilent();
+    uint32_t getSilentCount();
+#if !WAV_FFT_USE_Q15
+    WAV_spectrum spectrum;  // Spectrum of the latest column, before the Hann window
+#endif
+
+  private:
+#if WAV_FFT_USE_Q15
+    WAV_fft_q15 _fft;
+    int16_t  _ring[WAV_FFT_SIZE];
+    int16_t  _frame[WAV_FFT_SIZE];
+    int16_t  _real[WAV_FFT_BINS];  // Latest column, Hann windowed, _real * 2^_exponent
+    int16_t  _imag[WAV_FFT_BINS];
+    int8_t   _exponent = 0;
+#else
+    WAV_fft  _fft;
+    float    _ring[WAV_FFT_SIZE];
+    float    _frame[WAV_FFT_SIZE];
+#endif
+    float    _prev_in = 0;
+    float    _prev_out = 0;
+    float    _floor_db = WAV_STFT_FLOOR_DB;
+    float    _level_scale = 255.0 / WAV_STFT_RANGE_DB;
+    uint16_t _write_idx = 0;
+    uint16_t _hop_cnt = 0;
+    uint32_t _sample_cnt = 0;
+    uint32_t _column_cnt = 0;
+    WAV_vad *_gate = NULL;
+    bool     _silent = false;
+    uint32_t _silent_cnt = 0;
+};
+
+#endif // _WAV_STFT_
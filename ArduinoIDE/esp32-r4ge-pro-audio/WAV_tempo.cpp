@@ -0,0 +1,285 @@
+#include <math.h>
+#include <string.h>
+#include "WAV_tempo.h"
+
+WAV_tempo::WAV_tempo()
+{
+  begin(11025);
+}
+
+/*
+ * Sets the sample rate, which sets the lags searched and the tempo prior.
+ */
+void WAV_tempo::begin(uint32_t sample_rate)
+{
+  _onset.begin(sample_rate);
+  _frame_rate = _onset.getFrameRate();
+
+  _min_lag = (uint16_t)(_frame_rate * 60.0 / WAV_TEMPO_MAX_BPM);
+  _max_lag = (uint16_t)(_frame_rate * 60.0 / WAV_TEMPO_MIN_BPM) + 1;
+  if (_min_lag < 2) _min_lag = 2;
+  if (_max_lag > WAV_TEMPO_ENV_LEN - 2) _max_lag = WAV_TEMPO_ENV_LEN - 2;  // Room for the interpolation
+
+  for (uint16_t lag = 0; lag < WAV_TEMPO_ENV_LEN; lag++)
+  {
+    float octaves = (lag > 0 ? log2f(_frame_rate * 60.0f / lag / WAV_TEMPO_PRIOR_BPM) / WAV_TEMPO_PRIOR_WIDTH : 0);
+    _prior[lag] = expf(-0.5f * octaves * octaves);
+  }
+  reset();
+}
+
+/*
+ * Clears the onset detector, autocorrelation, beat phase and any unread events.
+ */
+void WAV_tempo::reset()
+{
+  _onset.reset();
+  memset(_env, 0, sizeof(_env));
+  memset(_comb, 0, sizeof(_comb));
+  memset(_acf, 0, sizeof(_acf));
+  _acf0 = 0;
+  _period = 0;
+  _next_beat = 0;
+  _confidence = 0;
+  _frame_cnt = 0;
+  _beat_cnt = 0;
+  _locked = false;
+  _event_write = 0;
+  _event_read = 0;
+  _dropped = 0;
+}
+
+/*
+ * Adds a sample.  Returns true when an onset frame was analysed, and there may be new events.
+ */
+bool WAV_tempo::pushSample(int16_t sample)
+{
+  if (!_onset.pushSample(sample)) return false;
+
+  if (_onset.getOnset())
+  {
+    addEvent(WAV_TEMPO_ONSET, _onset.getOnsetSample(), _onset.getStrength());
+  }
+  pushFrame(_onset.getNovelty());
+  return true;
+}
+
+/*
+ * Takes the oldest unread event.  Returns false if there are none.
+ */
+bool WAV_tempo::getEvent(wav_tempo_event_t *event)
+{
+  if (_event_read == _event_write) return false;
+
+  *event = _events[_event_read & (WAV_TEMPO_EVENTS - 1)];
+  _event_read++;
+  return true;
+}
+
+bool WAV_tempo::getLocked()
+{
+  return _locked;
+}
+
+/*
+ * Latest tempo estimate, 0 before the first one.
+ */
+float WAV_tempo::getBPM()
+{
+  return (_period > 0 ? _frame_rate * 60.0 / _period : 0);
+}
+
+/*
+ * Normalized autocorrelation of the onset envelope at the beat period, 0 to 1.
+ */
+float WAV_tempo::getConfidence()
+{
+  return _confidence;
+}
+
+/*
+ * Samples pushed since begin(), to compare with event positions.
+ */
+uint32_t WAV_tempo::getSampleCount()
+{
+  return _onset.getSampleCount();
+}
+
+uint32_t WAV_tempo::getBeatCount()
+{
+  return _beat_cnt;
+}
+
+/*
+ * Events lost because the queue was full.
+ */
+uint32_t WAV_tempo::getDropped()
+{
+  return _dropped;
+}
+
+WAV_onset *WAV_tempo::getOnset()
+{
+  return &_onset;
+}
+
+//----- PRIVATE METHODS -----//
+
+/*
+ * Updates the autocorrelation and comb filter with the novelty of a frame,
+ * and queues a beat if one is due before the next frame.
+ */
+void WAV_tempo::pushFrame(float novelty)
+{
+  uint32_t n = _frame_cnt;
+
+  _env[n & (WAV_TEMPO_ENV_LEN - 1)] = novelty;
+  _acf0 = _acf0 * WAV_TEMPO_ACF_DECAY + novelty * novelty;
+  for (uint16_t lag = _min_lag / 2 - 1; lag <= _max_lag + 1; lag++)  // From half the shortest period for checkOctave()
+  {
+    _acf[lag] = _acf[lag] * WAV_TEMPO_ACF_DECAY + novelty * _env[(n - lag) & (WAV_TEMPO_ENV_LEN - 1)];
+  }
+
+  float comb = novelty;
+  if (_period > 0 && n > _period + 1)
+  {
+    comb = (1 - WAV_TEMPO_COMB_FEEDBACK) * novelty + WAV_TEMPO_COMB_FEEDBACK * combAt(n - _period);
+  }
+  _comb[n & (WAV_TEMPO_ENV_LEN - 1)] = comb;
+
+  _frame_cnt++;
+  if (_frame_cnt % WAV_TEMPO_UPDATE == 0) estimate();
+
+  while (_locked && _next_beat < n + 1)
+  {
+    int32_t sample = WAV_onset::frameToSample(_next_beat);
+    addEvent(WAV_TEMPO_BEAT, sample > 0 ? sample : 0, getBPM());
+    _next_beat += _period;
+    _beat_cnt++;
+  }
+}
+
+/*
+ * Picks the beat period from the autocorrelation and corrects the beat phase.
+ */
+void WAV_tempo::estimate()
+{
+  uint32_t n = _frame_cnt - 1;
+  uint16_t best_lag = _min_lag;
+  float    best_score = -1;
+
+  for (uint16_t lag = _min_lag; lag <= _max_lag; lag++)
+  {
+    float score = _acf[lag] * _prior[lag];
+    if (score > best_score)
+    {
+      best_score = score;
+      best_lag = lag;
+    }
+  }
+  best_lag = checkOctave(best_lag);
+
+  // Parabolic interpolation for a fraction of a frame
+  float a = _acf[best_lag - 1];
+  float b = _acf[best_lag];
+  float c = _acf[best_lag + 1];
+  float curve = a - 2 * b + c;
+  float offset = (curve < 0 ? 0.5f * (a - c) / curve : 0);
+  if (offset > 0.5f) offset = 0.5f;
+  if (offset < -0.5f) offset = -0.5f;
+  float period = best_lag + offset;
+
+  _confidence = (_acf0 > 1e-9f ? b / _acf0 : 0);
+
+  // Small changes are smoothed, a new tempo is taken straight away
+  if (_period == 0 || fabsf(period - _period) > 0.08f * _period)
+  {
+    _period = period;
+  }
+  else
+  {
+    _period += 0.5f * (period - _period);
+  }
+
+  if (_locked && _confidence < WAV_TEMPO_UNLOCK)
+  {
+    _locked = false;
+    addEvent(WAV_TEMPO_LOST, getSampleCount(), getBPM());
+    return;
+  }
+  if (!_locked && (_confidence < WAV_TEMPO_LOCK || _frame_cnt < 2 * _max_lag)) return;
+
+  // The largest comb output in the last period is on the beat
+  uint16_t span = (uint16_t)(_period + 0.5f);
+  uint32_t peak = n;
+  float    peak_value = -1;
+  for (uint16_t k = 0; k < span; k++)
+  {
+    float value = _comb[(n - k) & (WAV_TEMPO_ENV_LEN - 1)];
+    if (value > peak_value)
+    {
+      peak_value = value;
+      peak = n - k;
+    }
+  }
+
+  if (!_locked)
+  {
+    _locked = true;
+    _next_beat = peak + _period;
+    addEvent(WAV_TEMPO_LOCKED, getSampleCount(), getBPM());
+  }
+  else
+  {
+    // Phase error to the nearest beat of the comb's grid
+    float error = (float)peak - _next_beat;
+    error -= _period * floorf(error / _period + 0.5f);
+    _next_beat += WAV_TEMPO_PHASE_GAIN * error;
+  }
+}
+
+/*
+ * Comb output at a fractional frame, by linear interpolation.
+ */
+float WAV_tempo::combAt(float frame)
+{
+  uint32_t i = (uint32_t)frame;
+  float    frac = frame - i;
+
+  return _comb[i & (WAV_TEMPO_ENV_LEN - 1)] * (1 - frac) + _comb[(i + 1) & (WAV_TEMPO_ENV_LEN - 1)] * frac;
+}
+
+/*
+ * Returns double the lag if it looks like the half beat of a slower tempo:
+ * nothing at half the lag, and a peak at double the lag that, weighted by the
+ * prior, is at least WAV_TEMPO_OCTAVE of the lag's.  Otherwise returns the lag.
+ */
+uint16_t WAV_tempo::checkOctave(uint16_t lag)
+{
+  if (2 * lag > _max_lag) return lag;
+
+  float half = fmaxf(_acf[lag / 2], _acf[(lag + 1) / 2]);
+  if (half >= WAV_TEMPO_SUBDIVISION * _acf[lag]) return lag;
+
+  uint16_t twice = 2 * lag;
+  for (uint16_t k = 2 * lag - 1; k <= 2 * lag + 1 && k <= _max_lag; k++)
+  {
+    if (_acf[k] > _acf[twice]) twice = k;
+  }
+  return (_acf[twice] * _prior[twice] >= WAV_TEMPO_OCTAVE * _acf[lag] * _prior[lag] ? twice : lag);
+}
+
+void WAV_tempo::addEvent(uint8_t type, uint32_t sample, float value)
+{
+  if (_event_write - _event_read >= WAV_TEMPO_EVENTS)
+  {
+    _dropped++;
+    return;
+  }
+
+  wav_tempo_event_t *event = &_events[_event_write & (WAV_TEMPO_EVENTS - 1)];
+  event->type = type;
+  event->sample = sample;
+  event->value = value;
+  _event_write++;
+}
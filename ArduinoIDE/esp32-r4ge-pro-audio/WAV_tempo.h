@@ -0,0 +1,101 @@
+#ifndef _WAV_TEMPO_
+#define _WAV_TEMPO_
+
+#include <stdint.h>
+#include "WAV_onset.h"
+
+#define WAV_TEMPO_MIN_BPM        60.0
+#define WAV_TEMPO_MAX_BPM       180.0
+#define WAV_TEMPO_ENV_LEN         128   // Onset frames kept, must be power of 2 and over the longest period (86 at 60 BPM)
+#define WAV_TEMPO_ACF_DECAY     0.997   // Autocorrelation memory per frame, ~4 sec at 86 frames per second
+#define WAV_TEMPO_PRIOR_BPM     120.0   // Most likely tempo, used to choose between half and double time
+#define WAV_TEMPO_PRIOR_WIDTH     1.0   // Octaves, standard deviation of the tempo prior
+#define WAV_TEMPO_SUBDIVISION    0.25   // Autocorrelation at half the period, against the period, below which the beat is undivided
+#define WAV_TEMPO_OCTAVE          0.5   // Weighted autocorrelation at double the period, against the period, to take half time
+#define WAV_TEMPO_UPDATE           16   // Frames between tempo estimates (~190 msec)
+#define WAV_TEMPO_COMB_FEEDBACK   0.8   // Share of the comb output fed back one period later
+#define WAV_TEMPO_PHASE_GAIN     0.25   // Share of the beat phase error corrected per estimate
+#define WAV_TEMPO_LOCK            0.5   // Normalized autocorrelation at the period to lock.  Random onsets settle near 0.2
+#define WAV_TEMPO_UNLOCK          0.3   // and to lose the lock
+#define WAV_TEMPO_EVENTS           32   // Events waiting to be read.  Must be power of 2
+
+enum wav_tempo_event_type
+{
+  WAV_TEMPO_ONSET,     // A note or drum hit started, value is the strength
+  WAV_TEMPO_BEAT,      // A beat is due, value is the tempo in BPM
+  WAV_TEMPO_LOCKED,    // A steady tempo was found, value is the tempo in BPM
+  WAV_TEMPO_LOST       // The tempo is no longer clear, beats stop until it locks again
+};
+
+typedef struct
+{
+  uint8_t  type;       // wav_tempo_event_type
+  uint32_t sample;     // Position in the input, counted from begin().  Beats can be up to one hop ahead
+  float    value;
+} wav_tempo_event_t;
+
+/*
+ * Tempo and beat tracker for a live sample stream, built on WAV_onset.
+ * Each onset frame adds its novelty to a running autocorrelation of the onset
+ * envelope, one multiply-add per lag, which decays so the tempo can change.
+ * Every WAV_TEMPO_UPDATE frames the lag with the highest autocorrelation,
+ * weighted by a log normal prior around WAV_TEMPO_PRIOR_BPM, gives the beat period.
+ * Beats are nearly always divided, so a period with no onsets half way through
+ * is taken as the half beat of a slower tempo when double the period is strong
+ * enough, which stops steady eighth notes locking slow songs at double time.
+ * A comb filter with that period resonates with onsets that fall on the beat, so
+ * its largest output in the last period marks the beat phase.  The next beat is
+ * predicted one period on and gradually pulled toward the comb's phase.
+ * It does not lock until two of the longest periods have been heard.
+ * Onsets, beats and lock changes are queued as events with their sample
+ * positions for the app to read with getEvent(), e.g. to send MIDI clock.
+ * The events are written and read in the same task, there is no locking.
+ * All the work is per hop, there is no batch step.
+ * No Arduino dependencies.
+ */
+class WAV_tempo
+{
+  public:
+    WAV_tempo();
+    void     begin(uint32_t sample_rate);
+    void     reset();
+    bool     pushSample(int16_t sample);
+    bool     getEvent(wav_tempo_event_t *event);
+    bool     getLocked();
+    float    getBPM();
+    float    getConfidence();
+    uint32_t getSampleCount();
+    uint32_t getBeatCount();
+    uint32_t getDropped();
+    WAV_onset *getOnset();
+
+  private:
+    void     pushFrame(float novelty);
+    void     estimate();
+    float    combAt(float frame);
+    uint16_t checkOctave(uint16_t lag);
+    void     addEvent(uint8_t type, uint32_t sample, float value);
+
+    WAV_onset _onset;
+    float    _env[WAV_TEMPO_ENV_LEN];       // Onset envelope by frame
+    float    _comb[WAV_TEMPO_ENV_LEN];      // Comb filter output by frame
+    float    _acf[WAV_TEMPO_ENV_LEN];       // Running autocorrelation by lag
+    float    _prior[WAV_TEMPO_ENV_LEN];     // Tempo prior by lag
+    float    _acf0 = 0;                     // Running energy, for normalizing
+    float    _frame_rate = 86.13;
+    float    _period = 0;                   // Beat period in frames, 0 until the first estimate
+    float    _next_beat = 0;                // Frame of the next beat
+    float    _confidence = 0;
+    uint16_t _min_lag = 28;
+    uint16_t _max_lag = 87;
+    uint32_t _frame_cnt = 0;
+    uint32_t _beat_cnt = 0;
+    bool     _locked = false;
+
+    wav_tempo_event_t _events[WAV_TEMPO_EVENTS];
+    uint32_t _event_write = 0;
+    uint32_t _event_read = 0;
+    uint32_t _dropped = 0;
+};
+
+#endif // _WAV_TEMPO_
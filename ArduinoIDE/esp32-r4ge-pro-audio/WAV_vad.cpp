@@ -0,0 +1,148 @@
+#include "WAV_vad.h"
+
+WAV_vad::WAV_vad()
+{
+  reset();
+}
+
+/*
+ * Forgets the noise floor and goes inactive, for example when the microphone restarts.
+ */
+void WAV_vad::reset()
+{
+  _dc_q8 = 0;
+  _sum_sq = 0;
+  _block_cnt = 0;
+  _level = 0;
+  _floor_q8 = 0;
+  _hang = 0;
+  _active = false;
+  _primed = false;
+  _blocks = 0;
+  _active_blocks = 0;
+}
+
+/*
+ * Adds a sample.  Returns true when a block has ended and getActive() may have changed.
+ */
+bool WAV_vad::pushSample(int16_t sample)
+{
+  // Integer DC tracker, so a bias on the microphone does not count as level
+  _dc_q8 += (((int32_t)sample << 8) - _dc_q8) >> WAV_VAD_DC_SHIFT;
+  int32_t ac = (int32_t)sample - (_dc_q8 >> 8);
+  
+  _sum_sq += (uint32_t)(ac * ac);
+  if (++_block_cnt < WAV_VAD_BLOCK) return false;
+  
+  endBlock();
+  return true;
+}
+
+void WAV_vad::pushBlock(const int16_t *samples, uint16_t count)
+{
+  for (uint16_t i = 0; i < count; i++)
+  {
+    pushSample(samples[i]);
+  }
+}
+
+/*
+ * Sets the start and end levels as multiples of the noise floor, in Q8 (256 = 1x).
+ */
+void WAV_vad::setRatios(uint16_t on_ratio_q8, uint16_t off_ratio_q8)
+{
+  _on_ratio_q8 = on_ratio_q8;
+  _off_ratio_q8 = (off_ratio_q8 <= on_ratio_q8 ? off_ratio_q8 : on_ratio_q8);
+}
+
+bool WAV_vad::getActive()
+{
+  return _active;
+}
+
+/*
+ * Returns the RMS of the last block, after DC removal.
+ */
+uint16_t WAV_vad::getLevel()
+{
+  return _level;
+}
+
+uint16_t WAV_vad::getNoiseFloor()
+{
+  return _floor_q8 >> 8;
+}
+
+uint32_t WAV_vad::getBlockCount()
+{
+  return _blocks;
+}
+
+uint32_t WAV_vad::getActiveCount()
+{
+  return _active_blocks;
+}
+
+/*
+ * Integer square root, rounded down.
+ */
+uint32_t WAV_vad::isqrt(uint64_t value)
+{
+  uint64_t root = 0;
+  uint64_t bit = (uint64_t)1 << 62;
+
+  while (bit > value) bit >>= 2;
+  while (bit != 0)
+  {
+    if (value >= root + bit)
+    {
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    }
+    else
+    {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (uint32_t)root;
+}
+
+/*
+ * Updates the floor and the active state from the block that just ended.
+ */
+void WAV_vad::endBlock()
+{
+  uint32_t level = isqrt(_sum_sq / WAV_VAD_BLOCK);
+  uint32_t level_q8 = level << 8;
+  
+  _level = (level > 0xFFFF ? 0xFFFF : level);
+  _sum_sq = 0;
+  _block_cnt = 0;
+  _blocks++;
+
+  if (!_primed)
+  {
+    _floor_q8 = level_q8;
+    _primed = true;
+  }
+
+  // Compare with the floor before this block moves it
+  uint32_t floor = (_floor_q8 >> 8 > WAV_VAD_MIN_FLOOR ? _floor_q8 >> 8 : WAV_VAD_MIN_FLOOR);
+  if (level * 256 > floor * _on_ratio_q8)
+  {
+    _active = true;
+    _hang = WAV_VAD_HANG_BLOCKS;
+  }
+  else if (_active && level * 256 < floor * _off_ratio_q8)
+  {
+    if (_hang > 0) _hang--;
+    if (_hang == 0) _active = false;
+  }
+  if (_active) _active_blocks++;
+
+  if (level_q8 < _floor_q8)
+    _floor_q8 -= (_floor_q8 - level_q8) >> WAV_VAD_FLOOR_FALL;
+  else
+    _floor_q8 += ((level_q8 - _floor_q8) >> (_active ? WAV_VAD_FLOOR_RISE_ACTIVE : WAV_VAD_FLOOR_RISE)) + 1;
+}
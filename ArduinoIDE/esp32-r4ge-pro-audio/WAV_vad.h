@@ -0,0 +1,57 @@
+#ifndef _WAV_VAD_
+#define _WAV_VAD_
+
+#include <stdint.h>
+
+#define WAV_VAD_BLOCK          64  // Samples per decision (~6 msec at 11025 Hz)
+#define WAV_VAD_ON_RATIO_Q8  1024  // Level over the noise floor that starts activity, Q8 (4x, 12 dB)
+#define WAV_VAD_OFF_RATIO_Q8  512  // Level it has to stay under to end activity, Q8 (2x, 6 dB)
+#define WAV_VAD_HANG_BLOCKS    24  // Quiet blocks before going inactive.  Covers a whole 512 sample frame and short pauses
+#define WAV_VAD_FLOOR_FALL      2  // Floor moves 1/4 of the way down to a quieter block
+#define WAV_VAD_FLOOR_RISE      6  // and 1/64 of the way up to a louder one (~0.4 sec) while inactive
+#define WAV_VAD_FLOOR_RISE_ACTIVE 10  // 1/1024 while active (~6 sec), so steady new noise still ends activity
+#define WAV_VAD_MIN_FLOOR       4  // Keeps digital silence from making any noise look active
+#define WAV_VAD_DC_SHIFT        8  // DC tracker time constant, 256 samples
+
+/*
+ * Energy based voice (or any sound) activity detector for 16-bit samples.
+ * The RMS of each block of WAV_VAD_BLOCK samples is compared with an adaptive 
+ * noise floor, which follows quiet blocks down quickly and louder ones up slowly.  
+ * Activity starts above WAV_VAD_ON_RATIO times the floor and ends after 
+ * WAV_VAD_HANG_BLOCKS blocks under WAV_VAD_OFF_RATIO times the floor.
+ * Integer math only, so it costs far less than the FFT it is used to skip.
+ * No Arduino dependencies.
+ */
+class WAV_vad
+{
+  public:
+    WAV_vad();
+    void     reset();
+    bool     pushSample(int16_t sample);
+    void     pushBlock(const int16_t *samples, uint16_t count);
+    void     setRatios(uint16_t on_ratio_q8, uint16_t off_ratio_q8);
+    bool     getActive();
+    uint16_t getLevel();
+    uint16_t getNoiseFloor();
+    uint32_t getBlockCount();
+    uint32_t getActiveCount();
+    static uint32_t isqrt(uint64_t value);
+
+  private:
+    void     endBlock();
+    
+    int32_t  _dc_q8 = 0;         // Running DC level, Q8
+    uint64_t _sum_sq = 0;        // Squares of the current block
+    uint16_t _block_cnt = 0;     // Samples in the current block
+    uint16_t _level = 0;         // RMS of the last block
+    uint32_t _floor_q8 = 0;      // Noise floor RMS, Q8
+    uint16_t _on_ratio_q8 = WAV_VAD_ON_RATIO_Q8;
+    uint16_t _off_ratio_q8 = WAV_VAD_OFF_RATIO_Q8;
+    uint16_t _hang = 0;          // Quiet blocks left before going inactive
+    bool     _active = false;
+    bool     _primed = false;    // The floor has been set from a first block
+    uint32_t _blocks = 0;
+    uint32_t _active_blocks = 0;
+};
+
+#endif // _WAV_VAD_
@@ -17,8 +17,23 @@ There is no warranty; not even for merchantability or fitness for a particular p
 #include "freertos/queue.h"
 #include "WAV_audio.h"
 #include "WAV_file.h"
+#include "WAV_features.h"
 #include "WAV_frame.h"
+#include "WAV_mfcc.h"
+#include "WAV_stft.h"
+#include "WAV_pitch.h"
+#include "WAV_kws.h"
+#include "WAV_tempo.h"
+#include "WAV_midi_clock.h"
+#include "WAV_peaks.h"
+#include "WAV_capture.h"
+#include "WAV_capture_i2s.h"
+#include "WAV_recorder.h"
+#include "WAV_player.h"
+#include "WAV_conv.h"
 #include "DFT.h"
+#include <new>
+#include <TLM_channel.h>
 #include "sd_icon.h"
 
 #define TOP_LINE     30
@@ -35,6 +50,21 @@ There is no warranty; not even for merchantability or fitness for a particular p
 #define SD_TOUCH_X2 3800
 #define SD_TOUCH_Y2  500
 
+// Touch screen area of the title, to step through the impulse responses
+#define IR_TOUCH_X2 3000
+#define IR_TOUCH_Y2  500
+
+#define IR_FILE_CNT    4  // /AUDIO/IR/IR1.WAV to IR4.WAV, reverb or cabinet IRs at any rate
+#define IR_WET_MIX   1.0  // Room IRs include the direct sound, so none of the dry signal is added
+#define IR_MAX_LOAD  0.75  // Share of each block's play time the convolution may take
+
+// Touch screen areas of the waveform for zoom and pan
+#define WAVE_TOUCH_Y1     500
+#define WAVE_TOUCH_Y2    2100
+#define WAVE_TOUCH_MID_Y 1300  // Above zooms in, below zooms out
+#define WAVE_TOUCH_LEFT  1300  // Left of this pans left
+#define WAVE_TOUCH_RIGHT 3000  // Right of this pans right
+
 #define SEL_BTN_CNT 20
 #define SEL_BTN_WD  60
 #define SEL_BTN_HT  40
@@ -42,18 +72,53 @@ There is no warranty; not even for merchantability or fitness for a particular p
 #define SEL_BTN_SCRN_X(btn) (((btn) - 1) % 5 * (SEL_BTN_WD + 4))
 #define SEL_BTN_SCRN_Y(btn) (TOP_LINE + 4 + (((btn) - 1) / 5) * (SEL_BTN_HT + 4))
 
+#define SPECTRO_FIRST_BIN       1  // Skip DC.  One bin per pixel, ~21.5 Hz per bin
+#define SPECTRO_STATS_MS     5000  // How often the column rate is sent to the serial port
+#define MIC_SAMPLE_RATE     11025
+#define TUNER_DRAW_MS         100  // Estimates arrive ~43 times a second, the display is redrawn at most this often
+#define TUNER_CENTS_X(cents)  (160 + (int)((cents) * 2.8))  // +/-50 cents across the bar
+#define TUNER_BAR_Y           160
+#define TUNER_BAR_HT           24
+#define KWS_BOX_Y             150  // Touch a keyword box, then say the word to record it
+#define KWS_BOX_WD             80
+#define KWS_BOX_HT             50
+#define KWS_TOUCH_Y1         2500
+#define KWS_TOUCH_X0          400
+#define KWS_TOUCH_BOX_WD      850
+#define TEMPO_DRAW_MS         100  // BPM and confidence redraw
+#define TEMPO_FLASH_MS         80  // Beat light on time
+#define TEMPO_LIGHT_X         160
+#define TEMPO_LIGHT_Y         160
+#define TEMPO_LIGHT_R          20
+#define TEMPO_CONF_Y          190
+
+// Hardware scrolling runs along the panel's 320 memory lines, which are screen columns
+// in landscape.  With SCREEN_ROT 3 the first memory line is the right edge of the screen.
+#define SPECTRO_LINE_X(line) (SCREEN_WD - 1 - (line))
+
 enum app_mode_type 
 {
   MODE_WAV_DISPLAY,
   MODE_WAV_SELECT_LOAD,
   MODE_WAV_SELECT_SAVE,
-  MODE_WAV_ANALYZE
+  MODE_WAV_ANALYZE,
+  MODE_WAV_SPECTROGRAM,
+  MODE_WAV_TUNER,
+  MODE_WAV_KEYWORD,
+  MODE_WAV_TEMPO
 };
 enum app_mode_type app_mode, prev_app_mode;
 
 const char* APP_FOLDER = "/AUDIO/MIC/";
 const char* WAV_NAME   = "MIC000";
 char wav_filename[]    = "/AUDIO/MIC/MIC000.WAV";      
+char mfcc_filename[]   = "/AUDIO/MIC/MIC000.FEA";
+char rec_filename[]    = "/AUDIO/MIC/REC000.WAV";
+char rec_feat_filename[] = "/AUDIO/MIC/REC000.FEA";  // MFCC of the streamed recording
+const char* IR_FOLDER  = "/AUDIO/IR/";
+char ir_filename[]     = "/AUDIO/IR/IR1.WAV";
+const char* KWS_FOLDER = "/AUDIO/KWS/";
+char kws_filename[]    = "/AUDIO/KWS/W0T0.KWS";      // Keyword and template slot
 uint16_t    mic_index  = 1;
 
 bool btn_pressed[8], btn_released[8], btnSD_pressed, btnSD_released;
@@ -90,11 +155,69 @@ i2s_pin_config_t pin_config = {
 WAV_audio wav_audio;
 WAV_frame wav_frame;
 WAV_file  wav_file;
+WAV_mfcc  wav_mfcc;
+WAV_stft *wav_stft = NULL;     // Allocated while the spectrogram is on screen
+WAV_vad   spectro_vad;          // Skips the FFT of quiet spectrogram columns
+WAV_vad   mfcc_vad;             // Skips the FFT of quiet MFCC frames
+
+WAV_capture     wav_capture;
+WAV_capture_i2s mic_i2s;
+uint16_t  mic_peak = 0;         // Largest sample since the meter last read it
+uint32_t  record_pos = 0;
+bool      record_done = false;
+WAV_recorder wav_recorder;      // Streams to SD, no length limit
+WAV_player   wav_player;        // Streams from SD, no length limit
+WAV_features wav_features;      // MFCC feature file, of the buffer or the streamed recording
+WAV_conv     wav_conv;          // Impulse response applied to playback
+WAV_resampler_q15 ir_resampler; // Converts IR files to the playback rate
+uint8_t      ir_index = 0;      // IR file in use, 0 = none
+uint32_t     ir_rate = WAV_SAMPLE_RATE;  // Rate the loaded IR was converted to
+bool      wav_from_file = false;  // wav_audio holds the start of wav_filename
+bool      file_playing = false;
+
+WAV_peaks  wav_peaks;            // Peaks of the sample buffer
+WAV_peaks  rec_peaks;            // Peaks of the streaming recording, any length
+WAV_peaks *wave_peaks = &wav_peaks;  // Peaks of the waveform on screen
+uint32_t   wave_start = 0;       // Sample at the left edge of the waveform
+uint32_t   wave_zoom = 1;        // Samples per screen column
+wav_peak_t wave_cols[SCREEN_WD];
 
 #define   BUFFER_SIZE          512 
 #define   SAMPLES_PER_BUFFER   256   // 2 bytes per sample
 uint8_t   audio_buffer[BUFFER_SIZE];
 
+uint16_t  spectro_lut[256];             // Level to RGB565 colour map
+uint8_t   spectro_levels[SCREEN_HT];
+uint16_t  spectro_column[SCREEN_HT];
+uint16_t  spectro_scroll = 0;           // Hardware scroll start line
+uint32_t  spectro_col_cnt = 0;
+uint32_t  spectro_silent_cnt = 0;       // Columns the VAD gate skipped
+uint32_t  spectro_stats_ms = 0;
+
+WAV_pitch  *wav_pitch = NULL;           // Allocated while the tuner is on screen
+wav_pitch_t tuner_pitch;
+bool        tuner_new = false;          // tuner_pitch has been updated since it was drawn
+uint32_t    tuner_draw_ms = 0;
+WAV_kws         *wav_kws = NULL;        // Allocated while the keyword spotter is on screen
+WAV_mfcc        *kws_mfcc = NULL;
+WAV_vad          kws_vad;               // Opens for each utterance
+wav_kws_result_t kws_result;
+bool      kws_in_utterance = false;
+bool      kws_matched = false;          // kws_result is under the threshold
+bool      kws_new = false;              // kws_result has been updated since it was drawn
+int8_t    kws_record_word = -1;         // Keyword the next utterance is recorded as
+int8_t    kws_saved_word = -1;          // Recorded in the subscriber, to be saved to SD
+uint8_t   kws_saved_slot = 0;
+WAV_tempo     *wav_tempo = NULL;        // Allocated while the tempo tracker is on screen
+WAV_midi_clock midi_clock;              // Beats out to TX2 for a synth or drum machine to follow
+uint32_t  tempo_draw_ms = 0;
+uint32_t  tempo_beat_ms = 0;            // When the beat light went on, 0 if it is off
+bool      tempo_beat_new = false;       // A beat has arrived since updateTempo()
+uint32_t  tempo_onset_cnt = 0;
+uint8_t   kws_next_slot[WAV_KWS_WORDS]; // Empty or oldest template of each keyword
+
+const char* NOTE_NAMES[12] = { "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B" };
+
 File     root;
 XPT2046_Touchscreen ts(TCH_CS);
 Adafruit_ILI9341 tft = Adafruit_ILI9341(TFT_CS, TFT_DC, TFT_RST);
@@ -105,6 +228,7 @@ Adafruit_ILI9341 tft = Adafruit_ILI9341(TFT_CS, TFT_DC, TFT_RST);
 void setup() 
 {
   Serial.begin(115200);
+  tlm_channel.begin(&Serial);
   Serial.println("ESP32 Badge Pro Audio I2S"); 
   delay(100);
   
@@ -136,212 +260,1244 @@ void setup()
   sd_present = initSD();
   if (sd_present)
   {
-    if (!SD.exists(APP_FOLDER))
-    {
-      SD.mkdir(APP_FOLDER);
-    }
+    if (!SD.exists(APP_FOLDER))
+    {
+      SD.mkdir(APP_FOLDER);
+    }
+    if (!SD.exists(KWS_FOLDER))
+    {
+      SD.mkdir(KWS_FOLDER);
+    }
+    if (!SD.exists(IR_FOLDER))
+    {
+      SD.mkdir(IR_FOLDER);
+    }
+  }
+
+  // Set up the initial test waveform
+  //wav_audio.fillWaveform(440, 0);  // 440Hz = A4
+
+  double two_pi_scaled = 2 * PI / 16;
+  int16_t sample;
+  for(int i = 0; i < WAV_MAX_SAMPLES; i++) 
+  {
+    sample = (int16_t)(30000 * sin((double)i * two_pi_scaled));
+    wav_audio.setSample(i, 0, sample);
+    //if (i < 400) Serial.println(sample);
+  }
+  
+  buildPeaks();
+  initSpectrogramLUT();
+  wav_mfcc.setGate(&mfcc_vad);
+  wav_conv.setMix(IR_WET_MIX);
+  wav_player.setConvolver(&wav_conv);
+  midi_clock.begin(&Serial2);
+  wav_capture.subscribe(meterBlock, NULL);
+  mic_i2s.begin(&wav_capture, MIC_SAMPLE_RATE);
+  
+  beginWavDisplay();
+  drawSD(sd_present);
+  
+  Serial.println(F("Setup complete."));
+}
+
+/*
+ * Initialize the SD file system before trying using a reader or writer
+ */
+bool initSD()
+{
+  // ESP32 requires 25 MHz SPI clock limit. Breakouts may require 10 MHz limit due to longer wires
+  // See SDFat/src/SdCard/SdInfo.h for list of error codes
+  bool sd_ok = false;  
+  digitalWrite(TFT_CS, HIGH); // disable TFT
+  digitalWrite(TCH_CS, HIGH); // disable Touchscreen - otherwise SD.begin() will fail!
+
+  Serial.print(F("Initializing filesystem..."));
+  if(SD.begin(SD_CS)) 
+  { 
+    root = SD.open("/");
+    if (root) 
+    {
+      sd_ok = true;
+    }
+    else
+    {
+      tft.println(F("open root failed!"));
+      Serial.println(F("open root failed!"));
+    }
+  }
+  else
+  { 
+    tft.println(F("SD begin() failed!"));
+    Serial.println(F("SD begin() failed!")); 
+  }
+ 
+  return sd_ok;
+}
+
+void setFilename(uint16_t index)
+{
+	wav_filename[14] = char(48 + (index % 1000) / 100);
+	wav_filename[15] = char(48 + (index % 100) / 10);
+	wav_filename[16] = char(48 + (index % 10));
+}
+
+bool loadWavFile(uint16_t index)
+{
+	setFilename(index);
+	wav_from_file = wav_file.loadFile(wav_filename, &wav_audio);
+	if (wav_from_file) buildPeaks();
+	return wav_from_file;
+}
+
+bool saveWavFile(uint16_t index)
+{
+	setFilename(index);
+	return wav_file.saveFile(wav_filename, &wav_audio);
+}
+
+/*
+ * Streams the recorded audio through the MFCC extractor into a binary feature file.
+ * Read it on the host with tools/feature_dump.
+ */
+bool saveMfccFile(uint16_t index)
+{
+  if (wav_features.getWriting())
+  {
+    Serial.println(F("Feature file in use by the streamed recording!"));
+    return false; // failure
+  }
+
+  mfcc_filename[14] = char(48 + (index % 1000) / 100);
+  mfcc_filename[15] = char(48 + (index % 100) / 10);
+  mfcc_filename[16] = char(48 + (index % 10));
+  Serial.print(F("Saving MFCC file: "));
+  Serial.println(mfcc_filename);
+  
+  if (!wav_features.begin(mfcc_filename, WAV_FEAT_KIND_MFCC, WAV_FEAT_FLOAT32, WAV_SAMPLE_RATE, 
+                          WAV_FRAME_SIZE, WAV_FRAME_STRIDE, WAV_FRAME_MFCC_CNT))
+    return false; // failure
+
+  wav_mfcc.reset();
+  for (uint16_t i = 0; i < WAV_MAX_SAMPLES; i++)
+  {
+    if (wav_mfcc.pushSample(wav_audio.getSample(i, WAV_CHNL_LEFT)))
+    {
+      wav_features.addFrame(wav_mfcc.getCoefficients());
+      if (!wav_features.update()) return false; // failure
+    }
+  }
+  Serial.print(F("MFCC frames: "));  Serial.print(wav_mfcc.getFrameCount());
+  Serial.print(F(", silent: "));     Serial.println(wav_mfcc.getSilentCount());
+  return wav_features.end();
+}
+
+/*
+ * Starts streaming the microphone to the next unused RECnnn.WAV file.
+ */
+bool startStreamRecording()
+{
+  uint16_t index = 0;
+  
+  do 
+  {
+    rec_filename[14] = char(48 + (index % 1000) / 100);
+    rec_filename[15] = char(48 + (index % 100) / 10);
+    rec_filename[16] = char(48 + (index % 10));
+    index++;
+  } while (SD.exists(rec_filename) && index < 1000);
+
+  if (!wav_recorder.begin(rec_filename, wav_capture.getSampleRate()))
+    return false;
+
+  // The MFCC of the recording, written once here rather than worked out again off the badge
+  if (wav_capture.getSampleRate() == WAV_MFCC_SAMPLE_RATE && !wav_features.getWriting())
+  {
+    memcpy(&rec_feat_filename[14], &rec_filename[14], 3);
+    wav_mfcc.reset();
+    wav_features.begin(rec_feat_filename, WAV_FEAT_KIND_MFCC, WAV_FEAT_FLOAT32, WAV_MFCC_SAMPLE_RATE,
+                       WAV_MFCC_FRAME_SIZE, WAV_MFCC_STRIDE, WAV_MFCC_COEF_CNT);
+  }
+  
+  rec_peaks.reset();
+  wav_capture.subscribe(streamBlock, NULL);
+  drawRecording(true);
+  return true;
+}
+
+/*
+ * Capture subscriber for the streaming recording.  Queues the samples for the 
+ * SD card, adds them to the recording's peaks for the waveform display, and 
+ * queues each MFCC frame for the feature file.
+ */
+void streamBlock(const int16_t *samples, uint16_t count, void *context)
+{
+  WAV_recorder::captureBlock(samples, count, &wav_recorder);
+  rec_peaks.pushBlock(samples, count);
+
+  if (!wav_features.getWriting()) return;
+  for (uint16_t i = 0; i < count; i++)
+  {
+    if (wav_mfcc.pushSample(samples[i]))
+    {
+      wav_features.addFrame(wav_mfcc.getCoefficients());
+    }
+  }
+}
+
+/*
+ * Stops the streaming recording and reports how well the SD card kept up.
+ */
+void stopStreamRecording()
+{
+  wav_recorder_stats_t stats;
+
+  wav_capture.unsubscribe(streamBlock, NULL);
+  wav_recorder.end();
+  drawRecording(false);
+
+  if (wav_features.getWriting())
+  {
+    wav_features_stats_t feat_stats;
+    wav_features.end();
+    wav_features.getStats(&feat_stats);
+    TLM_INFO("Features", "MFCC frames: %u, overruns: %u", feat_stats.frames, feat_stats.overruns);
+  }
+
+  // Show the whole recording, not just the first second
+  wave_peaks = &rec_peaks;
+  fitWaveView();
+  if (app_mode == MODE_WAV_DISPLAY) drawWaveform();
+
+  wav_recorder.getStats(&stats);
+  Serial.print(F("Recorded samples: "));    Serial.println(stats.samples);
+  Serial.print(F("Buffer writes:    "));    Serial.println(stats.writes);
+  Serial.print(F("Max write usec:   "));    Serial.println(stats.max_write_us);
+  Serial.print(F("SD bytes/sec:     "));    Serial.print(wav_recorder.getThroughput());
+  Serial.print(F(" (need "));               Serial.print(wav_capture.getSampleRate() * 2); Serial.println(F(")"));
+  Serial.print(F("Buffer overruns:  "));    Serial.println(stats.overruns);
+  Serial.print(F("Capture overruns: "));    Serial.println(wav_capture.getOverruns());
+}
+
+/*
+ * Initialize the I2S audio output
+ */
+bool initAudioI2S()
+{
+	esp_err_t err;
+	
+	err = i2s_driver_install((i2s_port_t)i2s_port_num, &i2s_config, 0, NULL);
+	if (err != ESP_OK)
+	{
+		Serial.print("I2S driver install fail: ");
+		Serial.println(err);
+		return false;
+	}	
+	i2s_set_pin((i2s_port_t)i2s_port_num, &pin_config);
+	i2s_set_clk((i2s_port_t)i2s_port_num, 11025, I2S_BITS_PER_SAMPLE_16BIT, I2S_CHANNEL_MONO);
+	
+	return true;
+}
+
+/* 
+ * Plays the audio sample.  
+ * Does not return until sample is done playing.
+ */
+void playAudio()
+{
+  bool     audio_playing = false;
+  uint32_t sample_pos = 0;
+  uint32_t end_pos = WAV_MAX_SAMPLES - 1;
+  int16_t  block[SAMPLES_PER_BUFFER];
+  int16_t  temp;
+  size_t   bytes_out;
+
+  mic_i2s.end();  // The microphone and speaker share I2S0
+  matchImpulseRate(WAV_SAMPLE_RATE);
+  audio_playing = initAudioI2S();
+
+  if (wav_conv.getLoaded())
+  {
+    wav_conv.reset();
+    end_pos += wav_conv.getTapCount() + WAV_CONV_BLOCK;  // Let the IR ring out
+  }
+  
+  // Fill I2S transfer audio buffer from sample buffer
+  while (audio_playing)
+  {
+    for (int i = 0; i < SAMPLES_PER_BUFFER; i++)
+    {
+      block[i] = (sample_pos + i < WAV_MAX_SAMPLES ? wav_audio.getSample(sample_pos + i, 0) : WAV_SILENCE);
+    }
+    wav_conv.process(block, SAMPLES_PER_BUFFER);  // Passes the samples through if no IR is loaded
+    
+    for (int i = 0; i < SAMPLES_PER_BUFFER; i++)
+    {
+      temp = block[i];
+      audio_buffer[i * 2] = (uint8_t)temp & 0xff;
+      temp = temp >> 8;
+      audio_buffer[i * 2 + 1] = (uint8_t)temp;
+    }
+    
+    // Write data to I2S DMA buffer.  Blocking call, last parameter = ticks to wait or portMAX_DELAY for no timeout
+    i2s_write((i2s_port_t)i2s_port_num, (const char *)&audio_buffer, sizeof(audio_buffer), &bytes_out, 100);
+    if (bytes_out != sizeof(audio_buffer)) TLM_WARN("I2S", "Write timeout, %u of %u bytes", bytes_out, sizeof(audio_buffer));
+
+    sample_pos += SAMPLES_PER_BUFFER;
+    if (sample_pos >= end_pos) audio_playing = false;
+  }
+  // Stop audio playback
+  i2s_driver_uninstall((i2s_port_t)i2s_port_num);
+  mic_i2s.begin(&wav_capture, MIC_SAMPLE_RATE);
+}
+
+/*
+ * Loads impulse response IRn.WAV into the convolver, or unloads it for 0.
+ * The IR is converted to rate, the rate it will be played at, and cut off at 
+ * WAV_CONV_MAX_TAPS (~93 msec at 44100 Hz).
+ * Returns true if an IR is loaded.
+ */
+bool loadImpulse(uint8_t index, uint32_t rate)
+{
+  WAV_reader reader;
+  int16_t    block[WAV_CONV_BLOCK];
+  float      taps[WAV_CONV_BLOCK];
+  uint32_t   count;
+
+  wav_conv.unload();
+  if (index == 0) return false;
+
+  ir_filename[12] = char(48 + index);
+  if (!sd_present || !SD.exists(ir_filename) || !reader.open(ir_filename)) return false;
+
+  bool ok = reader.setOutputRate(rate, &ir_resampler);
+  uint32_t tap_cnt = reader.getOutputCount();
+  if (tap_cnt > WAV_CONV_MAX_TAPS)
+  {
+    Serial.println(F("Impulse response truncated to 4096 taps"));
+    tap_cnt = WAV_CONV_MAX_TAPS;
+  }
+
+  if (!ok || !wav_conv.beginIR(tap_cnt))
+  {
+    Serial.println(F("Unable to load the impulse response!"));
+    reader.close();
+    return false;
+  }
+
+  while ((count = reader.readMono(block, WAV_CONV_BLOCK)) > 0)
+  {
+    for (uint32_t i = 0; i < count; i++)
+    {
+      taps[i] = block[i] / 32768.0;
+    }
+    if (!wav_conv.addTaps(taps, count)) break;  // Longer than WAV_CONV_MAX_TAPS
+  }
+  reader.close();
+  wav_conv.endIR(true);
+  ir_rate = rate;
+
+  TLM_INFO("IR", "Loaded IR%u at %u Hz, %u taps in %u partitions", index, rate, wav_conv.getTapCount(), wav_conv.getPartCount());
+  return wav_conv.getLoaded();
+}
+
+/*
+ * Converts the impulse response in use to the rate audio is about to play at.
+ * The I2S clock runs at the audio's own rate, and an IR converted for another 
+ * rate would ring for the wrong time and be shifted in pitch.
+ * The convolution costs the same per block at any rate, but a block plays for 
+ * less time at higher rates, so one block is timed against IR_MAX_LOAD of its 
+ * play time.  If the IR will not load or is too slow, playback is dry.
+ */
+void matchImpulseRate(uint32_t rate)
+{
+  int16_t block[WAV_CONV_BLOCK];
+
+  if (ir_index == 0 || (ir_rate == rate && wav_conv.getLoaded())) return;
+
+  bool ok = loadImpulse(ir_index, rate);
+  if (ok)
+  {
+    for (uint16_t i = 0; i < WAV_CONV_BLOCK; i++)
+    {
+      block[i] = WAV_SILENCE;
+    }
+    uint32_t start_us = micros();
+    wav_conv.process(block, WAV_CONV_BLOCK);  // A full block runs the transforms
+    uint32_t cost_us = micros() - start_us;
+    uint32_t budget_us = (uint32_t)(IR_MAX_LOAD * WAV_CONV_BLOCK * 1000000.0 / rate);
+    wav_conv.reset();
+
+    TLM_INFO("IR", "%u us per block at %u Hz, budget %u us", cost_us, rate, budget_us);
+    if (cost_us > budget_us)
+    {
+      Serial.println(F("Impulse response too slow at this sample rate, playing dry"));
+      ok = false;
+    }
+  }
+
+  if (!ok)
+  {
+    loadImpulse(0, rate);
+    ir_index = 0;
+    drawImpulse();
+  }
+}
+
+/*
+ * Shows the impulse response in use in place of the title.
+ */
+void drawImpulse()
+{
+  tft.fillRect(0, 0, 256, TOP_LINE, ILI9341_BLACK);
+  tft.setTextColor(ILI9341_WHITE);  
+  tft.setTextSize(2);
+  tft.setCursor(0, 4);
+  if (!wav_conv.getLoaded())
+  {
+    tft.print("ESP32 Badge Pro Audio");
+    return;
+  }
+  tft.print("IR");
+  tft.print(ir_index);
+  tft.print(": ");
+  tft.print(wav_conv.getTapCount());
+  tft.print(" taps");
+}
+
+/*
+ * Steps to the next impulse response on the card, skipping missing files, then none.
+ */
+void nextImpulse()
+{
+  if (file_playing) return;  // The player task is using the convolver
+  
+  do
+  {
+    ir_index = (ir_index + 1) % (IR_FILE_CNT + 1);
+  } while (ir_index != 0 && !loadImpulse(ir_index, WAV_SAMPLE_RATE));
+  
+  if (ir_index == 0) loadImpulse(0, WAV_SAMPLE_RATE);
+  drawImpulse();
+}
+
+/*
+ * Starts streaming the last loaded file from the SD card, so the whole file 
+ * is played rather than the part that fits in wav_audio.  
+ * updateFilePlayback() keeps it fed.
+ */
+bool startFilePlayback()
+{
+  WAV_reader reader;
+
+  // The player runs I2S at the file's own rate, so the IR has to be at that rate too
+  if (ir_index != 0 && reader.open(wav_filename))
+  {
+    uint32_t rate = reader.getSampleRate();
+    reader.close();
+    matchImpulseRate(rate);
+  }
+
+  mic_i2s.end();  // The microphone and speaker share I2S0
+  file_playing = wav_player.begin(wav_filename, &i2s_config, &pin_config, (i2s_port_t)i2s_port_num);
+  if (!file_playing)
+  {
+    mic_i2s.begin(&wav_capture, MIC_SAMPLE_RATE);
+  }
+  return file_playing;
+}
+
+/*
+ * Tops up the file playback from the SD card.  Call on each loop.
+ */
+void updateFilePlayback()
+{
+  if (!file_playing || wav_player.update()) return;
+
+  wav_player.end();
+  file_playing = false;
+  Serial.print(F("Playback underruns: "));
+  Serial.println(wav_player.getUnderruns());
+  mic_i2s.begin(&wav_capture, MIC_SAMPLE_RATE);
+}
+
+/*
+ * Use to toggle between normal and inverted text display
+ */
+void setTextColor(uint16_t color, bool inverted)
+{
+  if (inverted)
+    tft.setTextColor(ILI9341_BLACK, color);
+  else
+    tft.setTextColor(color, ILI9341_BLACK);
+}
+
+/*
+ * Draws the SD card status icon indicating if the card is present or not.
+ */
+void drawSD(bool present)
+{
+  uint16_t color = (present ? ILI9341_WHITE : ILI9341_DARKGREY);
+  tft.drawRGBBitmap(294, 2, (uint16_t *)sd_icon, 18, 24);
+  if (!present)
+    tft.drawLine(294, 0, 314, 26, ILI9341_RED);  
+
+  tft.drawRect(284, 0, 35, 28, color); // button outline
+}
+
+/*
+ * Draws or clears the streaming recording indicator next to the SD icon.
+ */
+void drawRecording(bool recording)
+{
+  if (app_mode == MODE_WAV_SPECTROGRAM) return;  // Would scroll with the waterfall
+  
+  if (recording)
+    tft.fillCircle(270, 14, 8, ILI9341_RED);
+  else
+    tft.fillCircle(270, 14, 8, ILI9341_BLACK);
+}
+
+/*
+ * Builds the peaks of the sample buffer after it is recorded or loaded, and shows all of it.
+ */
+void buildPeaks()
+{
+  wav_peaks.reset();
+  for (uint16_t i = 0; i < WAV_MAX_SAMPLES; i++)
+  {
+    wav_peaks.pushSample(wav_audio.getNormalizedSample(i, WAV_CHNL_LEFT));
+  }
+  wave_peaks = &wav_peaks;
+  fitWaveView();
+}
+
+/*
+ * Returns the closest zoom.  The buffer can be shown sample by sample, a streaming 
+ * recording is only in memory as peaks.
+ */
+uint32_t minWaveZoom()
+{
+  return (wave_peaks == &wav_peaks ? 1 : wave_peaks->getBlockSize());
+}
+
+/*
+ * Returns the zoom that fits the whole waveform on the screen.
+ */
+uint32_t maxWaveZoom()
+{
+  uint32_t zoom = (wave_peaks->getSampleCount() + SCREEN_WD - 1) / SCREEN_WD;
+  return (zoom > minWaveZoom() ? zoom : minWaveZoom());
+}
+
+/*
+ * Keeps the view within the waveform.
+ */
+void clampWaveView()
+{
+  uint32_t count = wave_peaks->getSampleCount();
+
+  if (wave_zoom < minWaveZoom()) wave_zoom = minWaveZoom();
+  if (wave_zoom > maxWaveZoom()) wave_zoom = maxWaveZoom();
+  uint32_t width = wave_zoom * SCREEN_WD;
+  if (wave_start + width > count) wave_start = (count > width ? count - width : 0);
+}
+
+void fitWaveView()
+{
+  wave_start = 0;
+  wave_zoom = maxWaveZoom();
+}
+
+/*
+ * Zooms in or out by 2, keeping the centre of the screen in place.
+ */
+void zoomWave(bool zoom_in)
+{
+  uint32_t centre = wave_start + wave_zoom * SCREEN_WD / 2;
+
+  wave_zoom = (zoom_in ? wave_zoom / 2 : wave_zoom * 2);
+  clampWaveView();
+  uint32_t half = wave_zoom * SCREEN_WD / 2;
+  wave_start = (centre > half ? centre - half : 0);
+  clampWaveView();
+}
+
+/*
+ * Moves the view half a screen left (-1) or right (1).
+ */
+void panWave(int8_t dir)
+{
+  uint32_t step = wave_zoom * SCREEN_WD / 2;
+
+  if (dir < 0)
+    wave_start = (wave_start > step ? wave_start - step : 0);
+  else
+    wave_start += step;
+  clampWaveView();
+}
+
+/*
+ * Draw the WAV time domain amplitude waveform to the screen.
+ * Each column is drawn from the lowest to the highest sample it covers, read 
+ * from one level of the peaks, or from the buffer when zoomed in past them.
+ */
+void drawWaveform()
+{
+    double scale_ht = (double)WAVFORM_HT / (wav_audio.header.bits_per_sample == 8 ? 256.0 : 65536.0);
+    
+    if (wave_peaks == &wav_peaks && wave_zoom < wav_peaks.getBlockSize())
+    {
+      for (uint16_t i = 0; i < SCREEN_WD; i++)
+      {
+        uint32_t pos = wave_start + i * wave_zoom;
+        wave_cols[i].lo = wave_cols[i].hi = wav_audio.getNormalizedSample(pos, WAV_CHNL_LEFT);
+        for (uint32_t j = 1; j < wave_zoom; j++)
+        {
+          int16_t sample = wav_audio.getNormalizedSample(pos + j, WAV_CHNL_LEFT);
+          if (sample < wave_cols[i].lo) wave_cols[i].lo = sample;
+          if (sample > wave_cols[i].hi) wave_cols[i].hi = sample;
+        }
+      }
+    }
+    else
+    {
+      wave_peaks->getPeaks(wave_start, wave_zoom, SCREEN_WD, wave_cols);
+    }
+    
+    tft.fillRect(0, TOP_LINE + 1, SCREEN_WD, WAVFORM_HT, ILI9341_BLACK);
+    
+    for (uint16_t i = 0; i < SCREEN_WD; i++)
+    {
+      // Join each column to the one before, so single samples make a line
+      wav_peak_t col = wave_cols[i];
+      if (i > 0)
+      {
+        if (col.lo > wave_cols[i - 1].hi) col.lo = wave_cols[i - 1].hi;
+        if (col.hi < wave_cols[i - 1].lo) col.hi = wave_cols[i - 1].lo;
+      }
+      int16_t y = WAVFORM_CTR - col.hi * scale_ht;
+      tft.drawFastVLine(i, y, (WAVFORM_CTR - col.lo * scale_ht) - y + 1, ILI9341_GREEN);
+    }
+}
+
+/*
+ * Draw the DFT frequency domain amplitude waveform to the screen.
+ */
+void drawDFT()
+{
+    float    scale_ht = (float)ANALYZE_HT / (wav_frame.findMaxMagnitudeOutput() + 1);
+    float    pitch    = findBufferPitch();
+    float    mag      = wav_frame.getMagnitude(2);
+    float    next_mag;
+    
+    tft.fillRect(0, ANALYZE_Y - ANALYZE_HT, SCREEN_WD, ANALYZE_HT, ILI9341_BLACK);
+
+    // Skip first bin (DC offset)
+    for (uint16_t i = 2; i < WAV_FRAME_SIZE / 2; i ++)
+    {
+      next_mag = wav_frame.getMagnitude(i + 1);
+      tft.drawLine(i, ANALYZE_Y - (int)(mag * scale_ht), i + 1, ANALYZE_Y - (int)(next_mag * scale_ht), ILI9341_YELLOW); 
+
+      TLM_VERBOSE("DFT", "Bin %u magnitude %f", i, mag);
+      mag = next_mag;
+    }
+
+    tft.setTextSize(2);
+    tft.setCursor(0, 220);
+    tft.setTextColor(ILI9341_YELLOW, ILI9341_BLACK);
+    tft.print("Pitch: ");
+    if (pitch > 0)
+    {
+      tft.print((int)(pitch + 0.5));
+      tft.print(" Hz ");
+      printNote(pitch, NULL);
+    }
+    else
+    {
+      tft.print("--");
+    }
+    tft.print("        ");
+}
+
+/*
+ * Runs the pitch detector over the sample buffer.  
+ * Returns the estimate with the clearest period, or 0 if none are voiced.
+ */
+float findBufferPitch()
+{
+  wav_pitch_t estimate;
+  float best_freq = 0, best_clarity = 0;
+  WAV_pitch *pitch = new (std::nothrow) WAV_pitch();
+
+  if (pitch == NULL) return 0;
+  
+  pitch->begin(wav_audio.header.sample_rate);
+  for (uint16_t i = 0; i < WAV_MAX_SAMPLES; i++)
+  {
+    if (pitch->pushSample(wav_audio.getSample(i, WAV_CHNL_LEFT)))
+    {
+      pitch->getPitch(&estimate);
+      if (estimate.freq > 0 && estimate.clarity > best_clarity)
+      {
+        best_freq = estimate.freq;
+        best_clarity = estimate.clarity;
+      }
+    }
+  }
+  delete pitch;
+  return best_freq;
+}
+
+/*
+ * Prints the nearest note name and octave, e.g. A4, and returns how far 
+ * the frequency is from it in cents.
+ */
+void printNote(float freq, float *cents)
+{
+  float note = WAV_pitch::freqToNote(freq);
+  int16_t nearest = (int16_t)floorf(note + 0.5);
+  if (nearest < 0) nearest = 0;
+
+  tft.print(NOTE_NAMES[nearest % 12]);
+  tft.print(nearest / 12 - 1);
+  if (cents != NULL) *cents = (note - nearest) * 100;
+}
+
+/*
+ * Builds the spectrogram colour map:  black, blue, magenta, red, yellow, white.
+ */
+void initSpectrogramLUT()
+{
+  const uint8_t stops[6][3] = {{0, 0, 0}, {0, 0, 160}, {160, 0, 160}, {255, 0, 0}, {255, 255, 0}, {255, 255, 255}};
+
+  for (uint16_t i = 0; i < 256; i++)
+  {
+    uint16_t seg  = i / 51;  // 5 segments of 51 levels
+    uint16_t frac = i % 51;
+    if (seg >= 5) 
+    {
+      seg = 4;
+      frac = 51;
+    }
+    
+    uint8_t r = stops[seg][0] + ((stops[seg + 1][0] - stops[seg][0]) * frac) / 51;
+    uint8_t g = stops[seg][1] + ((stops[seg + 1][1] - stops[seg][1]) * frac) / 51;
+    uint8_t b = stops[seg][2] + ((stops[seg + 1][2] - stops[seg][2]) * frac) / 51;
+    spectro_lut[i] = tft.color565(r, g, b);
+  }
+}
+
+/*
+ * Intial drawing and setup of the live spectrogram.  
+ * The whole screen is the waterfall, so it scrolls as one.
+ */
+void beginSpectrogram()
+{
+  tft.fillScreen(ILI9341_BLACK);
+  tft.setScrollMargins(0, 0);
+  spectro_scroll = 0;
+  tft.scrollTo(spectro_scroll);
+  
+  wav_stft = new (std::nothrow) WAV_stft();
+  if (wav_stft == NULL)
+  {
+    drawNoMemory();
+    return;
+  }
+  wav_stft->setGate(&spectro_vad);
+  spectro_col_cnt = 0;
+  spectro_silent_cnt = 0;
+  spectro_stats_ms = millis();
+  wav_capture.subscribe(spectrogramBlock, NULL);
+}
+
+/*
+ * Capture subscriber for the spectrogram.  Draws each column as it is ready.
+ */
+void spectrogramBlock(const int16_t *samples, uint16_t count, void *context)
+{
+  for (uint16_t i = 0; i < count; i++)
+  {
+    if (wav_stft->pushSample(samples[i]))
+    {
+      drawSpectrogramColumn();
+    }
+  }
+}
+
+/*
+ * Draws the latest STFT column at the right edge of the screen.
+ * The screen is moved along one column with the hardware scroll, so only 
+ * this one column of pixels is sent to the display.
+ */
+void drawSpectrogramColumn()
+{
+  wav_stft->calcLevels(spectro_levels, SPECTRO_FIRST_BIN, SCREEN_HT);
+
+  // Low frequencies at the bottom
+  for (uint16_t i = 0; i < SCREEN_HT; i++)
+  {
+    spectro_column[SCREEN_HT - 1 - i] = spectro_lut[spectro_levels[i]];
+  }
+
+  // Step the scroll start back one line and draw the new column there, 
+  // so it is shown at the right edge and the older columns move left.
+  spectro_scroll = (spectro_scroll + SCREEN_WD - 1) % SCREEN_WD;
+  
+  tft.startWrite();
+  tft.setAddrWindow(SPECTRO_LINE_X(spectro_scroll), 0, 1, SCREEN_HT);
+  tft.writePixels(spectro_column, SCREEN_HT);
+  tft.endWrite();
+  tft.scrollTo(spectro_scroll);
+
+  spectro_col_cnt++;
+  if (wav_stft->getSilent()) spectro_silent_cnt++;
+}
+
+/*
+ * Reports the spectrogram column rate, and how many columns were silent and 
+ * skipped the FFT.  The columns are drawn by spectrogramBlock().
+ */
+void updateSpectrogram()
+{
+  if (wav_stft == NULL) return;
+
+  if (millis() - spectro_stats_ms >= SPECTRO_STATS_MS)
+  {
+    TLM_INFO("Spectro", "Columns/sec: %.1f, silent: %u%%", spectro_col_cnt * 1000.0 / (millis() - spectro_stats_ms), 
+             spectro_col_cnt > 0 ? spectro_silent_cnt * 100 / spectro_col_cnt : 0);
+    spectro_col_cnt = 0;
+    spectro_silent_cnt = 0;
+    spectro_stats_ms = millis();
+  }
+}
+
+/*
+ * Intial drawing and setup of the tuner.  The cents scale is drawn once, 
+ * the note and needle are redrawn by updateTuner().
+ */
+void beginTuner()
+{
+  tft.fillScreen(ILI9341_BLACK);
+  tft.setTextColor(ILI9341_WHITE);  
+  tft.setTextSize(2);
+  tft.setCursor(0, 4);
+  tft.println("Tuner");
+  tft.drawLine(0, TOP_LINE, 319, TOP_LINE, ILI9341_BLUE);   
+  drawSD(sd_present);
+  drawRecording(wav_recorder.getRecording());
+
+  for (int cents = -50; cents <= 50; cents += 10)
+  {
+    uint16_t color = (cents == 0 ? ILI9341_GREEN : ILI9341_DARKGREY);
+    tft.drawLine(TUNER_CENTS_X(cents), TUNER_BAR_Y + TUNER_BAR_HT + 2, TUNER_CENTS_X(cents), TUNER_BAR_Y + TUNER_BAR_HT + 8, color);
+  }
+  tft.drawLine(0, BOTTOM_LINE, 319, BOTTOM_LINE, ILI9341_BLUE);  
+
+  wav_pitch = new (std::nothrow) WAV_pitch();
+  if (wav_pitch == NULL)
+  {
+    drawNoMemory();
+    return;
+  }
+  wav_pitch->begin(wav_capture.getSampleRate());
+  tuner_new = false;
+  tuner_draw_ms = 0;
+  wav_capture.subscribe(pitchBlock, NULL);
+}
+
+/*
+ * Capture subscriber for the tuner.  Keeps the latest estimate for updateTuner().
+ */
+void pitchBlock(const int16_t *samples, uint16_t count, void *context)
+{
+  for (uint16_t i = 0; i < count; i++)
+  {
+    if (wav_pitch->pushSample(samples[i]))
+    {
+      wav_pitch->getPitch(&tuner_pitch);
+      tuner_new = true;
+    }
+  }
+}
+
+/*
+ * Draws the latest pitch estimate as a note name, frequency and cents needle.
+ */
+void updateTuner()
+{
+  if (wav_pitch == NULL) return;
+  if (!tuner_new || millis() - tuner_draw_ms < TUNER_DRAW_MS) return;
+  tuner_new = false;
+  tuner_draw_ms = millis();
+
+  float cents = 0;
+  tft.fillRect(0, TUNER_BAR_Y, SCREEN_WD, TUNER_BAR_HT, ILI9341_BLACK);
+  
+  if (tuner_pitch.freq <= 0)
+  {
+    tft.setTextSize(6);
+    tft.setCursor(100, 60);
+    tft.setTextColor(ILI9341_DARKGREY, ILI9341_BLACK);
+    tft.print("--   ");
+    tft.setTextSize(2);
+    tft.setCursor(0, 220);
+    tft.print("         ");
+    return;
+  }
+
+  tft.setTextSize(6);
+  tft.setCursor(100, 60);
+  tft.setTextColor(ILI9341_WHITE, ILI9341_BLACK);
+  printNote(tuner_pitch.freq, &cents);
+  tft.print("  ");
+
+  uint16_t color = ILI9341_RED;
+  if (fabsf(cents) < 15) color = ILI9341_YELLOW;
+  if (fabsf(cents) < 5) color = ILI9341_GREEN;
+  tft.fillRect(TUNER_CENTS_X(cents) - 3, TUNER_BAR_Y, 7, TUNER_BAR_HT, color);
+  
+  tft.setTextSize(2);
+  tft.setCursor(0, 220);
+  tft.setTextColor(color, ILI9341_BLACK);
+  tft.print(tuner_pitch.freq, 1);
+  tft.print(" Hz  ");
+}
+
+/*
+ * Sets the name of a keyword template file, e.g. /AUDIO/KWS/W1T2.KWS
+ */
+void setKeywordFilename(uint8_t word, uint8_t slot)
+{
+  kws_filename[12] = char(48 + word);
+  kws_filename[14] = char(48 + slot);
+}
+
+/*
+ * Loads the keyword templates from the SD card.  Missing slots are left empty.
+ */
+void loadKeywords()
+{
+  wav_kws->clear();
+  for (uint8_t word = 0; word < WAV_KWS_WORDS; word++)
+  {
+    kws_next_slot[word] = 0;
+    for (uint8_t slot = 0; slot < WAV_KWS_TEMPLATES; slot++)
+    {
+      setKeywordFilename(word, slot);
+      if (sd_present && SD.exists(kws_filename))
+      {
+        wav_file.loadKeyword(kws_filename, wav_kws->getTemplate(word, slot));
+      }
+    }
+    // Fill the empty slots first
+    while (kws_next_slot[word] < WAV_KWS_TEMPLATES - 1 && wav_kws->getTemplate(word, kws_next_slot[word])->frame_cnt > 0)
+    {
+      kws_next_slot[word]++;
+    }
+  }
+}
+
+/*
+ * Draws a keyword box with its number and how many templates it has.
+ * The box being recorded is highlighted.
+ */
+void drawKeywordBox(uint8_t word)
+{
+  uint16_t color = (word == kws_record_word ? ILI9341_WHITE : ILI9341_ORANGE);
+  uint16_t x = word * KWS_BOX_WD;
+  
+  tft.fillRect(x + 2, KWS_BOX_Y, KWS_BOX_WD - 4, KWS_BOX_HT, color);
+  tft.setTextColor(ILI9341_BLACK, color);
+  tft.setTextSize(3);
+  tft.setCursor(x + 30, KWS_BOX_Y + 4);
+  tft.print(word + 1);
+  tft.setTextSize(1);
+  tft.setCursor(x + 10, KWS_BOX_Y + 36);
+  tft.print(wav_kws->getTemplateCount(word));
+  tft.print(" of ");
+  tft.print(WAV_KWS_TEMPLATES);
+}
+
+/*
+ * Intial drawing and setup of the keyword spotter.  The result is redrawn by updateKeywords().
+ */
+void beginKeywords()
+{
+  tft.fillScreen(ILI9341_BLACK);
+  tft.setTextColor(ILI9341_WHITE);  
+  tft.setTextSize(2);
+  tft.setCursor(0, 4);
+  tft.println("Keywords");
+  tft.drawLine(0, TOP_LINE, 319, TOP_LINE, ILI9341_BLUE);   
+  drawSD(sd_present);
+  drawRecording(wav_recorder.getRecording());
+
+  wav_kws = new (std::nothrow) WAV_kws();
+  kws_mfcc = new (std::nothrow) WAV_mfcc();
+  if (wav_kws == NULL || kws_mfcc == NULL)
+  {
+    endKeywords();
+    drawNoMemory();
+    return;
   }
+  kws_mfcc->setGate(&kws_vad);
 
-  // Set up the initial test waveform
-  //wav_audio.fillWaveform(440, 0);  // 440Hz = A4
-
-  double two_pi_scaled = 2 * PI / 16;
-  int16_t sample;
-  for(int i = 0; i < WAV_MAX_SAMPLES; i++) 
+  loadKeywords();
+  kws_record_word = -1;
+  kws_saved_word = -1;
+  for (uint8_t word = 0; word < WAV_KWS_WORDS; word++)
   {
-    sample = (int16_t)(30000 * sin((double)i * two_pi_scaled));
-    wav_audio.setSample(i, 0, sample);
-    //if (i < 400) Serial.println(sample);
+    drawKeywordBox(word);
   }
-  
-  beginWavDisplay();
-  drawSD(sd_present);
-  
-  Serial.println(F("Setup complete."));
+  tft.drawLine(0, BOTTOM_LINE, 319, BOTTOM_LINE, ILI9341_BLUE);  
+
+  kws_in_utterance = false;
+  kws_new = false;
+  wav_capture.subscribe(keywordBlock, NULL);
 }
 
 /*
- * Initialize the SD file system before trying using a reader or writer
+ * Capture subscriber for the keyword spotter.  An utterance is the MFCC frames from 
+ * when the VAD gate opens until it closes.  It is matched against the templates 
+ * as it is spoken, or recorded as a template if a keyword box was touched.
  */
-bool initSD()
+void keywordBlock(const int16_t *samples, uint16_t count, void *context)
 {
-  // ESP32 requires 25 MHz SPI clock limit. Breakouts may require 10 MHz limit due to longer wires
-  // See SDFat/src/SdCard/SdInfo.h for list of error codes
-  bool sd_ok = false;  
-  digitalWrite(TFT_CS, HIGH); // disable TFT
-  digitalWrite(TCH_CS, HIGH); // disable Touchscreen - otherwise SD.begin() will fail!
+  for (uint16_t i = 0; i < count; i++)
+  {
+    if (!kws_mfcc->pushSample(samples[i])) continue;
 
-  Serial.print(F("Initializing filesystem..."));
-  if(SD.begin(SD_CS)) 
-  { 
-    root = SD.open("/");
-    if (root) 
+    if (!kws_mfcc->getSilent())
     {
-      sd_ok = true;
+      if (!kws_in_utterance) wav_kws->beginUtterance();
+      kws_in_utterance = true;
+      wav_kws->pushFrame(kws_mfcc->getCoefficients());
     }
-    else
+    else if (kws_in_utterance)
     {
-      tft.println(F("open root failed!"));
-      Serial.println(F("open root failed!"));
+      kws_in_utterance = false;
+      if (wav_kws->getFrameCount() < WAV_KWS_MIN_FRAMES) continue;  // A click or bump
+
+      if (kws_record_word >= 0)
+      {
+        uint8_t slot = kws_next_slot[kws_record_word];
+        if (wav_kws->copyUtterance(wav_kws->getTemplate(kws_record_word, slot)))
+        {
+          kws_saved_word = kws_record_word;
+          kws_saved_slot = slot;
+          kws_next_slot[kws_record_word] = (slot + 1) % WAV_KWS_TEMPLATES;
+          kws_record_word = -1;
+        }
+        continue;
+      }
+      kws_matched = wav_kws->endUtterance(&kws_result);
+      kws_new = true;
     }
   }
-  else
-  { 
-    tft.println(F("SD begin() failed!"));
-    Serial.println(F("SD begin() failed!")); 
-  }
- 
-  return sd_ok;
 }
 
-void setFilename(uint16_t index)
+/*
+ * Saves a newly recorded template and draws the latest result.
+ */
+void updateKeywords()
 {
-	wav_filename[14] = char(48 + (index % 1000) / 100);
-	wav_filename[15] = char(48 + (index % 100) / 10);
-	wav_filename[16] = char(48 + (index % 10));
-}
+  if (wav_kws == NULL) return;
 
-bool loadWavFile(uint16_t index)
-{
-	setFilename(index);
-	return wav_file.loadFile(wav_filename, &wav_audio);
-}
+  if (kws_saved_word >= 0)
+  {
+    uint8_t word = kws_saved_word;
+    kws_saved_word = -1;
+    
+    setKeywordFilename(word, kws_saved_slot);
+    if (sd_present) wav_file.saveKeyword(kws_filename, wav_kws->getTemplate(word, kws_saved_slot));
+    TLM_INFO("KWS", "Recorded word %u slot %u, %u frames", word + 1, kws_saved_slot, wav_kws->getTemplate(word, kws_saved_slot)->frame_cnt);
+    drawKeywordBox(word);
+  }
+  
+  if (!kws_new) return;
+  kws_new = false;
+  TLM_INFO("KWS", "Word %d score %f, %u frames, %u DTW cells", kws_result.word + 1, kws_result.score, kws_result.frames, kws_result.cells);
 
-bool saveWavFile(uint16_t index)
-{
-	setFilename(index);
-	return wav_file.saveFile(wav_filename, &wav_audio);
+  tft.setTextSize(6);
+  tft.setCursor(130, 60);
+  if (kws_matched)
+  {
+    tft.setTextColor(ILI9341_GREEN, ILI9341_BLACK);
+    tft.print(kws_result.word + 1);
+  }
+  else
+  {
+    tft.setTextColor(ILI9341_DARKGREY, ILI9341_BLACK);
+    tft.print("-");
+  }
+  
+  tft.setTextSize(2);
+  tft.setCursor(0, 220);
+  tft.setTextColor(ILI9341_WHITE, ILI9341_BLACK);
+  tft.print("Score ");
+  if (kws_result.word >= 0)
+    tft.print(kws_result.score, 2);
+  else
+    tft.print("--");
+  tft.print("    ");
 }
 
 /*
- * Initialize the I2S audio output
- */
-bool initAudioI2S()
-{
-	esp_err_t err;
-	
-	err = i2s_driver_install((i2s_port_t)i2s_port_num, &i2s_config, 0, NULL);
-	if (err != ESP_OK)
-	{
-		Serial.print("I2S driver install fail: ");
-		Serial.println(err);
-		return false;
-	}	
-	i2s_set_pin((i2s_port_t)i2s_port_num, &pin_config);
-	i2s_set_clk((i2s_port_t)i2s_port_num, 11025, I2S_BITS_PER_SAMPLE_16BIT, I2S_CHANNEL_MONO);
-	
-	return true;
-}
-
-/* 
- * Plays the audio sample.  
- * Does not return until sample is done playing.
+ * Arms recording of the touched keyword box.  Touching it again cancels.
  */
-void playAudio()
+void touchKeyword(int16_t tx)
 {
-  bool     audio_playing = false;
-  uint16_t sample_pos = 0;
-  int16_t  temp;
-  size_t   bytes_out;
-    
-  audio_playing = initAudioI2S();
+  int8_t word = (tx - KWS_TOUCH_X0) / KWS_TOUCH_BOX_WD;
+  int8_t prev_word = kws_record_word;
   
-  // Fill I2S transfer audio buffer from sample buffer
-  while (audio_playing)
-  {
-    for (int i = 0; i < SAMPLES_PER_BUFFER - 1; i++)
-    {
-      temp = wav_audio.getSample(sample_pos + i, 0);
-      audio_buffer[i * 2] = (uint8_t)temp & 0xff;
-      temp = temp >> 8;
-      audio_buffer[i * 2 + 1] = (uint8_t)temp;
-    }
-    
-    // Write data to I2S DMA buffer.  Blocking call, last parameter = ticks to wait or portMAX_DELAY for no timeout
-    i2s_write((i2s_port_t)i2s_port_num, (const char *)&audio_buffer, sizeof(audio_buffer), &bytes_out, 100);
-    if (bytes_out != sizeof(audio_buffer)) Serial.println("I2S write timeout");
+  if (wav_kws == NULL || tx < KWS_TOUCH_X0 || word >= WAV_KWS_WORDS) return;
 
-    sample_pos += SAMPLES_PER_BUFFER;
-    if (sample_pos >= WAV_MAX_SAMPLES - 1) audio_playing = false;
-  }
-  // Stop audio playback
-  i2s_driver_uninstall((i2s_port_t)i2s_port_num);
+  kws_record_word = (word == prev_word ? -1 : word);
+  if (prev_word >= 0) drawKeywordBox(prev_word);
+  drawKeywordBox(word);
 }
 
 /*
- * Use to toggle between normal and inverted text display
+ * Frees the keyword spotter when leaving its mode.
  */
-void setTextColor(uint16_t color, bool inverted)
+void endKeywords()
 {
-  if (inverted)
-    tft.setTextColor(ILI9341_BLACK, color);
-  else
-    tft.setTextColor(color, ILI9341_BLACK);
+  delete wav_kws;
+  delete kws_mfcc;
+  wav_kws = NULL;
+  kws_mfcc = NULL;
 }
 
 /*
- * Draws the SD card status icon indicating if the card is present or not.
+ * Intial drawing and setup of the tempo tracker.  Tracked beats are sent as MIDI clock.
  */
-void drawSD(bool present)
+void beginTempo()
 {
-  uint16_t color = (present ? ILI9341_WHITE : ILI9341_DARKGREY);
-  tft.drawRGBBitmap(294, 2, (uint16_t *)sd_icon, 18, 24);
-  if (!present)
-    tft.drawLine(294, 0, 314, 26, ILI9341_RED);  
+  tft.fillScreen(ILI9341_BLACK);
+  tft.setTextColor(ILI9341_WHITE);  
+  tft.setTextSize(2);
+  tft.setCursor(0, 4);
+  tft.println("Tempo");
+  tft.drawLine(0, TOP_LINE, 319, TOP_LINE, ILI9341_BLUE);   
+  drawSD(sd_present);
+  drawRecording(wav_recorder.getRecording());
+  tft.drawCircle(TEMPO_LIGHT_X, TEMPO_LIGHT_Y, TEMPO_LIGHT_R, ILI9341_DARKGREY);
+  tft.drawLine(0, BOTTOM_LINE, 319, BOTTOM_LINE, ILI9341_BLUE);  
 
-  tft.drawRect(284, 0, 35, 28, color); // button outline
+  wav_tempo = new (std::nothrow) WAV_tempo();
+  if (wav_tempo == NULL)
+  {
+    drawNoMemory();
+    return;
+  }
+  wav_tempo->begin(wav_capture.getSampleRate());
+  tempo_draw_ms = 0;
+  tempo_beat_ms = 0;
+  tempo_beat_new = false;
+  tempo_onset_cnt = 0;
+  wav_capture.subscribe(tempoBlock, NULL);
 }
 
 /*
- * Draw the WAV time domain amplitude waveform to the screen.
+ * Capture subscriber for the tempo tracker.  Beats are passed to the MIDI clock 
+ * as micros() times, counted back from the capture task's time stamp on the 
+ * block, so a late loop() does not move them.
  */
-void drawWaveform()
+void tempoBlock(const int16_t *samples, uint16_t count, void *context)
 {
-    double scale_ht = (double)WAVFORM_HT / (wav_audio.header.bits_per_sample == 8 ? 256.0 : 65536.0);
-    uint16_t skip = 1;
-    
-    tft.fillRect(0, TOP_LINE + 1, SCREEN_WD, WAVFORM_HT, ILI9341_BLACK);
+  wav_tempo_event_t event;
+  uint32_t block_us = wav_capture.getBlockTime();  // When samples[count - 1] was captured
+  
+  for (uint16_t i = 0; i < count; i++)
+  {
+    wav_tempo->pushSample(samples[i]);
+  }
+
+  while (wav_tempo->getEvent(&event))
+  {
+    int32_t ago = (int32_t)(wav_tempo->getSampleCount() - event.sample);  // Beats can be a little ahead
     
-    for (uint16_t i = 0; i < SCREEN_WD - 1; i ++)
+    switch (event.type)
     {
-      tft.drawLine(i, WAVFORM_CTR - wav_audio.getNormalizedSample(i * skip, 0) * scale_ht, i + 1, WAVFORM_CTR - wav_audio.getNormalizedSample((i + 1) * skip, 0) * scale_ht, ILI9341_GREEN); 
-
-      if (wav_audio.header.num_channels > 1)
-      {
-        tft.drawLine(i, WAVFORM_CTR - wav_audio.getNormalizedSample(i * 32, 1) * scale_ht, i + 1, WAVFORM_CTR - wav_audio.getNormalizedSample((i + 1) * 32, 1) * scale_ht, ILI9341_BLUE); 
-      }
+      case WAV_TEMPO_ONSET:
+        tempo_onset_cnt++;
+        break;
+      case WAV_TEMPO_BEAT:
+        midi_clock.beat(block_us - (int32_t)(ago * 1000000.0 / wav_capture.getSampleRate()), event.value);
+        tempo_beat_new = true;
+        break;
+      case WAV_TEMPO_LOCKED:
+        TLM_INFO("Tempo", "Locked at %.1f BPM", event.value);
+        break;
+      case WAV_TEMPO_LOST:
+        midi_clock.stop();
+        TLM_INFO("Tempo", "Lost at %.1f BPM, %u beats", event.value, wav_tempo->getBeatCount());
+        break;
     }
+  }
 }
 
 /*
- * Draw the DFT frequency domain amplitude waveform to the screen.
+ * Flashes the beat light and redraws the tempo and confidence.
  */
-void drawDFT()
+void updateTempo()
 {
-    double   scale_ht = (double)ANALYZE_HT / (wav_frame.findMaxPowerOutput() + 1);
-    double   deltaF   = wav_audio.header.sample_rate / WAV_FRAME_SIZE;
-    uint16_t max_idx  = 2;
-    
-    tft.fillRect(0, ANALYZE_Y - ANALYZE_HT, SCREEN_WD, ANALYZE_HT, ILI9341_BLACK);
+  if (wav_tempo == NULL) return;
 
-    // Skip first bin (DC offset)
-    for (uint16_t i = 2; i < WAV_FRAME_SIZE / 2; i ++)
-    {
-      //tft.drawLine(i, ANALYZE_Y - (int)wav_frame.dft_output[i].real() * scale_ht, i + 1, ANALYZE_Y - (int)wav_frame.dft_output[i + 1].real(), ILI9341_BLUE); 
-      tft.drawLine(i, ANALYZE_Y - (int)wav_frame.power_spectrum[i]  * scale_ht, i + 1, ANALYZE_Y - (int)wav_frame.power_spectrum[i + 1] * scale_ht, ILI9341_YELLOW); 
+  if (tempo_beat_new)
+  {
+    tempo_beat_new = false;
+    tempo_beat_ms = millis();
+    tft.fillCircle(TEMPO_LIGHT_X, TEMPO_LIGHT_Y, TEMPO_LIGHT_R - 2, ILI9341_GREEN);
+  }
+  else if (tempo_beat_ms > 0 && millis() - tempo_beat_ms >= TEMPO_FLASH_MS)
+  {
+    tempo_beat_ms = 0;
+    tft.fillCircle(TEMPO_LIGHT_X, TEMPO_LIGHT_Y, TEMPO_LIGHT_R - 2, ILI9341_BLACK);
+  }
 
-      Serial.println(wav_frame.power_spectrum[i]);
-      
-      if (wav_frame.power_spectrum[i] > wav_frame.power_spectrum[max_idx])
-        max_idx = i;
-    }
+  if (millis() - tempo_draw_ms < TEMPO_DRAW_MS) return;
+  tempo_draw_ms = millis();
 
-    tft.setTextSize(2);
-    tft.setCursor(0, 220);
-    tft.setTextColor(ILI9341_YELLOW, ILI9341_BLACK);
-    tft.print("Primary Freq: ");
-    tft.print((int)(max_idx * deltaF));
-    tft.print(" Hz  ");
+  tft.setTextSize(6);
+  tft.setCursor(70, 60);
+  if (wav_tempo->getLocked())
+  {
+    tft.setTextColor(ILI9341_WHITE, ILI9341_BLACK);
+    tft.print(wav_tempo->getBPM(), 1);
+    tft.print(" ");
+  }
+  else
+  {
+    tft.setTextColor(ILI9341_DARKGREY, ILI9341_BLACK);
+    tft.print("--    ");
+  }
+
+  float conf = wav_tempo->getConfidence();
+  uint16_t conf_wd = (uint16_t)(constrain(conf, 0.0, 1.0) * SCREEN_WD);
+  tft.fillRect(0, TEMPO_CONF_Y, conf_wd, 8, conf >= WAV_TEMPO_LOCK ? ILI9341_GREEN : ILI9341_DARKGREY);
+  tft.fillRect(conf_wd, TEMPO_CONF_Y, SCREEN_WD - conf_wd, 8, ILI9341_BLACK);
+
+  tft.setTextSize(2);
+  tft.setCursor(0, 220);
+  tft.setTextColor(ILI9341_WHITE, ILI9341_BLACK);
+  tft.print("Onsets ");
+  tft.print(tempo_onset_cnt);
+  tft.print(midi_clock.getRunning() ? "  MIDI clock " : "              ");
+}
+
+/*
+ * Reports a mode that could not allocate its engine.  The mode's screen stays up with nothing running.
+ */
+void drawNoMemory()
+{
+  Serial.println(F("Not enough memory for this mode!"));
+  tft.setTextSize(2);
+  tft.setCursor(0, 220);
+  tft.setTextColor(ILI9341_RED, ILI9341_BLACK);
+  tft.print("Not enough memory");
 }
 
 /*
@@ -372,14 +1528,14 @@ void beginWavDisplay()
   tft.setTextColor(ILI9341_WHITE);  
   tft.setTextSize(2);
 
-  tft.setCursor(0, 4);
-  tft.println("ESP32 Badge Pro Audio");
+  drawImpulse();
 
   tft.drawLine(0, TOP_LINE, 319, TOP_LINE, ILI9341_BLUE);   
   tft.drawLine(0, MID_LINE, 319, MID_LINE, ILI9341_BLUE);  
   tft.drawLine(0, BOTTOM_LINE, 319, BOTTOM_LINE, ILI9341_BLUE);  
   
   drawSD(sd_present);
+  drawRecording(wav_recorder.getRecording());
   drawWaveform();
 }
 
@@ -403,6 +1559,33 @@ void updateScreen()
 {
   if (prev_app_mode != app_mode)
   {
+    // Free the engine of the mode being left, so there is heap for the next one
+    if (prev_app_mode == MODE_WAV_SPECTROGRAM)
+    {
+      wav_capture.unsubscribe(spectrogramBlock, NULL);
+      tft.scrollTo(0);  // Put the screen back where the other modes expect it
+      delete wav_stft;
+      wav_stft = NULL;
+    }
+    if (prev_app_mode == MODE_WAV_TUNER)
+    {
+      wav_capture.unsubscribe(pitchBlock, NULL);
+      delete wav_pitch;
+      wav_pitch = NULL;
+    }
+    if (prev_app_mode == MODE_WAV_KEYWORD)
+    {
+      wav_capture.unsubscribe(keywordBlock, NULL);
+      endKeywords();
+    }
+    if (prev_app_mode == MODE_WAV_TEMPO)
+    {
+      wav_capture.unsubscribe(tempoBlock, NULL);
+      midi_clock.stop();
+      delete wav_tempo;
+      wav_tempo = NULL;
+    }
+    
     // Do initial screen drawing for new mode
     switch(app_mode)
     {
@@ -417,6 +1600,18 @@ void updateScreen()
 		break;
       case MODE_WAV_ANALYZE:
 		break;
+      case MODE_WAV_SPECTROGRAM:
+		beginSpectrogram();
+		break;
+      case MODE_WAV_TUNER:
+		beginTuner();
+		break;
+      case MODE_WAV_KEYWORD:
+		beginKeywords();
+		break;
+      case MODE_WAV_TEMPO:
+		beginTempo();
+		break;
       default:
 		break;
     }
@@ -434,6 +1629,18 @@ void updateScreen()
     break;
     case MODE_WAV_ANALYZE:
     break;
+    case MODE_WAV_SPECTROGRAM:
+    updateSpectrogram();
+    break;
+    case MODE_WAV_TUNER:
+    updateTuner();
+    break;
+    case MODE_WAV_KEYWORD:
+    updateKeywords();
+    break;
+    case MODE_WAV_TEMPO:
+    updateTempo();
+    break;
     default:
     break;
   }
@@ -504,6 +1711,7 @@ bool checkScreenTouch(bool debug)
 {
   // Check for screen touches
   static uint8_t prev_touched_cell = 0;
+  static bool    prev_touched = false;  // Zoom and pan once per touch
   uint8_t touched_cell = 0;  
   
   btnSD_released = false;
@@ -526,6 +1734,27 @@ bool checkScreenTouch(bool debug)
     // Check if the touch is within the bounds of the "touch" button
     btnSD_pressed = ((p.x > SD_TOUCH_X1) && (p.x < SD_TOUCH_X2) && (p.y > SD_TOUCH_Y1) && (p.y < SD_TOUCH_Y2)); 
 
+    if (app_mode == MODE_WAV_DISPLAY && !prev_touched && p.y > WAVE_TOUCH_Y1 && p.y < WAVE_TOUCH_Y2)
+    {
+      if (p.x < WAVE_TOUCH_LEFT)
+        panWave(-1);
+      else if (p.x > WAVE_TOUCH_RIGHT)
+        panWave(1);
+      else
+        zoomWave(p.y < WAVE_TOUCH_MID_Y);
+      drawWaveform();
+    }
+
+    if (app_mode == MODE_WAV_DISPLAY && !prev_touched && p.x < IR_TOUCH_X2 && p.y < IR_TOUCH_Y2)
+    {
+      nextImpulse();
+    }
+
+    if (app_mode == MODE_WAV_KEYWORD && !prev_touched && p.y > KWS_TOUCH_Y1)
+    {
+      touchKeyword(p.x);
+    }
+
     if (app_mode == MODE_WAV_SELECT_LOAD || app_mode == MODE_WAV_SELECT_SAVE)
     {
       touched_cell = checkCellTouch(p.x, p.y);
@@ -557,11 +1786,41 @@ bool checkScreenTouch(bool debug)
 	  app_mode = MODE_WAV_DISPLAY;
   }
   
+  prev_touched = is_touched;
   return is_touched;
 }
 
 /*
- * Reads from the microphone and displays the max amplitude
+ * Capture subscriber for the level meter.  Keeps the largest sample until checkMicrophone() reads it.
+ */
+void meterBlock(const int16_t *samples, uint16_t count, void *context)
+{
+  for (uint16_t i = 0; i < count; i++)
+  {
+    uint16_t amp = abs(samples[i]);
+    if (amp > mic_peak) mic_peak = amp;
+  }
+}
+
+/*
+ * Capture subscriber for the recorder.  Fills the WAV buffer, then unsubscribes.
+ */
+void recordBlock(const int16_t *samples, uint16_t count, void *context)
+{
+  for (uint16_t i = 0; i < count && record_pos < WAV_MAX_SAMPLES; i++)
+  {
+    wav_audio.setSample(record_pos++, WAV_CHNL_LEFT, samples[i]);
+  }
+
+  if (record_pos >= WAV_MAX_SAMPLES)
+  {
+    wav_capture.unsubscribe(recordBlock, NULL);
+    record_done = true;
+  }
+}
+
+/*
+ * Reads the level from the microphone and displays the max amplitude
  * both as a bar graph and numeric value
  */
 void checkMicrophone()
@@ -572,7 +1831,8 @@ void checkMicrophone()
   uint16_t mic_color = ILI9341_GREEN;
   double percent;
   
-  mic_sample[mic_idx] = abs(analogRead(MIC) - 1800);  // 12-bit (0 - 4095)
+  mic_sample[mic_idx] = mic_peak;  // 12-bit ADC, centered on MIC_OFFSET
+  mic_peak = 0;
   percent = (double)mic_sample[mic_idx] / 2048; 
   
   if (mic_sample[mic_idx] > max_amp)
@@ -633,21 +1893,23 @@ void loop(void)
   
   if (btn_released[BTN_B])  // RECORD
   {
-    delay(100);
+    // Samples are filled in by recordBlock() as they are captured
+    wav_from_file = false;
+    record_pos = 0;
+    record_done = false;
+    wav_capture.subscribe(recordBlock, NULL);
+  }
+
+  if (record_done)
+  {
+    record_done = false;
     wav_audio.setSample(0, 0, wav_audio.silence()); 
-    for (uint16_t i = 1; i < WAV_MAX_SAMPLES; i++)
-    {
-      int16_t sample = analogRead(MIC) - MIC_OFFSET;
-      wav_audio.setSample(i, WAV_CHNL_LEFT, sample);
-      delayMicroseconds(80); // delay to approximate 11025 sample rate
-    }
     wav_audio.setSample(WAV_MAX_SAMPLES - 1, WAV_CHNL_LEFT, wav_audio.silence());  
-    wav_audio.header.data_bytes = WAV_MAX_SAMPLES;
-    wav_audio.header.wav_size = WAV_MAX_SAMPLES + sizeof(wav_audio.header) - 8;
+    wav_audio.header.data_bytes = WAV_MAX_SAMPLES * 2;
+    wav_audio.header.wav_size = wav_audio.header.data_bytes + sizeof(wav_audio.header) - 8;
     
+    buildPeaks();
     drawWaveform();
-
-    delay(200);
   }
 
   if (btn_released[BTN_LEFT]) // ANALYZE
@@ -663,14 +1925,59 @@ void loop(void)
     
   }
   
-  if (btn_released[BTN_RIGHT])  // Play WAV
+  if (btn_released[BTN_RIGHT] && !file_playing)  // Play WAV
+  {
+    if (!wav_from_file || !startFilePlayback())
+    {
+      playAudio();
+    }
+  }
+
+  if (btn_released[BTN_Y])  // Save MFCC features of the temp wav
+  {
+    saveMfccFile(0);
+  }
+
+  if (btn_released[BTN_UP])  // Stream recording to SD on/off
+  {
+    if (wav_recorder.getRecording())
+      stopStreamRecording();
+    else if (sd_present)
+      startStreamRecording();
+  }
+
+  if (btn_released[BTN_DOWN])  // Live views:  spectrogram, tuner, keywords, tempo, then back to the waveform
   {
-    playAudio();
+    if (app_mode == MODE_WAV_SPECTROGRAM)
+      app_mode = MODE_WAV_TUNER;
+    else if (app_mode == MODE_WAV_TUNER)
+      app_mode = MODE_WAV_KEYWORD;
+    else if (app_mode == MODE_WAV_KEYWORD)
+      app_mode = MODE_WAV_TEMPO;
+    else if (app_mode == MODE_WAV_TEMPO)
+      app_mode = MODE_WAV_DISPLAY;
+    else
+      app_mode = MODE_WAV_SPECTROGRAM;
   }
   
   checkButtonPresses();
-  checkScreenTouch(true);
-  checkMicrophone();
+  wav_capture.poll();
+  if (!wav_recorder.update())
+  {
+    stopStreamRecording();  // Card full or write error
+  }
+  wav_features.update();    // Closes the feature file itself on a write error
+  updateFilePlayback();
+  if (app_mode == MODE_WAV_SPECTROGRAM)
+  {
+    // Anything else drawn would be scrolled along with the waterfall
+    checkScreenTouch(false);
+  }
+  else
+  {
+    checkScreenTouch(true);
+    checkMicrophone();
+  }
 
   if (btnSD_released)
   {
@@ -0,0 +1,337 @@
+/*
+ * Host batch analyzer.  Runs the badge analysis pipeline over every WAV file in 
+ * a directory tree, using the sketch's own WAV_audio, WAV_frame and WAV_mfcc code:
+ *   load    - decode to mono and convert to 11025 Hz, keep the first WAV_MAX_SAMPLES (WAV_file::loadFile)
+ *   dft     - Hann windowed FFT of the first frame (Analyze screen)
+ *   power   - power spectrum of that frame
+ *   mfcc    - MFCC frames of the buffer (Y button)
+ * Files are spread over a pool of threads.  Each thread works through its own 
+ * queue and steals from the others when it runs dry, so a few long files do not 
+ * leave threads idle.  Results are written in file order, so runs can be diffed:
+ *   <prefix>.dft.csv   file,power bin 0 .. WAV_FFT_BINS-1
+ *   <prefix>.mfcc.csv  file,frame,c0 .. c11
+ * Reports files per second and the CPU time of each stage, so it is also the 
+ * profiling harness for the analysis code.
+ * With -v the MFCC stage is gated by WAV_vad as on the badge.  Silent frames get 
+ * the fixed silence coefficients, and the share of frames skipped is reported.
+ *
+ * Build and run from the sketch folder:
+ *   g++ -std=c++17 -O2 -pthread -Itools/host -o batch_analyze tools/batch_analyze.cpp tools/wav_load_file.cpp \
+ *       WAV_audio.cpp WAV_frame.cpp WAV_fft.cpp WAV_fft_q15.cpp WAV_mfcc.cpp WAV_spectrum.cpp WAV_resample.cpp WAV_vad.cpp
+ *   ./batch_analyze WAV_DIR [prefix] [-j threads] [-v]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <strings.h>
+#include <thread>
+#include <vector>
+#include "../WAV_audio.h"
+#include "../WAV_frame.h"
+#include "../WAV_mfcc.h"
+#include "../WAV_resample.h"
+#include "../WAV_vad.h"
+#include "wav_load_file.h"
+
+enum stage_type
+{
+  STAGE_LOAD,
+  STAGE_DFT,
+  STAGE_POWER,
+  STAGE_MFCC,
+  STAGE_CNT
+};
+
+const char *STAGE_NAMES[STAGE_CNT] = { "load", "dft", "power", "mfcc" };
+
+typedef struct
+{
+  bool     loaded;
+  uint32_t sample_rate;  // Of the file
+  uint32_t samples;      // At 11025 Hz, up to WAV_MAX_SAMPLES
+  float    power[WAV_FFT_BINS];
+  std::vector<float> mfcc;  // WAV_MFCC_COEF_CNT per frame
+} file_result_t;
+
+/*
+ * Analysis state for one thread.  Large, so each worker has its own on the heap.
+ */
+typedef struct
+{
+  WAV_audio     audio;
+  WAV_frame     frame;
+  WAV_mfcc      mfcc;
+  WAV_resampler resampler;
+  WAV_vad       vad;
+  std::vector<int16_t> samples;
+  std::vector<float>   in, out;
+  double        stage_sec[STAGE_CNT];
+  uint32_t      files;
+  uint32_t      steals;
+  uint32_t      frames;
+  uint32_t      silent_frames;
+} worker_t;
+
+/*
+ * Per-thread queues of file indexes.  The owner takes from the back and thieves 
+ * take from the front, so they only meet on the last item.
+ */
+class WorkPool
+{
+  public:
+    WorkPool(uint32_t workers, uint32_t jobs) : _queues(workers), _locks(workers)
+    {
+      for (uint32_t i = 0; i < jobs; i++)
+      {
+        _queues[i % workers].push_back(i);
+      }
+    }
+
+    bool next(uint32_t worker, uint32_t *job, uint32_t *steals)
+    {
+      {
+        std::lock_guard<std::mutex> lock(_locks[worker]);
+        if (!_queues[worker].empty())
+        {
+          *job = _queues[worker].back();
+          _queues[worker].pop_back();
+          return true;
+        }
+      }
+      
+      for (uint32_t i = 1; i < _queues.size(); i++)
+      {
+        uint32_t victim = (worker + i) % _queues.size();
+        std::lock_guard<std::mutex> lock(_locks[victim]);
+        if (!_queues[victim].empty())
+        {
+          *job = _queues[victim].front();
+          _queues[victim].pop_front();
+          (*steals)++;
+          return true;
+        }
+      }
+      return false;
+    }
+
+  private:
+    std::vector<std::deque<uint32_t>> _queues;
+    std::vector<std::mutex>           _locks;
+};
+
+static double secondsSince(std::chrono::steady_clock::time_point *start)
+{
+  auto now = std::chrono::steady_clock::now();
+  double sec = std::chrono::duration<double>(now - *start).count();
+  *start = now;
+  return sec;
+}
+
+/*
+ * Loads a file into the worker's WAV_audio the way WAV_file::loadFile() does.
+ */
+static bool loadAudio(worker_t *w, const char *filename, file_result_t *result)
+{
+  if (!wavLoadFile(filename, &w->samples, &result->sample_rate)) return false;
+
+  uint32_t count = w->samples.size();
+  if (result->sample_rate != WAV_SAMPLE_RATE)
+  {
+    if (!w->resampler.begin(result->sample_rate, WAV_SAMPLE_RATE)) return false;
+
+    // Only as much as fits in the buffer, then silence to flush the filter
+    uint32_t out_cnt = (uint32_t)(((uint64_t)count * WAV_SAMPLE_RATE) / result->sample_rate);
+    if (out_cnt > WAV_MAX_SAMPLES) out_cnt = WAV_MAX_SAMPLES;
+    
+    uint32_t in_cnt = (uint32_t)(((uint64_t)out_cnt * result->sample_rate) / WAV_SAMPLE_RATE) + 1;
+    if (in_cnt > count) in_cnt = count;
+    w->in.assign(w->samples.begin(), w->samples.begin() + in_cnt);
+    w->in.resize(in_cnt + w->resampler.getDelay(), 0);
+    w->out.resize(out_cnt);
+    
+    uint32_t used;
+    count = w->resampler.process(w->in.data(), w->in.size(), w->out.data(), out_cnt, &used);
+    for (uint32_t i = 0; i < count; i++)
+    {
+      float value = w->out[i];
+      w->samples[i] = (int16_t)(value > 32767 ? 32767 : (value < -32768 ? -32768 : lroundf(value)));
+    }
+  }
+  if (count > WAV_MAX_SAMPLES) count = WAV_MAX_SAMPLES;
+
+  w->audio.header = wav_header_t();
+  for (uint32_t i = 0; i < WAV_MAX_SAMPLES; i++)
+  {
+    w->audio.setSample(i, WAV_CHNL_LEFT, i < count ? w->samples[i] : WAV_SILENCE);
+  }
+  w->audio.header.data_bytes = count * 2;
+  result->samples = count;
+  return true;
+}
+
+static void analyzeFile(worker_t *w, const char *filename, file_result_t *result)
+{
+  auto start = std::chrono::steady_clock::now();
+  
+  result->loaded = loadAudio(w, filename, result);
+  w->stage_sec[STAGE_LOAD] += secondsSince(&start);
+  if (!result->loaded) return;
+
+  w->frame.calcDFT(&w->audio);
+  w->stage_sec[STAGE_DFT] += secondsSince(&start);
+
+  w->frame.calcPower(result->power);
+  w->stage_sec[STAGE_POWER] += secondsSince(&start);
+
+  // Same as saveMfccFile() on the badge
+  w->mfcc.reset();
+  result->mfcc.clear();
+  for (uint32_t i = 0; i < result->samples; i++)
+  {
+    if (w->mfcc.pushSample(w->audio.getSample(i, WAV_CHNL_LEFT)))
+    {
+      const float *coef = w->mfcc.getCoefficients();
+      result->mfcc.insert(result->mfcc.end(), coef, coef + WAV_MFCC_COEF_CNT);
+      if (result->mfcc.size() >= WAV_FRAMES_PER_SEC * WAV_MFCC_COEF_CNT) break;
+    }
+  }
+  w->frames += result->mfcc.size() / WAV_MFCC_COEF_CNT;
+  w->silent_frames += w->mfcc.getSilentCount();
+  w->stage_sec[STAGE_MFCC] += secondsSince(&start);
+  w->files++;
+}
+
+static bool writeResults(const std::string &prefix, const std::vector<std::string> &files, const std::vector<file_result_t> &results)
+{
+  FILE *dft = fopen((prefix + ".dft.csv").c_str(), "w");
+  FILE *mfcc = fopen((prefix + ".mfcc.csv").c_str(), "w");
+  if (dft == NULL || mfcc == NULL)
+  {
+    fprintf(stderr, "Unable to create %s.dft.csv / .mfcc.csv\n", prefix.c_str());
+    if (dft) fclose(dft);
+    if (mfcc) fclose(mfcc);
+    return false;
+  }
+
+  fprintf(dft, "# file,power bins 0-%d, %.3f Hz per bin\n", WAV_FFT_BINS - 1, (double)WAV_SAMPLE_RATE / WAV_FFT_SIZE);
+  fprintf(mfcc, "# file,frame,c0-c%d, size=%d stride=%d\n", WAV_MFCC_COEF_CNT - 1, WAV_MFCC_FRAME_SIZE, WAV_MFCC_STRIDE);
+  
+  for (uint32_t i = 0; i < files.size(); i++)
+  {
+    if (!results[i].loaded) continue;
+
+    fprintf(dft, "%s", files[i].c_str());
+    for (uint16_t k = 0; k < WAV_FFT_BINS; k++)
+    {
+      fprintf(dft, ",%.6g", results[i].power[k]);
+    }
+    fprintf(dft, "\n");
+
+    for (uint32_t f = 0; f < results[i].mfcc.size() / WAV_MFCC_COEF_CNT; f++)
+    {
+      fprintf(mfcc, "%s,%u", files[i].c_str(), f);
+      for (uint8_t c = 0; c < WAV_MFCC_COEF_CNT; c++)
+      {
+        fprintf(mfcc, ",%.4f", results[i].mfcc[f * WAV_MFCC_COEF_CNT + c]);
+      }
+      fprintf(mfcc, "\n");
+    }
+  }
+  
+  fclose(dft);
+  fclose(mfcc);
+  return true;
+}
+
+int main(int argc, char *argv[])
+{
+  std::string dir, prefix = "features";
+  uint32_t thread_cnt = std::thread::hardware_concurrency();
+  bool have_prefix = false;
+  bool gate = false;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) thread_cnt = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-v") == 0) gate = true;
+    else if (dir.empty()) dir = argv[i];
+    else if (!have_prefix) { prefix = argv[i]; have_prefix = true; }
+  }
+  if (dir.empty())
+  {
+    fprintf(stderr, "Usage: %s WAV_DIR [prefix] [-j threads] [-v]\n", argv[0]);
+    return 1;
+  }
+  if (thread_cnt < 1) thread_cnt = 1;
+
+  std::vector<std::string> files;
+  std::error_code err;
+  for (auto it = std::filesystem::recursive_directory_iterator(dir, err); !err && it != std::filesystem::recursive_directory_iterator(); it.increment(err))
+  {
+    std::string ext = it->path().extension().string();
+    if (it->is_regular_file() && strcasecmp(ext.c_str(), ".wav") == 0) files.push_back(it->path().string());
+  }
+  if (err || files.empty())
+  {
+    fprintf(stderr, "No WAV files found in %s\n", dir.c_str());
+    return 1;
+  }
+  std::sort(files.begin(), files.end());
+
+  std::vector<file_result_t> results(files.size());
+  std::vector<worker_t *>    workers(thread_cnt);
+  std::vector<std::thread>   threads;
+  WorkPool pool(thread_cnt, files.size());
+
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t t = 0; t < thread_cnt; t++)
+  {
+    workers[t] = new worker_t();
+    if (gate) workers[t]->mfcc.setGate(&workers[t]->vad);
+    threads.emplace_back([&, t]()
+    {
+      uint32_t job;
+      while (pool.next(t, &job, &workers[t]->steals))
+      {
+        analyzeFile(workers[t], files[job].c_str(), &results[job]);
+      }
+    });
+  }
+  for (auto &thread : threads) thread.join();
+  double elapsed = secondsSince(&start);
+
+  if (!writeResults(prefix, files, results)) return 1;
+
+  // Stage times are CPU seconds summed over the threads
+  double stage_sec[STAGE_CNT] = { 0 }, total_sec = 0;
+  uint32_t done = 0, steals = 0, frames = 0, silent_frames = 0;
+  for (uint32_t t = 0; t < thread_cnt; t++)
+  {
+    for (int s = 0; s < STAGE_CNT; s++) stage_sec[s] += workers[t]->stage_sec[s];
+    done += workers[t]->files;
+    steals += workers[t]->steals;
+    frames += workers[t]->frames;
+    silent_frames += workers[t]->silent_frames;
+    delete workers[t];
+  }
+  for (int s = 0; s < STAGE_CNT; s++) total_sec += stage_sec[s];
+
+  fprintf(stderr, "%u of %zu files in %.3f sec with %u threads: %.1f files/sec, %u steals\n", 
+          done, files.size(), elapsed, thread_cnt, done / elapsed, steals);
+  fprintf(stderr, "%-6s %10s %10s %6s\n", "stage", "cpu sec", "us/file", "%");
+  for (int s = 0; s < STAGE_CNT; s++)
+  {
+    fprintf(stderr, "%-6s %10.3f %10.1f %6.1f\n", STAGE_NAMES[s], stage_sec[s], 
+            done ? stage_sec[s] * 1e6 / done : 0, total_sec > 0 ? 100 * stage_sec[s] / total_sec : 0);
+  }
+  if (gate) fprintf(stderr, "%u of %u MFCC frames silent (%.1f%%)\n", silent_frames, frames, frames ? 100.0 * silent_frames / frames : 0);
+  if (done < files.size()) fprintf(stderr, "%zu files could not be read\n", files.size() - done);
+  return 0;
+}
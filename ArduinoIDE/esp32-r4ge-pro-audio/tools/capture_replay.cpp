@@ -0,0 +1,90 @@
+/*
+ * Replays a WAV file through WAV_capture at real-time pace, as the badge microphone would 
+ * deliver it, and runs the level meter and spectrogram subscribers on the blocks.
+ * Polls on a slow loop like the badge loop() does, then reports the delivered sample rate, 
+ * spectrogram columns and overruns.
+ *
+ * Build and run from the sketch folder:
+ *   g++ -O2 -pthread -o capture_replay tools/capture_replay.cpp tools/wav_capture_file.cpp WAV_capture.cpp WAV_stft.cpp WAV_spectrum.cpp WAV_fft.cpp WAV_fft_q15.cpp WAV_vad.cpp
+ *   ./capture_replay MIC000.WAV [poll_ms]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <thread>
+#include "wav_capture_file.h"
+#include "../WAV_stft.h"
+
+static WAV_capture wav_capture;
+static WAV_stft    wav_stft;
+static uint16_t    peak = 0;
+static uint32_t    columns = 0;
+
+static void meterBlock(const int16_t *samples, uint16_t count, void *context)
+{
+  for (uint16_t i = 0; i < count; i++)
+  {
+    uint16_t amp = abs(samples[i]);
+    if (amp > peak) peak = amp;
+  }
+}
+
+static void spectrogramBlock(const int16_t *samples, uint16_t count, void *context)
+{
+  uint8_t levels[240];
+  
+  for (uint16_t i = 0; i < count; i++)
+  {
+    if (wav_stft.pushSample(samples[i]))
+    {
+      wav_stft.calcLevels(levels, 1, 240);
+      columns++;
+    }
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  WAV_capture_file source;
+  uint32_t poll_ms = (argc > 2 ? atoi(argv[2]) : 31);  // Button scan and delay(10) in loop()
+
+  if (argc < 2)
+  {
+    fprintf(stderr, "Usage: %s input.wav [poll_ms]\n", argv[0]);
+    return 1;
+  }
+  if (!source.open(argv[1]))
+  {
+    fprintf(stderr, "Unable to read PCM WAV file: %s\n", argv[1]);
+    return 1;
+  }
+
+  wav_capture.subscribe(meterBlock, NULL);
+  wav_capture.subscribe(spectrogramBlock, NULL);
+
+  auto start = std::chrono::steady_clock::now();
+  source.begin(&wav_capture, false);
+
+  uint32_t next_report = source.getSampleRate();
+  while (source.getRunning())
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(poll_ms));
+    wav_capture.poll();
+
+    if (wav_capture.getSampleCount() >= next_report)
+    {
+      printf("%6.2f sec  peak %5u  columns %u\n", (double)wav_capture.getSampleCount() / source.getSampleRate(), peak, columns);
+      peak = 0;
+      next_report += source.getSampleRate();
+    }
+  }
+  source.end();
+  wav_capture.poll();
+  
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  printf("%u samples in %.3f sec = %.1f samples/sec (file %u Hz)\n", wav_capture.getSampleCount(), elapsed, 
+         wav_capture.getSampleCount() / elapsed, source.getSampleRate());
+  printf("%u spectrogram columns = %.1f columns/sec, %u overruns\n", columns, columns / elapsed, wav_capture.getOverruns());
+  return 0;
+}
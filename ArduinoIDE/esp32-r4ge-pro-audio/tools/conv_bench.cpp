@@ -0,0 +1,166 @@
+/*
+ * Host test and benchmark of WAV_conv, the partitioned convolution for IRs.
+ * Checks the output against direct convolution in double precision (one block
+ * later), with the IR length not a whole number of partitions, and that a dry
+ * mix is the input delayed by one block.
+ * Then times WAV_conv against direct convolution for IRs of 256 to 4096 taps, as
+ * the processing time per second of 11025 Hz audio.  Direct convolution grows
+ * with the taps, the partitioned cost per block is two FFTs plus a multiply-add
+ * per bin per partition.  Files play with the IR at their own rate, so the share
+ * of real time is also given for 48000 Hz, where each block plays for less time.
+ * Returns non-zero if the output does not match.
+ *
+ * Build and run from the sketch folder:
+ *   g++ -O2 -o conv_bench tools/conv_bench.cpp WAV_conv.cpp WAV_fft.cpp && ./conv_bench
+ */
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "../WAV_conv.h"
+
+#define SAMPLE_RATE   11025
+#define TEST_TAPS      3000  // Not a multiple of WAV_CONV_BLOCK, so the last partition is partial
+#define TEST_SAMPLES  20000
+#define MAX_ERROR         1  // Output is rounded to int16
+#define BENCH_SECONDS     5
+#define HIGH_RATE     48000  // Highest file rate played through the IR
+
+/*
+ * Decaying noise, like a room's impulse response.
+ */
+static std::vector<float> makeIR(uint32_t taps, float peak)
+{
+  std::vector<float> ir(taps);
+  for (uint32_t i = 0; i < taps; i++)
+  {
+    ir[i] = peak * expf(-4.0f * i / taps) * (rand() / (float)RAND_MAX - 0.5f);
+  }
+  return ir;
+}
+
+static std::vector<int16_t> makeInput(uint32_t count, int16_t amp)
+{
+  std::vector<int16_t> input(count);
+  for (uint32_t i = 0; i < count; i++)
+  {
+    input[i] = (int16_t)(rand() % (2 * amp + 1) - amp);
+  }
+  return input;
+}
+
+static bool loadIR(WAV_conv *conv, const std::vector<float> &ir)
+{
+  if (!conv->beginIR(ir.size())) return false;
+
+  // In uneven pieces, as if read from the card
+  for (uint32_t pos = 0; pos < ir.size(); )
+  {
+    uint16_t count = (ir.size() - pos < 100 ? ir.size() - pos : 100);
+    if (!conv->addTaps(&ir[pos], count)) return false;
+    pos += count;
+  }
+  conv->endIR(false);
+  return true;
+}
+
+int main()
+{
+  WAV_conv *conv = new WAV_conv();
+  bool passed = true;
+
+  srand(3);
+  std::vector<float> ir = makeIR(TEST_TAPS, 0.1f);
+  std::vector<int16_t> input = makeInput(TEST_SAMPLES, 2000);
+  std::vector<int16_t> output = input;
+
+  if (!loadIR(conv, ir))
+  {
+    printf("Unable to load the IR\nFAILED\n");
+    return 1;
+  }
+  printf("%u taps in %u partitions of %u\n", conv->getTapCount(), conv->getPartCount(), WAV_CONV_BLOCK);
+
+  // Odd sized calls, the output does not depend on how the samples are passed
+  for (uint32_t pos = 0; pos < output.size(); )
+  {
+    uint16_t count = (output.size() - pos < 77 ? output.size() - pos : 77);
+    conv->process(&output[pos], count);
+    pos += count;
+  }
+
+  double max_error = 0, peak = 0;
+  for (uint32_t n = WAV_CONV_BLOCK; n < output.size(); n++)
+  {
+    double expected = 0;
+    uint32_t in_n = n - WAV_CONV_BLOCK;
+    for (uint32_t k = 0; k < ir.size() && k <= in_n; k++)
+    {
+      expected += (double)ir[k] * input[in_n - k];
+    }
+    max_error = fmax(max_error, fabs(output[n] - expected));
+    peak = fmax(peak, fabs(expected));
+  }
+  printf("Against direct convolution:  max error %.3f (output peak %.0f)  %s\n", max_error, peak,
+         max_error <= MAX_ERROR ? "ok" : "FAILED");
+  passed &= (max_error <= MAX_ERROR);
+
+  // Dry only is the input one block later
+  conv->reset();
+  conv->setMix(0);
+  output = input;
+  conv->process(&output[0], output.size());
+  bool dry_ok = true;
+  for (uint32_t n = WAV_CONV_BLOCK; n < output.size(); n++)
+  {
+    dry_ok &= (output[n] == input[n - WAV_CONV_BLOCK]);
+  }
+  printf("Dry mix is the delayed input:  %s\n", dry_ok ? "ok" : "FAILED");
+  passed &= dry_ok;
+  conv->setMix(1);
+
+  // Processing time per second of audio
+  printf("\n%6s %6s %16s %16s %10s %12s\n", "taps", "parts", "direct ms/sec", "WAV_conv ms/sec", "speedup", "48 kHz load");
+  std::vector<int16_t> bench_in = makeInput(SAMPLE_RATE * BENCH_SECONDS, 2000);
+  for (uint32_t taps = 256; taps <= WAV_CONV_MAX_TAPS; taps *= 2)
+  {
+    std::vector<float> bench_ir = makeIR(taps, 0.05f);
+    std::vector<float> history(taps, 0);
+    std::vector<int16_t> samples = bench_in;
+    volatile float sink = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    uint32_t pos = 0;
+    for (uint32_t n = 0; n < samples.size(); n++)
+    {
+      history[pos] = samples[n];
+      float sum = 0;
+      uint32_t idx = pos;
+      for (uint32_t k = 0; k < taps; k++)
+      {
+        sum += bench_ir[k] * history[idx];
+        idx = (idx == 0 ? taps - 1 : idx - 1);
+      }
+      sink = sink + sum;
+      pos = (pos + 1 == taps ? 0 : pos + 1);
+    }
+    double direct_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    loadIR(conv, bench_ir);
+    start = std::chrono::steady_clock::now();
+    for (uint32_t n = 0; n < samples.size(); n += 256)
+    {
+      conv->process(&samples[n], samples.size() - n < 256 ? samples.size() - n : 256);
+    }
+    double conv_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%6u %6u %16.2f %16.2f %9.1fx %11.2f%%\n", taps, conv->getPartCount(), direct_sec * 1000 / BENCH_SECONDS,
+           conv_sec * 1000 / BENCH_SECONDS, direct_sec / conv_sec, conv_sec * 100 / BENCH_SECONDS * HIGH_RATE / SAMPLE_RATE);
+  }
+
+  delete conv;
+  printf(passed ? "PASSED\n" : "FAILED\n");
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,266 @@
+/*
+ * Host reader for the binary feature files the badge writes (MIC000.FEA with the
+ * Y button, RECnnn.FEA alongside a streamed recording).  The file is memory mapped
+ * with wav_feature_map, so there is no parsing.
+ * Prints the header, and writes the frames as CSV.  MFCC files use the same CSV
+ * format as WAV_file::saveMFCC() and mfcc_cli, so they can be diffed.
+ * With -t it runs a self test instead:  MFCC frames are streamed through the badge's
+ * own WAV_features writer (as float32 and int16), mapped back and compared,
+ * including a file that was never closed and one written while the card was
+ * too slow.  The read is also timed against parsing the same frames as CSV.
+ * Returns non-zero if a check fails.
+ *
+ * Build and run from the sketch folder:
+ *   g++ -std=c++17 -O2 -Itools/host -o feature_dump tools/feature_dump.cpp tools/wav_feature_map.cpp \
+ *       WAV_features.cpp WAV_mfcc.cpp WAV_fft.cpp WAV_fft_q15.cpp WAV_vad.cpp
+ *   ./feature_dump MIC000.FEA [MIC000.csv]
+ *   ./feature_dump -t
+ */
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "../WAV_features.h"
+#include "../WAV_mfcc.h"
+#include "wav_feature_map.h"
+
+#define TEST_SECONDS      60    // Audio run through the MFCC for the self test
+#define TEST_INT16_SCALE  0.01  // Step of the int16 test file
+#define TEST_UPDATE_EVERY 4     // Frames between update() calls, about one loop() at 10 msec
+
+static const char *KIND_NAMES[] = { "MFCC", "power", "DFT" };
+
+static uint32_t failures = 0;
+
+static void check(bool passed, const char *what)
+{
+  printf("%-52s %s\n", what, passed ? "ok" : "FAILED");
+  if (!passed) failures++;
+}
+
+/*
+ * Writes the frames as CSV.  MFCC uses the WAV_file::saveMFCC() header line.
+ */
+static void writeCSV(const wav_feature_map_t *map, FILE *out)
+{
+  const wav_feature_header_t *hdr = map->header;
+
+  if (hdr->kind == WAV_FEAT_KIND_MFCC)
+    fprintf(out, "# frames=%u size=%u stride=%u cepstra=%u\n", map->frame_cnt, hdr->frame_size, hdr->frame_stride, hdr->coef_cnt);
+  else
+    fprintf(out, "# kind=%s frames=%u size=%u stride=%u coefs=%u\n", hdr->kind <= WAV_FEAT_KIND_DFT ? KIND_NAMES[hdr->kind] : "?",
+            map->frame_cnt, hdr->frame_size, hdr->frame_stride, hdr->coef_cnt);
+
+  for (uint32_t frame = 0; frame < map->frame_cnt; frame++)
+  {
+    for (uint16_t c = 0; c < hdr->coef_cnt; c++)
+    {
+      fprintf(out, c > 0 ? ",%.4f" : "%.4f", wavFeatureValue(map, frame, c));
+    }
+    fprintf(out, "\n");
+  }
+}
+
+/*
+ * Streams the frames through WAV_features, calling update() every few frames like loop().
+ * With update_every of 0 update() is never called, as if the card had stalled.
+ */
+static bool writeFeatures(const char *filename, wav_feat_dtype dtype, float scale, const std::vector<float> &coefs,
+                          uint32_t update_every, bool close, wav_features_stats_t *stats)
+{
+  static WAV_features features;
+  uint32_t frame_cnt = coefs.size() / WAV_MFCC_COEF_CNT;
+
+  if (!features.begin(filename, WAV_FEAT_KIND_MFCC, dtype, WAV_MFCC_SAMPLE_RATE, WAV_MFCC_FRAME_SIZE,
+                      WAV_MFCC_STRIDE, WAV_MFCC_COEF_CNT, scale)) return false;
+
+  for (uint32_t i = 0; i < frame_cnt; i++)
+  {
+    features.addFrame(&coefs[i * WAV_MFCC_COEF_CNT]);
+    if (update_every > 0 && i % update_every == update_every - 1 && !features.update()) return false;
+  }
+  features.getStats(stats);
+  if (!close)
+  {
+    // Leave it as a reset would, only the full buffers written and no frame count
+    features.update();
+    features.getStats(stats);
+    return true;
+  }
+  bool ended = features.end();
+  features.getStats(stats);
+  return ended;
+}
+
+/*
+ * Largest difference between the mapped frames and the originals.
+ */
+static float maxError(const wav_feature_map_t *map, const std::vector<float> &coefs)
+{
+  float error = 0;
+
+  for (uint32_t frame = 0; frame < map->frame_cnt; frame++)
+  {
+    for (uint16_t c = 0; c < WAV_MFCC_COEF_CNT; c++)
+    {
+      error = fmaxf(error, fabsf(wavFeatureValue(map, frame, c) - coefs[frame * WAV_MFCC_COEF_CNT + c]));
+    }
+  }
+  return error;
+}
+
+static int selfTest()
+{
+  char path[] = "/tmp/feature_dump_XXXXXX";
+  if (mkdtemp(path) == NULL) return 1;
+  std::string dir = path;
+  std::string f32_name = dir + "/F32.FEA", i16_name = dir + "/I16.FEA", open_name = dir + "/OPEN.FEA";
+  std::string slow_name = dir + "/SLOW.FEA", csv_name = dir + "/F32.CSV";
+
+  // Chirp with a little noise, through the badge's MFCC
+  WAV_mfcc *mfcc = new WAV_mfcc();
+  std::vector<float> coefs;
+  srand(1);
+  for (uint32_t i = 0; i < TEST_SECONDS * WAV_MFCC_SAMPLE_RATE; i++)
+  {
+    double t = (double)i / WAV_MFCC_SAMPLE_RATE;
+    double freq = 100 + 3000 * fmod(t, 5.0) / 5.0;
+    int16_t sample = (int16_t)(8000 * sin(2 * M_PI * freq * t) + (rand() % 401) - 200);
+    if (mfcc->pushSample(sample))
+    {
+      coefs.insert(coefs.end(), mfcc->getCoefficients(), mfcc->getCoefficients() + WAV_MFCC_COEF_CNT);
+    }
+  }
+  delete mfcc;
+  uint32_t frame_cnt = coefs.size() / WAV_MFCC_COEF_CNT;
+  printf("%u MFCC frames from %u seconds of audio\n", frame_cnt, TEST_SECONDS);
+
+  wav_features_stats_t stats;
+  wav_feature_map_t map;
+
+  // float32, closed normally
+  bool written = writeFeatures(f32_name.c_str(), WAV_FEAT_FLOAT32, 1, coefs, TEST_UPDATE_EVERY, true, &stats);
+  check(written && stats.overruns == 0, "float32 streamed with no overruns");
+  bool mapped = wavFeatureMap(f32_name.c_str(), &map);
+  check(mapped && map.frame_cnt == frame_cnt && map.header->frame_cnt == frame_cnt, "float32 header frame count");
+  check(mapped && map.header->sample_rate == WAV_MFCC_SAMPLE_RATE && map.header->frame_stride == WAV_MFCC_STRIDE &&
+        map.header->coef_cnt == WAV_MFCC_COEF_CNT, "float32 header settings");
+  check(mapped && maxError(&map, coefs) == 0, "float32 frames are exact");
+  size_t f32_bytes = map.map_bytes;
+  wavFeatureUnmap(&map);
+
+  // int16, rounded to the nearest step
+  written = writeFeatures(i16_name.c_str(), WAV_FEAT_INT16, TEST_INT16_SCALE, coefs, TEST_UPDATE_EVERY, true, &stats);
+  mapped = wavFeatureMap(i16_name.c_str(), &map);
+  float error = (mapped ? maxError(&map, coefs) : 1);
+  check(written && mapped && map.frame_cnt == frame_cnt, "int16 header frame count");
+  check(error <= TEST_INT16_SCALE * 0.501, "int16 frames within half a step");
+  printf("  int16 max error %.5f, %zu bytes vs %zu for float32\n", error, map.map_bytes, f32_bytes);
+  wavFeatureUnmap(&map);
+
+  // Never closed:  no frame count, and the last record cut off by the buffer boundary
+  written = writeFeatures(open_name.c_str(), WAV_FEAT_FLOAT32, 1, coefs, TEST_UPDATE_EVERY, false, &stats);
+  mapped = wavFeatureMap(open_name.c_str(), &map);
+  check(written && mapped && map.header->frame_cnt == 0 && map.frame_cnt == stats.frames && map.frame_cnt > 0,
+        "unclosed file frames counted from its size");
+  check(mapped && maxError(&map, coefs) == 0, "unclosed file frames are exact");
+  wavFeatureUnmap(&map);
+
+  // Card stalled:  update() never called, so frames are dropped whole once the buffers fill
+  written = writeFeatures(slow_name.c_str(), WAV_FEAT_FLOAT32, 1, coefs, 0, true, &stats);
+  mapped = wavFeatureMap(slow_name.c_str(), &map);
+  check(written && mapped && stats.overruns > 0 && map.frame_cnt + stats.overruns == frame_cnt,
+        "stalled card drops whole frames");
+  check(mapped && maxError(&map, coefs) == 0, "frames before the stall are exact");
+  wavFeatureUnmap(&map);
+
+  // Not a feature file
+  check(!wavFeatureMap(csv_name.c_str(), &map), "missing file is rejected");
+  FILE *csv = fopen(csv_name.c_str(), "w");
+  if (!wavFeatureMap(f32_name.c_str(), &map) || csv == NULL) return 1;
+  writeCSV(&map, csv);
+  wavFeatureUnmap(&map);
+  fclose(csv);
+  check(!wavFeatureMap(csv_name.c_str(), &map), "CSV file is rejected");
+
+  // Read every value:  mapped binary against parsing the CSV
+  double sum = 0, csv_sum = 0;
+  auto start = std::chrono::steady_clock::now();
+  mapped = wavFeatureMap(f32_name.c_str(), &map);
+  for (uint32_t frame = 0; mapped && frame < map.frame_cnt; frame++)
+    for (uint16_t c = 0; c < map.header->coef_cnt; c++)
+      sum += wavFeatureValue(&map, frame, c);
+  wavFeatureUnmap(&map);
+  double map_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  start = std::chrono::steady_clock::now();
+  csv = fopen(csv_name.c_str(), "r");
+  char line[512];
+  size_t csv_bytes = 0;
+  while (csv != NULL && fgets(line, sizeof(line), csv) != NULL)
+  {
+    csv_bytes += strlen(line);
+    if (line[0] == '#') continue;
+    for (char *pos = line; *pos != '\0' && *pos != '\n'; )
+    {
+      csv_sum += strtof(pos, &pos);
+      if (*pos == ',') pos++;
+    }
+  }
+  if (csv != NULL) fclose(csv);
+  double csv_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  check(fabs(sum - csv_sum) < 1e-3 * frame_cnt, "mapped and CSV values agree");
+  printf("  Read all frames:  mapped %.2f msec (%zu bytes), CSV %.2f msec (%zu bytes), %.0fx faster\n",
+         map_sec * 1000, f32_bytes, csv_sec * 1000, csv_bytes, map_sec > 0 ? csv_sec / map_sec : 0);
+
+  remove(f32_name.c_str());
+  remove(i16_name.c_str());
+  remove(open_name.c_str());
+  remove(slow_name.c_str());
+  remove(csv_name.c_str());
+  rmdir(path);
+
+  printf(failures == 0 ? "PASSED\n" : "FAILED\n");
+  return failures == 0 ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc < 2)
+  {
+    fprintf(stderr, "Usage: %s input.fea [output.csv]\n       %s -t\n", argv[0], argv[0]);
+    return 1;
+  }
+  if (strcmp(argv[1], "-t") == 0) return selfTest();
+
+  wav_feature_map_t map;
+  if (!wavFeatureMap(argv[1], &map))
+  {
+    fprintf(stderr, "Unable to read feature file: %s\n", argv[1]);
+    return 1;
+  }
+
+  const wav_feature_header_t *hdr = map.header;
+  fprintf(stderr, "%s: %s, %s, %u frames of %u, %u Hz, frame %u, stride %u%s\n", argv[1],
+          hdr->kind <= WAV_FEAT_KIND_DFT ? KIND_NAMES[hdr->kind] : "unknown kind", hdr->dtype == WAV_FEAT_INT16 ? "int16" : "float32",
+          map.frame_cnt, hdr->coef_cnt, hdr->sample_rate, hdr->frame_size, hdr->frame_stride,
+          hdr->frame_cnt == 0 ? " (not closed)" : "");
+
+  FILE *out = (argc > 2 ? fopen(argv[2], "w") : stdout);
+  if (out == NULL)
+  {
+    fprintf(stderr, "Unable to create: %s\n", argv[2]);
+    wavFeatureUnmap(&map);
+    return 1;
+  }
+  writeCSV(&map, out);
+  if (out != stdout) fclose(out);
+  wavFeatureUnmap(&map);
+  return 0;
+}
@@ -0,0 +1,105 @@
+/*
+ * Host benchmark of WAV_fft against the original O(N^2) DFT from WAV_frame::calcDFT.
+ * Reports the time per frame, the frame rate compared to WAV_FRAMES_PER_SEC, 
+ * and the largest difference in the power spectrum.
+ *
+ * Build and run from the sketch folder:
+ *   g++ -O2 -o fft_bench tools/fft_bench.cpp WAV_fft.cpp && ./fft_bench
+ */
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../WAV_fft.h"
+
+#define BENCH_FRAMES_PER_SEC  96  // WAV_FRAMES_PER_SEC
+#define BENCH_DFT_RUNS        20
+#define BENCH_FFT_RUNS     20000
+
+static int16_t samples[WAV_FFT_SIZE];
+static double  dft_power[WAV_FFT_SIZE];
+static float   fft_power[WAV_FFT_BINS];
+
+/*
+ * The original per-frame DFT, calculating cos() and sin() in the inner loop.
+ */
+static void referenceDFT()
+{
+  double in[WAV_FFT_SIZE];
+  double invs = 1.0 / WAV_FFT_SIZE;
+
+  for (int i = 0; i < WAV_FFT_SIZE; i++)
+  {
+    in[i] = samples[i] * (-.5 * cos(2.0 * M_PI * (double)i / (double)WAV_FFT_SIZE) + .5);
+  }
+
+  for (int y = 0; y < WAV_FFT_SIZE; y++)
+  {
+    double re = 0, im = 0;
+    for (int x = 0; x < WAV_FFT_SIZE; x++)
+    {
+      double angle = -2.0 * M_PI * y * x * invs;
+      re += in[x] * cos(angle);
+      im += in[x] * sin(angle);
+    }
+    dft_power[y] = invs * (re * re + im * im);
+  }
+}
+
+static void fastFFT(WAV_fft *fft)
+{
+  float in[WAV_FFT_SIZE], re[WAV_FFT_BINS], im[WAV_FFT_BINS];
+  const float *window = WAV_fft::getHannWindow();
+
+  for (int i = 0; i < WAV_FFT_SIZE; i++)
+  {
+    in[i] = samples[i] * window[i];
+  }
+
+  fft->realForward(in, re, im);
+
+  for (int i = 0; i < WAV_FFT_BINS; i++)
+  {
+    fft_power[i] = (re[i] * re[i] + im[i] * im[i]) / WAV_FFT_SIZE;
+  }
+}
+
+int main()
+{
+  WAV_fft fft;
+
+  // Two tones plus noise at the 11025 Hz sample rate
+  srand(1);
+  for (int i = 0; i < WAV_FFT_SIZE; i++)
+  {
+    samples[i] = (int16_t)(12000 * sin(2 * M_PI * 440 * i / 11025.0) + 6000 * sin(2 * M_PI * 2750 * i / 11025.0) 
+                         + (rand() % 2000) - 1000);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < BENCH_DFT_RUNS; r++) referenceDFT();
+  double dft_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / BENCH_DFT_RUNS;
+
+  start = std::chrono::steady_clock::now();
+  for (int r = 0; r < BENCH_FFT_RUNS; r++) fastFFT(&fft);
+  double fft_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / BENCH_FFT_RUNS;
+
+  double max_power = 0, max_err = 0;
+  for (int i = 0; i < WAV_FFT_BINS; i++)
+  {
+    if (dft_power[i] > max_power) max_power = dft_power[i];
+  }
+  for (int i = 0; i < WAV_FFT_BINS; i++)
+  {
+    double err = fabs(dft_power[i] - fft_power[i]) / max_power;
+    if (err > max_err) max_err = err;
+  }
+
+  printf("DFT: %10.1f us/frame  %8.1f frames/sec\n", dft_us, 1e6 / dft_us);
+  printf("FFT: %10.1f us/frame  %8.1f frames/sec\n", fft_us, 1e6 / fft_us);
+  printf("Speedup: %.0fx, budget at %d frames/sec: %.1f%% of real time\n", 
+         dft_us / fft_us, BENCH_FRAMES_PER_SEC, fft_us * BENCH_FRAMES_PER_SEC / 1e4);
+  printf("Max power error (relative to peak): %.2e %s\n", max_err, max_err < 1e-4 ? "OK" : "FAIL");
+  return max_err < 1e-4 ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+/*
+ * Host accuracy test of the Q15 fixed point FFT against the float WAV_fft path.
+ * Each test signal is transformed by both, and the Q15 power spectrum error is 
+ * reported as a signal to noise ratio relative to the float result.  The complex
+ * transform (used by WAV_pitch) is checked the same way, with the signal as the
+ * real part and the signal reversed as the imaginary part.
+ * Returns non-zero if any signal falls below Q15_MIN_SNR_DB.
+ *
+ * Build and run from the sketch folder:
+ *   g++ -O2 -o fft_q15_test tools/fft_q15_test.cpp WAV_fft.cpp WAV_fft_q15.cpp && ./fft_q15_test
+ * The pipeline benches (pitch_bench, tempo_bench, kws_bench) check the Q15 path end 
+ * to end when built with -DWAV_FFT_USE_Q15=1.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../WAV_fft.h"
+#include "../WAV_fft_q15.h"
+
+#define Q15_MIN_SNR_DB     50.0  // Spectrum accuracy, exact complex output
+#define Q15_MIN_MAG_SNR_DB 25.0  // Spectrum accuracy using the magnitude approximation
+#define TEST_SAMPLE_RATE  11025.0
+
+static int16_t samples[WAV_FFT_SIZE];
+
+/*
+ * Fills the test signal.  12-bit mic data is +/-2048 around the ADC offset.
+ */
+static void fillSignal(int type)
+{
+  srand(type + 1);
+  for (int i = 0; i < WAV_FFT_SIZE; i++)
+  {
+    double t = i / TEST_SAMPLE_RATE;
+    double value = 0;
+    switch (type)
+    {
+      case 0: value = 2000 * sin(2 * M_PI * 440 * t); break;                                   // 12-bit full scale tone
+      case 1: value = 1200 * sin(2 * M_PI * 300 * t) + 600 * sin(2 * M_PI * 2900 * t); break;  // Two tones
+      case 2: value = (rand() % 4096) - 2048; break;                                           // 12-bit white noise
+      case 3: value = 12 * sin(2 * M_PI * 1000 * t) + (rand() % 5) - 2; break;                 // Very quiet tone
+      case 4: value = 32000 * sin(2 * M_PI * 5000 * t); break;                                 // 16-bit full scale
+      case 5: value = (i == 10 ? 2047 : 0); break;                                             // Impulse
+      default: break;
+    }
+    samples[i] = (int16_t)lround(value);
+  }
+}
+
+int main()
+{
+  const char *names[] = { "12-bit tone", "two tones", "white noise", "quiet tone", "16-bit tone", "impulse" };
+  WAV_fft     fft;
+  WAV_fft_q15 fft_q15;
+  float   in[WAV_FFT_SIZE], re[WAV_FFT_BINS], im[WAV_FFT_BINS];
+  int16_t q_re[WAV_FFT_BINS], q_im[WAV_FFT_BINS];
+  float   c_re[WAV_FFT_SIZE], c_im[WAV_FFT_SIZE];
+  int16_t qc_re[WAV_FFT_SIZE], qc_im[WAV_FFT_SIZE];
+  const float *window = WAV_fft::getHannWindow();
+  bool passed = true;
+
+  printf("%-12s %9s %9s %9s %5s\n", "signal", "SNR dB", "mag dB", "cplx dB", "exp");
+  for (int type = 0; type < 6; type++)
+  {
+    fillSignal(type);
+
+    for (int i = 0; i < WAV_FFT_SIZE; i++) in[i] = samples[i] * window[i];
+    fft.realForward(in, re, im);
+
+    int8_t exponent = fft_q15.realForward(samples, q_re, q_im);
+    double scale = ldexp(1.0, exponent);
+
+    double signal = 0, noise = 0, mag_signal = 0, mag_noise = 0;
+    for (int k = 0; k < WAV_FFT_BINS; k++)
+    {
+      double dr = q_re[k] * scale - re[k];
+      double di = q_im[k] * scale - im[k];
+      double mag = sqrt((double)re[k] * re[k] + (double)im[k] * im[k]);
+      double mag_err = WAV_fft_q15::magnitude(q_re[k], q_im[k]) * scale - mag;
+
+      signal += (double)re[k] * re[k] + (double)im[k] * im[k];
+      noise  += dr * dr + di * di;
+      mag_signal += mag * mag;
+      mag_noise  += mag_err * mag_err;
+    }
+
+    double snr = 10 * log10(signal / (noise + 1e-30));
+    double mag_snr = 10 * log10(mag_signal / (mag_noise + 1e-30));
+
+    for (int i = 0; i < WAV_FFT_SIZE; i++)
+    {
+      c_re[i] = qc_re[i] = samples[i];
+      c_im[i] = qc_im[i] = samples[WAV_FFT_SIZE - 1 - i];
+    }
+    fft.complexForward(c_re, c_im);
+    double c_scale = ldexp(1.0, fft_q15.complexForward(qc_re, qc_im));
+
+    double c_signal = 0, c_noise = 0;
+    for (int k = 0; k < WAV_FFT_SIZE; k++)
+    {
+      double dr = qc_re[k] * c_scale - c_re[k];
+      double di = qc_im[k] * c_scale - c_im[k];
+      c_signal += (double)c_re[k] * c_re[k] + (double)c_im[k] * c_im[k];
+      c_noise  += dr * dr + di * di;
+    }
+    double c_snr = 10 * log10(c_signal / (c_noise + 1e-30));
+
+    bool ok = (snr >= Q15_MIN_SNR_DB && mag_snr >= Q15_MIN_MAG_SNR_DB && c_snr >= Q15_MIN_SNR_DB);
+    passed &= ok;
+
+    printf("%-12s %9.1f %9.1f %9.1f %5d %s\n", names[type], snr, mag_snr, c_snr, exponent, ok ? "OK" : "FAIL");
+  }
+
+  printf("Memory: float work %u bytes, Q15 work %u bytes\n", 
+         (unsigned)sizeof(WAV_fft), (unsigned)sizeof(WAV_fft_q15));
+  printf(passed ? "PASSED\n" : "FAILED\n");
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,7 @@
+#ifndef _HOST_ADAFRUIT_GFX_
+#define _HOST_ADAFRUIT_GFX_
+
+// Host stand-in, esp32_r4ge_pro.h only needs the pin definitions
+#include "Arduino.h"
+
+#endif // _HOST_ADAFRUIT_GFX_
@@ -0,0 +1,46 @@
+#ifndef _HOST_ARDUINO_
+#define _HOST_ARDUINO_
+
+/*
+ * Minimal stand-in for the Arduino core so the sketch's analysis classes 
+ * (WAV_audio, WAV_frame) build unchanged in the host tools.  
+ * Serial output goes to stderr.  Add -Itools/host to the host build line.
+ */
+
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#ifndef PI
+#define PI 3.1415926535897932384626433832795
+#endif
+#define F(str) (str)
+
+class HostSerial
+{
+  public:
+    void   begin(unsigned long baud) { }
+    size_t print(const char *str)      { return fprintf(stderr, "%s", str); }
+    size_t print(char c)               { return fprintf(stderr, "%c", c); }
+    size_t print(long value)           { return fprintf(stderr, "%ld", value); }
+    size_t print(unsigned long value)  { return fprintf(stderr, "%lu", value); }
+    size_t print(int value)            { return print((long)value); }
+    size_t print(unsigned int value)   { return print((unsigned long)value); }
+    size_t print(double value, int digits = 2) { return fprintf(stderr, "%.*f", digits, value); }
+    template <typename T> 
+    size_t println(T value)            { size_t len = print(value); return len + print('\n'); }
+    size_t println(double value, int digits) { size_t len = print(value, digits); return len + print('\n'); }
+    size_t println()                   { return print('\n'); }
+};
+
+inline HostSerial Serial;
+
+inline uint32_t micros()
+{
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#endif // _HOST_ARDUINO_
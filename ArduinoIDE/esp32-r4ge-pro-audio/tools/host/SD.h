@@ -0,0 +1,43 @@
+#ifndef _HOST_SD_
+#define _HOST_SD_
+
+/*
+ * Minimal stand-in for the SD library so the sketch's file writers 
+ * (WAV_features) build unchanged in the host tools.  Paths are host paths.
+ */
+
+#include "Arduino.h"
+
+#define FILE_READ  "rb"
+#define FILE_WRITE "w+b"  // Truncates, like the ESP32 SD library
+
+class File
+{
+  public:
+    File(FILE *fp = NULL) : _fp(fp) { }
+    operator bool() const                          { return _fp != NULL; }
+    size_t write(const uint8_t *buff, size_t len)  { return fwrite(buff, 1, len, _fp); }
+    int    read(uint8_t *buff, size_t len)         { return (int)fread(buff, 1, len, _fp); }
+    bool   seek(uint32_t pos)                      { return fseek(_fp, pos, SEEK_SET) == 0; }
+    void   close()                                 { if (_fp) fclose(_fp); _fp = NULL; }
+  private:
+    FILE *_fp;
+};
+
+class HostSD
+{
+  public:
+    File open(const char *path, const char *mode = FILE_READ)
+    {
+      // Unbuffered, so what is on disk is what the sketch has written, as after a reset
+      FILE *fp = fopen(path, mode);
+      if (fp) setvbuf(fp, NULL, _IONBF, 0);
+      return File(fp);
+    }
+    bool exists(const char *path)                              { FILE *fp = fopen(path, "rb"); if (fp) fclose(fp); return fp != NULL; }
+    bool remove(const char *path)                              { return ::remove(path) == 0; }
+};
+
+inline HostSD SD;
+
+#endif // _HOST_SD_
@@ -0,0 +1,322 @@
+/*
+ * Host benchmark of the WAV_kws keyword spotter.
+ * Words are synthesized as voiced formant and fricative noise segments, each 
+ * spoken with its own timing (segments 0.8 - 1.25x), pitch (+/-10%), level and 
+ * background noise.  They go through the same chain as the badge:  WAV_mfcc gated by WAV_vad, 
+ * with an utterance from when the gate opens until it closes.
+ * Three recordings of each keyword are the templates.  Then new recordings of the 
+ * keywords and of other words are spotted, and the time spent scoring gives the 
+ * templates scored per second.  The same utterances are also scored with full DTW 
+ * (no band, no abandoning) for comparison.
+ * Returns non-zero if too few keywords are found or too many other words are accepted.
+ *
+ * Build and run from the sketch folder:
+ *   g++ -O2 -o kws_bench tools/kws_bench.cpp WAV_kws.cpp WAV_mfcc.cpp WAV_fft.cpp WAV_fft_q15.cpp WAV_vad.cpp && ./kws_bench
+ */
+
+#include <chrono>
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <vector>
+#include "../WAV_kws.h"
+#include "../WAV_vad.h"
+
+#define SAMPLE_RATE      WAV_MFCC_SAMPLE_RATE
+#define TESTS_PER_WORD      25
+#define MIN_HIT_RATE      0.90
+#define MAX_FALSE_RATE    0.10
+#define SPEAKER_F0         130  // Templates are recorded by the person using them
+
+typedef struct
+{
+  float f1, f2;      // Formants, or f1 = 0 and f2 = centre of a fricative
+  float ms;
+} segment_t;
+
+typedef struct
+{
+  const char *name;
+  segment_t   seg[4];
+  uint8_t     seg_cnt;
+  bool        near;   // Only one sound away from a keyword, not counted in the result
+} word_t;
+
+// The first WAV_KWS_WORDS are the keywords, the rest should be rejected
+static const word_t WORDS[] = 
+{
+  { "yes",   { { 300, 2200, 110 }, { 550, 1800, 150 }, { 0, 4500, 140 } }, 3 },
+  { "no",    { { 280, 1000, 90 },  { 550, 950, 160 },  { 380, 800, 140 } }, 3 },
+  { "stop",  { { 0, 4000, 110 },   { 650, 1150, 170 }, { 0, 1500, 50 } }, 3 },
+  { "left",  { { 350, 1300, 80 },  { 550, 1750, 140 }, { 0, 3000, 90 }, { 0, 5000, 60 } }, 4 },
+  { "less",  { { 350, 1300, 80 },  { 550, 1800, 150 }, { 0, 4500, 140 } }, 3, true },
+  { "hi",    { { 0, 1600, 70 },    { 750, 1250, 130 }, { 350, 2200, 130 } }, 3 },
+  { "moon",  { { 280, 1000, 90 },  { 300, 850, 200 },  { 280, 1600, 110 } }, 3 },
+  { "sit",   { { 0, 4500, 120 },   { 400, 2000, 120 }, { 0, 3500, 50 } }, 3 },
+  { "ride",  { { 350, 1200, 80 },  { 700, 1200, 120 }, { 350, 2200, 120 } }, 3 },
+};
+static const uint8_t WORD_CNT = sizeof(WORDS) / sizeof(WORDS[0]);
+
+static std::mt19937 rng(7);
+
+static float uniform(float lo, float hi)
+{
+  return std::uniform_real_distribution<float>(lo, hi)(rng);
+}
+
+/*
+ * Two pole resonator, for the formants and fricative bands.
+ */
+class Resonator
+{
+  public:
+    float process(float x, float freq, float bw)
+    {
+      float r = expf(-M_PI * bw / SAMPLE_RATE);
+      float a1 = 2 * r * cosf(2 * M_PI * freq / SAMPLE_RATE);
+      float y = (1 - r) * x + a1 * _y1 - r * r * _y2;
+      _y2 = _y1;
+      _y1 = y;
+      return y;
+    }
+  private:
+    float _y1 = 0, _y2 = 0;
+};
+
+/*
+ * Speaks a word, with silence and background noise either side.
+ */
+static std::vector<int16_t> speak(const word_t *word)
+{
+  std::vector<float> out;
+  std::normal_distribution<float> noise(0, 1);
+  Resonator f1, f2, f3, fric;
+  float f0 = SPEAKER_F0 * uniform(0.9, 1.1), level = uniform(0.3, 1.0), bg = uniform(20, 80);
+  float phase = 0, cur_f1 = word->seg[0].f1, cur_f2 = word->seg[0].f2;
+  
+  out.resize((size_t)(uniform(0.25, 0.4) * SAMPLE_RATE), 0);
+  for (uint8_t s = 0; s < word->seg_cnt; s++)
+  {
+    const segment_t *seg = &word->seg[s];
+    uint32_t len = (uint32_t)(seg->ms * uniform(0.8, 1.25) * SAMPLE_RATE / 1000);
+    float tf1 = seg->f1 * uniform(0.95, 1.05), tf2 = seg->f2 * uniform(0.95, 1.05);
+
+    for (uint32_t i = 0; i < len; i++)
+    {
+      float y;
+      if (seg->f1 > 0)
+      {
+        // Glide to the segment's formants over ~30 msec
+        cur_f1 += (tf1 - cur_f1) * 0.003f;
+        cur_f2 += (tf2 - cur_f2) * 0.003f;
+        phase += f0 / SAMPLE_RATE;
+        if (phase >= 1) phase -= 1;
+        float pulse = (phase < 0.05f ? 1.0f : 0) - 0.05f;  // Glottal pulse train
+        y = f1.process(pulse, cur_f1, 80) * 0.6f + f2.process(pulse, cur_f2, 120) * 0.3f + f3.process(pulse, 2600, 200) * 0.1f;
+        y *= 400;
+      }
+      else
+      {
+        y = fric.process(noise(rng), tf2, 800) * 2.5f;
+      }
+      // Short fades stop clicks between segments
+      float fade = fminf(1.0f, fminf(i, len - i) / 80.0f);
+      out.push_back(y * fade);
+    }
+  }
+  out.resize(out.size() + (size_t)(uniform(0.3, 0.45) * SAMPLE_RATE), 0);
+
+  float peak = 1;
+  for (float v : out) peak = fmaxf(peak, fabsf(v));
+  
+  std::vector<int16_t> pcm(out.size());
+  for (size_t i = 0; i < out.size(); i++)
+  {
+    pcm[i] = (int16_t)lrintf(out[i] / peak * 20000 * level + noise(rng) * bg);
+  }
+  return pcm;
+}
+
+static double scoring_sec = 0;
+
+/*
+ * Runs a recording through the badge's chain.  Returns true if an utterance was found,
+ * with the kws result of the longest one, and its frames left in kws for copyUtterance().
+ */
+static bool spot(WAV_kws *kws, const std::vector<int16_t> &pcm, wav_kws_result_t *result, bool *match)
+{
+  WAV_vad  vad;
+  WAV_mfcc mfcc;
+  bool     in_utterance = false, found = false;
+
+  mfcc.setGate(&vad);
+  for (size_t i = 0; i < pcm.size(); i++)
+  {
+    if (!mfcc.pushSample(pcm[i])) continue;
+
+    auto start = std::chrono::steady_clock::now();
+    if (!mfcc.getSilent())
+    {
+      if (!in_utterance) kws->beginUtterance();
+      in_utterance = true;
+      kws->pushFrame(mfcc.getCoefficients());
+    }
+    else if (in_utterance)
+    {
+      wav_kws_result_t res;
+      bool m = kws->endUtterance(&res);
+      in_utterance = false;
+      if (res.frames >= WAV_KWS_MIN_FRAMES && (!found || res.frames > result->frames))
+      {
+        *result = res;
+        *match = m;
+        found = true;
+      }
+    }
+    scoring_sec += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+  return found;
+}
+
+/*
+ * Symmetric DTW over the whole table, the cost without the band or abandoning.
+ */
+static float fullDTW(const wav_kws_template_t *a, const wav_kws_template_t *b, std::vector<float> &table)
+{
+  uint16_t n = a->frame_cnt, m = b->frame_cnt;
+  table.assign(n * m, 0);
+  
+  for (uint16_t i = 0; i < n; i++)
+  {
+    for (uint16_t j = 0; j < m; j++)
+    {
+      float d = 0;
+      for (uint8_t c = 0; c < WAV_KWS_COEF_CNT; c++)
+      {
+        float diff = a->frames[i][c] - b->frames[j][c];
+        d += diff * diff;
+      }
+      d = sqrtf(d);
+      
+      float cost;
+      if (i == 0 && j == 0) cost = 2 * d;
+      else
+      {
+        cost = WAV_KWS_INFINITY;
+        if (i > 0 && j > 0) cost = table[(i - 1) * m + j - 1] + 2 * d;
+        if (i > 0) cost = fminf(cost, table[(i - 1) * m + j] + d);
+        if (j > 0) cost = fminf(cost, table[i * m + j - 1] + d);
+      }
+      table[i * m + j] = cost;
+    }
+  }
+  return table[n * m - 1] / (n + m);
+}
+
+int main()
+{
+  WAV_kws *kws = new WAV_kws();
+  wav_kws_result_t result;
+  bool match;
+
+  // Record the templates
+  for (uint8_t w = 0; w < WAV_KWS_WORDS; w++)
+  {
+    for (uint8_t slot = 0; slot < WAV_KWS_TEMPLATES; slot++)
+    {
+      if (!spot(kws, speak(&WORDS[w]), &result, &match) || !kws->copyUtterance(kws->getTemplate(w, slot)))
+      {
+        printf("Template %s %u was not recorded (%u frames)\n", WORDS[w].name, slot, result.frames);
+      }
+    }
+  }
+
+  uint32_t hits = 0, misses = 0, confusions = 0, false_accepts = 0, other_tests = 0;
+  uint32_t utterances = 0, templates_scored = 0, abandoned = 0;
+  uint64_t cells = 0, full_cells = 0, frames = 0;
+  double   full_sec = 0;
+  std::vector<float> table;
+  wav_kws_template_t *utter = new wav_kws_template_t();
+
+  scoring_sec = 0;
+  printf("%-6s %5s %5s %5s   %s\n", "word", "hit", "other", "none", "best score avg / min / max");
+  for (uint8_t w = 0; w < WORD_CNT; w++)
+  {
+    uint32_t word_hits = 0, word_other = 0, word_none = 0;
+    uint32_t score_cnt = 0;
+    float    score_sum = 0, score_min = WAV_KWS_INFINITY, score_max = 0;
+    
+    for (uint32_t t = 0; t < TESTS_PER_WORD; t++)
+    {
+      if (!spot(kws, speak(&WORDS[w]), &result, &match))
+      {
+        word_none++;
+        continue;
+      }
+      utterances++;
+      templates_scored += WAV_KWS_WORDS * WAV_KWS_TEMPLATES;
+      abandoned += result.abandoned;
+      cells += result.cells;
+      frames += result.frames;
+      
+      if (result.score < WAV_KWS_INFINITY)
+      {
+        // Otherwise every template was abandoned
+        score_cnt++;
+        score_sum += result.score;
+        score_min = fminf(score_min, result.score);
+        score_max = fmaxf(score_max, result.score);
+      }
+      if (!match) word_none++;
+      else if (result.word == w) word_hits++;
+      else word_other++;
+
+      // The same utterance with full DTW
+      if (kws->copyUtterance(utter))
+      {
+        auto start = std::chrono::steady_clock::now();
+        for (uint8_t k = 0; k < WAV_KWS_WORDS; k++)
+          for (uint8_t s = 0; s < WAV_KWS_TEMPLATES; s++)
+          {
+            fullDTW(utter, kws->getTemplate(k, s), table);
+            full_cells += table.size();
+          }
+        full_sec += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      }
+    }
+    
+    if (w < WAV_KWS_WORDS)
+    {
+      hits += word_hits;
+      confusions += word_other;
+      misses += word_none;
+    }
+    else if (!WORDS[w].near)
+    {
+      false_accepts += word_hits + word_other;
+      other_tests += TESTS_PER_WORD;
+    }
+    printf("%-6s %5u %5u %5u   %.2f / %.2f / %.2f%s\n", WORDS[w].name, word_hits, word_other, word_none, 
+           score_cnt ? score_sum / score_cnt : 0, score_min, score_max, WORDS[w].near ? "   (near a keyword)" : "");
+  }
+
+  uint32_t keyword_tests = WAV_KWS_WORDS * TESTS_PER_WORD;
+  float hit_rate = (float)hits / keyword_tests;
+  float false_rate = (float)false_accepts / other_tests;
+
+  printf("\nKeywords found %.1f%%, confused %u, missed %u.  Other words accepted %.1f%%\n", 
+         100 * hit_rate, confusions, misses, 100 * false_rate);
+  printf("Banded + abandoning: %8.0f templates/sec, %6.1f cells/template, %4.1f%% abandoned\n", 
+         templates_scored / scoring_sec, (double)cells / templates_scored, 100.0 * abandoned / templates_scored);
+  printf("Full DTW:            %8.0f templates/sec, %6.1f cells/template\n", 
+         templates_scored / full_sec, (double)full_cells / templates_scored);
+  double speech_sec = (double)frames * WAV_KWS_DECIMATE * WAV_MFCC_STRIDE / WAV_MFCC_SAMPLE_RATE;
+  printf("Per second of speech, all %u templates:  %.0f cells, %.0f multiply-adds\n", 
+         WAV_KWS_WORDS * WAV_KWS_TEMPLATES, cells / speech_sec, cells * WAV_KWS_COEF_CNT / speech_sec);
+  
+  delete utter;
+  delete kws;
+  bool passed = hit_rate >= MIN_HIT_RATE && false_rate <= MAX_FALSE_RATE;
+  printf(passed ? "PASSED\n" : "FAILED\n");
+  return passed ? 0 : 1;
+}
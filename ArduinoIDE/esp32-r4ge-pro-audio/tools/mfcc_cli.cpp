@@ -0,0 +1,153 @@
+/*
+ * Host command line MFCC extractor.  Uses the same WAV_mfcc code as the badge,
+ * so the features match what the badge saves with the Y button (as a binary 
+ * feature file, tools/feature_dump converts it to this CSV).
+ * Input must be PCM WAV, 8 or 16-bit.  Only the first channel is used.
+ * Other sample rates are converted to 11025 Hz with the WAV_resampler.
+ * Output is the same CSV format as WAV_file::saveMFCC().
+ *
+ * Build and run from the sketch folder:
+ *   g++ -O2 -o mfcc_cli tools/mfcc_cli.cpp WAV_mfcc.cpp WAV_fft.cpp WAV_fft_q15.cpp WAV_resample.cpp WAV_vad.cpp
+ *   ./mfcc_cli MIC000.WAV [MIC000.MFC]
+ */
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "../WAV_mfcc.h"
+#include "../WAV_resample.h"
+
+static WAV_mfcc      mfcc;
+static WAV_resampler resampler;
+
+/*
+ * Resamples one input sample to the MFCC rate and writes any completed frames.
+ */
+static void pushSample(float sample, bool resample, FILE *out)
+{
+  float    samples[64];
+  uint32_t count = 1, used;
+
+  if (resample) count = resampler.process(&sample, 1, samples, 64, &used);
+  else samples[0] = sample;
+
+  for (uint32_t i = 0; i < count; i++)
+  {
+    if (mfcc.pushSample((int16_t)lroundf(samples[i])))
+    {
+      const float *coef = mfcc.getCoefficients();
+      for (uint8_t c = 0; c < WAV_MFCC_COEF_CNT; c++)
+      {
+        fprintf(out, c > 0 ? ",%.4f" : "%.4f", coef[c]);
+      }
+      fprintf(out, "\n");
+    }
+  }
+}
+
+/*
+ * Finds the fmt and data chunks.  Returns false if the file is not a usable PCM WAV.
+ */
+static bool readHeader(FILE *in, uint16_t *channels, uint32_t *sample_rate, uint16_t *bits, uint32_t *data_bytes)
+{
+  uint8_t  hdr[12], fmt[16];
+  uint32_t chunk_len;
+  bool     fmt_found = false;
+
+  if (fread(hdr, 1, 12, in) != 12 || memcmp(hdr, "RIFF", 4) != 0 || memcmp(hdr + 8, "WAVE", 4) != 0) return false;
+
+  while (fread(hdr, 1, 8, in) == 8)
+  {
+    chunk_len = hdr[4] | (hdr[5] << 8) | (hdr[6] << 16) | ((uint32_t)hdr[7] << 24);
+
+    if (memcmp(hdr, "fmt ", 4) == 0 && chunk_len >= 16)
+    {
+      if (fread(fmt, 1, 16, in) != 16) return false;
+      if ((fmt[0] | (fmt[1] << 8)) != 1) return false;  // PCM only
+      *channels    = fmt[2] | (fmt[3] << 8);
+      *sample_rate = fmt[4] | (fmt[5] << 8) | (fmt[6] << 16) | ((uint32_t)fmt[7] << 24);
+      *bits        = fmt[14] | (fmt[15] << 8);
+      fmt_found = true;
+      fseek(in, chunk_len - 16 + (chunk_len & 1), SEEK_CUR);
+    }
+    else if (memcmp(hdr, "data", 4) == 0)
+    {
+      *data_bytes = chunk_len;
+      return fmt_found && *channels > 0 && (*bits == 8 || *bits == 16);
+    }
+    else
+    {
+      fseek(in, chunk_len + (chunk_len & 1), SEEK_CUR);
+    }
+  }
+  return false;
+}
+
+int main(int argc, char *argv[])
+{
+  uint16_t channels = 0, bits = 0;
+  uint32_t sample_rate = 0, data_bytes = 0, sample_cnt = 0;
+
+  if (argc < 2)
+  {
+    fprintf(stderr, "Usage: %s input.wav [output.mfc]\n", argv[0]);
+    return 1;
+  }
+
+  FILE *in = fopen(argv[1], "rb");
+  if (in == NULL || !readHeader(in, &channels, &sample_rate, &bits, &data_bytes))
+  {
+    fprintf(stderr, "Unable to read PCM WAV file: %s\n", argv[1]);
+    return 1;
+  }
+  bool resample = (sample_rate != WAV_MFCC_SAMPLE_RATE);
+  if (resample)
+  {
+    // Upsampling more than 64x would overflow the pushSample() buffer
+    if (sample_rate * 64 < WAV_MFCC_SAMPLE_RATE || !resampler.begin(sample_rate, WAV_MFCC_SAMPLE_RATE))
+    {
+      fprintf(stderr, "Unable to resample %u Hz to %d Hz\n", sample_rate, WAV_MFCC_SAMPLE_RATE);
+      return 1;
+    }
+    fprintf(stderr, "Resampling %u Hz to %d Hz\n", sample_rate, WAV_MFCC_SAMPLE_RATE);
+  }
+
+  FILE *out = (argc > 2 ? fopen(argv[2], "w") : stdout);
+  if (out == NULL)
+  {
+    fprintf(stderr, "Unable to create: %s\n", argv[2]);
+    return 1;
+  }
+
+  uint32_t frame_bytes = channels * (bits / 8);
+  uint32_t total_samples = data_bytes / frame_bytes;
+  uint32_t mfcc_samples = (uint32_t)(((uint64_t)total_samples * WAV_MFCC_SAMPLE_RATE) / sample_rate);
+  uint32_t frame_cnt = (mfcc_samples >= WAV_MFCC_FRAME_SIZE ? (mfcc_samples - WAV_MFCC_FRAME_SIZE) / WAV_MFCC_STRIDE + 1 : 0);
+  uint8_t  frame[16];
+
+  fprintf(out, "# frames=%u size=%d stride=%d cepstra=%d\n", frame_cnt, WAV_MFCC_FRAME_SIZE, WAV_MFCC_STRIDE, WAV_MFCC_COEF_CNT);
+
+  auto start = std::chrono::steady_clock::now();
+  while (sample_cnt < total_samples && fread(frame, 1, frame_bytes, in) == frame_bytes)
+  {
+    // 8-bit WAV is unsigned, 16-bit is signed
+    int16_t sample = (bits == 8 ? (int16_t)((frame[0] - 128) << 8) : (int16_t)(frame[0] | (frame[1] << 8)));
+    sample_cnt++;
+    pushSample(sample, resample, out);
+  }
+  
+  // Flush the end of the file out of the filter
+  for (uint32_t i = 0; resample && i < resampler.getDelay(); i++)
+  {
+    pushSample(0, resample, out);
+  }
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  fclose(in);
+  if (out != stdout) fclose(out);
+
+  fprintf(stderr, "%u frames from %.2f sec of audio in %.3f sec (%.0fx real time)\n", mfcc.getFrameCount(), 
+          (double)sample_cnt / sample_rate, elapsed, elapsed > 0 ? ((double)sample_cnt / sample_rate) / elapsed : 0);
+  return 0;
+}
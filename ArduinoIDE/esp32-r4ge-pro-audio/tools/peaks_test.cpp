@@ -0,0 +1,106 @@
+/*
+ * Host test of the WAV_peaks waveform cache.
+ * Random waveforms from a few samples to ~2 minutes are pushed in uneven blocks, 
+ * so level 0 is dropped several times, then viewed at a range of zooms starting 
+ * part way in.  Each column must match the lowest and highest sample of the 
+ * entries it reads, found by brute force, and columns past the end must be 0.
+ * Also times a full screen of columns at each length, which should not grow with it.
+ * Returns non-zero if any column is wrong.
+ *
+ * Build and run from the sketch folder:
+ *   g++ -O2 -o peaks_test tools/peaks_test.cpp WAV_peaks.cpp && ./peaks_test
+ */
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "../WAV_peaks.h"
+
+#define SCREEN_COLS   320
+#define TIMING_RUNS  1000
+
+static const uint32_t LENGTHS[] = { 5, 11025, 16384, 16385, 100000, 1323000 };
+static const uint32_t ZOOMS[]   = { 1, 7, 16, 33, 100, 1000, 5000, 100000 };
+
+/*
+ * Checks one view against the samples.  Returns the number of wrong columns.
+ */
+static uint32_t checkView(WAV_peaks *peaks, const std::vector<int16_t> &x, uint32_t start, uint32_t zoom)
+{
+  wav_peak_t cols[SCREEN_COLS];
+  uint32_t   size = peaks->getBlockSize() << peaks->findLevel(zoom);
+  uint32_t   count = x.size();
+  uint32_t   errors = 0;
+
+  peaks->getPeaks(start, zoom, SCREEN_COLS, cols);
+  for (uint32_t c = 0; c < SCREEN_COLS; c++)
+  {
+    uint32_t first = start + c * zoom;
+    int16_t  lo = 0, hi = 0;
+
+    if (first < count)
+    {
+      // Whole entries covering the column
+      uint32_t a = first / size * size;
+      uint32_t b = (first + zoom + size - 1) / size * size;
+      if (b > count) b = count;
+      lo = hi = x[a];
+      for (uint32_t i = a; i < b; i++)
+      {
+        if (x[i] < lo) lo = x[i];
+        if (x[i] > hi) hi = x[i];
+      }
+    }
+    if (cols[c].lo != lo || cols[c].hi != hi)
+    {
+      if (errors == 0) printf("\n  samples %u zoom %u column %u: %d,%d expected %d,%d", count, zoom, c, cols[c].lo, cols[c].hi, lo, hi);
+      errors++;
+    }
+  }
+  return errors;
+}
+
+int main()
+{
+  uint32_t errors = 0;
+  WAV_peaks *peaks = new WAV_peaks();
+
+  srand(3);
+  printf("%10s %6s %12s\n", "samples", "block", "us/screen");
+  for (uint32_t length : LENGTHS)
+  {
+    std::vector<int16_t> x(length);
+    for (uint32_t i = 0; i < length; i++) x[i] = (rand() % 65536) - 32768;
+
+    peaks->reset();
+    for (uint32_t i = 0; i < length; )
+    {
+      uint16_t block = 1 + rand() % 300;
+      if (block > length - i) block = length - i;
+      peaks->pushBlock(&x[i], block);
+      i += block;
+    }
+
+    for (uint32_t zoom : ZOOMS)
+    {
+      errors += checkView(peaks, x, length / 3, zoom);
+      errors += checkView(peaks, x, 0, zoom);
+    }
+
+    // Fit to screen, as the badge shows a new waveform
+    wav_peak_t cols[SCREEN_COLS];
+    uint32_t zoom = (length + SCREEN_COLS - 1) / SCREEN_COLS;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t run = 0; run < TIMING_RUNS; run++)
+    {
+      peaks->getPeaks(0, zoom, SCREEN_COLS, cols);
+    }
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / TIMING_RUNS;
+    printf("%10u %6u %12.2f\n", length, peaks->getBlockSize(), us);
+  }
+  delete peaks;
+
+  printf(errors == 0 ? "PASSED\n" : "FAILED, %u columns wrong\n", errors);
+  return errors == 0 ? 0 : 1;
+}
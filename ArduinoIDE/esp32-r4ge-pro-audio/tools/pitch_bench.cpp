@@ -0,0 +1,191 @@
+/*
+ * Host accuracy and cost benchmark of the WAV_pitch detector.
+ * Synthetic fixtures (sine, band limited sawtooth, weak fundamental with a strong 
+ * 2nd harmonic, and harmonics in noise) are generated at musical pitches across 
+ * the tuner range and streamed through the detector at 11025 Hz.  WAV files can 
+ * be added as file / expected Hz pairs.  The strongest FFT bin, as used by 
+ * drawDFT(), is measured alongside for comparison.
+ * Returns non-zero if the detector misses its accuracy limits on the fixtures.
+ *
+ * Build and run from the sketch folder:
+ *   g++ -O2 -o pitch_bench tools/pitch_bench.cpp tools/wav_load_file.cpp WAV_pitch.cpp WAV_fft.cpp WAV_fft_q15.cpp && ./pitch_bench
+ *   ./pitch_bench GUITAR_E2.WAV 82.41 ...
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "../WAV_pitch.h"
+#include "../WAV_fft.h"
+#include "wav_load_file.h"
+
+#define SAMPLE_RATE       11025
+#define FIXTURE_SECONDS   2.0
+#define FIXTURE_LEVEL     2000.0  // 12-bit microphone range
+#define GROSS_CENTS       50.0    // Errors over this are wrong notes (or octaves)
+#define MAX_GROSS_PCT     1.0     // Clean fixtures
+#define MAX_NOISY_GROSS_PCT 5.0
+#define MAX_MEDIAN_CENTS  2.0
+
+typedef struct
+{
+  const char *name;
+  uint32_t    estimates;
+  uint32_t    voiced;
+  uint32_t    gross;
+  uint32_t    fft_gross;
+  std::vector<float> cents;
+  double      seconds;
+  uint32_t    samples;
+} result_t;
+
+static WAV_pitch pitch;
+static WAV_fft   fft;
+
+/*
+ * Generates a fixture.  type 0 sine, 1 sawtooth, 2 strong 2nd harmonic, 3 noisy
+ */
+static void makeFixture(int type, double freq, std::vector<int16_t> *samples)
+{
+  uint32_t count = (uint32_t)(SAMPLE_RATE * FIXTURE_SECONDS);
+  srand(type * 1000 + (int)freq);
+  samples->resize(count);
+  
+  for (uint32_t i = 0; i < count; i++)
+  {
+    double t = (double)i / SAMPLE_RATE;
+    double value = 0;
+    switch (type)
+    {
+      case 0:
+        value = sin(2 * M_PI * freq * t);
+        break;
+      case 1:
+      case 3:
+        for (int h = 1; h <= 10 && h * freq < SAMPLE_RATE / 2; h++) value += sin(2 * M_PI * h * freq * t) / h * 0.6;
+        if (type == 3) value += ((rand() / (double)RAND_MAX) - 0.5) * 0.35;  // ~20 dB SNR
+        break;
+      case 2:
+        value = 0.25 * sin(2 * M_PI * freq * t) + 0.8 * sin(2 * M_PI * 2 * freq * t + 1) + 0.4 * sin(2 * M_PI * 3 * freq * t + 2);
+        break;
+    }
+    (*samples)[i] = (int16_t)lround(value * FIXTURE_LEVEL);
+  }
+}
+
+/*
+ * The Analyze screen method:  strongest bin of a Hann windowed frame.
+ */
+static float fftPeak(const int16_t *frame)
+{
+  float in[WAV_FFT_SIZE], re[WAV_FFT_BINS], im[WAV_FFT_BINS];
+  const float *window = WAV_fft::getHannWindow();
+  
+  for (int i = 0; i < WAV_FFT_SIZE; i++) in[i] = frame[i] * window[i];
+  fft.realForward(in, re, im);
+
+  int best = 2;
+  for (int k = 2; k < WAV_FFT_BINS; k++)
+  {
+    if (re[k] * re[k] + im[k] * im[k] > re[best] * re[best] + im[best] * im[best]) best = k;
+  }
+  return (float)best * SAMPLE_RATE / WAV_FFT_SIZE;
+}
+
+static void runDetector(const std::vector<int16_t> &samples, double expected, result_t *result)
+{
+  wav_pitch_t estimate;
+  
+  pitch.reset();
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < samples.size(); i++)
+  {
+    if (!pitch.pushSample(samples[i])) continue;
+
+    pitch.getPitch(&estimate);
+    result->estimates++;
+    if (estimate.freq > 0)
+    {
+      float cents = 1200 * log2f(estimate.freq / expected);
+      result->voiced++;
+      result->cents.push_back(fabsf(cents));
+      if (fabsf(cents) > GROSS_CENTS) result->gross++;
+    }
+    else
+    {
+      result->gross++;
+    }
+  }
+  result->seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  result->samples += samples.size();
+
+  for (uint32_t i = WAV_FFT_SIZE; i <= samples.size(); i += WAV_PITCH_HOP)
+  {
+    float cents = 1200 * log2f(fftPeak(&samples[i - WAV_FFT_SIZE]) / expected);
+    if (fabsf(cents) > GROSS_CENTS) result->fft_gross++;
+  }
+}
+
+static void printResult(result_t *result)
+{
+  float median = 0;
+  if (!result->cents.empty())
+  {
+    std::sort(result->cents.begin(), result->cents.end());
+    median = result->cents[result->cents.size() / 2];
+  }
+  
+  printf("%-14s %6u %7.1f %9.2f %8.2f %10.2f %8.1f %7.0fx\n", result->name, result->estimates,
+         100.0 * result->voiced / result->estimates, median, 100.0 * result->gross / result->estimates,
+         100.0 * result->fft_gross / result->estimates, result->seconds * 1e6 / result->estimates,
+         (result->samples / (double)SAMPLE_RATE) / result->seconds);
+}
+
+int main(int argc, char *argv[])
+{
+  const char   *names[] = { "sine", "sawtooth", "weak fund.", "noisy" };
+  const double  notes[] = { 82.41, 110.0, 146.83, 196.0, 261.63, 329.63, 440.0, 659.26, 987.77, 1318.51 };
+  bool passed = true;
+
+  pitch.begin(SAMPLE_RATE);
+  printf("%-14s %6s %7s %9s %8s %10s %8s %8s\n", "fixture", "est.", "voiced%", "med cents", "gross%", "FFT gross%", "us/est", "speed");
+  
+  for (int type = 0; type < 4; type++)
+  {
+    result_t result = { names[type] };
+    std::vector<int16_t> samples;
+    
+    for (uint8_t i = 0; i < sizeof(notes) / sizeof(notes[0]); i++)
+    {
+      makeFixture(type, notes[i], &samples);
+      runDetector(samples, notes[i], &result);
+    }
+    printResult(&result);
+
+    float median = result.cents.empty() ? 1e9 : result.cents[result.cents.size() / 2];
+    float max_gross = (type == 3 ? MAX_NOISY_GROSS_PCT : MAX_GROSS_PCT);
+    passed &= (100.0 * result.gross / result.estimates <= max_gross && median <= MAX_MEDIAN_CENTS);
+  }
+
+  for (int i = 1; i + 1 < argc; i += 2)
+  {
+    result_t result = { argv[i] };
+    std::vector<int16_t> samples;
+    uint32_t rate = 0;
+    
+    if (!wavLoadFile(argv[i], &samples, &rate) || rate != SAMPLE_RATE)
+    {
+      fprintf(stderr, "Unable to read %s, must be PCM WAV at %d Hz\n", argv[i], SAMPLE_RATE);
+      continue;
+    }
+    runDetector(samples, atof(argv[i + 1]), &result);
+    printResult(&result);
+  }
+
+  printf("Estimates per second: %.1f\n", (double)SAMPLE_RATE / WAV_PITCH_HOP);
+  printf(passed ? "PASSED\n" : "FAILED\n");
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,189 @@
+/*
+ * Host quality test of the float and Q15 polyphase resamplers.
+ * For each rate pair, tones across the passband are resampled and fitted with a
+ * sine at the expected frequency.  The fitted gain gives the passband ripple and
+ * the residual gives the alias and image rejection.  Tones above the output 
+ * Nyquist (downsampling only) must be rejected by the filter.
+ * Input is fed in uneven blocks with a small output buffer to exercise streaming.
+ * Returns non-zero if any rate pair is outside the limits.
+ *
+ * Build and run from the sketch folder:
+ *   g++ -O2 -o resample_test tools/resample_test.cpp WAV_resample.cpp WAV_resample_q15.cpp && ./resample_test
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../WAV_resample.h"
+#include "../WAV_resample_q15.h"
+
+#define MAX_RIPPLE_DB        0.1   // Gain range across the passband, float
+#define MAX_RIPPLE_Q15_DB    0.2
+#define MIN_REJECT_DB       70.0   // Aliases and images relative to the tone, float
+#define MIN_REJECT_Q15_DB   60.0
+#define PASSBAND          0.40     // Passband edge as a fraction of the lower rate
+#define STOPBAND          0.60     // Stopband edge as a fraction of the output rate
+#define TEST_SECONDS      0.5
+#define TONE_AMPLITUDE    16000.0
+
+static float   in_f[48000];
+static float   out_f[48000];
+static int16_t in_q[48000];
+static int16_t out_q[48000];
+static double  out_d[48000];
+
+/*
+ * Resamples the input held in in_f and in_q with uneven block sizes.
+ * Returns the output count, with the output in out_d.
+ */
+static uint32_t runBlocks(WAV_resampler *rs, WAV_resampler_q15 *rs_q, uint32_t in_cnt)
+{
+  uint32_t in_pos = 0, out_cnt = 0, used;
+  
+  srand(1);
+  rs ? rs->reset() : rs_q->reset();
+  while (in_pos < in_cnt)
+  {
+    uint32_t block = 1 + rand() % 300;
+    uint32_t room = 1 + rand() % 97;
+    if (block > in_cnt - in_pos) block = in_cnt - in_pos;
+
+    uint32_t cnt;
+    if (rs)
+    {
+      cnt = rs->process(&in_f[in_pos], block, &out_f[out_cnt], room, &used);
+      for (uint32_t i = 0; i < cnt; i++) out_d[out_cnt + i] = out_f[out_cnt + i];
+    }
+    else
+    {
+      cnt = rs_q->process(&in_q[in_pos], block, &out_q[out_cnt], room, &used);
+      for (uint32_t i = 0; i < cnt; i++) out_d[out_cnt + i] = out_q[out_cnt + i];
+    }
+    in_pos += used;
+    out_cnt += cnt;
+  }
+  return out_cnt;
+}
+
+/*
+ * Least squares fit of a sine at freq to out_d[start..end).
+ * Returns the amplitude, and the residual RMS in residual.
+ */
+static double fitSine(double freq, double rate, uint32_t start, uint32_t end, double *residual)
+{
+  double cc = 0, ss = 0, cs = 0, yc = 0, ys = 0;
+  for (uint32_t n = start; n < end; n++)
+  {
+    double c = cos(2 * M_PI * freq * n / rate);
+    double s = sin(2 * M_PI * freq * n / rate);
+    cc += c * c; ss += s * s; cs += c * s;
+    yc += out_d[n] * c; ys += out_d[n] * s;
+  }
+  double det = cc * ss - cs * cs;
+  double a = (yc * ss - ys * cs) / det;
+  double b = (ys * cc - yc * cs) / det;
+
+  double err = 0;
+  for (uint32_t n = start; n < end; n++)
+  {
+    double e = out_d[n] - a * cos(2 * M_PI * freq * n / rate) - b * sin(2 * M_PI * freq * n / rate);
+    err += e * e;
+  }
+  *residual = sqrt(err / (end - start));
+  return sqrt(a * a + b * b);
+}
+
+static bool testRates(uint32_t in_rate, uint32_t out_rate, bool q15)
+{
+  static WAV_resampler     rs;
+  static WAV_resampler_q15 rs_q;
+  const wav_resample_plan_t *plan;
+  uint32_t delay, settle;
+
+  if (q15)
+  {
+    rs_q.begin(in_rate, out_rate);
+    plan = rs_q.getPlan();
+    delay = rs_q.getDelay();
+  }
+  else
+  {
+    rs.begin(in_rate, out_rate);
+    plan = rs.getPlan();
+    delay = rs.getDelay();
+  }
+
+  settle = delay * out_rate / in_rate + 16;  // The filter has to fill before the output is a clean tone
+  uint32_t in_cnt = (uint32_t)(in_rate * TEST_SECONDS);
+  double low_rate = (in_rate < out_rate ? in_rate : out_rate);
+  double min_gain = 1e9, max_gain = -1e9, min_reject = 1e9, min_stop = 1e9;
+
+  // Passband tones, ripple and residual
+  for (int t = 1; t <= 16; t++)
+  {
+    double freq = low_rate * PASSBAND * t / 16.0;
+    for (uint32_t i = 0; i < in_cnt; i++)
+    {
+      double value = TONE_AMPLITUDE * sin(2 * M_PI * freq * i / in_rate);
+      in_f[i] = (float)value;
+      in_q[i] = (int16_t)lround(value);
+    }
+    uint32_t out_cnt = runBlocks(q15 ? NULL : &rs, q15 ? &rs_q : NULL, in_cnt);
+    double residual;
+    double amp = fitSine(freq, out_rate, settle, out_cnt, &residual);
+    double gain = 20 * log10(amp / TONE_AMPLITUDE);
+    double reject = 20 * log10(amp / M_SQRT2 / residual);
+
+    if (gain < min_gain) min_gain = gain;
+    if (gain > max_gain) max_gain = gain;
+    if (reject < min_reject) min_reject = reject;
+  }
+
+  // Stopband tones, everything in the output is an alias
+  for (int t = 0; t < 8 && out_rate < in_rate; t++)
+  {
+    double freq = out_rate * STOPBAND + (in_rate * 0.49 - out_rate * STOPBAND) * t / 7.0;
+    for (uint32_t i = 0; i < in_cnt; i++)
+    {
+      double value = TONE_AMPLITUDE * sin(2 * M_PI * freq * i / in_rate);
+      in_f[i] = (float)value;
+      in_q[i] = (int16_t)lround(value);
+    }
+    uint32_t out_cnt = runBlocks(q15 ? NULL : &rs, q15 ? &rs_q : NULL, in_cnt);
+    double sum = 0;
+    for (uint32_t n = settle; n < out_cnt; n++) sum += out_d[n] * out_d[n];
+    double rms = sqrt(sum / (out_cnt - delay - 16)) + 1e-9;
+    double reject = 20 * log10(TONE_AMPLITUDE / M_SQRT2 / rms);
+    if (reject < min_stop) min_stop = reject;
+  }
+  
+  double ripple = max_gain - min_gain;
+  double min_db = (q15 ? MIN_REJECT_Q15_DB : MIN_REJECT_DB);
+  bool ok = (ripple <= (q15 ? MAX_RIPPLE_Q15_DB : MAX_RIPPLE_DB) && fabs(max_gain) <= 0.1 &&
+             min_reject >= min_db && min_stop >= min_db);
+
+  printf("%5u -> %5u %-5s %3u/%-3u %5s %4u %9.3f %9.3f %8.1f ", (unsigned)in_rate, (unsigned)out_rate, q15 ? "Q15" : "float",
+         (unsigned)plan->up, (unsigned)plan->down, plan->exact ? "exact" : "interp", plan->taps, min_gain, ripple, min_reject);
+  if (out_rate < in_rate) printf("%8.1f ", min_stop);
+  else printf("%8s ", "-");
+  printf("%s\n", ok ? "OK" : "FAIL");
+  return ok;
+}
+
+int main()
+{
+  const uint32_t rates[][2] = { { 44100, 11025 }, { 44100, 22050 }, { 22050, 11025 }, { 11025, 44100 }, 
+                                { 22050, 44100 }, { 48000, 11025 }, { 11025, 8000 }, { 8000, 11025 } };
+  bool passed = true;
+
+  printf("%-14s %-5s %7s %5s %4s %9s %9s %8s %8s\n", "rates", "type", "L/M", "table", "taps", "gain dB", "ripple", "resid dB", "stop dB");
+  for (uint8_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++)
+  {
+    passed &= testRates(rates[i][0], rates[i][1], false);
+    passed &= testRates(rates[i][0], rates[i][1], true);
+  }
+  
+  printf("Memory: float %u bytes, Q15 %u bytes\n", (unsigned)sizeof(WAV_resampler), (unsigned)sizeof(WAV_resampler_q15));
+  printf(passed ? "PASSED\n" : "FAILED\n");
+  return passed ? 0 : 1;
+}
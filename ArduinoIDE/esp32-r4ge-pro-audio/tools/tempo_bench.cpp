@@ -0,0 +1,299 @@
+/*
+ * Host accuracy and cost benchmark of WAV_onset and WAV_tempo.
+ * Synthetic drum loops (kick, snare on 2 and 4, hats on the eighths, with a little
+ * timing and level variation over background noise) at tempos across the tracked
+ * range, and one that changes tempo halfway, are streamed through the tracker at
+ * 11025 Hz in capture sized blocks.  For each loop it reports:
+ *   onset F    detected onsets against the hits (within ONSET_TOLERANCE_MS)
+ *   onset ms   mean offset of the matched onsets, should be near 0
+ *   lock s     time until the tempo locked
+ *   BPM        last tempo estimate, and the error against the loop
+ *   conf       last tempo confidence
+ *   beat%      beats from BEAT_SKIP_SEC on that land within BEAT_TOLERANCE_MS of a quarter note
+ *   us/hop     processing time per WAV_ONSET_HOP samples, the budget is the hop length
+ * Hits at random intervals, with no tempo, must not lock for long.
+ * WAV files can be added as file / expected BPM pairs, their beats are not scored.
+ * Returns non-zero if the tracker misses its limits on the loops.
+ *
+ * Build and run from the sketch folder:
+ *   g++ -O2 -o tempo_bench tools/tempo_bench.cpp tools/wav_load_file.cpp WAV_tempo.cpp WAV_onset.cpp WAV_fft.cpp WAV_fft_q15.cpp && ./tempo_bench
+ *   ./tempo_bench SONG.WAV 124 ...
+ */
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "../WAV_tempo.h"
+#include "wav_load_file.h"
+
+#define SAMPLE_RATE         11025
+#define LOOP_SECONDS        20.0
+#define CHANGE_SECONDS      10.0   // When the changing loop switches tempo
+#define BLOCK               256    // Like WAV_CAPTURE_BLOCK
+#define ONSET_TOLERANCE_MS  35.0
+#define BEAT_TOLERANCE_MS   50.0
+#define BEAT_SKIP_SEC        6.0   // Beats before this, or this long after a tempo change, are not scored
+#define MAX_BPM_ERROR_PCT    2.0
+#define MIN_ONSET_F          0.90
+#define MIN_BEAT_PCT        85.0
+#define MAX_MISSES           0     // Loops allowed to miss the BPM or beat limits
+#define MAX_RANDOM_BEATS     8     // Beats allowed for the random hits
+
+typedef struct
+{
+  const char *name;
+  double   bpm;
+  double   bpm2;             // Tempo after CHANGE_SECONDS, 0 if steady
+  std::vector<double> hits;  // Seconds
+  std::vector<double> beats;
+} loop_t;
+
+typedef struct
+{
+  double   onset_f;
+  double   onset_ms;
+  double   lock_sec;
+  double   bpm;
+  double   confidence;
+  double   beat_pct;
+  double   us_per_hop;
+} result_t;
+
+static WAV_tempo tempo;
+
+static double noise()
+{
+  return rand() / (double)RAND_MAX * 2 - 1;
+}
+
+/*
+ * Adds a drum hit at t seconds.  type 0 kick, 1 snare, 2 closed hat
+ */
+static void addHit(std::vector<float> *mix, double t, int type, double level)
+{
+  uint32_t start = (uint32_t)(t * SAMPLE_RATE);
+  double   phase = 0, prev = 0;
+
+  for (uint32_t i = 0; i < SAMPLE_RATE / 4 && start + i < mix->size(); i++)
+  {
+    double s = (double)i / SAMPLE_RATE;
+    double value = 0;
+    if (type == 0)
+    {
+      phase += 2 * M_PI * (50 + 90 * exp(-s * 30)) / SAMPLE_RATE;
+      value = sin(phase) * exp(-s * 12);
+    }
+    else if (type == 1)
+    {
+      value = (0.6 * noise() + 0.4 * sin(2 * M_PI * 190 * s)) * exp(-s * 20);
+    }
+    else
+    {
+      double n = noise();
+      value = 0.5 * (n - prev) * exp(-s * 70);  // Differenced noise is mostly highs
+      prev = n;
+    }
+    (*mix)[start + i] += value * level;
+  }
+}
+
+/*
+ * Builds a loop with its hit and quarter note times.
+ */
+static void makeLoop(loop_t *loop, std::vector<int16_t> *samples, int seed)
+{
+  std::vector<float> mix((size_t)(LOOP_SECONDS * SAMPLE_RATE), 0);
+  srand(seed);
+
+  loop->hits.clear();
+  loop->beats.clear();
+  double t = 0.05;
+  uint32_t eighth = 0;
+  while (loop->bpm == 0 && t < LOOP_SECONDS - 0.3)
+  {
+    addHit(&mix, t, rand() % 3, 6000 * (1.0 + 0.3 * noise()));
+    loop->hits.push_back(t);
+    t += 0.08 + 0.5 * rand() / RAND_MAX;
+  }
+  while (loop->bpm > 0 && t < LOOP_SECONDS - 0.3)
+  {
+    double bpm = (loop->bpm2 > 0 && t >= CHANGE_SECONDS ? loop->bpm2 : loop->bpm);
+    double jitter = 0.004 * noise();  // Played, not programmed
+    double level = 1.0 + 0.15 * noise();
+    uint8_t step = eighth % 8;
+
+    if (step % 2 == 0) loop->beats.push_back(t);
+    if (step == 0 || step == 4 || step == 5) addHit(&mix, t + jitter, 0, 9000 * level);
+    if (step == 2 || step == 6) addHit(&mix, t + jitter, 1, 6000 * level);
+    addHit(&mix, t + jitter, 2, (step % 2 == 0 ? 2500 : 1500) * level);
+    loop->hits.push_back(t + jitter);
+
+    t += 30.0 / bpm;
+    eighth++;
+  }
+
+  samples->resize(mix.size());
+  for (size_t i = 0; i < mix.size(); i++)
+  {
+    double value = mix[i] + 60 * noise();
+    (*samples)[i] = (int16_t)(value > 32767 ? 32767 : (value < -32768 ? -32768 : value));
+  }
+}
+
+/*
+ * Streams the samples through the tracker and collects its events.
+ */
+static void runTracker(const std::vector<int16_t> &samples, std::vector<wav_tempo_event_t> *events, result_t *result)
+{
+  wav_tempo_event_t event;
+
+  tempo.begin(SAMPLE_RATE);
+  events->clear();
+  auto start = std::chrono::steady_clock::now();
+  for (size_t pos = 0; pos < samples.size(); pos += BLOCK)
+  {
+    size_t end = (pos + BLOCK < samples.size() ? pos + BLOCK : samples.size());
+    for (size_t i = pos; i < end; i++)
+    {
+      tempo.pushSample(samples[i]);
+    }
+    while (tempo.getEvent(&event))
+    {
+      events->push_back(event);
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  result->us_per_hop = seconds * 1e6 / (samples.size() / WAV_ONSET_HOP);
+  result->bpm = tempo.getBPM();
+  result->confidence = tempo.getConfidence();
+  result->lock_sec = -1;
+  for (size_t i = 0; i < events->size(); i++)
+  {
+    if ((*events)[i].type == WAV_TEMPO_LOCKED)
+    {
+      result->lock_sec = (double)(*events)[i].sample / SAMPLE_RATE;
+      break;
+    }
+  }
+}
+
+/*
+ * Distance in seconds from t to the nearest time in the sorted list.
+ */
+static double nearest(const std::vector<double> &times, double t)
+{
+  double best = 1e9;
+  for (size_t i = 0; i < times.size(); i++)
+  {
+    if (fabs(times[i] - t) < fabs(best)) best = times[i] - t;
+  }
+  return best;
+}
+
+static void scoreLoop(const loop_t &loop, const std::vector<wav_tempo_event_t> &events, result_t *result)
+{
+  uint32_t detected = 0, matched = 0, beats = 0, on_beat = 0;
+  double   offset_sum = 0;
+
+  for (size_t i = 0; i < events.size(); i++)
+  {
+    double t = (double)events[i].sample / SAMPLE_RATE;
+    if (events[i].type == WAV_TEMPO_ONSET)
+    {
+      detected++;
+      double error = -nearest(loop.hits, t);
+      if (fabs(error) * 1000 <= ONSET_TOLERANCE_MS)
+      {
+        matched++;
+        offset_sum += error;
+      }
+    }
+    if (events[i].type == WAV_TEMPO_BEAT && t >= BEAT_SKIP_SEC &&
+        (loop.bpm2 == 0 || t < CHANGE_SECONDS || t >= CHANGE_SECONDS + BEAT_SKIP_SEC))
+    {
+      beats++;
+      if (fabs(nearest(loop.beats, t)) * 1000 <= BEAT_TOLERANCE_MS) on_beat++;
+    }
+  }
+
+  double precision = (detected > 0 ? (double)matched / detected : 0);
+  double recall = (double)matched / loop.hits.size();
+  result->onset_f = (precision + recall > 0 ? 2 * precision * recall / (precision + recall) : 0);
+  result->onset_ms = (matched > 0 ? offset_sum * 1000 / matched : 0);
+  result->beat_pct = (beats > 0 ? 100.0 * on_beat / beats : 0);
+}
+
+int main(int argc, char *argv[])
+{
+  loop_t loops[] = { { "70 BPM", 70 }, { "85 BPM", 85 }, { "96 BPM", 96 }, { "110 BPM", 110 },
+                     { "120 BPM", 120 }, { "128 BPM", 128 }, { "140 BPM", 140 }, { "160 BPM", 160 },
+                     { "100-130 BPM", 100, 130 } };
+  std::vector<int16_t> samples;
+  std::vector<wav_tempo_event_t> events;
+  uint32_t misses = 0;
+  double   f_sum = 0, us_max = 0;
+  bool     passed = true;
+
+  printf("%-12s %8s %9s %7s %7s %7s %5s %6s %7s\n", "loop", "onset F", "onset ms", "lock s", "BPM", "error%", "conf", "beat%", "us/hop");
+  for (uint8_t i = 0; i < sizeof(loops) / sizeof(loops[0]); i++)
+  {
+    result_t result;
+    makeLoop(&loops[i], &samples, i + 1);
+    runTracker(samples, &events, &result);
+    scoreLoop(loops[i], events, &result);
+
+    double expected = (loops[i].bpm2 > 0 ? loops[i].bpm2 : loops[i].bpm);
+    double error = 100.0 * (result.bpm - expected) / expected;
+    printf("%-12s %8.3f %9.1f %7.1f %7.1f %7.1f %5.2f %6.1f %7.1f\n", loops[i].name, result.onset_f, result.onset_ms,
+           result.lock_sec, result.bpm, error, result.confidence, result.beat_pct, result.us_per_hop);
+
+    f_sum += result.onset_f;
+    if (result.us_per_hop > us_max) us_max = result.us_per_hop;
+    if (fabs(error) > MAX_BPM_ERROR_PCT || result.beat_pct < MIN_BEAT_PCT) misses++;
+  }
+
+  double f_mean = f_sum / (sizeof(loops) / sizeof(loops[0]));
+  printf("Mean onset F %.3f (min %.2f), %u of %u loops missed the BPM or beat limits (max %u)\n", f_mean, MIN_ONSET_F,
+         misses, (unsigned)(sizeof(loops) / sizeof(loops[0])), MAX_MISSES);
+  printf("Worst %.1f us per hop, the hop is %.0f us (%.2f%% of real time)\n", us_max, 1e6 * WAV_ONSET_HOP / SAMPLE_RATE,
+         100.0 * us_max * SAMPLE_RATE / (1e6 * WAV_ONSET_HOP));
+
+  // No tempo to find
+  loop_t random_loop = { "random", 0 };
+  result_t result;
+  uint32_t random_beats = 0;
+  makeLoop(&random_loop, &samples, 99);
+  runTracker(samples, &events, &result);
+  scoreLoop(random_loop, events, &result);
+  for (size_t i = 0; i < events.size(); i++)
+  {
+    if (events[i].type == WAV_TEMPO_BEAT) random_beats++;
+  }
+  printf("Random hits: onset F %.3f, conf %.2f, %u beats (max %u)\n", result.onset_f, result.confidence, random_beats,
+         MAX_RANDOM_BEATS);
+  f_mean = (f_sum + result.onset_f) / (sizeof(loops) / sizeof(loops[0]) + 1);
+  
+  passed = (f_mean >= MIN_ONSET_F && misses <= MAX_MISSES && random_beats <= MAX_RANDOM_BEATS);
+
+  for (int i = 1; i + 1 < argc; i += 2)
+  {
+    result_t result;
+    uint32_t rate = 0;
+
+    if (!wavLoadFile(argv[i], &samples, &rate) || rate != SAMPLE_RATE)
+    {
+      fprintf(stderr, "Unable to read %s, must be PCM WAV at %d Hz\n", argv[i], SAMPLE_RATE);
+      continue;
+    }
+    runTracker(samples, &events, &result);
+    double expected = atof(argv[i + 1]);
+    printf("%-12s lock %.1f s, %.1f BPM, error %.1f%%, %u events\n", argv[i], result.lock_sec, result.bpm,
+           100.0 * (result.bpm - expected) / expected, (unsigned)events.size());
+  }
+
+  printf(passed ? "PASSED\n" : "FAILED\n");
+  return passed ? 0 : 1;
+}
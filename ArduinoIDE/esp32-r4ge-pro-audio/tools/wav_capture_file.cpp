@@ -0,0 +1,163 @@
+#include <string.h>
+#include <chrono>
+#include "wav_capture_file.h"
+
+WAV_capture_file::WAV_capture_file()
+{
+  _running = false;
+}
+
+WAV_capture_file::~WAV_capture_file()
+{
+  end();
+  if (_file != NULL) fclose(_file);
+}
+
+/*
+ * Opens a PCM WAV file and finds its sample data.
+ * Returns true on success, false on failure.
+ */
+bool WAV_capture_file::open(const char *filename)
+{
+  uint8_t  hdr[12], fmt[16];
+  uint32_t chunk_len;
+  bool     fmt_found = false;
+
+  end();
+  if (_file != NULL) fclose(_file);
+  
+  _file = fopen(filename, "rb");
+  if (_file == NULL) return false;
+
+  if (fread(hdr, 1, 12, _file) != 12 || memcmp(hdr, "RIFF", 4) != 0 || memcmp(hdr + 8, "WAVE", 4) != 0) return false;
+
+  while (fread(hdr, 1, 8, _file) == 8)
+  {
+    chunk_len = hdr[4] | (hdr[5] << 8) | (hdr[6] << 16) | ((uint32_t)hdr[7] << 24);
+
+    if (memcmp(hdr, "fmt ", 4) == 0 && chunk_len >= 16)
+    {
+      if (fread(fmt, 1, 16, _file) != 16) return false;
+      if ((fmt[0] | (fmt[1] << 8)) != 1) return false;  // PCM only
+      _channels    = fmt[2] | (fmt[3] << 8);
+      _sample_rate = fmt[4] | (fmt[5] << 8) | (fmt[6] << 16) | ((uint32_t)fmt[7] << 24);
+      _bits        = fmt[14] | (fmt[15] << 8);
+      fmt_found = true;
+      fseek(_file, chunk_len - 16 + (chunk_len & 1), SEEK_CUR);
+    }
+    else if (memcmp(hdr, "data", 4) == 0)
+    {
+      if (!fmt_found || _channels == 0 || (_bits != 8 && _bits != 16) || _sample_rate == 0) return false;
+      _data_pos = ftell(_file);
+      _sample_total = chunk_len / (_channels * (_bits / 8));
+      _sample_pos = 0;
+      return _sample_total > 0;
+    }
+    else
+    {
+      fseek(_file, chunk_len + (chunk_len & 1), SEEK_CUR);
+    }
+  }
+  return false;
+}
+
+/*
+ * Starts the replay thread.  If repeat is true the file loops until end() is called.
+ */
+bool WAV_capture_file::begin(WAV_capture *capture, bool repeat)
+{
+  if (_file == NULL || _running) return false;
+
+  _capture = capture;
+  _repeat = repeat;
+  _capture->reset();
+  _capture->setSampleRate(_sample_rate);
+  
+  fseek(_file, _data_pos, SEEK_SET);
+  _sample_pos = 0;
+  _running = true;
+  _thread = std::thread(&WAV_capture_file::replay, this);
+  return true;
+}
+
+/*
+ * Stops the replay thread.
+ */
+void WAV_capture_file::end()
+{
+  _running = false;
+  if (_thread.joinable()) _thread.join();
+}
+
+/*
+ * Returns false once the file has finished playing (when not repeating) or end() is called.
+ */
+bool WAV_capture_file::getRunning()
+{
+  return _running;
+}
+
+uint32_t WAV_capture_file::getSampleRate()
+{
+  return _sample_rate;
+}
+
+uint32_t WAV_capture_file::getSampleTotal()
+{
+  return _sample_total;
+}
+
+void WAV_capture_file::replay()
+{
+  auto     start = std::chrono::steady_clock::now();
+  uint64_t block_cnt = 0;
+
+  while (_running)
+  {
+    int16_t *block = _capture->getWriteBlock();
+    if (!readBlock(block))
+    {
+      _running = false;
+      break;
+    }
+    
+    // Wait until the last sample of this block would have been captured, and stamp it with that time
+    block_cnt++;
+    uint64_t time_us = block_cnt * WAV_CAPTURE_BLOCK * 1000000ULL / _sample_rate;
+    std::this_thread::sleep_until(start + std::chrono::microseconds(time_us));
+    _capture->commitBlock((uint32_t)time_us);
+  }
+}
+
+/*
+ * Reads WAV_CAPTURE_BLOCK samples, converted to signed 16-bit.  A partial block at
+ * the end of the file is padded with silence.  Returns false at the end of the file.
+ */
+bool WAV_capture_file::readBlock(int16_t *block)
+{
+  uint8_t  frame[16];
+  uint16_t frame_bytes = _channels * (_bits / 8);
+  uint16_t i = 0;
+
+  if (frame_bytes > sizeof(frame)) return false;
+  
+  while (i < WAV_CAPTURE_BLOCK)
+  {
+    if (_sample_pos >= _sample_total)
+    {
+      if (!_repeat || i > 0) break;
+      fseek(_file, _data_pos, SEEK_SET);
+      _sample_pos = 0;
+    }
+    if (fread(frame, 1, frame_bytes, _file) != frame_bytes) break;
+    _sample_pos++;
+
+    // 8-bit WAV is unsigned, 16-bit is signed
+    block[i++] = (_bits == 8 ? (int16_t)((frame[0] - 128) << 8) : (int16_t)(frame[0] | (frame[1] << 8)));
+  }
+
+  if (i == 0) return false;
+  
+  while (i < WAV_CAPTURE_BLOCK) block[i++] = 0;
+  return true;
+}
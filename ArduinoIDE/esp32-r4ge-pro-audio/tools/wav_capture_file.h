@@ -0,0 +1,44 @@
+#ifndef _WAV_CAPTURE_FILE_
+#define _WAV_CAPTURE_FILE_
+
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+#include "../WAV_capture.h"
+
+/*
+ * Host replacement for WAV_capture_i2s.  Replays a PCM WAV file into a WAV_capture 
+ * ring from a thread at real-time pace, committing each block when its last sample
+ * would have been captured, so code that polls WAV_capture sees the badge timing.
+ * 8 or 16-bit PCM.  Only the first channel is used.
+ */
+class WAV_capture_file
+{
+  public:
+    WAV_capture_file();
+    ~WAV_capture_file();
+    bool     open(const char *filename);
+    bool     begin(WAV_capture *capture, bool repeat);
+    void     end();
+    bool     getRunning();
+    uint32_t getSampleRate();
+    uint32_t getSampleTotal();
+
+  private:
+    void     replay();
+    bool     readBlock(int16_t *block);
+
+    FILE        *_file = NULL;
+    WAV_capture *_capture = NULL;
+    std::thread  _thread;
+    std::atomic<bool> _running;
+    bool         _repeat = false;
+    uint16_t     _channels = 1;
+    uint16_t     _bits = 16;
+    uint32_t     _sample_rate = 11025;
+    uint32_t     _data_pos = 0;    // File offset of the first sample
+    uint32_t     _sample_total = 0;
+    uint32_t     _sample_pos = 0;
+};
+
+#endif // _WAV_CAPTURE_FILE_
@@ -0,0 +1,43 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "wav_feature_map.h"
+
+bool wavFeatureMap(const char *filename, wav_feature_map_t *map)
+{
+  struct stat st;
+  
+  memset(map, 0, sizeof(*map));
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) return false;
+
+  if (fstat(fd, &st) != 0 || st.st_size < WAV_FEAT_HEADER_SIZE || st.st_size > UINT32_MAX)
+  {
+    close(fd);
+    return false;
+  }
+
+  void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);  // The mapping keeps the file open
+  if (data == MAP_FAILED) return false;
+
+  map->map = data;
+  map->map_bytes = st.st_size;
+  map->header = (const wav_feature_header_t *)data;
+  map->records = (const uint8_t *)data + WAV_FEAT_HEADER_SIZE;
+
+  if (!wavFeatureCheck(map->header, (uint32_t)st.st_size, &map->frame_cnt))
+  {
+    wavFeatureUnmap(map);
+    return false;
+  }
+  madvise(data, st.st_size, MADV_SEQUENTIAL);
+  return true;
+}
+
+void wavFeatureUnmap(wav_feature_map_t *map)
+{
+  if (map->map != NULL) munmap(map->map, map->map_bytes);
+  memset(map, 0, sizeof(*map));
+}
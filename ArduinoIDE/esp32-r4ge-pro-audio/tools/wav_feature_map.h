@@ -0,0 +1,44 @@
+#ifndef _WAV_FEATURE_MAP_
+#define _WAV_FEATURE_MAP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "../WAV_feature_format.h"
+
+typedef struct
+{
+  const wav_feature_header_t *header;
+  const uint8_t *records;    // Frame 0, each frame is header->record_bytes
+  uint32_t frame_cnt;        // Complete frame records
+  void    *map;
+  size_t   map_bytes;
+} wav_feature_map_t;
+
+/*
+ * Host reader for the binary feature files written by WAV_features.  The file is 
+ * memory mapped read only, so frames are read straight from the page cache 
+ * with no parsing or copying, and opening is the same cost for any length.
+ * Returns false if the file is missing or not a feature file.
+ */
+bool wavFeatureMap(const char *filename, wav_feature_map_t *map);
+void wavFeatureUnmap(wav_feature_map_t *map);
+
+/*
+ * Returns one coefficient of a frame as a float, scaling WAV_FEAT_INT16 values.
+ */
+inline float wavFeatureValue(const wav_feature_map_t *map, uint32_t frame, uint16_t coef)
+{
+  const uint8_t *record = map->records + (size_t)frame * map->header->record_bytes;
+
+  if (map->header->dtype == WAV_FEAT_INT16)
+  {
+    int16_t value;
+    memcpy(&value, record + coef * 2, 2);
+    return value * map->header->scale;
+  }
+  float value;
+  memcpy(&value, record + coef * 4, 4);
+  return value;
+}
+
+#endif // _WAV_FEATURE_MAP_
@@ -0,0 +1,65 @@
+#include <stdio.h>
+#include <string.h>
+#include "wav_load_file.h"
+
+bool wavLoadFile(const char *filename, std::vector<int16_t> *samples, uint32_t *sample_rate)
+{
+  uint8_t  hdr[12], fmt[16];
+  uint16_t channels = 0, bits = 0;
+  bool     loaded = false;
+  FILE    *in = fopen(filename, "rb");
+
+  samples->clear();
+  if (in == NULL) return false;
+  
+  if (fread(hdr, 1, 12, in) != 12 || memcmp(hdr, "RIFF", 4) != 0 || memcmp(hdr + 8, "WAVE", 4) != 0)
+  {
+    fclose(in);
+    return false;
+  }
+
+  while (!loaded && fread(hdr, 1, 8, in) == 8)
+  {
+    uint32_t chunk_len = hdr[4] | (hdr[5] << 8) | (hdr[6] << 16) | ((uint32_t)hdr[7] << 24);
+    
+    if (memcmp(hdr, "fmt ", 4) == 0 && chunk_len >= 16)
+    {
+      if (fread(fmt, 1, 16, in) != 16 || (fmt[0] | (fmt[1] << 8)) != 1) break;  // PCM only
+      channels     = fmt[2] | (fmt[3] << 8);
+      *sample_rate = fmt[4] | (fmt[5] << 8) | (fmt[6] << 16) | ((uint32_t)fmt[7] << 24);
+      bits         = fmt[14] | (fmt[15] << 8);
+      fseek(in, chunk_len - 16 + (chunk_len & 1), SEEK_CUR);
+    }
+    else if (memcmp(hdr, "data", 4) == 0)
+    {
+      if (channels < 1 || channels > 2 || (bits != 8 && bits != 16)) break;
+      
+      // Read the whole chunk at once, a truncated recording just has fewer frames
+      uint32_t frame_bytes = channels * bits / 8;
+      std::vector<uint8_t> data(chunk_len);
+      uint32_t frame_cnt = fread(data.data(), 1, chunk_len, in) / frame_bytes;
+      
+      samples->resize(frame_cnt);
+      for (uint32_t i = 0; i < frame_cnt; i++)
+      {
+        const uint8_t *frame = &data[i * frame_bytes];
+        int32_t sum = 0;
+        for (uint16_t c = 0; c < channels; c++)
+        {
+          // 8-bit WAV is unsigned, 16-bit is signed
+          const uint8_t *src = frame + c * (bits / 8);
+          sum += (bits == 8 ? (int16_t)((src[0] - 128) << 8) : (int16_t)(src[0] | (src[1] << 8)));
+        }
+        (*samples)[i] = (int16_t)(sum / channels);
+      }
+      loaded = true;
+    }
+    else
+    {
+      fseek(in, chunk_len + (chunk_len & 1), SEEK_CUR);
+    }
+  }
+  
+  fclose(in);
+  return loaded;
+}
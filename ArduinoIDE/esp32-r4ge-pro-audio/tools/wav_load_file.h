@@ -0,0 +1,14 @@
+#ifndef _WAV_LOAD_FILE_
+#define _WAV_LOAD_FILE_
+
+#include <stdint.h>
+#include <vector>
+
+/*
+ * Host WAV loader for the tools.  Reads a whole 8 or 16-bit PCM file, walking the 
+ * RIFF chunks like WAV_reader, and averages stereo to mono like readMono().
+ * Returns false if the file is missing or not a usable PCM WAV.
+ */
+bool wavLoadFile(const char *filename, std::vector<int16_t> *samples, uint32_t *sample_rate);
+
+#endif // _WAV_LOAD_FILE_
@@ -22,6 +22,7 @@ There is no warranty; not even for merchantability or fitness for a particular p
 #include <BLEUtils.h>
 #include <BLEServer.h>
 #include <BLE2902.h>
+#include <TLM_channel.h>
 
 #define BLE_DEVICE_ID   "Cmdr1"  // Adjust as desired, but keep short
 
@@ -130,21 +131,17 @@ class MyClientCallbacks: public BLEClientCallbacks
  */
 static void notifyCallback(BLERemoteCharacteristic* pBLERemoteCharacteristic, uint8_t* pData, size_t length, bool isNotify) 
 {
-    Serial.print("Notify callback for characteristic ");
-    Serial.print(pBLERemoteCharacteristic->getUUID().toString().c_str());
-    Serial.print(" of data length ");
-    Serial.println(length);
-    Serial.print("data: ");
-    Serial.println((char*)pData);
-    
     if (length != PACKET_SIZE)
+    {
+      TLM_WARN("BLE", "Notify with %u bytes, expected %u", length, PACKET_SIZE);
       return;
+    }
     
     for (int i = 0; i < length; i++)
     {
         data_packet[i] = pData[i];
-        Serial.println(data_packet[i]);
     }
+    TLM_DEBUG("BLE", "Notify data: %u %u %u %u", data_packet[0], data_packet[1], data_packet[2], data_packet[3]);
     data_received = true;
 }
 
@@ -271,6 +268,7 @@ bool pairBlePeripheral()
 void setup() 
 {
   Serial.begin(115200);
+  tlm_channel.begin(&Serial);
   Serial.println("ESP32 Tank Commander"); 
   delay(100);
   
@@ -0,0 +1,136 @@
+#include "DRM_i2s.h"
+
+DRM_i2s::DRM_i2s()
+{
+
+}
+
+/**
+ * @brief Installs the I2S driver at DRM_SAMPLE_RATE and starts the output task,
+ *        which calls render for every DRM_BLOCK_FRAMES.
+ *
+ * @return true on success, false on failure
+ */
+bool DRM_i2s::begin(DRM_render_callback render, void *param, int bclk_pin, int lrck_pin, int dout_pin)
+{
+    esp_err_t err;
+
+    if (_running) return true;
+    _render = render;
+    _render_param = param;
+
+    // See https://github.com/espressif/arduino-esp32/blob/master/tools/sdk/include/driver/driver/i2s.h
+    i2s_config_t i2s_config = {
+        .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX),
+        .sample_rate = DRM_SAMPLE_RATE,
+        .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
+        .channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT,
+        .communication_format = (i2s_comm_format_t)(I2S_COMM_FORMAT_I2S | I2S_COMM_FORMAT_I2S_MSB),
+        .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
+        .dma_buf_count = DRM_I2S_DMA_BUFF_CNT,
+        .dma_buf_len = DRM_I2S_DMA_BUFF_LEN,
+        .use_apll = true,         // Accurate sample clock
+        .tx_desc_auto_clear = true,  // Silence rather than a repeated buffer if the task is ever late
+        .fixed_mclk = 0
+    };
+
+    i2s_pin_config_t pin_config = {
+        .bck_io_num = bclk_pin,
+        .ws_io_num = lrck_pin,
+        .data_out_num = dout_pin,
+        .data_in_num = -1         // Not used
+    };
+
+    err = i2s_driver_install(DRM_I2S_PORT, &i2s_config, 0, NULL);
+    if (err != ESP_OK)
+    {
+        Serial.print(F("I2S driver install fail: "));
+        Serial.println(err);
+        return false;
+    }
+    i2s_set_pin(DRM_I2S_PORT, &pin_config);
+    i2s_set_clk(DRM_I2S_PORT, DRM_SAMPLE_RATE, I2S_BITS_PER_SAMPLE_16BIT, I2S_CHANNEL_STEREO);
+    _running = true;
+
+    if (_task == NULL)
+    {
+        if (xTaskCreatePinnedToCore(outputTask, "drumout", DRM_I2S_TASK_STACK, this, DRM_I2S_TASK_PRIORITY, &_task, DRM_I2S_TASK_CORE) != pdPASS)
+        {
+            Serial.println(F("Unable to start audio output task!"));
+            _task = NULL;
+            end();
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Stops the output and uninstalls the driver.  The task is kept for the next begin().
+ */
+void DRM_i2s::end()
+{
+    if (!_running) return;
+
+    _running = false;
+    while (_busy) delay(1);  // Let the task finish its current block
+
+    i2s_driver_uninstall(DRM_I2S_PORT);
+}
+
+bool DRM_i2s::getRunning()
+{
+    return _running;
+}
+
+/**
+ * @brief Slowest block render so far.  Must stay well under the block time (~5.8 msec).
+ */
+uint32_t DRM_i2s::getMaxRenderUs()
+{
+    return _max_render_us;
+}
+
+uint32_t DRM_i2s::getWriteTimeouts()
+{
+    return _timeouts;
+}
+
+// ------ PRIVATE METHODS ------//
+
+void DRM_i2s::outputTask(void *param)
+{
+    DRM_i2s *output = (DRM_i2s *)param;
+
+    while (true)
+    {
+        output->_busy = true;
+        if (output->_running)
+        {
+            output->writeBlock();
+            output->_busy = false;
+        }
+        else
+        {
+            output->_busy = false;
+            vTaskDelay(10 / portTICK_PERIOD_MS);
+        }
+    }
+}
+
+/*
+ * Renders one block and waits for room for it in the DMA buffers.
+ */
+void DRM_i2s::writeBlock()
+{
+    size_t   bytes_out = 0;
+    uint32_t start_us = micros();
+
+    _render(_block, DRM_BLOCK_FRAMES, _render_param);
+
+    uint32_t elapsed_us = micros() - start_us;
+    if (elapsed_us > _max_render_us) _max_render_us = elapsed_us;
+
+    i2s_write(DRM_I2S_PORT, (const char *)_block, sizeof(_block), &bytes_out, 100 / portTICK_PERIOD_MS);
+    if (bytes_out != sizeof(_block)) _timeouts++;
+}
@@ -0,0 +1,58 @@
+/**
+ * @file DRM_i2s.h
+ * @author Paul Pagel (https://twobittinker.com)
+ * @brief  Persistent I2S output for the drum mixer.
+ *         The driver is installed once, and a task on core 0 renders a block with
+ *         the render callback, e.g. the sequencer driving the mixer, and writes it
+ *         to the DMA buffers, over and over.  The blocking write paces the task to the
+ *         sample clock, so rendering always runs one block ahead of the speaker and
+ *         loop() never touches I2S.
+ * @version 0.1
+ * @date 2020-09-12
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#ifndef _DRM_I2S_
+#define _DRM_I2S_
+
+#include <Arduino.h>
+#include "driver/i2s.h"
+#include "DRM_mixer.h"
+
+#define DRM_I2S_PORT          I2S_NUM_0
+#define DRM_I2S_DMA_BUFF_CNT          4
+#define DRM_I2S_DMA_BUFF_LEN   DRM_BLOCK_FRAMES  // Output latency is about DMA_BUFF_CNT blocks (~23 msec)
+#define DRM_I2S_TASK_STACK         2048
+#define DRM_I2S_TASK_CORE             0  // Arduino loop() runs on core 1
+#define DRM_I2S_TASK_PRIORITY         3  // Above the loop() task, so drawing cannot starve the audio
+
+// Fills out with frames * 2 samples of right then left, e.g. DRM_sequencer::renderCallback
+typedef void (*DRM_render_callback)(int16_t *out, uint16_t frames, void *param);
+
+class DRM_i2s
+{
+  public:
+    DRM_i2s();
+    bool     begin(DRM_render_callback render, void *param, int bclk_pin, int lrck_pin, int dout_pin);
+    void     end();
+    bool     getRunning();
+    uint32_t getMaxRenderUs();
+    uint32_t getWriteTimeouts();
+
+  private:
+    static void outputTask(void *param);
+    void     writeBlock();
+
+    DRM_render_callback _render = NULL;
+    void        *_render_param = NULL;
+    int16_t      _block[DRM_BLOCK_FRAMES * 2];
+    TaskHandle_t _task = NULL;
+    volatile bool _running = false;
+    volatile bool _busy = false;         // Task is rendering or writing
+    uint32_t     _max_render_us = 0;
+    uint32_t     _timeouts = 0;
+};
+
+#endif // _DRM_I2S_
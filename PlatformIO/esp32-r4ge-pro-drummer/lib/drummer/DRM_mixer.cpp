@@ -0,0 +1,344 @@
+#include <math.h>
+#include <string.h>
+#include "DRM_mixer.h"
+
+DRM_mixer::DRM_mixer()
+{
+    reset();
+}
+
+/**
+ * @brief Finds the 16-bit mono PCM data of a WAV file held in memory, walking the RIFF chunks.
+ *
+ * @param wav     Whole WAV file, e.g. Kit01_kick_wav
+ * @param length  Bytes in wav
+ * @param sample  Set to the sample data and frame count
+ * @return true   The file is 16-bit mono PCM
+ */
+bool DRM_mixer::loadWav(const uint8_t *wav, uint32_t length, DRM_sample_t *sample)
+{
+    uint32_t pos = 12;
+    bool     fmt_ok = false;
+
+    sample->data = NULL;
+    sample->frames = 0;
+    if (length < 12 || memcmp(wav, "RIFF", 4) != 0 || memcmp(wav + 8, "WAVE", 4) != 0) return false;
+
+    while (pos + 8 <= length)
+    {
+        uint32_t size = wav[pos + 4] | (wav[pos + 5] << 8) | (wav[pos + 6] << 16) | ((uint32_t)wav[pos + 7] << 24);
+        const uint8_t *body = wav + pos + 8;
+
+        if (memcmp(wav + pos, "fmt ", 4) == 0 && size >= 16)
+        {
+            uint16_t format   = body[0] | (body[1] << 8);
+            uint16_t channels = body[2] | (body[3] << 8);
+            uint16_t bits     = body[14] | (body[15] << 8);
+            fmt_ok = (format == 1 && channels == 1 && bits == 16);
+        }
+        else if (memcmp(wav + pos, "data", 4) == 0)
+        {
+            if (size > length - pos - 8) size = length - pos - 8;  // Cut short
+            sample->data = body;
+            sample->frames = size / 2;
+            return fmt_ok;
+        }
+        pos += 8 + size + (size & 1);
+    }
+    return false;
+}
+
+/**
+ * @brief Silences every voice at once and clears the queue and stats.
+ *        Only call when render() is not running, e.g. before the output starts.
+ */
+void DRM_mixer::reset()
+{
+    for (uint8_t i = 0; i < DRM_VOICE_SLOTS; i++)
+    {
+        _free[i] = DRM_VOICE_SLOTS - 1 - i;
+        _voice[i].fading = false;
+    }
+    _free_cnt = DRM_VOICE_SLOTS;
+    _active_cnt = 0;
+    for (uint8_t g = 0; g < DRM_CHOKE_GROUPS; g++)
+    {
+        _choke_voice[g] = DRM_VOICE_SLOTS;
+    }
+    _queue_read = _queue_write;
+    _stop_all = false;
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+/**
+ * @brief Queues a hit for the start of the next rendered block.  Safe to call
+ *        from another task than render(), but only from one.
+ *
+ * @param sample       Sample from loadWav()
+ * @param gain         0.0 to 1.0
+ * @param pan          -1.0 (left) to 1.0 (right), constant power
+ * @param choke_group  Voices with the same group cut each other off, DRM_NO_CHOKE for none
+ * @return true        The hit was queued
+ */
+bool DRM_mixer::start(const DRM_sample_t *sample, float gain, float pan, uint8_t choke_group)
+{
+    if (_queue_write - _queue_read >= DRM_QUEUE_LEN)
+    {
+        _stats.dropped++;
+        return false;
+    }
+    if (!makeHit(sample, gain, pan, choke_group, &_queue[_queue_write & (DRM_QUEUE_LEN - 1)])) return false;
+
+    _queue_write++;
+    return true;
+}
+
+/**
+ * @brief Starts a hit now, so it sounds from the first frame of the next render() call.
+ *        Only call from the task that calls render(), e.g. between two render() calls
+ *        that split a block.  Other tasks use start().
+ *
+ * @return true        The hit started
+ */
+bool DRM_mixer::play(const DRM_sample_t *sample, float gain, float pan, uint8_t choke_group)
+{
+    DRM_hit_t hit;
+
+    if (!makeHit(sample, gain, pan, choke_group, &hit)) return false;
+
+    startHit(&hit);
+    return true;
+}
+
+/**
+ * @brief Fades out every voice at the start of the next block.
+ */
+void DRM_mixer::stopAll()
+{
+    _stop_all = true;
+}
+
+/**
+ * @brief Sets the gain applied to the mix before it is saturated, 0.0 to 2.0.
+ */
+void DRM_mixer::setMasterGain(float gain)
+{
+    gain = (gain < 0 ? 0 : (gain > 2 ? 2 : gain));
+    _master = (int32_t)lrintf(gain * 32768);
+}
+
+/**
+ * @brief Mixes the next frames of every voice into out, as 16-bit frames of right
+ *        then left like I2S_CHANNEL_FMT_RIGHT_LEFT.  Queued hits start first.
+ *
+ * @param out     frames * 2 samples
+ * @param frames  Any count, mixed DRM_BLOCK_FRAMES at a time
+ */
+void DRM_mixer::render(int16_t *out, uint16_t frames)
+{
+    while (frames > 0)
+    {
+        uint16_t count = (frames < DRM_BLOCK_FRAMES ? frames : DRM_BLOCK_FRAMES);
+
+        if (_stop_all)
+        {
+            _stop_all = false;
+            for (uint8_t k = 0; k < _active_cnt; k++)
+            {
+                fadeVoice(_active[k]);
+            }
+        }
+        while (_queue_read != _queue_write)
+        {
+            startHit(&_queue[_queue_read & (DRM_QUEUE_LEN - 1)]);
+            _queue_read++;
+        }
+
+        memset(_mix, 0, sizeof(int32_t) * count * 2);
+        uint8_t k = 0;
+        while (k < _active_cnt)
+        {
+            if (mixVoice(_active[k], count))
+            {
+                k++;
+                continue;
+            }
+            // Finished, back on the free list
+            _free[_free_cnt++] = _active[k];
+            memmove(&_active[k], &_active[k + 1], _active_cnt - k - 1);
+            _active_cnt--;
+        }
+
+        for (uint16_t i = 0; i < count * 2; i++)
+        {
+            int32_t value = (int32_t)(((int64_t)_mix[i] * _master + (1 << (DRM_MIX_SHIFT - 1))) >> DRM_MIX_SHIFT);
+            if (value > 32767)
+            {
+                value = 32767;
+                _stats.clips++;
+            }
+            else if (value < -32768)
+            {
+                value = -32768;
+                _stats.clips++;
+            }
+            out[i] = (int16_t)value;
+        }
+
+        _stats.blocks++;
+        out += count * 2;
+        frames -= count;
+    }
+}
+
+/**
+ * @brief Voices sounding or fading at the end of the last block.
+ */
+uint8_t DRM_mixer::getActiveCount()
+{
+    return _active_cnt;
+}
+
+void DRM_mixer::getStats(DRM_mixer_stats_t *stats)
+{
+    *stats = _stats;
+}
+
+// ------ PRIVATE METHODS ------//
+
+/*
+ * Fills in a hit with its pan and gain in Q15.  Returns false for an empty sample.
+ */
+bool DRM_mixer::makeHit(const DRM_sample_t *sample, float gain, float pan, uint8_t choke_group, DRM_hit_t *hit)
+{
+    if (sample == NULL || sample->frames == 0) return false;
+
+    gain = (gain < 0 ? 0 : (gain > 1 ? 1 : gain));
+    pan = (pan < -1 ? -1 : (pan > 1 ? 1 : pan));
+    float angle = (pan + 1) * (float)M_PI / 4;
+
+    hit->sample = sample;
+    hit->gain_l = (int32_t)lrintf(gain * cosf(angle) * 32768);
+    hit->gain_r = (int32_t)lrintf(gain * sinf(angle) * 32768);
+    hit->choke_group = (choke_group < DRM_CHOKE_GROUPS ? choke_group : DRM_NO_CHOKE);
+    return true;
+}
+
+/*
+ * Takes a voice from the free list and starts the hit on it.  If DRM_MAX_VOICES are
+ * already sounding the oldest starts fading, and the previous voice of the hit's choke
+ * group does too.  Only when every slot is fading is one cut off, the nearest the end
+ * of its fade.
+ */
+void DRM_mixer::startHit(const DRM_hit_t *hit)
+{
+    uint8_t v, sounding = 0, oldest = 0;
+
+    for (uint8_t k = _active_cnt; k > 0; k--)
+    {
+        if (!_voice[_active[k - 1]].fading)
+        {
+            oldest = _active[k - 1];
+            sounding++;
+        }
+    }
+    if (sounding >= DRM_MAX_VOICES)
+    {
+        fadeVoice(oldest);
+        _stats.steals++;
+    }
+
+    if (_free_cnt > 0)
+    {
+        v = _free[--_free_cnt];
+    }
+    else
+    {
+        uint8_t cut = 0;
+        for (uint8_t k = 1; k < _active_cnt; k++)
+        {
+            if (_voice[_active[k]].fade < _voice[_active[cut]].fade) cut = k;
+        }
+        v = _active[cut];
+        memmove(&_active[cut], &_active[cut + 1], _active_cnt - cut - 1);
+        _active_cnt--;
+        _stats.cuts++;
+    }
+
+    if (hit->choke_group != DRM_NO_CHOKE)
+    {
+        uint8_t prev = _choke_voice[hit->choke_group];
+        if (prev < DRM_VOICE_SLOTS && prev != v && _voice[prev].choke_group == hit->choke_group && !_voice[prev].fading)
+        {
+            fadeVoice(prev);
+            _stats.chokes++;
+        }
+        _choke_voice[hit->choke_group] = v;
+    }
+
+    DRM_voice_t *voice = &_voice[v];
+    voice->data = hit->sample->data;
+    voice->frames = hit->sample->frames;
+    voice->pos = 0;
+    voice->gain_l = hit->gain_l;
+    voice->gain_r = hit->gain_r;
+    voice->choke_group = hit->choke_group;
+    voice->fading = false;
+    voice->fade = 0;
+    _active[_active_cnt++] = v;
+    _stats.hits++;
+}
+
+/*
+ * Starts a voice's fade out.  It is freed by render() when the fade ends.
+ */
+void DRM_mixer::fadeVoice(uint8_t v)
+{
+    if (_voice[v].fading) return;
+    _voice[v].fading = true;
+    _voice[v].fade = DRM_FADE_FRAMES;
+}
+
+/*
+ * Adds the next frames of a voice to _mix.
+ * Returns false when the voice has finished, or finished fading.
+ */
+bool DRM_mixer::mixVoice(uint8_t v, uint16_t frames)
+{
+    DRM_voice_t *voice = &_voice[v];
+    uint32_t remain = voice->frames - voice->pos;
+    uint16_t count = (frames < remain ? frames : remain);
+    const uint8_t *src = voice->data + voice->pos * 2;
+    int32_t *dest = _mix;
+    int32_t  gain_l = voice->gain_l;
+    int32_t  gain_r = voice->gain_r;
+
+    if (!voice->fading)
+    {
+        for (uint16_t i = 0; i < count; i++)
+        {
+            int32_t s = (int16_t)(src[0] | (src[1] << 8));
+            dest[0] += (s * gain_r) >> DRM_MIX_FRAC;
+            dest[1] += (s * gain_l) >> DRM_MIX_FRAC;
+            src += 2;
+            dest += 2;
+        }
+    }
+    else
+    {
+        if (count > voice->fade) count = voice->fade;
+        for (uint16_t i = 0; i < count; i++)
+        {
+            int32_t s = (int16_t)(src[0] | (src[1] << 8)) * (int32_t)(voice->fade - i) / DRM_FADE_FRAMES;
+            dest[0] += (s * gain_r) >> DRM_MIX_FRAC;
+            dest[1] += (s * gain_l) >> DRM_MIX_FRAC;
+            src += 2;
+            dest += 2;
+        }
+        voice->fade -= count;
+        if (voice->fade == 0) return false;
+    }
+
+    voice->pos += count;
+    return voice->pos < voice->frames;
+}
@@ -0,0 +1,114 @@
+/**
+ * @file DRM_mixer.h
+ * @author Paul Pagel (https://twobittinker.com)
+ * @brief  Polyphonic drum sample mixer.
+ *         Up to DRM_MAX_VOICES samples sound at once, each with its own gain and
+ *         constant power pan.  Voices are summed in 32-bit fixed point, rounded once and
+ *         saturated to 16-bit stereo frames, a block at a time, for a persistent I2S stream.
+ *         Hits are queued by start() from loop() and picked up by render() at the
+ *         start of the next block, so the two can run on different cores without
+ *         locks.  play() starts a hit at once, for the render task itself, e.g. a
+ *         sequencer that renders up to a step and plays it on that exact frame.  Starting a voice only takes a slot from the free list: there is
+ *         no allocation.  When DRM_MAX_VOICES are already sounding the oldest is
+ *         stolen: it fades out in one of DRM_FADE_SLOTS spare voices while the new hit
+ *         starts.  Voices in the same choke group cut each other off (closed hat stops
+ *         the open hat) with the same short fade, so neither makes a click.
+ *         Samples are 16-bit mono PCM played in place, e.g. from the kit headers.
+ *         No Arduino dependencies, so it also builds on the host for benchmarking.
+ * @version 0.1
+ * @date 2020-09-12
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#ifndef _DRM_MIXER_
+#define _DRM_MIXER_
+
+#include <stdint.h>
+
+#define DRM_SAMPLE_RATE     22050  // Rate of the kit samples
+#define DRM_MAX_VOICES          8  // Voices sounding at once, not counting fades
+#define DRM_FADE_SLOTS          2  // Spare voices for stolen, choked or stopped voices to fade out in
+#define DRM_VOICE_SLOTS  (DRM_MAX_VOICES + DRM_FADE_SLOTS)
+#define DRM_BLOCK_FRAMES      128  // Stereo frames per render (~5.8 msec)
+#define DRM_QUEUE_LEN          16  // Hits waiting for the next block.  Must be power of 2
+#define DRM_FADE_FRAMES        64  // Fade out of a choked or stolen voice (~2.9 msec)
+#define DRM_CHOKE_GROUPS        4  // Groups 1 to 3, 0 is DRM_NO_CHOKE
+#define DRM_NO_CHOKE            0
+#define DRM_MIX_FRAC            7  // Voices are summed in Q8, leaving headroom for 8 full scale voices
+#define DRM_MIX_SHIFT          23  // Q8 mix times Q15 master back to 16-bit
+
+typedef struct
+{
+    const uint8_t *data;      // 16-bit little endian mono PCM.  Read a byte at a time, so it need not be aligned
+    uint32_t frames;
+} DRM_sample_t;
+
+typedef struct
+{
+    uint32_t hits;            // Voices started
+    uint32_t steals;          // Voices faded out to make room for a hit
+    uint32_t cuts;            // Fading voices cut off because every slot was in use
+    uint32_t chokes;          // Voices cut off by their choke group
+    uint32_t dropped;         // Hits lost because the queue was full
+    uint32_t clips;           // Output samples saturated
+    uint32_t blocks;
+} DRM_mixer_stats_t;
+
+class DRM_mixer
+{
+  public:
+    DRM_mixer();
+    static bool loadWav(const uint8_t *wav, uint32_t length, DRM_sample_t *sample);
+    void    reset();
+    bool    start(const DRM_sample_t *sample, float gain, float pan, uint8_t choke_group);
+    bool    play(const DRM_sample_t *sample, float gain, float pan, uint8_t choke_group);
+    void    stopAll();
+    void    setMasterGain(float gain);
+    void    render(int16_t *out, uint16_t frames);
+    uint8_t getActiveCount();
+    void    getStats(DRM_mixer_stats_t *stats);
+
+  private:
+    typedef struct
+    {
+        const DRM_sample_t *sample;
+        int32_t  gain_l;      // Q15
+        int32_t  gain_r;
+        uint8_t  choke_group;
+    } DRM_hit_t;
+
+    typedef struct
+    {
+        const uint8_t *data;
+        uint32_t frames;
+        uint32_t pos;
+        int32_t  gain_l;      // Q15
+        int32_t  gain_r;
+        uint16_t fade;        // Frames left of the fade out
+        uint8_t  choke_group;
+        bool     fading;
+    } DRM_voice_t;
+
+    static bool makeHit(const DRM_sample_t *sample, float gain, float pan, uint8_t choke_group, DRM_hit_t *hit);
+    void    startHit(const DRM_hit_t *hit);
+    void    fadeVoice(uint8_t v);
+    bool    mixVoice(uint8_t v, uint16_t frames);
+
+    DRM_voice_t _voice[DRM_VOICE_SLOTS];
+    uint8_t  _free[DRM_VOICE_SLOTS];    // Stack of idle voices
+    uint8_t  _free_cnt = 0;
+    uint8_t  _active[DRM_VOICE_SLOTS];  // Sounding and fading voices, oldest first
+    uint8_t  _active_cnt = 0;
+    uint8_t  _choke_voice[DRM_CHOKE_GROUPS];  // Last voice started in each group
+    int32_t  _mix[DRM_BLOCK_FRAMES * 2];  // Q8
+    int32_t  _master = 32768;           // Q15, 1.0
+    DRM_hit_t _queue[DRM_QUEUE_LEN];
+    volatile uint32_t _queue_write = 0; // Hits added by start()
+    volatile uint32_t _queue_read = 0;  // Hits taken by render()
+    volatile bool _stop_all = false;
+    DRM_mixer_stats_t _stats;
+};
+
+#endif // _DRM_MIXER_
@@ -0,0 +1,242 @@
+#include <stddef.h>
+#include "DRM_sequencer.h"
+
+DRM_sequencer::DRM_sequencer()
+{
+    setStepTime(250);
+}
+
+/**
+ * @brief Sets the mixer rendered between steps, and the callback that plays each step.
+ */
+void DRM_sequencer::begin(DRM_mixer *mixer, DRM_step_callback callback, void *param)
+{
+    _mixer = mixer;
+    _callback = callback;
+    _callback_param = param;
+}
+
+/**
+ * @brief Steps in the pattern, 1 to DRM_SEQ_MAX_STEPS.
+ */
+void DRM_sequencer::setLength(uint8_t steps)
+{
+    _length = (steps < 1 ? 1 : (steps > DRM_SEQ_MAX_STEPS ? DRM_SEQ_MAX_STEPS : steps));
+}
+
+/**
+ * @brief Sets the time from one step to the next when swing is straight.
+ *        Takes effect from the next step.
+ */
+void DRM_sequencer::setStepTime(uint16_t step_ms)
+{
+    if (step_ms < DRM_SEQ_MIN_STEP_MS) step_ms = DRM_SEQ_MIN_STEP_MS;
+    _step_len = (uint32_t)(((uint64_t)step_ms * DRM_SAMPLE_RATE * 256 + 500) / 1000);
+}
+
+/**
+ * @brief Sets the swing, DRM_SEQ_SWING_STRAIGHT (50%) to DRM_SEQ_SWING_MAX.
+ *        Takes effect from the next step.
+ */
+void DRM_sequencer::setSwing(uint8_t percent)
+{
+    _swing = (percent < DRM_SEQ_SWING_STRAIGHT ? DRM_SEQ_SWING_STRAIGHT : (percent > DRM_SEQ_SWING_MAX ? DRM_SEQ_SWING_MAX : percent));
+}
+
+/**
+ * @brief Plays step 0 on the first frame of the next rendered block, and on from there.
+ *        When following a MIDI clock, step 0 plays on the next clock instead.
+ */
+void DRM_sequencer::start()
+{
+    _step = 0;
+    _start_pending = true;
+}
+
+/**
+ * @brief Stops stepping at the next block.  Sounding hits play on.
+ */
+void DRM_sequencer::stop()
+{
+    _start_pending = false;
+    _running = false;
+}
+
+/**
+ * @brief Counts a MIDI Timing Clock message.  Call from loop() only, as each arrives.
+ */
+void DRM_sequencer::clock()
+{
+    _clock_cnt = _clock_cnt + 1;
+}
+
+/**
+ * @brief True while steps follow the MIDI clock rather than the step time.
+ */
+bool DRM_sequencer::getClocked()
+{
+    return _clocked;
+}
+
+bool DRM_sequencer::getRunning()
+{
+    return _running || _start_pending;
+}
+
+/**
+ * @brief Step last played, for drawing.
+ */
+uint8_t DRM_sequencer::getStep()
+{
+    return _step;
+}
+
+/**
+ * @brief Steps played since start(), so a change is seen even with one step.
+ */
+uint32_t DRM_sequencer::getStepCount()
+{
+    return _step_cnt;
+}
+
+/**
+ * @brief Frames rendered from start() to the last step played.
+ */
+uint32_t DRM_sequencer::getStepFrame()
+{
+    return _step_frame;
+}
+
+/**
+ * @brief Renders frames from the mixer, playing every step that falls in them
+ *        on its frame.  Call from the audio output task only.
+ *
+ * @param out     frames * 2 samples, as DRM_mixer::render()
+ * @param frames  Any count
+ */
+void DRM_sequencer::render(int16_t *out, uint16_t frames)
+{
+    if (_start_pending)
+    {
+        _start_pending = false;
+        _step = 0;
+        _step_cnt = 0;
+        _countdown = 0;
+        _frame = 0;
+        _step_frame = 0;
+        _clock_phase = 0;
+        _clock_steps = 0;
+        _running = true;
+    }
+
+    countClocks(frames);
+    if (_clocked)
+    {
+        // One step per block, so steps that were late do not all land on one frame
+        if (_running && _clock_steps > 0)
+        {
+            _clock_steps--;
+            playStep();
+        }
+        _mixer->render(out, frames);
+        _frame += frames;
+        return;
+    }
+
+    while (frames > 0)
+    {
+        if (!_running)
+        {
+            _mixer->render(out, frames);
+            return;
+        }
+
+        // Whole frames before the step, rounding its exact time up
+        uint32_t until = (_countdown <= 0 ? 0 : ((uint32_t)_countdown + 255) >> 8);
+        if (until >= frames)
+        {
+            _mixer->render(out, frames);
+            _countdown -= (int32_t)frames << 8;
+            _frame += frames;
+            return;
+        }
+
+        if (until > 0)
+        {
+            _mixer->render(out, until);
+            out += until * 2;
+            frames -= until;
+            _countdown -= (int32_t)until << 8;
+            _frame += until;
+        }
+        playStep();
+    }
+}
+
+/**
+ * @brief Render callback for DRM_i2s, param is the DRM_sequencer.
+ */
+void DRM_sequencer::renderCallback(int16_t *out, uint16_t frames, void *param)
+{
+    ((DRM_sequencer *)param)->render(out, frames);
+}
+
+// ------ PRIVATE METHODS ------//
+
+/*
+ * Takes the MIDI clocks counted since the last block, making a step due every
+ * DRM_SEQ_CLOCKS_PER_STEP from start().  Without a clock for DRM_SEQ_CLOCK_TIMEOUT_MS
+ * the next step is timed from the last one by the step time again.
+ */
+void DRM_sequencer::countClocks(uint16_t frames)
+{
+    uint32_t clocks = _clock_cnt;
+
+    if (clocks != _clock_seen)
+    {
+        while (_clock_seen != clocks)
+        {
+            _clock_seen++;
+            if (_clock_phase == 0 && _running && _clock_steps < 255) _clock_steps++;
+            _clock_phase = (_clock_phase + 1) % DRM_SEQ_CLOCKS_PER_STEP;
+        }
+        _clock_idle = 0;
+        _clocked = true;
+        return;
+    }
+
+    if (!_clocked) return;
+    _clock_idle += frames;
+    if (_clock_idle >= (uint32_t)DRM_SEQ_CLOCK_TIMEOUT_MS * DRM_SAMPLE_RATE / 1000)
+    {
+        uint32_t since = _frame - _step_frame;
+        _clocked = false;
+        _clock_steps = 0;
+        _countdown = (since < (_step_len >> 8) ? (int32_t)_step_len - (int32_t)(since << 8) : 0);
+    }
+}
+
+/*
+ * Plays the next step and schedules the one after from the current step time and swing.
+ * The countdown keeps the fraction of a sample it overran by, so steps do not drift.
+ */
+void DRM_sequencer::playStep()
+{
+    uint8_t length = _length;
+    uint8_t step = (_step_cnt > 0 && _step + 1 < length ? _step + 1 : 0);
+    int64_t step_len = _step_len;
+
+    // Swing lengthens the first step of each pair and shortens the second
+    if (length > 1)
+    {
+        uint8_t share = (step & 1 ? 100 - _swing : _swing);
+        step_len = step_len * 2 * share / 100;
+    }
+
+    _step = step;
+    _step_frame = _frame;
+    _step_cnt++;
+    _countdown += (int32_t)step_len;
+
+    if (_callback != NULL) _callback(step, _callback_param);
+}
@@ -0,0 +1,90 @@
+/**
+ * @file DRM_sequencer.h
+ * @author Paul Pagel (https://twobittinker.com)
+ * @brief  Step sequencer clocked by the audio samples.
+ *         render() is the audio output's render callback.  It counts samples and
+ *         renders the mixer up to the exact frame a step is due, calls the step
+ *         callback there so the step's hits start on that frame, then renders the
+ *         rest of the block.  Timing only depends on the sample clock, not on when
+ *         loop() gets round to it, and is the same whatever size the blocks are.
+ *         Step times are kept in 1/256 samples, so fractional step lengths do not
+ *         drift.  A step lands on the first frame at or after its exact time.
+ *         Step time and swing changes take effect from the next step.  Swing is
+ *         the share of each pair of steps given to the first, 50% is straight.
+ *         An external MIDI clock can drive the steps instead: clock() counts Timing
+ *         Clock messages from loop(), and every DRM_SEQ_CLOCKS_PER_STEP of them plays
+ *         a step on the first frame of the next block, so it is at most a block
+ *         late.  Swing is left to the clock source.  If the clock stops for
+ *         DRM_SEQ_CLOCK_TIMEOUT_MS the sequencer goes back to its own step time.
+ *         No Arduino dependencies, so it also builds on the host for testing.
+ * @version 0.1
+ * @date 2020-09-19
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#ifndef _DRM_SEQUENCER_
+#define _DRM_SEQUENCER_
+
+#include <stdint.h>
+#include "DRM_mixer.h"
+
+#define DRM_SEQ_MAX_STEPS        32
+#define DRM_SEQ_MIN_STEP_MS      20
+#define DRM_SEQ_SWING_STRAIGHT   50  // Percent of a pair of steps given to the first
+#define DRM_SEQ_SWING_MAX        75  // Dotted eighth and sixteenth
+#define DRM_SEQ_CLOCKS_PER_STEP   6  // MIDI clocks (24 per beat) per step, i.e. 16th notes
+#define DRM_SEQ_CLOCK_TIMEOUT_MS 500 // Without a clock for this long the step time is used again
+
+// Called from the render task when a step is due.  Start its hits with DRM_mixer::play()
+typedef void (*DRM_step_callback)(uint8_t step, void *param);
+
+class DRM_sequencer
+{
+  public:
+    DRM_sequencer();
+    void     begin(DRM_mixer *mixer, DRM_step_callback callback, void *param);
+    void     setLength(uint8_t steps);
+    void     setStepTime(uint16_t step_ms);
+    void     setSwing(uint8_t percent);
+    void     start();
+    void     stop();
+    void     clock();
+    bool     getRunning();
+    bool     getClocked();
+    uint8_t  getStep();
+    uint32_t getStepCount();
+    uint32_t getStepFrame();
+    void     render(int16_t *out, uint16_t frames);
+    static void renderCallback(int16_t *out, uint16_t frames, void *param);
+
+  private:
+    void     playStep();
+    void     countClocks(uint16_t frames);
+
+    DRM_mixer *_mixer = NULL;
+    DRM_step_callback _callback = NULL;
+    void    *_callback_param = NULL;
+
+    volatile uint32_t _step_len = 0;     // Samples per step * 256
+    volatile uint8_t  _swing = DRM_SEQ_SWING_STRAIGHT;
+    volatile uint8_t  _length = 8;
+    volatile bool     _start_pending = false;
+    volatile bool     _running = false;
+    volatile uint32_t _clock_cnt = 0;    // MIDI clocks counted by clock()
+
+    uint32_t _clock_seen = 0;            // MIDI clocks counted by render()
+    uint8_t  _clock_phase = 0;           // Clocks into the current step
+    uint8_t  _clock_steps = 0;           // Steps the clock has made due, not yet played
+    uint32_t _clock_idle = 0;            // Frames since the last clock
+    volatile bool _clocked = false;      // Following the MIDI clock
+
+    int32_t  _countdown = 0;             // Samples * 256 until the next step
+    uint32_t _frame = 0;                 // Frames rendered since start
+    volatile uint8_t  _step = 0;
+    volatile uint32_t _step_cnt = 0;     // Steps played since start
+    volatile uint32_t _step_frame = 0;   // Frame the last step landed on
+};
+
+#endif // _DRM_SEQUENCER_
@@ -13,8 +13,10 @@ There is no warranty; not even for merchantability or fitness for a particular p
 #include <XPT2046_Touchscreen.h>
 #include <SD.h> 
 #include <Fonts/FreeMonoBold12pt7b.h>
-#include "driver/i2s.h"
-#include "freertos/queue.h"
+#include <MIDI.h>
+#include "DRM_mixer.h"
+#include "DRM_i2s.h"
+#include "DRM_sequencer.h"
 #include "Kit01_chat_wav.h"
 #include "Kit01_ohat_wav.h"
 #include "Kit01_kick_wav.h"
@@ -38,7 +40,7 @@ enum app_state_type {
 
 enum app_state_type app_state, prev_app_state;
 
-bool btn_pressed[8], btn_released[8];
+bool btn_pressed[8], btn_released[8], btn_hit[8];
 bool btnA_pressed, btnB_pressed, btnX_pressed, btnY_pressed;
 bool btnUp_pressed, btnDown_pressed, btnLeft_pressed, btnRight_pressed;
 bool spkrLeft_on, spkrRight_on;
@@ -46,56 +48,43 @@ bool btnTouch_pressed, btnTouch_released;
 int16_t joy_x_left, joy_y_left, joy_x_right, joy_y_right; 
 bool sd_present = false;
 
-uint32_t state_start_time, step_start_time;
+uint32_t state_start_time;
 uint8_t  seq_step, compose_seq_step, compose_row;
 
-const uint8_t *audio_wav;
-bool          audio_playing;
-uint16_t      wav_length, sample_pos, tempo_ms;
+uint16_t tempo_ms;
+uint8_t  swing_pct;
 
 uint8_t  sequence[] = { 1, 0, 2, 0, 1, 3, 2, 4 };
 uint16_t seq_dark[] = { ILI9341_PURPLE, ILI9341_NAVY, ILI9341_MAROON, ILI9341_DARKGREEN };
 uint16_t seq_light[] = { ILI9341_MAGENTA, ILI9341_BLUE, ILI9341_RED, ILI9341_GREEN };
 
-// i2s configuration
-// See https://github.com/espressif/arduino-esp32/blob/master/tools/sdk/include/driver/driver/i2s.h
-
-int i2s_port_num = 0; 
-i2s_config_t i2s_config = {
-  .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX),
-  .sample_rate = 22050,
-  .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,  // (i2s_bits_per_sample_t) 8
-  .channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT,  //I2S_CHANNEL_FMT_ONLY_RIGHT, I2S_CHANNEL_FMT_RIGHT_LEFT
-  .communication_format = (i2s_comm_format_t)(I2S_COMM_FORMAT_I2S | I2S_COMM_FORMAT_I2S_MSB),  // | I2S_COMM_FORMAT_PCM    
-  .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,      // high interrupt priority. See esp_intr_alloc.h for more
-  .dma_buf_count = 8,
-  .dma_buf_len = 64,        
-  .use_apll = true,        // I2S using APLL as main I2S clock, enable it to get accurate clock
-  .tx_desc_auto_clear = 0,  // helps in avoiding noise in case of data unavailability
-  .fixed_mclk = 0
-};
+// Drum kit: kick, snare, closed hat, open hat, indexed by sequence value - 1
+#define HAT_CHOKE  1  // Closed hat cuts off the open hat
 
-i2s_pin_config_t pin_config = {
-  .bck_io_num = I2S_BCLK,   // bit clock pin - to BCK pin on I2S DAC/PCM5102
-  .ws_io_num = I2S_LRCK,    // left right select - to LCK pin on I2S DAC
-  .data_out_num = I2S_DOUT, // DATA output pin - to DIN pin on I2S DAC
-  .data_in_num = -1         // Not used
-};
+DRM_sample_t kit[4];
+const float  kit_gain[] = { 0.9, 0.8, 0.5, 0.5 };
+const float  kit_pan[]  = { 0.0, -0.1, 0.3, 0.3 };
+const uint8_t kit_choke[] = { DRM_NO_CHOKE, DRM_NO_CHOKE, HAT_CHOKE, HAT_CHOKE };
 
-#define  BUFFER_SIZE          4096 
-#define  SAMPLES_PER_BUFFER   2048  // 2 bytes per sample (16bit x 2 channels for stereo)
-uint8_t  audio_buffer[BUFFER_SIZE];
+DRM_mixer     mixer;
+DRM_sequencer sequencer;
+DRM_i2s       audio_out;
 
 File     root;
 XPT2046_Touchscreen ts(TCH_CS);
 Adafruit_ILI9341 tft = Adafruit_ILI9341(TFT_CS, TFT_DC, TFT_RST);
 
+MIDI_CREATE_INSTANCE(HardwareSerial, Serial2, midi_in);
+
 void setup();
 bool checkSD();
 bool initSD();
-bool initAudioI2S();
-void playAudio(const uint8_t *wav, uint16_t length);
-void updateAudio();
+bool initAudio();
+void playDrum(uint8_t instrument);
+void playStep(uint8_t step, void *param);
+void handleClock();
+void handleStart();
+void handleStop();
 void drawMenu();
 void drawCompose();
 void drawSequencer();
@@ -104,12 +93,15 @@ void drawTempo();
 void checkButtonPresses();
 void checkJoysticks();
 void checkTempo();
+void checkSwing();
 void loop(void) ;
 void handleTitle();
 void handleMenu();
 void handleFreePlay();
+void freePlayButton(uint8_t btn, uint8_t instrument);
 void handleCompose();
 void handlePlayback();
+void stopPlayback();
 
 /*
  * Set up the board
@@ -149,6 +141,14 @@ void setup()
   tft.setTextColor(ILI9341_WHITE);  
 
   tempo_ms = 250;
+  swing_pct = DRM_SEQ_SWING_STRAIGHT;
+  initAudio();
+
+  // Set up MIDI (IN only) to follow an external clock on the RX2 pin
+  midi_in.setHandleClock(handleClock);
+  midi_in.setHandleStart(handleStart);
+  midi_in.setHandleStop(handleStop);
+  midi_in.begin(MIDI_CHANNEL_OMNI);
 
   drawMenu();
   app_state = STATE_MENU;
@@ -208,83 +208,91 @@ bool initSD()
 }
 
 /*
- * Initialize the I2S audio output
+ * Finds the kit samples and starts the audio output.  The I2S stream runs from
+ * here on, mixing whatever drums are sounding.  The sequencer is clocked by the
+ * stream, so playback steps are timed to the sample whatever loop() is doing.
  */
-bool initAudioI2S()
+bool initAudio()
 {
-  esp_err_t err;
-  
-  err = i2s_driver_install((i2s_port_t)i2s_port_num, &i2s_config, 0, NULL);
-  if (err != ESP_OK)
+  const uint8_t *wavs[] = { Kit01_kick_wav, Kit01_snare_wav, Kit01_chat_wav, Kit01_ohat_wav };
+  const uint32_t lengths[] = { sizeof(Kit01_kick_wav), sizeof(Kit01_snare_wav), sizeof(Kit01_chat_wav), sizeof(Kit01_ohat_wav) };
+
+  for (int i = 0; i < 4; i++)
   {
-    Serial.print("I2S driver install fail: ");
-    Serial.println(err);
-    return false;
-  } 
-  i2s_set_pin((i2s_port_t)i2s_port_num, &pin_config);
-  i2s_set_clk((i2s_port_t)i2s_port_num, 11025, I2S_BITS_PER_SAMPLE_16BIT, I2S_CHANNEL_STEREO);
-  
-  return true;
+    if (!DRM_mixer::loadWav(wavs[i], lengths[i], &kit[i]))
+    {
+      Serial.print("Kit sample not 16-bit mono PCM: ");
+      Serial.println(i);
+    }
+  }
+
+  sequencer.begin(&mixer, playStep, NULL);
+  sequencer.setLength(SEQ_LEN);
+  sequencer.setStepTime(tempo_ms);
+  sequencer.setSwing(swing_pct);
+
+  return audio_out.begin(DRM_sequencer::renderCallback, &sequencer, I2S_BCLK, I2S_LRCK, I2S_DOUT);
 }
 
 /* 
- * Plays the audio sample through either or both speaker channels.  
- * Does not return until sample is done playing.
+ * Starts a drum sound.  Returns at once, the sound plays over anything already playing.
+ * instrument is the sequence value, 1 kick, 2 snare, 3 closed hat, 4 open hat.
  */
-void playAudio(const uint8_t *wav, uint16_t length)
+void playDrum(uint8_t instrument)
 { 
-  audio_playing = initAudioI2S();
-  audio_wav = wav;
-  wav_length = length;
-  sample_pos = 44;  // skip RIFF header, could detect & skip(?)
+  if (instrument < 1 || instrument > 4) return;
 
-  updateAudio();
+  uint8_t k = instrument - 1;
+  mixer.start(&kit[k], kit_gain[k], kit_pan[k], kit_choke[k]);
 }
 
-void updateAudio()
+/*
+ * Sequencer step callback.  Runs in the audio task on the step's exact sample,
+ * so the drum is started there with play() rather than queued.
+ */
+void playStep(uint8_t step, void *param)
 {
-  int16_t   buff_pos;
-  uint8_t   temp, temp_msb;
-  size_t    bytes_out;
-  
-  if (!audio_playing) return;
+  uint8_t instrument = sequence[step];
+  if (instrument < 1 || instrument > 4) return;
 
-  // Fill I2S transfer audio buffer from sample buffer
-  for (int i = 0; i < SAMPLES_PER_BUFFER - 1; i+= 2)
-  {    
-    if (sample_pos + i < wav_length - 1)
-    {
-      temp = audio_wav[sample_pos + i];  
-      temp_msb = audio_wav[sample_pos + i + 1];  
-    }
-    else
-    {
-      temp = 0;
-      temp_msb = 0;
-    }
-
-    buff_pos = i * 2; // right + left channel samples
+  uint8_t k = instrument - 1;
+  mixer.play(&kit[k], kit_gain[k], kit_pan[k], kit_choke[k]);
+}
 
-    audio_buffer[buff_pos] = temp;
-    audio_buffer[buff_pos + 1] = temp_msb;
+/**
+ * @brief MIDI callback for Timing Clock messages, 24 per beat.
+ *        While they arrive the sequencer steps on the clock instead of its tempo.
+ */
+void handleClock()
+{
+  sequencer.clock();
+}
 
-    audio_buffer[buff_pos + 2] = temp;
-    audio_buffer[buff_pos + 3] = temp_msb;
+/**
+ * @brief MIDI callback for Start messages.  Plays the sequence from the first step,
+ *        on the next clock, when composing or playing.
+ */
+void handleStart()
+{
+  if (app_state == STATE_PLAYBACK)
+  {
+    sequencer.start();
   }
-  
-  // Write data to I2S DMA buffer.  Blocking call, last parameter = ticks to wait or portMAX_DELAY for no timeout
-  i2s_write((i2s_port_t)i2s_port_num, (const char *)&audio_buffer, sizeof(audio_buffer), &bytes_out, 100);
-  if (bytes_out != sizeof(audio_buffer)) Serial.println("I2S write timeout");
-
-  sample_pos += SAMPLES_PER_BUFFER;
-  if (sample_pos >= wav_length - 1)
+  else if (app_state == STATE_COMPOSE)
   {
-    // Stop audio playback
-    i2s_driver_uninstall((i2s_port_t)i2s_port_num);
-    audio_playing = false;
+    tft.fillRect(70 + compose_seq_step * PIXELS_PER_STEP, 92 + compose_row * 32, 20, 4, ILI9341_BLACK); 
+    app_state = STATE_PLAYBACK;
   }
 }
 
+/**
+ * @brief MIDI callback for Stop messages.
+ */
+void handleStop()
+{
+  if (app_state == STATE_PLAYBACK) stopPlayback();
+}
+
 /*
  * Draws the app title/splash screen
  */
@@ -374,6 +382,12 @@ void drawTempo()
   tft.print("Tempo: ");
   tft.fillRect(100, 210, 40, 20, ILI9341_BLACK);
   tft.print(tempo_ms);
+
+  tft.setCursor(170, 226);
+  tft.print("Swing: ");
+  tft.fillRect(268, 210, 52, 20, ILI9341_BLACK);
+  tft.print(swing_pct);
+  tft.print("%");
 }
 
 /*
@@ -392,6 +406,7 @@ void checkButtonPresses()
   {
     pressed = (digitalRead(SR_Q7) == LOW ? 1: 0);// read the state of the SO:
     btn_released[i] = !pressed && btn_pressed[i];
+    btn_hit[i] = pressed && !btn_pressed[i];
     btn_pressed[i] = pressed;
     // Shift the next button pin value into the serial data out
     digitalWrite(SR_CP, LOW);
@@ -423,11 +438,32 @@ void checkTempo()
   if (joy_y_left > 3)
   {
     tempo_ms += 1;
+    sequencer.setStepTime(tempo_ms);
     drawTempo();
   }
-  if (joy_y_left < -3)
+  if (joy_y_left < -3 && tempo_ms > DRM_SEQ_MIN_STEP_MS)
   {
     tempo_ms -= 1;
+    sequencer.setStepTime(tempo_ms);
+    drawTempo();
+  }
+}
+
+/*
+ * Checks for any swing adjustments with the right joystick and updates the display
+ */
+void checkSwing()
+{
+  if (joy_y_right > 3 && swing_pct < DRM_SEQ_SWING_MAX)
+  {
+    swing_pct += 1;
+    sequencer.setSwing(swing_pct);
+    drawTempo();
+  }
+  if (joy_y_right < -3 && swing_pct > DRM_SEQ_SWING_STRAIGHT)
+  {
+    swing_pct -= 1;
+    sequencer.setSwing(swing_pct);
     drawTempo();
   }
 }
@@ -437,6 +473,7 @@ void checkTempo()
  */
 void loop(void) 
 {
+  while (midi_in.read());  // Clocks are timed when they are read, so read them all
   checkButtonPresses();
   checkJoysticks();
     
@@ -461,7 +498,9 @@ void loop(void)
         break;
       case STATE_PLAYBACK:
         Serial.println("New state: PLAYBACK");
-        step_start_time = 0;
+        seq_step = 0;
+        sequencer.start();
+        tft.fillRect(70 + seq_step * PIXELS_PER_STEP, 192, 20, 4, ILI9341_YELLOW); 
         break;
     }
   }
@@ -484,7 +523,6 @@ void loop(void)
       break;
   }
 
-  updateAudio();
   //delay(1);
 }
 
@@ -536,38 +574,31 @@ void handleFreePlay()
     return;
   }
 
-  if (btn_pressed[BTN_LEFT])
-  {
-    tft.fillRect(1, 162, 6, 28, seq_light[3]);
-    playAudio(Kit01_kick_wav, 12056);
-    tft.fillRect(1, 162, 6, 28, ILI9341_BLACK);
-    return;
-  }
+  // Light each instrument while its button is held.  A hit plays on the press, so
+  // drums can be layered and rolled.
+  freePlayButton(BTN_LEFT, 1);   // kick, bottom track
+  freePlayButton(BTN_RIGHT, 2);  // snare
+  freePlayButton(BTN_DOWN, 3);   // closed hat
+  freePlayButton(BTN_UP, 4);     // open hat, top track
+}
 
-  if (btn_pressed[BTN_RIGHT])
-  {
-    tft.fillRect(1, 130, 6, 28, seq_light[2]);
-    playAudio(Kit01_snare_wav, 11316);
-    tft.fillRect(1, 130, 6, 28, ILI9341_BLACK);
-    return;
-  }
+/*
+ * Plays the drum for a free play button when pressed and draws its ON indicator.
+ * instrument is the sequence value, also counted up from the bottom track.
+ */
+void freePlayButton(uint8_t btn, uint8_t instrument)
+{
+  uint8_t track = 4 - instrument;
 
-  if (btn_pressed[BTN_DOWN])
+  if (btn_hit[btn])
   {
-    tft.fillRect(1, 98, 6, 28, seq_light[1]);
-    playAudio(Kit01_chat_wav, 11026);
-    tft.fillRect(1, 98, 6, 28, ILI9341_BLACK);
-    return;
+    playDrum(instrument);
+    tft.fillRect(1, 66 + track * 32, 6, 28, seq_light[track]);
   }
-
-  if (btn_pressed[BTN_UP])
+  else if (btn_released[btn])
   {
-    tft.fillRect(1, 66, 6, 28, seq_light[0]);
-    playAudio(Kit01_ohat_wav, 33474);
-    tft.fillRect(1, 66, 6, 28, ILI9341_BLACK);
-    return;
+    tft.fillRect(1, 66 + track * 32, 6, 28, ILI9341_BLACK);
   }
-
 }
 
 /*
@@ -638,57 +669,35 @@ void handleCompose()
 }
 
 /*
- * Handles the STATE_PLAYBACK app state logic
+ * Handles the STATE_PLAYBACK app state logic.  The sequencer plays the steps from
+ * the audio task, this only follows it with the step marker.
  */
 void handlePlayback()
 {
   if (btn_released[BTN_Y])
   {
-    app_state = STATE_COMPOSE;
+    stopPlayback();
     return;
   }
 
   checkTempo();
+  checkSwing();
 
-  tft.fillRect(70 + seq_step * PIXELS_PER_STEP, 192, 20, 4, ILI9341_BLACK); 
-  
-  bool play = false;
-
-  if (step_start_time == 0)
-  {
-    seq_step = 0;
-    step_start_time = millis();
-    play = true;
-  }
-
-  if (millis() - step_start_time > tempo_ms)
-  {
-    seq_step = (seq_step == 7 ? 0 : seq_step + 1);
-    step_start_time = millis();
-    play = true;
-  }
-
-  if (play)
+  uint8_t step = sequencer.getStep();
+  if (step != seq_step)
   {
+    tft.fillRect(70 + seq_step * PIXELS_PER_STEP, 192, 20, 4, ILI9341_BLACK); 
+    seq_step = step;
     tft.fillRect(70 + seq_step * PIXELS_PER_STEP, 192, 20, 4, ILI9341_YELLOW); 
-    
-    switch(sequence[seq_step])
-    {
-      case 1:  // kick
-        playAudio(Kit01_kick_wav, 12056);
-        break;
-      case 2:  // snare
-        playAudio(Kit01_snare_wav, 11316);
-        break;
-      case 3:  // closed hat
-        playAudio(Kit01_chat_wav, 11026);
-        break;
-      case 4:  // open hat
-        playAudio(Kit01_ohat_wav, 33474);
-        break;
-      default:
-        break; 
-    }
   }
-  
-}
\ No newline at end of file
+}
+
+/*
+ * Stops the sequencer and goes back to composing.
+ */
+void stopPlayback()
+{
+  sequencer.stop();
+  tft.fillRect(70 + seq_step * PIXELS_PER_STEP, 192, 20, 4, ILI9341_BLACK); 
+  app_state = STATE_COMPOSE;
+}
@@ -0,0 +1,307 @@
+/**
+ * @file mixer_bench.cpp
+ * @author Paul Pagel (https://twobittinker.com)
+ * @brief  Host test and benchmark of DRM_mixer with the Kit01 samples.
+ *         Checks the mix against a floating point reference for overlapping hits
+ *         with different gains and pans, that a closed hat chokes the open hat with
+ *         a fade rather than a click, that the oldest voice fades out when all are
+ *         busy, and that a loud mix saturates instead of wrapping.
+ *         Then times render() with 1 to DRM_MAX_VOICES voices sounding, as the
+ *         processing time per second of audio.
+ *         Returns non-zero if a check fails.
+ *
+ *         Build and run from the project folder:
+ *           g++ -O2 -Ilib/drummer -Iinclude tools/mixer_bench.cpp lib/drummer/DRM_mixer.cpp -o mixer_bench && ./mixer_bench
+ * @version 0.1
+ * @date 2020-09-12
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "DRM_mixer.h"
+
+#define PROGMEM
+#include "Kit01_chat_wav.h"
+#include "Kit01_ohat_wav.h"
+#include "Kit01_kick_wav.h"
+#include "Kit01_snare_wav.h"
+
+#define MAX_ERROR         1  // Q15 gains, rounded once
+#define BENCH_SECONDS    10
+
+typedef struct
+{
+    const DRM_sample_t *sample;
+    uint32_t frame;       // Output frame the hit lands on, a multiple of DRM_BLOCK_FRAMES
+    float    gain;
+    float    pan;
+} bench_hit_t;
+
+static DRM_sample_t kit[4];
+static bool passed = true;
+
+static void check(bool ok, const char *what)
+{
+    printf("  %-52s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) passed = false;
+}
+
+static float sampleAt(const DRM_sample_t *sample, uint32_t pos)
+{
+    if (pos >= sample->frames) return 0;
+    return (int16_t)(sample->data[pos * 2] | (sample->data[pos * 2 + 1] << 8));
+}
+
+/*
+ * Renders frames from the mixer, queuing each hit just before the block it lands on.
+ */
+static std::vector<int16_t> renderHits(DRM_mixer *mixer, const bench_hit_t *hits, int count, uint32_t frames, uint8_t choke = DRM_NO_CHOKE)
+{
+    std::vector<int16_t> out(frames * 2);
+    int next = 0;
+
+    for (uint32_t f = 0; f < frames; f += DRM_BLOCK_FRAMES)
+    {
+        while (next < count && hits[next].frame <= f)
+        {
+            mixer->start(hits[next].sample, hits[next].gain, hits[next].pan, choke);
+            next++;
+        }
+        mixer->render(&out[f * 2], DRM_BLOCK_FRAMES);
+    }
+    return out;
+}
+
+/*
+ * Overlapping hits of every drum, against the sum in floating point.
+ */
+static void testReference()
+{
+    DRM_mixer mixer;
+    const bench_hit_t hits[] = {
+        { &kit[0],    0, 0.9f,  0.0f },
+        { &kit[2],  128, 0.5f,  0.7f },
+        { &kit[1], 2048, 0.7f, -0.4f },
+        { &kit[3], 2048, 0.4f,  1.0f },
+        { &kit[0], 6144, 0.8f, -1.0f }
+    };
+    const int count = sizeof(hits) / sizeof(hits[0]);
+    uint32_t frames = 0;
+    for (int h = 0; h < count; h++)
+    {
+        if (hits[h].frame + hits[h].sample->frames > frames) frames = hits[h].frame + hits[h].sample->frames;
+    }
+    frames += DRM_BLOCK_FRAMES - frames % DRM_BLOCK_FRAMES;
+
+    std::vector<int16_t> out = renderHits(&mixer, hits, count, frames);
+
+    int max_error = 0;
+    for (uint32_t f = 0; f < frames; f++)
+    {
+        float left = 0, right = 0;
+        for (int h = 0; h < count; h++)
+        {
+            if (f < hits[h].frame) continue;
+            float s = sampleAt(hits[h].sample, f - hits[h].frame) * hits[h].gain;
+            float angle = (hits[h].pan + 1) * (float)M_PI / 4;
+            left += s * cosf(angle);
+            right += s * sinf(angle);
+        }
+        right = fmaxf(-32768, fminf(32767, right));
+        left = fmaxf(-32768, fminf(32767, left));
+        int err_r = abs(out[f * 2] - (int)lrintf(right));
+        int err_l = abs(out[f * 2 + 1] - (int)lrintf(left));
+        if (err_r > max_error) max_error = err_r;
+        if (err_l > max_error) max_error = err_l;
+    }
+
+    DRM_mixer_stats_t stats;
+    mixer.getStats(&stats);
+    printf("Mix of %d hits against reference, max error %d\n", count, max_error);
+    check(max_error <= MAX_ERROR, "matches reference");
+    check(stats.hits == count && stats.steals == 0 && stats.clips == 0, "no steals or clips");
+    check(mixer.getActiveCount() == 0, "all voices finished");
+}
+
+/*
+ * Closed hat over a ringing open hat: the open hat fades over DRM_FADE_FRAMES.
+ */
+static void testChoke()
+{
+    DRM_mixer mixer;
+    const uint32_t choke_at = 4096;
+    const bench_hit_t hits[] = {
+        { &kit[3], 0,        1.0f, 0.0f },
+        { &kit[2], choke_at, 0.0f, 0.0f }  // Silent, so only the open hat is heard
+    };
+    std::vector<int16_t> out = renderHits(&mixer, hits, 2, choke_at + 2048, 1);
+
+    // Every step of the fade must be no bigger than the open hat's own steps
+    int max_step = 0, max_jump = 0;
+    for (uint32_t f = 1; f < choke_at; f++)
+    {
+        int step = abs(out[f * 2] - out[(f - 1) * 2]);
+        if (step > max_step) max_step = step;
+    }
+    for (uint32_t f = choke_at; f < choke_at + DRM_FADE_FRAMES + 1; f++)
+    {
+        int step = abs(out[f * 2] - out[(f - 1) * 2]);
+        if (step > max_jump) max_jump = step;
+    }
+    bool silent = true;
+    for (uint32_t f = choke_at + DRM_FADE_FRAMES; f < choke_at + 2048; f++)
+    {
+        if (out[f * 2] != 0 || out[f * 2 + 1] != 0) silent = false;
+    }
+
+    DRM_mixer_stats_t stats;
+    mixer.getStats(&stats);
+    printf("Choke: largest step %d in the fade, %d before\n", max_jump, max_step);
+    check(stats.chokes == 1, "closed hat chokes open hat");
+    check(max_jump <= max_step, "no click at the choke");
+    check(silent, "open hat silent after the fade");
+}
+
+/*
+ * One more hit than there are voices: the oldest fades out over DRM_FADE_FRAMES
+ * while the new hit starts, against the sum in floating point, and the rest play on.
+ */
+static void testSteal()
+{
+    DRM_mixer mixer;
+    bench_hit_t hits[DRM_MAX_VOICES + 1];
+    for (int h = 0; h <= DRM_MAX_VOICES; h++)
+    {
+        hits[h].sample = &kit[3];
+        hits[h].frame = h * DRM_BLOCK_FRAMES;
+        hits[h].gain = 0.1f;
+        hits[h].pan = 0;
+    }
+    const uint32_t steal_at = DRM_MAX_VOICES * DRM_BLOCK_FRAMES;
+    std::vector<int16_t> out = renderHits(&mixer, hits, DRM_MAX_VOICES + 1, steal_at + 2 * DRM_BLOCK_FRAMES);
+
+    int max_error = 0;
+    for (uint32_t f = steal_at; f < steal_at + 2 * DRM_BLOCK_FRAMES; f++)
+    {
+        uint32_t i = f - steal_at;
+        float right = sampleAt(&kit[3], f) * (i < DRM_FADE_FRAMES ? (float)(DRM_FADE_FRAMES - i) / DRM_FADE_FRAMES : 0);
+        for (int h = 1; h <= DRM_MAX_VOICES; h++)
+        {
+            right += sampleAt(&kit[3], f - hits[h].frame);
+        }
+        right *= 0.1f * sinf((float)M_PI / 4);
+        int error = abs(out[f * 2] - (int)lrintf(right));
+        if (error > max_error) max_error = error;
+    }
+
+    DRM_mixer_stats_t stats;
+    mixer.getStats(&stats);
+    printf("Steal: %u hits, %u steals, %u voices sounding, max error %d in the fade\n", 
+           stats.hits, stats.steals, mixer.getActiveCount(), max_error);
+    check(stats.steals == 1 && stats.cuts == 0 && mixer.getActiveCount() == DRM_MAX_VOICES, "oldest voice stolen");
+    check(max_error <= MAX_ERROR, "stolen voice fades out");
+
+    // Queue overflow is counted, not overwritten
+    int queued = 0;
+    for (int h = 0; h < DRM_QUEUE_LEN + 4; h++)
+    {
+        if (mixer.start(&kit[0], 1, 0, DRM_NO_CHOKE)) queued++;
+    }
+    mixer.getStats(&stats);
+    check(queued == DRM_QUEUE_LEN && stats.dropped == 4, "full queue drops hits");
+}
+
+/*
+ * Four full gain kicks at once, with master gain: output saturates.
+ */
+static void testSaturate()
+{
+    DRM_mixer mixer;
+    const bench_hit_t hits[] = {
+        { &kit[0], 0, 1.0f, 0.0f },
+        { &kit[0], 0, 1.0f, 0.0f },
+        { &kit[0], 0, 1.0f, 0.0f },
+        { &kit[0], 0, 1.0f, 0.0f }
+    };
+    mixer.setMasterGain(2.0f);
+    std::vector<int16_t> out = renderHits(&mixer, hits, 4, 2048);
+
+    // A wrapped sample would flip sign against the kick
+    bool wrapped = false;
+    for (uint32_t f = 0; f < 2048; f++)
+    {
+        float s = sampleAt(&kit[0], f);
+        if ((s > 4096 && out[f * 2] < 0) || (s < -4096 && out[f * 2] > 0)) wrapped = true;
+    }
+
+    DRM_mixer_stats_t stats;
+    mixer.getStats(&stats);
+    printf("Saturate: %u samples clipped\n", stats.clips);
+    check(stats.clips > 0 && !wrapped, "loud mix saturates without wrapping");
+}
+
+/*
+ * Seconds of CPU time per second of audio with the given voices always sounding.
+ */
+static double benchVoices(int voices)
+{
+    DRM_mixer mixer;
+    int16_t  out[DRM_BLOCK_FRAMES * 2];
+    uint32_t blocks = BENCH_SECONDS * DRM_SAMPLE_RATE / DRM_BLOCK_FRAMES;
+    uint32_t restart = kit[2].frames / DRM_BLOCK_FRAMES;  // Closed hat is the shortest
+    volatile int32_t sink = 0;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t b = 0; b < blocks; b++)
+    {
+        if (b % restart == 0)
+        {
+            for (int v = 0; v < voices; v++)
+            {
+                mixer.start(&kit[v & 3], 0.2f, (v & 1) ? 0.5f : -0.5f, DRM_NO_CHOKE);
+            }
+        }
+        mixer.render(out, DRM_BLOCK_FRAMES);
+        sink += out[0];
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(t1 - t0).count() / BENCH_SECONDS;
+}
+
+int main()
+{
+    const uint8_t *wavs[4] = { Kit01_kick_wav, Kit01_snare_wav, Kit01_chat_wav, Kit01_ohat_wav };
+    const uint32_t lengths[4] = { sizeof(Kit01_kick_wav), sizeof(Kit01_snare_wav), sizeof(Kit01_chat_wav), sizeof(Kit01_ohat_wav) };
+
+    for (int i = 0; i < 4; i++)
+    {
+        if (!DRM_mixer::loadWav(wavs[i], lengths[i], &kit[i]))
+        {
+            printf("Kit sample %d is not 16-bit mono PCM\n", i);
+            return 1;
+        }
+    }
+    printf("Kit: kick %u, snare %u, closed hat %u, open hat %u frames\n\n",
+           kit[0].frames, kit[1].frames, kit[2].frames, kit[3].frames);
+
+    testReference();
+    testChoke();
+    testSteal();
+    testSaturate();
+
+    printf("\nVoices  usec/block  CPU load\n");
+    for (int voices = 1; voices <= DRM_MAX_VOICES; voices++)
+    {
+        double load = benchVoices(voices);
+        printf("%6d  %10.2f  %7.3f%%\n", voices, load * DRM_BLOCK_FRAMES * 1e6 / DRM_SAMPLE_RATE, load * 100);
+    }
+
+    printf("\n%s\n", passed ? "PASSED" : "FAILED");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,296 @@
+/**
+ * @file seq_test.cpp
+ * @author Paul Pagel (https://twobittinker.com)
+ * @brief  Host test of DRM_sequencer timing.
+ *         Plays a one sample click on every step and checks that:
+ *          - steps land on the frame their exact time rounds up to, with no drift
+ *            over a long run although the step length is a fraction of a sample
+ *          - the click is heard from that frame, inside the block
+ *          - output is the same for any render block sizes, as when loop() or the
+ *            output task is held up
+ *          - swing splits each pair of steps by its percentage
+ *          - a step time change leaves the step being counted alone and applies
+ *            from the next one
+ *          - with a MIDI clock, every 6th clock plays a step at the start of the next
+ *            block, start() waits for the clock, and the step time takes over again
+ *            when the clock stops
+ *         Returns non-zero if a check fails.
+ *
+ *         Build and run from the project folder:
+ *           g++ -O2 -Ilib/drummer tools/seq_test.cpp lib/drummer/DRM_sequencer.cpp lib/drummer/DRM_mixer.cpp -o seq_test && ./seq_test
+ * @version 0.1
+ * @date 2020-09-19
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "DRM_sequencer.h"
+
+#define TEST_STEPS      1000
+#define CLICK_LEVEL    16384
+
+typedef struct
+{
+    DRM_sequencer *sequencer;
+    DRM_mixer     *mixer;
+    DRM_sample_t  *click;
+    std::vector<uint32_t> frames;   // Frame each step landed on
+    std::vector<uint8_t>  steps;
+} test_run_t;
+
+static uint8_t click_data[2] = { CLICK_LEVEL & 0xFF, CLICK_LEVEL >> 8 };
+static DRM_sample_t click = { click_data, 1 };
+static bool passed = true;
+
+static void check(bool ok, const char *what)
+{
+    printf("  %-52s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) passed = false;
+}
+
+static void onStep(uint8_t step, void *param)
+{
+    test_run_t *run = (test_run_t *)param;
+
+    run->frames.push_back(run->sequencer->getStepFrame());
+    run->steps.push_back(step);
+    run->mixer->play(run->click, 1.0f, 0.0f, DRM_NO_CHOKE);
+}
+
+/*
+ * Runs the sequencer for the given frames, rendering blocks of block_size frames
+ * or of random sizes up to 300 if block_size is 0.  Returns the right channel.
+ */
+static std::vector<int16_t> runSequencer(test_run_t *run, uint16_t step_ms, uint8_t swing, uint32_t frames, uint16_t block_size)
+{
+    DRM_mixer     mixer;
+    DRM_sequencer sequencer;
+    std::vector<int16_t> out(frames * 2 + 600);
+    std::vector<int16_t> right(frames);
+
+    run->sequencer = &sequencer;
+    run->mixer = &mixer;
+    run->click = &click;
+    run->frames.clear();
+    run->steps.clear();
+
+    sequencer.begin(&mixer, onStep, run);
+    sequencer.setLength(8);
+    sequencer.setStepTime(step_ms);
+    sequencer.setSwing(swing);
+    sequencer.start();
+
+    uint32_t f = 0;
+    while (f < frames)
+    {
+        uint16_t count = (block_size > 0 ? block_size : 1 + rand() % 300);
+        sequencer.render(&out[f * 2], count);
+        f += count;
+    }
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        right[i] = out[i * 2];
+    }
+
+    // The last block can run past frames
+    while (!run->frames.empty() && run->frames.back() >= frames)
+    {
+        run->frames.pop_back();
+        run->steps.pop_back();
+    }
+    return right;
+}
+
+/*
+ * Straight steps of 250 msec, 5512.5 frames: they must alternate 5512 and 5513
+ * frames forever, not round to one or the other.
+ */
+static void testExact()
+{
+    test_run_t run;
+    uint32_t frames = (uint32_t)(TEST_STEPS * 5512.5);
+    std::vector<int16_t> right = runSequencer(&run, 250, DRM_SEQ_SWING_STRAIGHT, frames, DRM_BLOCK_FRAMES);
+
+    int max_error = 0;
+    bool clicks_ok = true, order_ok = true;
+    for (size_t k = 0; k < run.frames.size(); k++)
+    {
+        uint32_t expect = (uint32_t)ceil(k * 5512.5);
+        int error = abs((int)run.frames[k] - (int)expect);
+        if (error > max_error) max_error = error;
+        if (right[run.frames[k]] != (int16_t)lrintf(CLICK_LEVEL * sinf((float)M_PI / 4))) clicks_ok = false;
+        if (run.steps[k] != k % 8) order_ok = false;
+    }
+
+    // Clicks must be the only sound
+    uint32_t heard = 0;
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        if (right[i] != 0) heard++;
+    }
+
+    printf("%u steps of 5512.5 frames, last at frame %u, max error %d frames\n",
+           (uint32_t)run.frames.size(), run.frames.back(), max_error);
+    check(run.frames.size() == TEST_STEPS && max_error == 0, "steps on exact frames, no drift");
+    check(clicks_ok && heard == run.frames.size(), "hit sounds on its step's frame");
+    check(order_ok, "steps play 0 to 7 in order");
+}
+
+/*
+ * The same run rendered in random block sizes must give the same samples.
+ */
+static void testBlockSizes()
+{
+    test_run_t fixed, random;
+    uint32_t frames = 200 * 3000;
+    std::vector<int16_t> a = runSequencer(&fixed, 137, 60, frames, DRM_BLOCK_FRAMES);
+    std::vector<int16_t> b = runSequencer(&random, 137, 60, frames, 0);
+    std::vector<int16_t> c = runSequencer(&random, 137, 60, frames, 1);
+
+    printf("Block sizes 128, random and 1: %u, %u steps\n", (uint32_t)fixed.frames.size(), (uint32_t)random.frames.size());
+    check(a == b && a == c && fixed.frames == random.frames, "timing independent of block size");
+}
+
+/*
+ * 66% swing: pairs of steps split 2/3 and 1/3.
+ */
+static void testSwing()
+{
+    test_run_t run;
+    runSequencer(&run, 200, 66, 100 * 4410, DRM_BLOCK_FRAMES);
+
+    // 200 msec is 4410 frames, a pair is 8820 split 5821.2 / 2998.8
+    bool ok = true;
+    for (size_t k = 0; k + 1 < run.frames.size(); k++)
+    {
+        double expect = (k / 2) * 8820.0 + (k & 1 ? 5821.2 : 0);
+        if (abs((int)run.frames[k] - (int)ceil(expect - 1e-6)) > 0) ok = false;
+    }
+    printf("Swing 66%%: first steps at %u, %u, %u, %u\n", run.frames[0], run.frames[1], run.frames[2], run.frames[3]);
+    check(ok, "swing splits each pair");
+}
+
+/*
+ * A step time change part way through a step applies from the next step.
+ */
+static void testTempoChange()
+{
+    DRM_mixer     mixer;
+    DRM_sequencer sequencer;
+    test_run_t    run;
+    int16_t       out[DRM_BLOCK_FRAMES * 2];
+
+    run.sequencer = &sequencer;
+    run.mixer = &mixer;
+    run.click = &click;
+    sequencer.begin(&mixer, onStep, &run);
+    sequencer.setStepTime(100);  // 2205 frames
+    sequencer.start();
+
+    uint32_t f = 0;
+    bool changed = false;
+    while (run.frames.size() < 4)
+    {
+        if (!changed && f >= 1000)  // During step 0
+        {
+            sequencer.setStepTime(200);
+            changed = true;
+        }
+        sequencer.render(out, DRM_BLOCK_FRAMES);
+        f += DRM_BLOCK_FRAMES;
+    }
+
+    printf("Tempo change during step 0: steps at %u, %u, %u, %u\n", run.frames[0], run.frames[1], run.frames[2], run.frames[3]);
+    check(run.frames[1] == 2205 && run.frames[2] == 2205 + 4410 && run.frames[3] == 2205 + 2 * 4410, "step time change applies on the next step");
+
+    sequencer.stop();
+    uint32_t count = sequencer.getStepCount();
+    for (int b = 0; b < 100; b++)
+    {
+        sequencer.render(out, DRM_BLOCK_FRAMES);
+    }
+    check(sequencer.getStepCount() == count && !sequencer.getRunning(), "no steps after stop");
+}
+
+/*
+ * MIDI clock at 120 BPM, 24 per beat: a clock every 459.375 frames, given to the
+ * sequencer between blocks as loop() would.  Then the clock stops.
+ */
+static void testClock()
+{
+    DRM_mixer     mixer;
+    DRM_sequencer sequencer;
+    test_run_t    run;
+    int16_t       out[DRM_BLOCK_FRAMES * 2];
+    std::vector<uint32_t> due;   // Frame of the first block rendered after each 6th clock
+
+    run.sequencer = &sequencer;
+    run.mixer = &mixer;
+    run.click = &click;
+    sequencer.begin(&mixer, onStep, &run);
+    sequencer.setStepTime(100);  // 2205 frames, not the clock's 2756.25
+
+    // Clock running before start, as most clock sources do
+    uint32_t f = 0, clocks = 0, start_frame = 0, last_clock = 0;
+    double next_clock = 0;
+    bool started = false;
+    while (clocks < 24 * 8)
+    {
+        if (!started && clocks == 13)
+        {
+            sequencer.start();  // MIDI Start: step 0 on the next clock
+            start_frame = f;    // Steps are counted in frames from here
+            started = true;
+            clocks = 0;
+        }
+        while (next_clock <= f)
+        {
+            sequencer.clock();
+            if (started && clocks % 6 == 0) due.push_back(f - start_frame);
+            last_clock = f - start_frame;
+            clocks++;
+            next_clock += 459.375;
+        }
+        sequencer.render(out, DRM_BLOCK_FRAMES);
+        f += DRM_BLOCK_FRAMES;
+    }
+
+    bool on_clock = (run.frames.size() == due.size());
+    for (size_t k = 0; on_clock && k < due.size(); k++)
+    {
+        if (run.frames[k] != due[k] || run.steps[k] != k % 8) on_clock = false;
+    }
+    printf("MIDI clock: %u steps at %u, %u, %u..., clocks due at %u, %u, %u...\n", (uint32_t)run.frames.size(), 
+           run.frames[0], run.frames[1], run.frames[2], due[0], due[1], due[2]);
+    check(sequencer.getClocked() && on_clock, "steps follow the clock, step 0 on the first after start");
+
+    // Clock stops: the step time takes over, the next step is overdue so it plays at once
+    size_t clocked_steps = run.frames.size();
+    while (run.frames.size() < clocked_steps + 3)
+    {
+        sequencer.render(out, DRM_BLOCK_FRAMES);
+    }
+    uint32_t timeout = DRM_SEQ_CLOCK_TIMEOUT_MS * DRM_SAMPLE_RATE / 1000;
+    uint32_t resumed = run.frames[clocked_steps] - last_clock;
+    printf("Clock stopped: steps at %u, %u, %u after the last clock\n", resumed, 
+           run.frames[clocked_steps + 1] - last_clock, run.frames[clocked_steps + 2] - last_clock);
+    check(!sequencer.getClocked() && resumed >= timeout && resumed <= timeout + DRM_BLOCK_FRAMES &&
+          run.frames[clocked_steps + 2] - run.frames[clocked_steps + 1] == 2205, "own step time after the clock stops");
+}
+
+int main()
+{
+    testExact();
+    testBlockSizes();
+    testSwing();
+    testTempoChange();
+    testClock();
+
+    printf("\n%s\n", passed ? "PASSED" : "FAILED");
+    return passed ? 0 : 1;
+}
@@ -1,5 +1,6 @@
 #include "Player.h"
 #include "esp32_r4ge_pro.h"
+#include <TLM_channel.h>
 
 Player::Player()
 {
@@ -66,7 +67,7 @@ update_result_type Player::update(int16_t controller_y, Ball *ball)
     // 1 - 10 = hit, 5 = center, 1 = top end, 10 = bottom end
     double x_chg = _paddle_angle[hit].x_change;
     double y_chg = _paddle_angle[hit].y_change;
-    Serial.printf("X: %f,  Y: %f", x_chg, y_chg);
+    TLM_DEBUG("Player", "Bounce X: %f,  Y: %f", x_chg, y_chg);
     
     ball->bounce(x_chg, y_chg);
     result = RESULT_BOUNCE;
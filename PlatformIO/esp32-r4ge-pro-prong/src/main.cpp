@@ -14,6 +14,7 @@ There is no warranty; not even for merchantability or fitness for a particular p
 #include "freertos/queue.h"
 #include "Ball.h" 
 #include "Player.h"  
+#include <TLM_channel.h>
 #include "Title.h"  
 #include "Bounce_wav.h"
 #include "Score_wav.h"
@@ -119,6 +120,7 @@ void handleScore();
 void setup() 
 {
   Serial.begin(115200);
+  tlm_channel.begin(&Serial);
   Serial.println("ESP32 R4ge Prong"); 
   delay(100);
 
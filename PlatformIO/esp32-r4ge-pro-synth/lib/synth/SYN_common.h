@@ -14,10 +14,14 @@
 
 #include <Arduino.h>
 
+#define SYN_SAMPLE_RATE   11025
 #define SYN_MAX_VOICES        4
-#define SYN_WAVE_TYPE_COUNT  10
+#define SYN_WAVE_TYPE_COUNT  11
 #define SYN_ROUTE_TYPE_COUNT  4
 #define SYN_SEQ_NOTE_COUNT    8
+#define SYN_LFO_COUNT         2
+#define SYN_LFO_WAVE_TYPE_COUNT  5
+#define SYN_LFO_DEST_TYPE_COUNT  5
 
 
 #define SYN_CFG_HDR_SYN1     0x314E5953  // "SYN1" big-endian
@@ -33,7 +37,8 @@ enum SYN_wave_type
     SYN_WAVE_MAJOR,
     SYN_WAVE_MINOR,
     SYN_WAVE_OCT3,
-    SYN_WAVE_CUSTOM
+    SYN_WAVE_CUSTOM,
+    SYN_WAVE_SAMPLE   // Streamed from SD by SYN_sampler
     // Update SYN_WAVE_TYPE_COUNT above if you add more wave types!
 };
 
@@ -55,6 +60,26 @@ enum SYN_filter_type
     SYN_FLTR_NOTCH
 };
 
+enum SYN_lfo_wave_type
+{
+    SYN_LFO_WAVE_SINE,
+    SYN_LFO_WAVE_TRIANGLE,
+    SYN_LFO_WAVE_SQUARE,
+    SYN_LFO_WAVE_SAMPLE_HOLD,
+    SYN_LFO_WAVE_RANDOM
+    // Update SYN_LFO_WAVE_TYPE_COUNT above if you add more LFO wave types!
+};
+
+enum SYN_lfo_dest_type
+{
+    SYN_LFO_DEST_NONE,
+    SYN_LFO_DEST_OP_LEVEL,
+    SYN_LFO_DEST_PITCH,
+    SYN_LFO_DEST_CUTOFF,
+    SYN_LFO_DEST_PAN
+    // Update SYN_LFO_DEST_TYPE_COUNT above if you add more LFO destinations!
+};
+
 enum SYN_op_mode_type
 {
     SYN_OP_MODE_CARRIER,
@@ -97,6 +122,15 @@ struct SYN_filter_config_t
     bool  active;
 };
 
+struct SYN_lfo_config_t
+{
+    SYN_lfo_wave_type lfo_wave;
+    SYN_lfo_dest_type dest;
+    uint8_t op_num;   // 1-4 for SYN_LFO_DEST_OP_LEVEL, 0 = all operators
+    float rate;       // Hz
+    float depth;      // 0.0 - 1.0
+};
+
 struct SYN_global_config_t
 {
     SYN_route_type route;
@@ -122,6 +156,7 @@ struct SYN_played_note_type
     uint8_t velocity;
     uint8_t status;  // 0 = available/unused, 1 = ready to play/on, 2 = playing, 3 = released, 4 = decaying
     float frequency;
+    float phase_inc; // Oscillator table step per sample for an op frequency ratio of 1.0
     ulong start_time;
     ulong release_time;
 };
@@ -2,7 +2,10 @@
 
 SYN_engine::SYN_engine()
 {    
-
+    for (uint8_t i = 0; i < SYN_ENG_OP_CNT; i++)
+    {
+        _op[i].setSampler(&_sampler);
+    }
 }
 
 /**
@@ -34,18 +37,47 @@ void SYN_engine::setGlobalConfig(SYN_global_config_t *global_cfg)
     _global_cfg.route = global_cfg->route;
 }
 
+/**
+ * @brief Set the configuration for the specified LFO.
+ * 
+ * @param lfo_num The one-based LFO index to change.
+ * @param lfo_cfg The new configuration for the LFO.
+ */
+void SYN_engine::setLfoConfig(uint8_t lfo_num, SYN_lfo_config_t *lfo_cfg)
+{
+    if (lfo_num > 0 && lfo_num <= SYN_LFO_COUNT)
+    {
+        _lfo[lfo_num - 1].setConfig(lfo_cfg);
+    }
+}
+
 
 /**
  * @brief Calculates all sound sample values and writes to the output buffer.
  *        Call continuously on every program loop.
  */
 void SYN_engine::update()
+{
+    update(SYN_ENG_UPDATE_LEN);
+}
+
+/**
+ * @brief Calculates and writes a block of a set length.  A player can split its
+ *        block at each event's sample time so events start on the sample they are due.
+ *
+ * @param length Samples to render, SYN_ENG_MIN_LEN to SYN_ENG_UPDATE_LEN.
+ */
+void SYN_engine::update(uint16_t length)
 {
     ulong elapsed_time;
-    float freq;
+    float phase_inc;
     bool released, data_present = false;
     uint8_t active_note_cnt = 0;
 
+    if (length < SYN_ENG_MIN_LEN) length = SYN_ENG_MIN_LEN;
+    if (length > SYN_ENG_UPDATE_LEN) length = SYN_ENG_UPDATE_LEN;
+    uint32_t block_ms = (length * 1000) / SYN_I2S_SAMPLE_RATE;
+
     for (uint8_t note_idx = 0; note_idx < SYN_MAX_VOICES; note_idx++)
     {
         if (_played_note[note_idx].status > 0)
@@ -55,12 +87,35 @@ void SYN_engine::update()
     }
     // TODO: vary routing/mix level based on # of active notes
 
+    if (active_note_cnt == 0)
+    {
+        // Idle fast path: flush the DMA with silence, then pause output until the next note
+        if (_idle_len < SYN_ENG_IDLE_BLOCKS * SYN_ENG_UPDATE_LEN)
+        {
+            resumeClock();
+            _i2s.playSilence(length);
+            _sample_clock += length;
+            _idle_len += length;
+        }
+        else if (!_clock_paused)
+        {
+            _i2s.pauseAudio();
+            _pause_us = micros();
+            _clock_paused = true;
+        }
+        return;
+    }
+    _idle_len = 0;
+    resumeClock();
+
+    updateLfos(length);
+
     for (uint8_t note_idx = 0; note_idx < SYN_MAX_VOICES; note_idx++)
     {
         if (_played_note[note_idx].start_time > 0 && _played_note[note_idx].status > 0)
         {
             
-            freq = _played_note[note_idx].frequency * _pitch_bend;
+            phase_inc = _played_note[note_idx].phase_inc * _pitch_bend;
             if (_played_note[note_idx].release_time > 0)
             {
                 released = true;
@@ -70,79 +125,87 @@ void SYN_engine::update()
             {
                 released = false;
                 elapsed_time = millis() - _played_note[note_idx].start_time;
+                _played_note[note_idx].status = 2; // playing
+            }
+
+            // A modulator multiplies the voice, so once its release has ended the voice is silent
+            if (released && modulatorEnded(elapsed_time))
+            {
+                retireVoice(note_idx);
+                continue;
             }
 
             if (!data_present)
             {
                 // Initial op data has not been loaded to first op yet
                 // TODO: add volume parameter
-                _op[0].fillBuffer(note_idx, freq, SYN_I2S_SAMPLE_RATE, &_buff, SYN_ENG_UPDATE_LEN, elapsed_time, released);
+                _op[0].fillBuffer(note_idx, phase_inc, &_buff, length, elapsed_time, released);
             }
             else
             {
-                _op[0].mixBuffer(note_idx, freq, SYN_I2S_SAMPLE_RATE, &_buff, SYN_ENG_UPDATE_LEN, elapsed_time, released);
+                _op[0].mixBuffer(note_idx, phase_inc, &_buff, length, elapsed_time, released);
             }
             
             if (_op[1].getActive())
-                _op[1].modulateBuffer(freq, SYN_I2S_SAMPLE_RATE, &_buff, SYN_ENG_UPDATE_LEN, elapsed_time, released, _mod_level);
+                _op[1].modulateBuffer(phase_inc, &_buff, length, elapsed_time, released, _mod_level);
 
             if (_op[2].getActive())
-                _op[2].modulateBuffer(freq, SYN_I2S_SAMPLE_RATE, &_buff, SYN_ENG_UPDATE_LEN, elapsed_time, released, _mod_level);
+                _op[2].modulateBuffer(phase_inc, &_buff, length, elapsed_time, released, _mod_level);
 
             if (_op[3].getActive())
-                _op[3].modulateBuffer(freq, SYN_I2S_SAMPLE_RATE, &_buff, SYN_ENG_UPDATE_LEN, elapsed_time, released, _mod_level);
+                _op[3].modulateBuffer(phase_inc, &_buff, length, elapsed_time, released, _mod_level);
 
             /*
             switch(_global_cfg.route)
             {
                 case SYN_ROUTE_1234:
-                    _op[0].fillBuffer(1, freq, SYN_I2S_SAMPLE_RATE, &_buff, SYN_ENG_UPDATE_LEN, elapsed_time, released);
+                    _op[0].fillBuffer(1, phase_inc, &_buff, SYN_ENG_UPDATE_LEN, elapsed_time, released);
                     
                     if (_op[1].getActive())
-                        _op[1].modulateBuffer(freq, SYN_I2S_SAMPLE_RATE, &_buff, SYN_ENG_UPDATE_LEN, elapsed_time, released, _mod_level);
+                        _op[1].modulateBuffer(phase_inc, &_buff, SYN_ENG_UPDATE_LEN, elapsed_time, released, _mod_level);
 
                     if (_op[2].getActive())
-                        _op[2].modulateBuffer(freq, SYN_I2S_SAMPLE_RATE, &_buff, SYN_ENG_UPDATE_LEN, elapsed_time, released, _mod_level);
+                        _op[2].modulateBuffer(phase_inc, &_buff, SYN_ENG_UPDATE_LEN, elapsed_time, released, _mod_level);
 
                     if (_op[3].getActive())
-                        _op[3].modulateBuffer(freq, SYN_I2S_SAMPLE_RATE, &_buff, SYN_ENG_UPDATE_LEN, elapsed_time, released, _mod_level);
+                        _op[3].modulateBuffer(phase_inc, &_buff, SYN_ENG_UPDATE_LEN, elapsed_time, released, _mod_level);
                     
                     break;
         
                 case SYN_ROUTE_12_34:
-                    _op[0].fillBuffer(0, freq, SYN_I2S_SAMPLE_RATE, &_buff, SYN_ENG_UPDATE_LEN, elapsed_time, released);
+                    _op[0].fillBuffer(0, phase_inc, &_buff, SYN_ENG_UPDATE_LEN, elapsed_time, released);
                     
                     if (_op[1].getActive())
-                        _op[1].modulateBuffer(freq, SYN_I2S_SAMPLE_RATE, &_buff, SYN_ENG_UPDATE_LEN, elapsed_time, released, _mod_level);
+                        _op[1].modulateBuffer(phase_inc, &_buff, SYN_ENG_UPDATE_LEN, elapsed_time, released, _mod_level);
 
-                    _op[2].fillBuffer(0, freq, SYN_I2S_SAMPLE_RATE, &_buff2, SYN_ENG_UPDATE_LEN, elapsed_time, released);
+                    _op[2].fillBuffer(0, phase_inc, &_buff2, SYN_ENG_UPDATE_LEN, elapsed_time, released);
 
                     if (_op[3].getActive())
-                        _op[3].modulateBuffer(freq, SYN_I2S_SAMPLE_RATE, &_buff2, SYN_ENG_UPDATE_LEN, elapsed_time, released, _mod_level);
+                        _op[3].modulateBuffer(phase_inc, &_buff2, SYN_ENG_UPDATE_LEN, elapsed_time, released, _mod_level);
                     
                     mixBuffers();
                     break;
 
                 case SYN_ROUTE_123_4:
-                    _op[0].fillBuffer(0, freq, SYN_I2S_SAMPLE_RATE, &_buff, SYN_ENG_UPDATE_LEN, elapsed_time, released);
+                    _op[0].fillBuffer(0, phase_inc, &_buff, SYN_ENG_UPDATE_LEN, elapsed_time, released);
                     
                     if (_op[1].getActive())
-                        _op[1].modulateBuffer(freq, SYN_I2S_SAMPLE_RATE, &_buff, SYN_ENG_UPDATE_LEN, elapsed_time, released, _mod_level);
+                        _op[1].modulateBuffer(phase_inc, &_buff, SYN_ENG_UPDATE_LEN, elapsed_time, released, _mod_level);
 
                     if (_op[2].getActive())
-                        _op[2].modulateBuffer(freq, SYN_I2S_SAMPLE_RATE, &_buff, SYN_ENG_UPDATE_LEN, elapsed_time, released, _mod_level);
+                        _op[2].modulateBuffer(phase_inc, &_buff, SYN_ENG_UPDATE_LEN, elapsed_time, released, _mod_level);
                     
-                    _op[3].fillBuffer(0, freq, SYN_I2S_SAMPLE_RATE, &_buff2, SYN_ENG_UPDATE_LEN, elapsed_time, released);
+                    _op[3].fillBuffer(0, phase_inc, &_buff2, SYN_ENG_UPDATE_LEN, elapsed_time, released);
                     
                     mixBuffers();
                     break;
 
                 case SYN_ROUTE_1_2_3_4:
-                    _op[0].fillBuffer(0, freq, SYN_I2S_SAMPLE_RATE, &_buff, SYN_ENG_UPDATE_LEN, elapsed_time, released);
-                    _op[1].mixBuffer(0, freq, SYN_I2S_SAMPLE_RATE, &_buff, SYN_ENG_UPDATE_LEN, elapsed_time, released);
+                    _op[0].fillBuffer(0, phase_inc, &_buff, SYN_ENG_UPDATE_LEN, elapsed_time, released);
+                    _op[1].mixBuffer(0, phase_inc, &_buff, SYN_ENG_UPDATE_LEN, elapsed_time, released);
                     
-                    _op[2].fillBuffer(0, freq, SYN_I2S_SAMPLE_RATE, &_buff2, SYN_ENG_UPDATE_LEN, elapsed_time, released);
-                    _op[3].mixBuffer(0, freq, SYN_I2S_SAMPLE_RATE, &_buff2, SYN_ENG_UPDATE_LEN, elapsed_time, released);
+                    _op[2].fillBuffer(0, phase_inc, &_buff2, SYN_ENG_UPDATE_LEN, elapsed_time, released);
+                    _op[3].mixBuffer(0, phase_inc, &_buff2, SYN_ENG_UPDATE_LEN, elapsed_time, released);
                     
                     mixBuffers();
                     break;
@@ -158,21 +221,24 @@ void SYN_engine::update()
 
     
     if (data_present &&_fltr.getActive())
-        _fltr.apply(&_buff, SYN_ENG_UPDATE_LEN);
+        _fltr.apply(&_buff, length);
 
     // TODO: other operators and effects
     
     if (!data_present)
     {
         // Zero out the audio buffer
-        for (size_t i = 0; i < SYN_ENG_UPDATE_LEN; i++)
+        for (size_t i = 0; i < length; i++)
             _buff.push(0); 
     }
     
-    _buff.updateComplete(SYN_ENG_UPDATE_LEN);
+    _buff.updateComplete(length);
     //Serial.print("Buff read size: "); Serial.println(_buff.getReadPopSize());
 
-    _i2s.playAudio(&_buff, SYN_ENG_UPDATE_LEN);
+    _i2s.playAudio(&_buff, length);
+    _sample_clock += length;
+
+    cullVoices(block_ms);
 }
 
 /**
@@ -195,15 +261,14 @@ void SYN_engine::noteOn(uint8_t channel, uint8_t note_num, uint8_t velocity)
     _played_note[_note_idx].start_time = millis();
     _played_note[_note_idx].release_time = 0; // not released
 
-    if (note_num >= 48 && note_num <= 100)
-    {
-        //note_freq = getFrequency(pitch);
-        _played_note[_note_idx].frequency = midi_note[note_num - SYN_MIDI_NOTE_OFFSET].frequency;
-    }
+    _played_note[_note_idx].phase_inc = _tuning.getPhaseInc(note_num);
+    _played_note[_note_idx].frequency = _tuning.getFrequency(note_num);
+
+    // Only the carrier plays samples, so only stream from SD when it needs them
+    if (_op[0].getWave() == SYN_WAVE_SAMPLE)
+        _sampler.startVoice(_note_idx, note_num);
     else
-    {
-        _played_note[_note_idx].frequency = 0;
-    }
+        _sampler.stopVoice(_note_idx);
   
     _note_idx = (_note_idx + 1) % SYN_MAX_VOICES;
 }
@@ -220,7 +285,7 @@ void SYN_engine::noteOff(uint8_t channel, uint8_t note_num)
     {
         if (channel == _played_note[i].channel && 
             note_num == _played_note[i].note_num && 
-            _played_note[i].status != 3
+            (_played_note[i].status == 1 || _played_note[i].status == 2)  // ignore released & retired voices
             )
         {
             _played_note[i].release_time = millis();
@@ -229,6 +294,22 @@ void SYN_engine::noteOff(uint8_t channel, uint8_t note_num)
     }
 }
 
+/**
+ * @brief Release every playing note, like MIDI All Notes Off.  
+ *        The voices fade out with their envelopes' release.
+ */
+void SYN_engine::allNotesOff()
+{
+    for (uint8_t i = 0; i < SYN_MAX_VOICES; i++)
+    {
+        if (_played_note[i].status == 1 || _played_note[i].status == 2)
+        {
+            _played_note[i].release_time = millis();
+            _played_note[i].status = 3;  // released
+        }
+    }
+}
+
 /**
  * @brief Turn all sounds off and shut down audio engine.  
  *        Similar to MIDI panic. 
@@ -240,6 +321,7 @@ void SYN_engine::allOff()
         //_played_note[i].frequency = 0;
         _played_note[i].start_time = 0;
         _played_note[i].status = 0;  // available
+        _sampler.stopVoice(i);
     }
     
     _i2s.stopAudio();
@@ -256,17 +338,230 @@ void SYN_engine::modLevel(float modulation)
 }
 
 /**
- * @brief Set the pitch bend (frequency multiplier) value.  1.0 = no bend.
+ * @brief Set the pitch bend in semitones.  0 = no bend.
+ *        Converted to a frequency multiplier once here rather than on every block.
  * 
- * @param bend The frequency multiplier to apply to the base note frequency.
+ * @param semitones The pitch offset to apply to all playing notes.
+ */
+void SYN_engine::pitchBend(float semitones)
+{
+    _pitch_bend = _tuning.semitonesToRatio(semitones);
+}
+
+/**
+ * @brief Gets the current pan position set by any LFO routed to SYN_LFO_DEST_PAN.
+ *        The I2S output is mono, so this is provided for stereo consumers.
+ * 
+ * @return float -1.0 = left, 0 = center, 1.0 = right
+ */
+float SYN_engine::getPan()
+{
+    return _pan;
+}
+
+/**
+ * @brief Loads a Scala (.scl) microtuning for all notes.
+ * 
+ * @param scl_text The text of the .scl file.
+ * @return true    The scale was loaded.
+ * @return false   Invalid scale, the current tuning is unchanged.
+ */
+bool SYN_engine::loadScale(const char *scl_text)
+{
+    return _tuning.loadScale(scl_text);
+}
+
+/**
+ * @brief Restores standard 12 tone equal temperament.
+ */
+void SYN_engine::resetScale()
+{
+    _tuning.resetScale();
+}
+
+/**
+ * @brief Loads the multisample zones for SYN_WAVE_SAMPLE operators and starts 
+ *        the background prefetch task that streams them from the SD card.
+ * 
+ * @param folder   SD card folder of WAV files named by root note, e.g. 060.WAV
+ * @return uint8_t Number of sample zones loaded.
+ */
+uint8_t SYN_engine::loadSamples(const char *folder)
+{
+    uint8_t zone_cnt = _sampler.load(folder);
+
+    if (zone_cnt > 0)
+    {
+        _sampler.begin();
+    }
+    return zone_cnt;
+}
+
+/**
+ * @brief Gets the sample clock, the samples written to the output so far.  While 
+ *        output is paused for silence it keeps counting in real time, so it can 
+ *        time songs and sequences through rests.
+ */
+uint32_t SYN_engine::getSampleClock()
+{
+    if (!_clock_paused) return _sample_clock;
+    return _sample_clock + (uint32_t)((uint64_t)(micros() - _pause_us) * SYN_SAMPLE_RATE / 1000000);
+}
+
+/**
+ * @brief Gets the sample streaming statistics, including prefetch misses.
  */
-void SYN_engine::pitchBend(float bend)
+void SYN_engine::getSamplerStats(SYN_sampler_stats_t *stats)
 {
-    _pitch_bend = bend;
+    _sampler.getStats(stats);
+}
+
+/**
+ * @brief Takes the SD card from the sample prefetch task.  Hold it around every 
+ *        other SD access, and release it with unlockSD() as soon as possible.
+ */
+void SYN_engine::lockSD()
+{
+    _sampler.lockSD();
+}
+
+void SYN_engine::unlockSD()
+{
+    _sampler.unlockSD();
 }
 
 // ------ PRIVATE METHODS ------//
 
+/**
+ * @brief Carries the sample clock on from the time spent paused, before output restarts.
+ */
+void SYN_engine::resumeClock()
+{
+    if (!_clock_paused) return;
+    _sample_clock = getSampleClock();
+    _clock_paused = false;
+}
+
+/**
+ * @brief Advances the LFO bank by one block at control rate and hands the 
+ *        start/end values to the operators and filter for interpolation.
+ */
+void SYN_engine::updateLfos(uint16_t length)
+{
+    float block_sec = (float)length / SYN_I2S_SAMPLE_RATE;
+    float lvl_start[SYN_ENG_OP_CNT], lvl_end[SYN_ENG_OP_CNT];
+    float pitch_start = 1.0, pitch_end = 1.0;
+    float cutoff_start = 0, cutoff_end = 0;
+    float semitones, depth, start_val, end_val;
+    uint8_t op_num;
+
+    for (uint8_t i = 0; i < SYN_ENG_OP_CNT; i++)
+    {
+        lvl_start[i] = 1.0;
+        lvl_end[i] = 1.0;
+    }
+    _pan = 0;
+
+    for (uint8_t i = 0; i < SYN_LFO_COUNT; i++)
+    {
+        if (!_lfo[i].getActive()) continue;
+
+        _lfo[i].update(block_sec);
+        depth = _lfo[i].getDepth();
+        start_val = _lfo[i].getStartValue();
+        end_val = _lfo[i].getEndValue();
+
+        switch (_lfo[i].getDest())
+        {
+            case SYN_LFO_DEST_OP_LEVEL:
+                // Tremolo: swing between full level and (1 - depth)
+                op_num = _lfo[i].getOpNum();
+                for (uint8_t op = 0; op < SYN_ENG_OP_CNT; op++)
+                {
+                    if (op_num != 0 && op_num != op + 1) continue;
+                    lvl_start[op] *= 1.0 - depth * (1.0 - start_val) / 2;
+                    lvl_end[op]   *= 1.0 - depth * (1.0 - end_val) / 2;
+                }
+                break;
+
+            case SYN_LFO_DEST_PITCH:
+                semitones = depth * SYN_LFO_PITCH_RANGE;
+                pitch_start *= _tuning.semitonesToRatio(start_val * semitones);
+                pitch_end   *= _tuning.semitonesToRatio(end_val * semitones);
+                break;
+
+            case SYN_LFO_DEST_CUTOFF:
+                cutoff_start += start_val * depth * SYN_LFO_CUTOFF_RANGE;
+                cutoff_end   += end_val * depth * SYN_LFO_CUTOFF_RANGE;
+                break;
+
+            case SYN_LFO_DEST_PAN:
+                _pan += end_val * depth;
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    for (uint8_t i = 0; i < SYN_ENG_OP_CNT; i++)
+    {
+        _op[i].setLevelRamp(lvl_start[i], lvl_end[i]);
+        _op[i].setPitchRamp(pitch_start, pitch_end);
+    }
+    _fltr.setCutoffRamp(cutoff_start, cutoff_end);
+
+    if (_pan < -1.0) _pan = -1.0;
+    if (_pan > 1.0) _pan = 1.0;
+}
+
+/**
+ * @brief Frees any released voices whose carrier envelope has decayed below
+ *        SYN_ENG_CULL_LVL by the end of the block just rendered.
+ * 
+ * @param block_ms Duration of one update block in milliseconds.
+ */
+void SYN_engine::cullVoices(uint32_t block_ms)
+{
+    ulong elapsed_time;
+
+    for (uint8_t i = 0; i < SYN_MAX_VOICES; i++)
+    {
+        if (_played_note[i].status != 3) continue;
+
+        elapsed_time = millis() - _played_note[i].release_time + block_ms;
+        if (_op[0].getEvelopeAmp(elapsed_time, true) < SYN_ENG_CULL_LVL || modulatorEnded(elapsed_time))
+        {
+            retireVoice(i);
+        }
+    }
+}
+
+/**
+ * @brief Checks for an active modulator whose release has ended.  Its envelope stays
+ *        at 0, which multiplies the voice to silence.
+ * 
+ * @param elapsed_ms Milliseconds since the note was released.
+ */
+bool SYN_engine::modulatorEnded(uint32_t elapsed_ms)
+{
+    for (uint8_t op = 1; op < SYN_ENG_OP_CNT; op++)
+    {
+        if (_op[op].getActive() && _op[op].getEvelopeAmp(elapsed_ms, true) <= 0) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Frees a voice for the next note.
+ */
+void SYN_engine::retireVoice(uint8_t voice)
+{
+    _played_note[voice].start_time = 0;
+    _played_note[voice].status = 0;  // available
+    _sampler.stopVoice(voice);
+}
+
 void SYN_engine::mixBuffers()
 {
     float sample;
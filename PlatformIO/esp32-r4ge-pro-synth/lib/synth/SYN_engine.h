@@ -5,14 +5,20 @@
 #include "SYN_buffer.h"
 #include "SYN_filter.h"
 #include "SYN_i2s.h"
+#include "SYN_lfo.h"
 #include "SYN_midi.h"
 #include "SYN_operator.h"
+#include "SYN_sampler.h"
+#include "SYN_tuning.h"
 
 #define SYN_ENG_OP_CNT         4
 #define SYN_ENG_FILTER_CNT     1
 #define SYN_ENG_AUDIO_LEN   8192  // Must be power of 2 
 #define SYN_ENG_UPDATE_LEN  1024
 #define SYN_ENG_PLAY_LEN    1024
+#define SYN_ENG_CULL_LVL    0.001  // Released voices below this envelope level are retired
+#define SYN_ENG_IDLE_BLOCKS     2  // Silent blocks written to flush the DMA before pausing output
+#define SYN_ENG_MIN_LEN        32  // Shortest block rendered when a block is split at an event (~3 ms)
 
 class SYN_engine
 {
@@ -21,19 +27,38 @@ class SYN_engine
     void setOpConfig(uint8_t op_num, SYN_op_config_t *op_cfg);
     void setFilterConfig(uint8_t filter_num, SYN_filter_config_t *filter_cfg);
     void setGlobalConfig(SYN_global_config_t *global_cfg);
+    void setLfoConfig(uint8_t lfo_num, SYN_lfo_config_t *lfo_cfg);
     void update();
+    void update(uint16_t length);
     void noteOn(uint8_t channel, uint8_t note_num, uint8_t velocity);
     void noteOff(uint8_t channel, uint8_t note_num);
     void allOff();
-    void pitchBend(float bend);
+    void allNotesOff();
+    void pitchBend(float semitones);
     void modLevel(float modulation);
+    float getPan();
+    bool  loadScale(const char *scl_text);
+    void  resetScale();
+    uint8_t loadSamples(const char *folder);
+    void  getSamplerStats(SYN_sampler_stats_t *stats);
+    uint32_t getSampleClock();
+    void  lockSD();
+    void  unlockSD();
     
     
   private:
     void mixBuffers();
+    void cullVoices(uint32_t block_ms);
+    bool modulatorEnded(uint32_t elapsed_ms);
+    void retireVoice(uint8_t voice);
+    void updateLfos(uint16_t length);
+    void resumeClock();
 
     SYN_operator _op[SYN_ENG_OP_CNT];
     SYN_filter _fltr = SYN_filter();
+    SYN_lfo _lfo[SYN_LFO_COUNT];
+    SYN_tuning _tuning = SYN_tuning();
+    SYN_sampler _sampler = SYN_sampler();
     SYN_i2s _i2s = SYN_i2s(SYN_I2S_DEFAULT_LRCK_PIN, SYN_I2S_DEFAULT_BCLK_PIN, SYN_I2S_DEFAULT_DOUT_PIN);
     SYN_buffer _buff  = SYN_buffer(SYN_ENG_AUDIO_LEN);
     SYN_buffer _buff2 = SYN_buffer(SYN_ENG_UPDATE_LEN * 2);  // 8192 caused blank screen and garbled serial output
@@ -41,13 +66,18 @@ class SYN_engine
     
     SYN_played_note_type _played_note[SYN_MAX_VOICES];
     uint8_t              _note_idx = 0;
+    uint32_t             _idle_len = 0;         // Silent samples written since the last note
+    uint32_t             _sample_clock = 0;     // Samples written to the output
+    bool                 _clock_paused = true;  // Output paused, the clock runs on micros()
+    uint32_t             _pause_us = 0;         // When the output paused
 
     //float    _note_freq[SYN_ENG_OP_CNT]; 
     //uint64_t _note_chg_time[SYN_ENG_OP_CNT];
     //bool     _released[SYN_ENG_OP_CNT];
     
     float    _mod_level = 1.0;  // No modulation change
-    float    _pitch_bend = 1.0; // No pitch bend
+    float    _pitch_bend = 1.0; // Pitch bend frequency multiplier, 1.0 = no bend
+    float    _pan = 0;          // -1.0 = left, 0 = center, 1.0 = right
 };
 
 #endif // _SYN_ENGINE_
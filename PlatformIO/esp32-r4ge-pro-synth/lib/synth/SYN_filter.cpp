@@ -44,12 +44,20 @@ float SYN_filter::next(float sample)
 void SYN_filter::apply(SYN_buffer *buff, size_t length)
 {
     float sample = 0;
-    float yn;
+    float yn, a0, a1;
+    float mod = _mod_start;
+    float mod_step = (_mod_end - _mod_start) / length;
 
     for(size_t i = 0; i < length; i++) 
     {   
+        a1 = _a1 + mod;
+        if (a1 < 0) a1 = 0;
+        if (a1 > 1) a1 = 1;
+        a0 = a1 - 1.0;
+        mod += mod_step;
+
         buff->peek(&sample, i);
-        yn = _a0 * sample + _a1 * _z1;
+        yn = a0 * sample + a1 * _z1;
         buff->write(yn, i);
     }
     _z1 = sample;
@@ -63,4 +71,17 @@ bool SYN_filter::getActive()
 void SYN_filter::setActive(bool active)
 {
     _active = active;
+}
+
+/**
+ * @brief Set the LFO cutoff modulation for the next block.  
+ *        The offset is added to the filter coefficient and interpolated across the block.
+ * 
+ * @param start_mod Coefficient offset at the first sample of the block.
+ * @param end_mod   Coefficient offset at the last sample of the block.
+ */
+void SYN_filter::setCutoffRamp(float start_mod, float end_mod)
+{
+    _mod_start = start_mod;
+    _mod_end = end_mod;
 }
\ No newline at end of file
@@ -16,6 +16,7 @@ class SYN_filter
     void  apply(SYN_buffer *buff, size_t length);
     bool  getActive();
     void  setActive(bool active);
+    void  setCutoffRamp(float start_mod, float end_mod);
     
   private:
     SYN_filter_type _filter_type;
@@ -25,6 +26,8 @@ class SYN_filter
     float  _a0, _a1;
     float  _z0, _z1;
     bool   _active = false;
+    float  _mod_start = 0;  // LFO coefficient offset at start of block
+    float  _mod_end = 0;    // LFO coefficient offset at end of block
 };
 
 #endif // _SYN_FILTER_
\ No newline at end of file
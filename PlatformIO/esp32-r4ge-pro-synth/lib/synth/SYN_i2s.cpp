@@ -1,4 +1,5 @@
 #include "SYN_i2s.h"
+#include <TLM_channel.h>
 
 SYN_i2s::SYN_i2s(int lrck_pin, int bclk_pin, int dout_pin)
 {
@@ -59,7 +60,7 @@ bool SYN_i2s::initAudio()
 void SYN_i2s::playAudio(SYN_buffer *buff, size_t length)
 {
   bool     audio_playing = false;
-  int      sample_pos = 0;
+  size_t   sample_pos = 0;
   float    buff_val = 0;
   int16_t  temp = 0;
   size_t   samples_read = 0;
@@ -67,19 +68,15 @@ void SYN_i2s::playAudio(SYN_buffer *buff, size_t length)
   uint8_t  audio_buffer[SYN_I2S_BUFFER_SIZE];
   SYN_buff_err err;
 
-  if (!_initialized)
-  {
-      audio_playing = initAudio();
-  }  
-  else
-  {
-      audio_playing = true;
-  }
+  audio_playing = resumeAudio();
   
-  // Fill I2S transfer audio buffer from sample buffer
+  // Fill I2S transfer audio buffer from sample buffer, the last transfer may be short
   while (audio_playing)
   {
-    for (int i = 0; i < SYN_I2S_SAMPLES_PER_BUFFER; i++)
+    size_t count = length - sample_pos;
+    if (count > SYN_I2S_SAMPLES_PER_BUFFER) count = SYN_I2S_SAMPLES_PER_BUFFER;
+
+    for (size_t i = 0; i < count; i++)
     {
         // get the next sample from the buffer
         err = buff->pop(&buff_val);
@@ -89,7 +86,7 @@ void SYN_i2s::playAudio(SYN_buffer *buff, size_t length)
         }
         else
         {
-            Serial.print(F("I2S play buffer pop error: ")); Serial.println(err);
+            TLM_ERROR("I2S", "Play buffer pop error: %d", (int)err);
             audio_playing = false;
             buff_val = 0;
             break;
@@ -104,17 +101,79 @@ void SYN_i2s::playAudio(SYN_buffer *buff, size_t length)
     }
     
     // Write data to I2S DMA buffer.  Blocking call, last parameter = ticks to wait or portMAX_DELAY for no timeout
-    i2s_write((i2s_port_t)_port_num, (const char *)&audio_buffer, sizeof(audio_buffer), &bytes_out, 100);
-    if (bytes_out != sizeof(audio_buffer)) Serial.println("I2S write timeout");
+    i2s_write((i2s_port_t)_port_num, (const char *)&audio_buffer, count * 2, &bytes_out, 100);
+    if (bytes_out != count * 2) TLM_WARN("I2S", "Write timeout, %u of %u bytes", bytes_out, count * 2);
 
-    sample_pos += SYN_I2S_SAMPLES_PER_BUFFER;
-    if (sample_pos >= length - 1) audio_playing = false;
+    sample_pos += count;
+    if (sample_pos >= length) audio_playing = false;
   }
   buff->readComplete(samples_read);
 }
 
+/*
+ * Writes silence straight to the I2S DMA buffers without going through a sample buffer.
+ * Used by the engine when no voices are sounding.
+ */
+void SYN_i2s::playSilence(size_t length)
+{
+  static const uint8_t silence_buffer[SYN_I2S_BUFFER_SIZE] = { 0 };
+  size_t   bytes_out = 0;
+  size_t   sample_pos = 0;
+
+  if (!resumeAudio()) return;
+
+  while (sample_pos < length)
+  {
+    size_t count = length - sample_pos;
+    if (count > SYN_I2S_SAMPLES_PER_BUFFER) count = SYN_I2S_SAMPLES_PER_BUFFER;
+
+    i2s_write((i2s_port_t)_port_num, (const char *)&silence_buffer, count * 2, &bytes_out, 100);
+    sample_pos += count;
+  }
+}
+
+/*
+ * Clears the DMA buffers and halts the I2S clock, leaving the driver installed.
+ * The next playAudio() or playSilence() call restarts output.
+ */
+void SYN_i2s::pauseAudio()
+{
+  if (!_initialized || _paused) return;
+
+  i2s_zero_dma_buffer((i2s_port_t)_port_num);
+  i2s_stop((i2s_port_t)_port_num);
+  _paused = true;
+}
+
+bool SYN_i2s::getPaused()
+{
+  return _paused;
+}
+
 void SYN_i2s::stopAudio()
 {
   i2s_driver_uninstall((i2s_port_t)_port_num);
   _initialized = false;
+  _paused = false;
+}
+
+// ------ PRIVATE METHODS ------//
+
+/*
+ * Makes sure the I2S driver is installed and running.
+ * Returns true if audio output is available.
+ */
+bool SYN_i2s::resumeAudio()
+{
+  if (!_initialized)
+  {
+    return initAudio();
+  }
+
+  if (_paused)
+  {
+    i2s_start((i2s_port_t)_port_num);
+    _paused = false;
+  }
+  return true;
 }
\ No newline at end of file
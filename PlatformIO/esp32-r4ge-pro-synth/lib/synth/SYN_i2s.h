@@ -9,7 +9,7 @@
 #define SYN_I2S_DEFAULT_BCLK_PIN  26
 #define SYN_I2S_DEFAULT_DOUT_PIN   4
 
-#define SYN_I2S_SAMPLE_RATE     11025
+#define SYN_I2S_SAMPLE_RATE     SYN_SAMPLE_RATE
 #define SYN_I2S_DMA_BUFF_CNT        8
 #define SYN_I2S_DMA_BUFF_LEN       64
 
@@ -22,14 +22,20 @@ class SYN_i2s
     SYN_i2s(int lrck_pin, int bclk_pin, int dout_pin);
     bool initAudio();
     void playAudio(SYN_buffer *buff, size_t length);
+    void playSilence(size_t length);
+    void pauseAudio();
+    bool getPaused();
     void stopAudio();
     
     
   private:
+    bool resumeAudio();
+
     int _port_num; 
     i2s_config_t _i2s_config;
     i2s_pin_config_t _pin_config;
     bool _initialized;
+    bool _paused = false;
 };
 
 #endif // _SYN_I2S_
\ No newline at end of file
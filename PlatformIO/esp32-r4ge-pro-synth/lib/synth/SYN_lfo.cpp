@@ -0,0 +1,143 @@
+#include "SYN_lfo.h"
+
+SYN_lfo::SYN_lfo()
+{
+    getDefaultConfig(&_lfo_cfg);
+}
+
+/**
+ * @brief Get the configuration of an LFO that does nothing, as a new LFO has.
+ * 
+ * @param lfo_cfg The configuration to fill.
+ */
+void SYN_lfo::getDefaultConfig(SYN_lfo_config_t *lfo_cfg)
+{
+    *lfo_cfg = {
+        .lfo_wave = SYN_LFO_WAVE_SINE,
+        .dest = SYN_LFO_DEST_NONE,
+        .op_num = 0,
+        .rate = 0,
+        .depth = 0
+    };
+}
+
+/**
+ * @brief Set the LFO configuration and restart the cycle.
+ * 
+ * @param lfo_cfg 
+ */
+void SYN_lfo::setConfig(SYN_lfo_config_t *lfo_cfg)
+{
+    _lfo_cfg = {
+        .lfo_wave = lfo_cfg->lfo_wave,
+        .dest = lfo_cfg->dest,
+        .op_num = lfo_cfg->op_num,
+        .rate = lfo_cfg->rate,
+        .depth = lfo_cfg->depth
+    };
+
+    reset();
+}
+
+void SYN_lfo::reset()
+{
+    _phase = 0;
+    _start_val = 0;
+    _end_val = 0;
+    _hold_val = nextRandom();
+    _rand_from = _hold_val;
+    _rand_to = nextRandom();
+}
+
+/**
+ * @brief Advances the LFO by one control block.  
+ *        The previous end value becomes the new start value.
+ * 
+ * @param block_sec Duration of the control block in seconds.
+ * @return float    The LFO value at the end of the block (-1.0 to 1.0).
+ */
+float SYN_lfo::update(float block_sec)
+{
+    _start_val = _end_val;
+
+    _phase += _lfo_cfg.rate * block_sec;
+    if (_phase >= 1.0)
+    {
+        _phase -= (int)_phase;
+
+        // New cycle: pick new random values
+        _hold_val = nextRandom();
+        _rand_from = _rand_to;
+        _rand_to = nextRandom();
+    }
+
+    switch (_lfo_cfg.lfo_wave)
+    {
+        case SYN_LFO_WAVE_SINE:
+            _end_val = sin(2 * PI * _phase);
+            break;
+        case SYN_LFO_WAVE_TRIANGLE:
+            _end_val = (_phase < 0.5) ? (4 * _phase - 1) : (3 - 4 * _phase);
+            break;
+        case SYN_LFO_WAVE_SQUARE:
+            _end_val = (_phase < 0.5) ? 1 : -1;
+            break;
+        case SYN_LFO_WAVE_SAMPLE_HOLD:
+            _end_val = _hold_val;
+            break;
+        case SYN_LFO_WAVE_RANDOM:
+            _end_val = _rand_from + (_rand_to - _rand_from) * _phase;
+            break;
+        default:
+            _end_val = 0;
+            break;
+    }
+
+    return _end_val;
+}
+
+float SYN_lfo::getStartValue()
+{
+    return _start_val;
+}
+
+float SYN_lfo::getEndValue()
+{
+    return _end_val;
+}
+
+bool SYN_lfo::getActive()
+{
+    return (_lfo_cfg.dest != SYN_LFO_DEST_NONE && _lfo_cfg.depth > 0 && _lfo_cfg.rate > 0);
+}
+
+SYN_lfo_dest_type SYN_lfo::getDest()
+{
+    return _lfo_cfg.dest;
+}
+
+uint8_t SYN_lfo::getOpNum()
+{
+    return _lfo_cfg.op_num;
+}
+
+float SYN_lfo::getDepth()
+{
+    return _lfo_cfg.depth;
+}
+
+//----- PRIVATE METHODS -----//
+
+/**
+ * @brief Xorshift pseudo random number generator.  Cheap and repeatable.
+ * 
+ * @return float Random value from -1.0 to 1.0
+ */
+float SYN_lfo::nextRandom()
+{
+    _seed ^= _seed << 13;
+    _seed ^= _seed >> 17;
+    _seed ^= _seed << 5;
+
+    return ((float)(_seed & 0xFFFF) / 32768.0) - 1.0;
+}
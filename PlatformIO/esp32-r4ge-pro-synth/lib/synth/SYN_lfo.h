@@ -0,0 +1,52 @@
+/**
+ * @file SYN_lfo.h
+ * @author Paul Pagel (https://twobittinker.com)
+ * @brief  Low frequency oscillator evaluated at control rate.
+ *         The LFO is advanced once per engine update block and the consumer 
+ *         interpolates between the start and end values across the block.
+ *         Output range: -1.0 to 1.0
+ * @version 0.1
+ * @date 2020-08-22
+ * 
+ * @copyright Copyright (c) 2020
+ * 
+ */
+
+#ifndef _SYN_LFO_
+#define _SYN_LFO_
+
+#include <Arduino.h>
+#include "SYN_common.h"
+
+#define SYN_LFO_PITCH_RANGE   2.0  // Semitones of pitch swing at full depth
+#define SYN_LFO_CUTOFF_RANGE  0.5  // Filter coefficient swing at full depth
+
+class SYN_lfo
+{
+  public:
+    SYN_lfo();
+    void  setConfig(SYN_lfo_config_t *lfo_cfg);
+    static void getDefaultConfig(SYN_lfo_config_t *lfo_cfg);
+    void  reset();
+    float update(float block_sec);
+    float getStartValue();
+    float getEndValue();
+    bool  getActive();
+    SYN_lfo_dest_type getDest();
+    uint8_t getOpNum();
+    float getDepth();
+    
+  private:
+    float nextRandom();
+
+    SYN_lfo_config_t _lfo_cfg;
+    float    _phase = 0;       // 0.0 - 1.0
+    float    _start_val = 0;
+    float    _end_val = 0;
+    float    _hold_val = 0;    // sample & hold output
+    float    _rand_from = 0;   // random glide start
+    float    _rand_to = 0;     // random glide target
+    uint32_t _seed = 0x1234567;
+};
+
+#endif // _SYN_LFO_
@@ -1,4 +1,5 @@
 #include "SYN_operator.h"
+#include "SYN_sampler.h"
 
 SYN_operator::SYN_operator()
 {
@@ -31,6 +32,9 @@ void SYN_operator::setConfig(SYN_op_config_t *op_cfg)
         .rel_dur = op_cfg->rel_dur
     };
 
+    // Fixed frequency modulators ignore the note, so their step only changes with the config
+    _fixed_step = _op_cfg.osc_freq * SYN_OP_OSC_LEN / SYN_SAMPLE_RATE;
+
     reset();
     fillOscTable();
 }
@@ -38,29 +42,39 @@ void SYN_operator::setConfig(SYN_op_config_t *op_cfg)
 /**
  * @brief Push data to the audio output buffer as a signal carrier.
  * 
+ * @param voice      The voice index, used to track the oscillator position.
+ * @param phase_inc  The note's oscillator phase increment from SYN_tuning.
  * @param buff       The audio output buffer.
  * @param length     The number of samples to calculate and push.
  * @param elapsed_ms Milliseconds since the note was triggered or released.
  * @param released   If true, elapsed_ms is time from note release.  
  *                   If false, elapsed_ms is time from note trigger.
  */
-void SYN_operator::fillBuffer(uint8_t voice, float frequency, float sample_rate, SYN_buffer *buff, 
+void SYN_operator::fillBuffer(uint8_t voice, float phase_inc, SYN_buffer *buff, 
                               size_t length, uint32_t elapsed_ms, bool released)
 {
-    float osc_step, osc_idx, sample, amp, ms_per_sample;
+    float osc_step, osc_idx, sample, amp;
+    float lvl = _lvl_start;
+    float lvl_step = (_lvl_end - _lvl_start) / length;
+    float pitch = _pitch_start;
+    float pitch_step = (_pitch_end - _pitch_start) / length;
 
-    osc_step = getOscStep(frequency, sample_rate);
-    ms_per_sample = 1000 / sample_rate;
+    osc_step = getOscStep(phase_inc);
 
     osc_idx = _osc_idx[voice];
 
+    bool streamed = (_op_cfg.osc_wave == SYN_WAVE_SAMPLE && _sampler != NULL);
+
     for(size_t i = 0; i < length; i++) 
     {
-        amp = getEvelopeAmp(elapsed_ms + (uint32_t)((float)i * ms_per_sample), released); 
-        sample = amp * _osc_table[(size_t)osc_idx] * _op_cfg.osc_lvl;
+        amp = getEvelopeAmp(elapsed_ms + (uint32_t)((float)i * SYN_OP_MS_PER_SAMPLE), released); 
+        sample = (streamed ? _sampler->nextSample(voice, osc_step * pitch) : _osc_table[(size_t)osc_idx]);
+        sample *= amp * _op_cfg.osc_lvl * lvl;
         buff->push(sample);
 
-        osc_idx += osc_step;
+        osc_idx += osc_step * pitch;
+        lvl += lvl_step;
+        pitch += pitch_step;
 
         // Apply a generalized modulus, allowing for positive and negative frequencies
         while (osc_idx >= SYN_OP_OSC_LEN) osc_idx -= SYN_OP_OSC_LEN;
@@ -72,27 +86,38 @@ void SYN_operator::fillBuffer(uint8_t voice, float frequency, float sample_rate,
 /**
  * @brief Mix data to the audio output buffer as a secondary signal carrier.
  * 
+ * @param voice      The voice index, used to track the oscillator position.
+ * @param phase_inc  The note's oscillator phase increment from SYN_tuning.
  * @param buff       The audio output buffer.
  * @param length     The number of samples to calculate and update.
  * @param elapsed_ms Milliseconds since the note was triggered or released.
  * @param released   If true, elapsed_ms is time from note release.  
  *                   If false, elapsed_ms is time from note trigger.
  */
-void SYN_operator::mixBuffer(uint8_t voice, float frequency, float sample_rate, SYN_buffer *buff, 
+void SYN_operator::mixBuffer(uint8_t voice, float phase_inc, SYN_buffer *buff, 
                              size_t length, uint32_t elapsed_ms, bool released)
 {
     float osc_step, osc_idx, sample, amp;
+    float lvl = _lvl_start;
+    float lvl_step = (_lvl_end - _lvl_start) / length;
+    float pitch = _pitch_start;
+    float pitch_step = (_pitch_end - _pitch_start) / length;
     
-    osc_step = getOscStep(frequency, sample_rate);
+    osc_step = getOscStep(phase_inc);
     osc_idx = _osc_idx[voice];
 
+    bool streamed = (_op_cfg.osc_wave == SYN_WAVE_SAMPLE && _sampler != NULL);
+
     for(size_t i = 0; i < length; i++) 
     {    
         amp = getEvelopeAmp(elapsed_ms + (uint32_t)((float)i * 0.01), released); 
-        sample = amp * _osc_table[(size_t)osc_idx] * _op_cfg.osc_lvl;
+        sample = (streamed ? _sampler->nextSample(voice, osc_step * pitch) : _osc_table[(size_t)osc_idx]);
+        sample *= amp * _op_cfg.osc_lvl * lvl;
         buff->update(sample, 0.5, i); // average this op with existing audio 
 
-        osc_idx += osc_step;
+        osc_idx += osc_step * pitch;
+        lvl += lvl_step;
+        pitch += pitch_step;
 
         // Apply a generalized modulus, allowing for positive and negative frequencies
         while (osc_idx >= SYN_OP_OSC_LEN) osc_idx -= SYN_OP_OSC_LEN;
@@ -104,6 +129,7 @@ void SYN_operator::mixBuffer(uint8_t voice, float frequency, float sample_rate,
 /**
  * @brief Modify the existing data in the buffer as a signal modulator.
  * 
+ * @param phase_inc  The note's oscillator phase increment from SYN_tuning.
  * @param buff       The audio output buffer.
  * @param length     The number of samples to calculate and update.
  * @param elapsed_ms Milliseconds since the note was triggered or released.
@@ -112,28 +138,36 @@ void SYN_operator::mixBuffer(uint8_t voice, float frequency, float sample_rate,
  * @param mod_level  Modifier to default oscillator level,
  *                   usually from a mod wheel, joystick, or control automation.
  */
-void SYN_operator::modulateBuffer(float frequency, float sample_rate, SYN_buffer *buff, 
+void SYN_operator::modulateBuffer(float phase_inc, SYN_buffer *buff, 
                                   size_t length, uint32_t elapsed_ms, bool released, float mod_level)
 {
     float osc_step = 0; 
     float osc_idx, multiplier, amp;
+    float lvl = _lvl_start;
+    float lvl_step = (_lvl_end - _lvl_start) / length;
+    float pitch = _pitch_start;
+    float pitch_step = (_pitch_end - _pitch_start) / length;
     
     if (_op_cfg.osc_fixed)
     {
-        osc_step = getOscStep(1, sample_rate);  // Only use fixed osc frequency
+        osc_step = _fixed_step;  // Only use fixed osc frequency
+        pitch = 1.0;                            // and ignore pitch modulation
+        pitch_step = 0;
     }
     else
     {
-        osc_step = getOscStep(frequency, sample_rate);  // Use osc fixed freq * note freq
+        osc_step = getOscStep(phase_inc);  // Use osc fixed freq * note freq
     }
 
     for(size_t i = 0; i < length; i++) 
     {    
         amp = getEvelopeAmp(elapsed_ms, released); 
-        multiplier = amp * _osc_table[(size_t)osc_idx] * _op_cfg.osc_lvl * mod_level;
+        multiplier = amp * _osc_table[(size_t)osc_idx] * _op_cfg.osc_lvl * mod_level * lvl;
         buff->update(multiplier, i);
 
-        osc_idx += osc_step;
+        osc_idx += osc_step * pitch;
+        lvl += lvl_step;
+        pitch += pitch_step;
 
         // Apply a generalized modulus, allowing for positive and negative frequencies
         while (osc_idx >= SYN_OP_OSC_LEN) osc_idx -= SYN_OP_OSC_LEN;
@@ -146,6 +180,11 @@ bool SYN_operator::getActive()
     return  (_op_cfg.osc_wave != SYN_WAVE_SILENCE && _op_cfg.osc_freq != 0);
 }
 
+SYN_wave_type SYN_operator::getWave()
+{
+    return _op_cfg.osc_wave;
+}
+
 SYN_op_mode_type SYN_operator::getMode()
 {
     return _op_cfg.op_mode;
@@ -165,8 +204,51 @@ void SYN_operator::reset()
     }
 }
 
-//----- PRIVATE METHODS -----//
+/**
+ * @brief Set the LFO level multiplier for the next block.  
+ *        The level is interpolated from start to end across the block.
+ * 
+ * @param start_lvl Level multiplier at the first sample of the block.
+ * @param end_lvl   Level multiplier at the last sample of the block.
+ */
+void SYN_operator::setLevelRamp(float start_lvl, float end_lvl)
+{
+    _lvl_start = start_lvl;
+    _lvl_end = end_lvl;
+}
 
+/**
+ * @brief Set the LFO frequency multiplier for the next block.  
+ *        The multiplier is interpolated from start to end across the block.
+ * 
+ * @param start_mult Frequency multiplier at the first sample of the block.
+ * @param end_mult   Frequency multiplier at the last sample of the block.
+ */
+void SYN_operator::setPitchRamp(float start_mult, float end_mult)
+{
+    _pitch_start = start_mult;
+    _pitch_end = end_mult;
+}
+
+/**
+ * @brief Set the sample source used when the oscillator wave is SYN_WAVE_SAMPLE.
+ *        Only carriers play samples; modulators treat it as silence.
+ * 
+ * @param sampler The engine's sampler, or NULL to disable sample playback.
+ */
+void SYN_operator::setSampler(SYN_sampler *sampler)
+{
+    _sampler = sampler;
+}
+
+/**
+ * @brief Gets the envelope amplitude at the specified time.
+ * 
+ * @param elapsed_ms Milliseconds since the note was triggered or released.
+ * @param released   If true, elapsed_ms is time from note release.  
+ *                   If false, elapsed_ms is time from note trigger.
+ * @return float     Envelope amplitude, 0.0 once the release has completed.
+ */
 float SYN_operator::getEvelopeAmp(uint32_t elapsed_ms, bool released)
 {
     float amp = 1;
@@ -202,11 +284,11 @@ float SYN_operator::getEvelopeAmp(uint32_t elapsed_ms, bool released)
     return _op_cfg.sus_lvl;
 }
 
-float SYN_operator::getOscStep(float frequency, float sample_rate)
-{
-    if (sample_rate == 0) return 0; // avoid divide by zero
+//----- PRIVATE METHODS -----//
 
-    return _op_cfg.osc_freq * frequency * SYN_OP_OSC_LEN / sample_rate;
+float SYN_operator::getOscStep(float phase_inc)
+{
+    return _op_cfg.osc_freq * phase_inc;
 }
 
 void  SYN_operator::fillOscTable()
@@ -247,6 +329,9 @@ void  SYN_operator::fillOscTable()
             case SYN_WAVE_CUSTOM:
                 fillSilence(); //fillCustom(&some_wav_ptr)
                 break;
+            case SYN_WAVE_SAMPLE:
+                fillSilence(); // Played from the sampler, table is unused
+                break;
             default:
                 fillSilence();
                 break; 
@@ -20,7 +20,10 @@
 #include "SYN_common.h"
 #include "SYN_buffer.h"
 
+class SYN_sampler;
+
 #define SYN_OP_OSC_LEN  4096
+#define SYN_OP_MS_PER_SAMPLE  (1000.0 / SYN_SAMPLE_RATE)
 
 // TODO: envelope
 
@@ -29,22 +32,32 @@ class SYN_operator
   public:
     SYN_operator();
     void setConfig(SYN_op_config_t *op_cfg);
-    void fillBuffer(uint8_t voice, float frequency, float sample_rate, SYN_buffer *buff, size_t length, uint32_t elapsed_ms, bool released);
-    void mixBuffer(uint8_t voice, float frequency, float sample_rate, SYN_buffer *buff, size_t length, uint32_t elapsed_ms, bool released);
-    void modulateBuffer(float frequency, float sample_rate, SYN_buffer *buff, size_t length, uint32_t elapsed_ms, bool released, float mod_level);
+    void fillBuffer(uint8_t voice, float phase_inc, SYN_buffer *buff, size_t length, uint32_t elapsed_ms, bool released);
+    void mixBuffer(uint8_t voice, float phase_inc, SYN_buffer *buff, size_t length, uint32_t elapsed_ms, bool released);
+    void modulateBuffer(float phase_inc, SYN_buffer *buff, size_t length, uint32_t elapsed_ms, bool released, float mod_level);
     SYN_op_mode_type getMode();
     void setMode(SYN_op_mode_type op_mode);
     void reset();
+    void setLevelRamp(float start_lvl, float end_lvl);
+    void setPitchRamp(float start_mult, float end_mult);
+    void setSampler(SYN_sampler *sampler);
     bool getActive();
+    SYN_wave_type getWave();
+    float getEvelopeAmp(uint32_t elapsed_ms, bool released);
     
     
   private:
     float _osc_idx[SYN_MAX_VOICES];
     float _osc_table[SYN_OP_OSC_LEN];
     SYN_op_config_t _op_cfg; 
+    float _lvl_start = 1.0;    // LFO level multiplier at start of block
+    float _lvl_end = 1.0;      // LFO level multiplier at end of block
+    float _pitch_start = 1.0;  // LFO frequency multiplier at start of block
+    float _pitch_end = 1.0;    // LFO frequency multiplier at end of block
+    float _fixed_step = 0;     // Oscillator step for fixed frequency modulators
+    SYN_sampler *_sampler = NULL;  // Sample source for SYN_WAVE_SAMPLE carriers
 
-    float getEvelopeAmp(uint32_t elapsed_ms, bool released);
-    float getOscStep(float frequency, float sample_rate);
+    float getOscStep(float phase_inc);
 
     void fillOscTable();
     void fillSilence();
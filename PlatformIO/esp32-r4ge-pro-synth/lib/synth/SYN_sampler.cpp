@@ -0,0 +1,458 @@
+#include "SYN_sampler.h"
+
+SYN_sampler::SYN_sampler()
+{
+    for (uint8_t i = 0; i < SYN_MAX_VOICES; i++)
+    {
+        _voice[i].active = false;
+        _voice[i].start_seq = 0;
+        _voice[i].ready_seq = 0;
+        _voice[i].ring = NULL;
+    }
+    for (uint8_t i = 0; i < SYN_SMP_ZONE_COUNT; i++)
+    {
+        _zone[i].head = NULL;
+    }
+    resetStats();
+    _sd_mutex = xSemaphoreCreateMutex();
+}
+
+/**
+ * @brief Load the sample zones from a folder of WAV files named by root note (e.g. 060.WAV).
+ *        Only the head of each sample is read into RAM.
+ *
+ * @param folder  SD card folder containing the samples, e.g. "/SYNTH/SMP"
+ * @return uint8_t Number of zones loaded.
+ */
+uint8_t SYN_sampler::load(const char *folder)
+{
+    unload();
+    lockSD();
+
+    File dir = SD.open(folder);
+    if (!dir || !dir.isDirectory())
+    {
+        unlockSD();
+        Serial.println(F("Sample folder not found."));
+        return 0;
+    }
+
+    for (uint8_t i = 0; i < SYN_MAX_VOICES; i++)
+    {
+        if (_voice[i].ring == NULL)
+        {
+            _voice[i].ring = (int16_t *)malloc(SYN_SMP_RING_LEN * sizeof(int16_t));
+            if (_voice[i].ring == NULL)
+            {
+                dir.close();
+                unlockSD();
+                Serial.println(F("Unable to allocate sample ring!"));
+                return 0;
+            }
+        }
+    }
+
+    File file = dir.openNextFile();
+    while (file && _zone_cnt < SYN_SMP_ZONE_COUNT)
+    {
+        // Older cores return the full path, so only look at the last path component
+        const char *name = file.name();
+        const char *slash = strrchr(name, '/');
+        if (slash != NULL) name = slash + 1;
+
+        if (!file.isDirectory() && isdigit(name[0]) && isdigit(name[1]) && isdigit(name[2]) &&
+            strcasecmp(name + 3, ".WAV") == 0)
+        {
+            uint16_t root_note = (name[0] - '0') * 100 + (name[1] - '0') * 10 + (name[2] - '0');
+            if (root_note < SYN_TUNE_NOTE_COUNT && loadZone(&_zone[_zone_cnt], file, root_note))
+            {
+                _zone_cnt++;
+                file = dir.openNextFile();
+                continue;  // Zone keeps the file open for streaming
+            }
+            Serial.print(F("Invalid sample file: ")); Serial.println(name);
+        }
+        file.close();
+        file = dir.openNextFile();
+    }
+    dir.close();
+    unlockSD();
+
+    // Sort zones by root note so the nearest zone search can stop early
+    for (uint8_t i = 1; i < _zone_cnt; i++)
+    {
+        for (uint8_t j = i; j > 0 && _zone[j].root_note < _zone[j - 1].root_note; j--)
+        {
+            SYN_sampler_zone_t temp = _zone[j];
+            _zone[j] = _zone[j - 1];
+            _zone[j - 1] = temp;
+        }
+    }
+
+    resetStats();
+    _loaded = (_zone_cnt > 0);
+    return _zone_cnt;
+}
+
+/**
+ * @brief Stop all voices and release the sample zones.
+ */
+void SYN_sampler::unload()
+{
+    _loaded = false;
+    while (_busy) delay(1);  // Let an in-progress prefetch finish with the files
+
+    for (uint8_t i = 0; i < SYN_MAX_VOICES; i++)
+    {
+        _voice[i].active = false;
+    }
+    lockSD();
+    for (uint8_t i = 0; i < _zone_cnt; i++)
+    {
+        _zone[i].file.close();
+        free(_zone[i].head);
+        _zone[i].head = NULL;
+    }
+    _zone_cnt = 0;
+    unlockSD();
+}
+
+/**
+ * @brief Start the background prefetch task.
+ *        It runs on the other core from the audio so SD latency never blocks update().
+ *
+ * @return true if the task is running.
+ */
+bool SYN_sampler::begin()
+{
+    if (_task != NULL) return true;
+
+    BaseType_t result = xTaskCreatePinnedToCore(prefetchTask, "SYN_sampler", SYN_SMP_TASK_STACK,
+                                                this, 1, &_task, SYN_SMP_TASK_CORE);
+    if (result != pdPASS)
+    {
+        _task = NULL;
+        Serial.println(F("Unable to start sample prefetch task!"));
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Start playing the zone nearest to the note on a voice.
+ *        Playback starts from the head in RAM while the prefetch ring is being filled.
+ *
+ * @param voice    The voice index.
+ * @param note_num MIDI note number.
+ */
+void SYN_sampler::startVoice(uint8_t voice, uint8_t note_num)
+{
+    if (voice >= SYN_MAX_VOICES) return;
+
+    SYN_sampler_voice_t *v = &_voice[voice];
+    v->active = false;
+    if (!_loaded) return;
+
+    uint8_t zone = 0;
+    for (uint8_t i = 1; i < _zone_cnt; i++)
+    {
+        if (abs((int)_zone[i].root_note - note_num) >= abs((int)_zone[zone].root_note - note_num)) break;
+        zone = i;
+    }
+
+    v->zone = zone;
+    v->frame = 0;
+    v->frac = 0;
+    v->miss_frame = 0;
+    v->start_seq = v->start_seq + 1;  // prefetch() resets the ring for the new note
+    v->active = true;
+}
+
+void SYN_sampler::stopVoice(uint8_t voice)
+{
+    if (voice < SYN_MAX_VOICES)
+    {
+        _voice[voice].active = false;
+    }
+}
+
+/**
+ * @brief Get the next sample for a voice.  Only reads from RAM, never from the SD card.
+ *
+ * @param voice     The voice index.
+ * @param phase_inc Oscillator phase increment (note, operator ratio, and pitch bend applied).
+ * @return float    Sample value, -1.0 to 1.0
+ */
+float SYN_sampler::nextSample(uint8_t voice, float phase_inc)
+{
+    SYN_sampler_voice_t *v = &_voice[voice];
+    if (!v->active) return 0;
+
+    SYN_sampler_zone_t *zone = &_zone[v->zone];
+
+    if (zone->loop_end == 0 && v->frame >= zone->length)
+    {
+        v->active = false;  // One-shot sample has finished
+        return 0;
+    }
+
+    int16_t s0 = getFrame(v, zone, v->frame);
+    int16_t s1 = getFrame(v, zone, v->frame + 1);
+    float sample = (s0 + (s1 - s0) * v->frac) / 32768.0;
+
+    v->frac += phase_inc * zone->step_scale;
+    uint32_t whole = (uint32_t)v->frac;
+    v->frame += whole;
+    v->frac -= whole;
+
+    // Let the prefetch task reuse ring space that has been played
+    if (v->frame > zone->head_len && v->ready_seq == v->start_seq)
+    {
+        v->read_frame = v->frame - zone->head_len;
+    }
+
+    return sample;
+}
+
+/**
+ * @brief Refill the prefetch rings of all playing voices.
+ *        Called continuously by the prefetch task, do not call from the audio path.
+ */
+void SYN_sampler::prefetch()
+{
+    _busy = true;
+
+    if (_loaded)
+    {
+        // Round-robin one chunk per voice so a long read does not starve the other voices
+        bool progress = true;
+        while (progress && _loaded)
+        {
+            progress = false;
+            for (uint8_t i = 0; i < SYN_MAX_VOICES; i++)
+            {
+                progress |= fillRing(&_voice[i]);
+            }
+        }
+    }
+
+    _busy = false;
+}
+
+/**
+ * @brief Get the streaming statistics since the last reset.
+ */
+void SYN_sampler::getStats(SYN_sampler_stats_t *stats)
+{
+    *stats = _stats;
+}
+
+void SYN_sampler::resetStats()
+{
+    _stats.misses = 0;
+    _stats.reads = 0;
+    _stats.max_read_us = 0;
+    _stats.min_headroom = SYN_SMP_RING_LEN;
+}
+
+/**
+ * @brief Take the SD card.  Hold it around every SD access made outside the sampler,
+ *        e.g. patch files in loop(), so it cannot interleave with a prefetch read.
+ *        Keep it short, the prefetch task waits for it.
+ */
+void SYN_sampler::lockSD()
+{
+    xSemaphoreTake(_sd_mutex, portMAX_DELAY);
+}
+
+void SYN_sampler::unlockSD()
+{
+    xSemaphoreGive(_sd_mutex);
+}
+
+bool SYN_sampler::getLoaded()
+{
+    return _loaded;
+}
+
+//----- PRIVATE METHODS -----//
+
+/**
+ * @brief Parse a WAV file and read the head of the sample into RAM.
+ */
+bool SYN_sampler::loadZone(SYN_sampler_zone_t *zone, File file, uint8_t root_note)
+{
+    uint8_t  hdr[12];
+    uint8_t  fmt[16];
+    uint32_t chunk_len, pos = 12;
+    uint32_t sample_rate = 0;
+    bool     fmt_ok = false;
+
+    zone->file = file;
+    zone->root_note = root_note;
+    zone->data_pos = 0;
+    zone->length = 0;
+    zone->loop_start = 0;
+    zone->loop_end = 0;
+
+    if (file.read(hdr, 12) != 12 || memcmp(hdr, "RIFF", 4) != 0 || memcmp(hdr + 8, "WAVE", 4) != 0) return false;
+
+    while (file.seek(pos) && file.read(hdr, 8) == 8)
+    {
+        chunk_len = hdr[4] | (hdr[5] << 8) | (hdr[6] << 16) | ((uint32_t)hdr[7] << 24);
+
+        if (memcmp(hdr, "fmt ", 4) == 0 && chunk_len >= 16 && file.read(fmt, 16) == 16)
+        {
+            // PCM, mono, 16-bit only
+            sample_rate = fmt[4] | (fmt[5] << 8) | (fmt[6] << 16) | ((uint32_t)fmt[7] << 24);
+            fmt_ok = (fmt[0] == 1 && fmt[2] == 1 && fmt[14] == 16);
+        }
+        else if (memcmp(hdr, "smpl", 4) == 0 && chunk_len >= 60)
+        {
+            // First sample loop, the end frame is inclusive
+            uint8_t loop[60];
+            if (file.read(loop, 60) == 60 && (loop[28] | loop[29]) > 0)
+            {
+                zone->loop_start = loop[44] | (loop[45] << 8) | (loop[46] << 16) | ((uint32_t)loop[47] << 24);
+                zone->loop_end = (loop[48] | (loop[49] << 8) | (loop[50] << 16) | ((uint32_t)loop[51] << 24)) + 1;
+            }
+        }
+        else if (memcmp(hdr, "data", 4) == 0)
+        {
+            zone->data_pos = pos + 8;
+            zone->length = chunk_len / 2;
+        }
+        pos += 8 + chunk_len + (chunk_len & 1);  // Chunks are word aligned
+    }
+
+    if (!fmt_ok || sample_rate == 0 || zone->length < 2) return false;
+
+    if (zone->loop_end > zone->length || zone->loop_start >= zone->loop_end)
+    {
+        zone->loop_start = 0;
+        zone->loop_end = 0;
+    }
+
+    zone->head_len = min((uint32_t)SYN_SMP_HEAD_LEN, zone->length);
+    zone->head = (int16_t *)malloc(zone->head_len * sizeof(int16_t));
+    if (zone->head == NULL) return false;
+
+    if (!file.seek(zone->data_pos) ||
+        file.read((uint8_t *)zone->head, zone->head_len * 2) != zone->head_len * 2)
+    {
+        free(zone->head);
+        zone->head = NULL;
+        return false;
+    }
+
+    // Phase increments are relative to the oscillator table, so scale by the root note's increment
+    zone->step_scale = ((float)sample_rate / SYN_SAMPLE_RATE) / synTuneNoteInc(root_note);
+    return true;
+}
+
+/**
+ * @brief Get a frame from the head or the prefetch ring.
+ */
+int16_t SYN_sampler::getFrame(SYN_sampler_voice_t *voice, SYN_sampler_zone_t *zone, uint32_t frame)
+{
+    if (frame < zone->head_len)
+    {
+        return zone->head[mapFrame(zone, frame)];
+    }
+
+    if (zone->loop_end == 0 && frame >= zone->length) return 0;  // Past the end of a one-shot
+
+    uint32_t stream_frame = frame - zone->head_len;
+    if (voice->ready_seq != voice->start_seq || stream_frame >= voice->write_frame)
+    {
+        // Interpolation and pitches below the root read a frame more than once, count it once
+        if (stream_frame >= voice->miss_frame)
+        {
+            _stats.misses++;
+            voice->miss_frame = stream_frame + 1;
+        }
+        return 0;
+    }
+
+    return voice->ring[stream_frame & (SYN_SMP_RING_LEN - 1)];
+}
+
+/**
+ * @brief Map a playback frame to a frame in the file, wrapping around the loop.
+ */
+uint32_t SYN_sampler::mapFrame(SYN_sampler_zone_t *zone, uint32_t frame)
+{
+    if (zone->loop_end == 0 || frame < zone->loop_end) return frame;
+
+    return zone->loop_start + (frame - zone->loop_start) % (zone->loop_end - zone->loop_start);
+}
+
+/**
+ * @brief Read the next chunk of a voice's sample into its ring, if there is room.
+ *
+ * @return true if a chunk was read.
+ */
+bool SYN_sampler::fillRing(SYN_sampler_voice_t *voice)
+{
+    if (!voice->active) return false;
+
+    uint32_t seq = voice->start_seq;
+    SYN_sampler_zone_t *zone = &_zone[voice->zone];
+
+    if (voice->ready_seq != seq)
+    {
+        voice->write_frame = 0;
+        voice->read_frame = 0;
+        voice->ready_seq = seq;
+    }
+
+    // Headroom only matters once the voice has played past its head
+    uint32_t buffered = voice->write_frame - voice->read_frame;
+    if (voice->read_frame > 0 && buffered < _stats.min_headroom) _stats.min_headroom = buffered;
+    if (SYN_SMP_RING_LEN - buffered < SYN_SMP_CHUNK_LEN) return false;  // Ring is full
+
+    uint32_t frame = zone->head_len + voice->write_frame;
+    uint32_t file_frame = mapFrame(zone, frame);
+    uint32_t end_frame = (zone->loop_end > 0 ? zone->loop_end : zone->length);
+    if (file_frame >= end_frame) return false;  // One-shot fully read
+
+    // Contiguous run: stop at the ring wrap and at the loop or sample end
+    uint32_t ring_idx = voice->write_frame & (SYN_SMP_RING_LEN - 1);
+    uint32_t count = SYN_SMP_CHUNK_LEN;
+    count = min(count, (uint32_t)SYN_SMP_RING_LEN - ring_idx);
+    count = min(count, end_frame - file_frame);
+
+    lockSD();
+    uint32_t start_us = micros();
+    bool read_ok = zone->file.seek(zone->data_pos + file_frame * 2) &&
+                   zone->file.read((uint8_t *)(voice->ring + ring_idx), count * 2) == count * 2;
+    uint32_t read_us = micros() - start_us;
+    unlockSD();
+
+    if (!read_ok)
+    {
+        voice->active = false;
+        return false;
+    }
+
+    _stats.reads++;
+    if (read_us > _stats.max_read_us) _stats.max_read_us = read_us;
+
+    // Only publish the data if the voice was not restarted during the read
+    if (voice->start_seq == seq)
+    {
+        voice->write_frame = voice->write_frame + count;
+    }
+    return true;
+}
+
+void SYN_sampler::prefetchTask(void *param)
+{
+    SYN_sampler *sampler = (SYN_sampler *)param;
+
+    while (true)
+    {
+        sampler->prefetch();
+        vTaskDelay(1);
+    }
+}
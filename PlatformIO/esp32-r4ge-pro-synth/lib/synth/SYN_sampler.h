@@ -0,0 +1,104 @@
+/**
+ * @file SYN_sampler.h
+ * @author Paul Pagel (https://twobittinker.com)
+ * @brief  Multisampled instrument streamed from the SD card (ROMpler).
+ *         Each sample zone keeps the first SYN_SMP_HEAD_LEN frames in RAM so notes
+ *         start instantly, and each voice has a prefetch ring that a background task
+ *         keeps filled with the rest of the sample.  The audio path only ever reads
+ *         from RAM; if the ring runs dry the frame is counted as a miss and played silent.
+ *         Samples are 16-bit mono WAV files named by root note, e.g. /SYNTH/SMP/060.WAV
+ *         Loop points are read from the WAV 'smpl' chunk when present.
+ *         The card is shared with loop(), so every SD access on either core must
+ *         hold lockSD().
+ * @version 0.1
+ * @date 2020-08-30
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#ifndef _SYN_SAMPLER_
+#define _SYN_SAMPLER_
+
+#include <Arduino.h>
+#include <SD.h>
+#include "SYN_common.h"
+#include "SYN_tuning.h"
+
+#define SYN_SMP_ZONE_COUNT      4
+#define SYN_SMP_HEAD_LEN     2048  // Frames preloaded in RAM per zone (~185 ms at 11025 Hz)
+#define SYN_SMP_RING_LEN     2048  // Prefetch ring frames per voice.  Must be power of 2
+#define SYN_SMP_CHUNK_LEN     256  // Frames read from SD per prefetch
+#define SYN_SMP_TASK_STACK   4096
+#define SYN_SMP_TASK_CORE       0  // Arduino loop() and the audio run on core 1
+
+typedef struct
+{
+    uint32_t misses;          // Frames the audio path needed before they were prefetched
+    uint32_t reads;           // SD chunk reads
+    uint32_t max_read_us;     // Slowest SD chunk read
+    uint32_t min_headroom;    // Fewest frames buffered ahead of a playing voice
+} SYN_sampler_stats_t;
+
+class SYN_sampler
+{
+  public:
+    SYN_sampler();
+    uint8_t load(const char *folder);
+    void    unload();
+    bool    begin();
+    void    startVoice(uint8_t voice, uint8_t note_num);
+    void    stopVoice(uint8_t voice);
+    float   nextSample(uint8_t voice, float phase_inc);
+    void    prefetch();
+    void    getStats(SYN_sampler_stats_t *stats);
+    void    resetStats();
+    bool    getLoaded();
+    void    lockSD();
+    void    unlockSD();
+
+  private:
+    typedef struct
+    {
+        File     file;
+        uint32_t data_pos;     // File offset of the first sample frame
+        uint32_t length;       // Total frames
+        uint32_t loop_start;   // First frame of the loop
+        uint32_t loop_end;     // Frame after the end of the loop, 0 = no loop
+        uint32_t head_len;     // Frames in head (less than SYN_SMP_HEAD_LEN for short samples)
+        float    step_scale;   // Frame step per unit of oscillator phase increment
+        uint8_t  root_note;
+        int16_t *head;
+    } SYN_sampler_zone_t;
+
+    typedef struct
+    {
+        volatile uint32_t start_seq;   // Incremented by startVoice()
+        volatile uint32_t ready_seq;   // Set by prefetch() once the ring is reset for start_seq
+        volatile uint32_t write_frame; // Stream frames (after the head) written to the ring
+        volatile uint32_t read_frame;  // Stream frames consumed by the audio path
+        volatile bool     active;
+        uint8_t  zone;
+        uint32_t frame;                // Playback position, whole frames from the start
+        float    frac;                 // Playback position, fraction between frames
+        uint32_t miss_frame;           // Stream frames before this have been counted as misses
+        int16_t *ring;
+    } SYN_sampler_voice_t;
+
+    bool     loadZone(SYN_sampler_zone_t *zone, File file, uint8_t root_note);
+    int16_t  getFrame(SYN_sampler_voice_t *voice, SYN_sampler_zone_t *zone, uint32_t frame);
+    uint32_t mapFrame(SYN_sampler_zone_t *zone, uint32_t stream_frame);
+    bool     fillRing(SYN_sampler_voice_t *voice);
+    static void prefetchTask(void *param);
+
+    SYN_sampler_zone_t  _zone[SYN_SMP_ZONE_COUNT];
+    SYN_sampler_voice_t _voice[SYN_MAX_VOICES];
+    SYN_sampler_stats_t _stats;
+    uint8_t             _zone_cnt = 0;
+    volatile bool       _loaded = false;
+    volatile bool       _busy = false;  // prefetch() is reading from SD
+    TaskHandle_t        _task = NULL;
+    SemaphoreHandle_t   _sd_mutex = NULL;
+};
+
+#endif // _SYN_SAMPLER_
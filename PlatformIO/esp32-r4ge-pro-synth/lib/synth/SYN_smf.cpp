@@ -0,0 +1,408 @@
+#include <math.h>
+#include "SYN_smf.h"
+
+SYN_smf::SYN_smf()
+{
+
+}
+
+/**
+ * @brief Open a Standard MIDI File and prime the first event of each track.
+ *
+ * @param reader      Storage the file is read from.  Must stay valid until close().
+ * @param sample_rate Sample rate used for the event timestamps.
+ * @return SYN_smf_err SYN_SMF_ERR_OK if the file can be played.
+ */
+SYN_smf_err SYN_smf::open(SYN_smf_reader *reader, uint32_t sample_rate)
+{
+    uint8_t  hdr[14];
+    uint16_t format, track_cnt;
+    uint32_t pos, chunk_len;
+
+    close();
+    _reader = reader;
+    _sample_rate = sample_rate;
+    _err = SYN_SMF_ERR_OK;
+
+    if (_reader == NULL || !readChunk(0, hdr, 14))
+    {
+        _err = SYN_SMF_ERR_READ;
+        return _err;
+    }
+
+    chunk_len = ((uint32_t)hdr[4] << 24) | ((uint32_t)hdr[5] << 16) | ((uint32_t)hdr[6] << 8) | hdr[7];
+    if (hdr[0] != 'M' || hdr[1] != 'T' || hdr[2] != 'h' || hdr[3] != 'd' || chunk_len < 6)
+    {
+        _err = SYN_SMF_ERR_HEADER;
+        return _err;
+    }
+
+    format    = ((uint16_t)hdr[8] << 8) | hdr[9];
+    track_cnt = ((uint16_t)hdr[10] << 8) | hdr[11];
+    _division = ((uint16_t)hdr[12] << 8) | hdr[13];
+
+    if (format > 1 || track_cnt == 0 || _division == 0)
+    {
+        _err = SYN_SMF_ERR_FORMAT;
+        return _err;
+    }
+
+    if (track_cnt > SYN_SMF_MAX_TRACKS) track_cnt = SYN_SMF_MAX_TRACKS;
+
+    _smpte = (_division & 0x8000) != 0;
+    if (_smpte)
+    {
+        // Upper byte is the negative frames per second, lower byte the ticks per frame
+        uint8_t fps = (uint8_t)(-(int8_t)(_division >> 8));
+        uint8_t tpf = _division & 0xFF;
+        if (fps == 0 || tpf == 0)
+        {
+            _err = SYN_SMF_ERR_FORMAT;
+            return _err;
+        }
+        _samples_per_tick = (double)_sample_rate / ((double)fps * tpf);
+    }
+    else
+    {
+        setTempo(SYN_SMF_DEFAULT_TEMPO);
+    }
+
+    // Locate each track chunk, skipping any unknown chunk types
+    pos = 8 + chunk_len;
+    while (_track_cnt < track_cnt)
+    {
+        if (!readChunk(pos, hdr, 8))
+        {
+            _err = SYN_SMF_ERR_TRACK;
+            break;
+        }
+        chunk_len = ((uint32_t)hdr[4] << 24) | ((uint32_t)hdr[5] << 16) | ((uint32_t)hdr[6] << 8) | hdr[7];
+        pos += 8;
+
+        if (hdr[0] == 'M' && hdr[1] == 'T' && hdr[2] == 'r' && hdr[3] == 'k')
+        {
+            SYN_smf_track_t *track = &_track[_track_cnt];
+            track->file_pos = pos;
+            track->end_pos = pos + chunk_len;
+            track->tick = 0;
+            track->buff_len = 0;
+            track->buff_idx = 0;
+            track->running_status = 0;
+
+            if (loadEvent(track))
+            {
+                heapPush(_track_cnt);
+            }
+            _track_cnt++;
+        }
+        pos += chunk_len;
+    }
+
+    if (_heap_cnt == 0 && _err == SYN_SMF_ERR_OK)
+    {
+        _err = SYN_SMF_ERR_TRACK;
+    }
+    return _err;
+}
+
+/**
+ * @brief Stop playback and release the reader.
+ */
+void SYN_smf::close()
+{
+    _reader = NULL;
+    _heap_cnt = 0;
+    _track_cnt = 0;
+    _sample_pos = 0;
+    _last_tick = 0;
+}
+
+/**
+ * @brief Get the next event that is due at the specified sample clock.
+ *        Call repeatedly until it returns false to drain all due events.
+ *
+ * @param sample_clock Current playback position in samples since the start of the file.
+ * @param event        Receives the event data.
+ * @return true if an event was returned.
+ */
+bool SYN_smf::getEvent(uint32_t sample_clock, SYN_smf_event_t *event)
+{
+    while (_heap_cnt > 0)
+    {
+        SYN_smf_track_t *track = &_track[_heap[0]];
+        double sample_pos = _sample_pos + (double)(track->tick - _last_tick) * _samples_per_tick;
+
+        if (sample_pos > (double)sample_clock) return false;
+
+        heapPop();
+        _sample_pos = sample_pos;
+        _last_tick = track->tick;
+
+        *event = track->event;
+        event->sample_time = (uint32_t)sample_pos;
+
+        if (event->type == SYN_SMF_EVENT_TEMPO)
+        {
+            if (!_smpte) setTempo(track->tempo);
+        }
+
+        if (loadEvent(track))
+        {
+            heapPush(track - _track);
+        }
+
+        if (event->type != SYN_SMF_EVENT_TEMPO) return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Get the sample clock at which the next event is due, so the caller can
+ *        render exactly up to it.  A pending tempo change also counts as an event.
+ *
+ * @return The first sample clock getEvent() returns it at, or SYN_SMF_NO_EVENT.
+ */
+uint32_t SYN_smf::getNextTime()
+{
+    if (_heap_cnt == 0) return SYN_SMF_NO_EVENT;
+
+    SYN_smf_track_t *track = &_track[_heap[0]];
+    return (uint32_t)ceil(_sample_pos + (double)(track->tick - _last_tick) * _samples_per_tick);
+}
+
+/**
+ * @brief Check whether any track still has events left to play.
+ */
+bool SYN_smf::getPlaying()
+{
+    return _heap_cnt > 0;
+}
+
+/**
+ * @brief Get the last error raised by open() or while streaming.
+ */
+SYN_smf_err SYN_smf::getError()
+{
+    return _err;
+}
+
+//----- PRIVATE METHODS -----//
+
+bool SYN_smf::readChunk(uint32_t pos, uint8_t *buff, uint32_t len)
+{
+    if (!_reader->seek(pos)) return false;
+    return _reader->read(buff, len) == (int32_t)len;
+}
+
+/**
+ * @brief Read the next byte of a track, refilling its read-ahead buffer as needed.
+ */
+bool SYN_smf::readByte(SYN_smf_track_t *track, uint8_t *value)
+{
+    if (track->buff_idx >= track->buff_len)
+    {
+        if (track->file_pos >= track->end_pos) return false;
+
+        uint32_t len = track->end_pos - track->file_pos;
+        if (len > SYN_SMF_TRACK_BUFF) len = SYN_SMF_TRACK_BUFF;
+
+        if (!readChunk(track->file_pos, track->buff, len))
+        {
+            _err = SYN_SMF_ERR_READ;
+            return false;
+        }
+        track->file_pos += len;
+        track->buff_len = len;
+        track->buff_idx = 0;
+    }
+
+    *value = track->buff[track->buff_idx++];
+    return true;
+}
+
+bool SYN_smf::readVarLen(SYN_smf_track_t *track, uint32_t *value)
+{
+    uint8_t byte;
+    *value = 0;
+
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        if (!readByte(track, &byte)) return false;
+        *value = (*value << 7) | (byte & 0x7F);
+        if ((byte & 0x80) == 0) return true;
+    }
+    return false;  // Malformed, quantities are at most 4 bytes
+}
+
+/**
+ * @brief Skip over event data.  Large blocks (SysEx, text) are skipped without reading them.
+ */
+bool SYN_smf::skipBytes(SYN_smf_track_t *track, uint32_t count)
+{
+    uint32_t buffered = track->buff_len - track->buff_idx;
+
+    if (count <= buffered)
+    {
+        track->buff_idx += count;
+        return true;
+    }
+
+    track->file_pos += count - buffered;
+    track->buff_idx = track->buff_len;
+    return track->file_pos <= track->end_pos;
+}
+
+/**
+ * @brief Parse forward to the next event of interest on a track.
+ *        Delta times of skipped events are still accumulated.
+ *
+ * @return true if an event is pending, false at the end of the track.
+ */
+bool SYN_smf::loadEvent(SYN_smf_track_t *track)
+{
+    uint8_t  status, data1, data2 = 0;
+    uint32_t delta, len;
+
+    while (true)
+    {
+        if (!readVarLen(track, &delta)) return false;
+        track->tick += delta;
+
+        if (!readByte(track, &status)) return false;
+
+        if (status < 0x80)
+        {
+            // Running status, this byte is the first data byte
+            if (track->running_status == 0) return false;
+            data1 = status;
+            status = track->running_status;
+        }
+        else if (status < 0xF0)
+        {
+            track->running_status = status;
+            if (!readByte(track, &data1)) return false;
+        }
+
+        if (status == 0xFF)
+        {
+            uint8_t meta_type;
+            track->running_status = 0;
+            if (!readByte(track, &meta_type) || !readVarLen(track, &len)) return false;
+
+            if (meta_type == 0x2F) return false;  // End of track
+
+            if (meta_type == 0x51 && len == 3)
+            {
+                uint8_t t0, t1, t2;
+                if (!readByte(track, &t0) || !readByte(track, &t1) || !readByte(track, &t2)) return false;
+                track->tempo = ((uint32_t)t0 << 16) | ((uint32_t)t1 << 8) | t2;
+                track->event.type = SYN_SMF_EVENT_TEMPO;
+                return true;
+            }
+
+            if (!skipBytes(track, len)) return false;
+            continue;
+        }
+
+        if (status == 0xF0 || status == 0xF7)
+        {
+            // SysEx
+            track->running_status = 0;
+            if (!readVarLen(track, &len) || !skipBytes(track, len)) return false;
+            continue;
+        }
+
+        track->event.channel = status & 0x0F;
+        track->event.data1 = data1;
+
+        switch (status & 0xF0)
+        {
+            case 0x80:
+            case 0x90:
+                if (!readByte(track, &data2)) return false;
+                // Note on with zero velocity is a note off
+                track->event.type = ((status & 0xF0) == 0x90 && data2 > 0) ? SYN_SMF_EVENT_NOTE_ON : SYN_SMF_EVENT_NOTE_OFF;
+                track->event.data2 = data2;
+                return true;
+
+            case 0xB0:
+                if (!readByte(track, &data2)) return false;
+                track->event.type = SYN_SMF_EVENT_CONTROL;
+                track->event.data2 = data2;
+                return true;
+
+            case 0xE0:
+                if (!readByte(track, &data2)) return false;
+                track->event.type = SYN_SMF_EVENT_PITCH_BEND;
+                track->event.bend = (int16_t)((((uint16_t)data2 << 7) | data1) - 8192);
+                return true;
+
+            case 0xA0:  // Poly aftertouch, ignored
+                if (!readByte(track, &data2)) return false;
+                break;
+
+            case 0xC0:  // Program change, ignored
+            case 0xD0:  // Channel aftertouch, ignored
+                break;
+
+            default:
+                return false;
+        }
+    }
+}
+
+void SYN_smf::setTempo(uint32_t tempo)
+{
+    _samples_per_tick = ((double)tempo * _sample_rate) / (1000000.0 * _division);
+}
+
+/**
+ * @brief Heap ordering: earliest tick first, lower track index first on ties
+ *        so that tempo events on the conductor track apply before notes at the same tick.
+ */
+bool SYN_smf::heapLess(uint8_t a, uint8_t b)
+{
+    if (_track[a].tick != _track[b].tick) return _track[a].tick < _track[b].tick;
+    return a < b;
+}
+
+void SYN_smf::heapPush(uint8_t track_idx)
+{
+    uint8_t idx = _heap_cnt++;
+    _heap[idx] = track_idx;
+
+    while (idx > 0)
+    {
+        uint8_t parent = (idx - 1) / 2;
+        if (!heapLess(_heap[idx], _heap[parent])) break;
+
+        uint8_t temp = _heap[parent];
+        _heap[parent] = _heap[idx];
+        _heap[idx] = temp;
+        idx = parent;
+    }
+}
+
+uint8_t SYN_smf::heapPop()
+{
+    uint8_t top = _heap[0];
+    uint8_t idx = 0;
+
+    _heap[0] = _heap[--_heap_cnt];
+
+    while (true)
+    {
+        uint8_t child = idx * 2 + 1;
+        if (child >= _heap_cnt) break;
+        if (child + 1 < _heap_cnt && heapLess(_heap[child + 1], _heap[child])) child++;
+        if (!heapLess(_heap[child], _heap[idx])) break;
+
+        uint8_t temp = _heap[child];
+        _heap[child] = _heap[idx];
+        _heap[idx] = temp;
+        idx = child;
+    }
+
+    return top;
+}
@@ -0,0 +1,117 @@
+/**
+ * @file SYN_smf.h
+ * @author Paul Pagel (https://twobittinker.com)
+ * @brief  Standard MIDI File (type 0/1) player that streams events from storage.
+ *         Each track keeps a small read-ahead buffer, so the file is never fully
+ *         loaded into RAM.  Tracks are merged in tick order with a min-heap and
+ *         tick deltas are converted to sample-clock timestamps as events are
+ *         popped, so tempo changes on any track apply to all tracks.
+ *         Has no Arduino dependencies so it can also be used in host builds.
+ * @version 0.1
+ * @date 2020-08-29
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#ifndef _SYN_SMF_
+#define _SYN_SMF_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SYN_SMF_MAX_TRACKS      16
+#define SYN_SMF_TRACK_BUFF      64      // Read-ahead bytes per track
+#define SYN_SMF_DEFAULT_TEMPO   500000  // Microseconds per quarter note (120 BPM)
+#define SYN_SMF_NO_EVENT        0xFFFFFFFF  // getNextTime() once every event has been returned
+
+enum SYN_smf_err
+{
+    SYN_SMF_ERR_OK,
+    SYN_SMF_ERR_READ,
+    SYN_SMF_ERR_HEADER,
+    SYN_SMF_ERR_FORMAT,
+    SYN_SMF_ERR_TRACK
+};
+
+enum SYN_smf_event_type
+{
+    SYN_SMF_EVENT_NOTE_OFF,
+    SYN_SMF_EVENT_NOTE_ON,
+    SYN_SMF_EVENT_CONTROL,
+    SYN_SMF_EVENT_PITCH_BEND,
+    SYN_SMF_EVENT_TEMPO,     // Internal only, never returned by getEvent()
+    SYN_SMF_EVENT_END
+};
+
+typedef struct
+{
+    uint32_t sample_time;  // Sample clock timestamp relative to the start of the file
+    uint8_t  type;         // SYN_smf_event_type
+    uint8_t  channel;
+    uint8_t  data1;        // Note number or controller number
+    uint8_t  data2;        // Velocity or controller value
+    int16_t  bend;         // Pitch bend, -8192 to 8191
+} SYN_smf_event_t;
+
+/**
+ * @brief Storage interface used by the player.  Implement for an SD card File or a host FILE.
+ */
+class SYN_smf_reader
+{
+  public:
+    virtual ~SYN_smf_reader() {}
+    virtual bool    seek(uint32_t pos) = 0;
+    virtual int32_t read(uint8_t *buff, uint32_t len) = 0;
+};
+
+class SYN_smf
+{
+  public:
+    SYN_smf();
+    SYN_smf_err open(SYN_smf_reader *reader, uint32_t sample_rate);
+    void        close();
+    bool        getEvent(uint32_t sample_clock, SYN_smf_event_t *event);
+    uint32_t    getNextTime();
+    bool        getPlaying();
+    SYN_smf_err getError();
+
+  private:
+    typedef struct
+    {
+        uint32_t file_pos;      // Next file position to load into the buffer
+        uint32_t end_pos;       // End of the track chunk
+        uint32_t tick;          // Absolute tick of the pending event
+        uint32_t tempo;         // Pending tempo change (microseconds per quarter)
+        uint8_t  buff[SYN_SMF_TRACK_BUFF];
+        uint8_t  buff_len;
+        uint8_t  buff_idx;
+        uint8_t  running_status;
+        SYN_smf_event_t event;  // Pending event
+    } SYN_smf_track_t;
+
+    bool     readChunk(uint32_t pos, uint8_t *buff, uint32_t len);
+    bool     readByte(SYN_smf_track_t *track, uint8_t *value);
+    bool     readVarLen(SYN_smf_track_t *track, uint32_t *value);
+    bool     skipBytes(SYN_smf_track_t *track, uint32_t count);
+    bool     loadEvent(SYN_smf_track_t *track);
+    void     setTempo(uint32_t tempo);
+    bool     heapLess(uint8_t a, uint8_t b);
+    void     heapPush(uint8_t track_idx);
+    uint8_t  heapPop();
+
+    SYN_smf_reader  *_reader = NULL;
+    SYN_smf_track_t  _track[SYN_SMF_MAX_TRACKS];
+    uint8_t          _heap[SYN_SMF_MAX_TRACKS];
+    uint8_t          _heap_cnt = 0;
+    uint8_t          _track_cnt = 0;
+    uint16_t         _division = 96;        // Ticks per quarter note
+    uint32_t         _sample_rate = 11025;
+    double           _samples_per_tick = 0;
+    double           _sample_pos = 0;       // Sample clock at _last_tick
+    uint32_t         _last_tick = 0;
+    bool             _smpte = false;        // Division is SMPTE frames, tempo events ignored
+    SYN_smf_err      _err = SYN_SMF_ERR_OK;
+};
+
+#endif // _SYN_SMF_
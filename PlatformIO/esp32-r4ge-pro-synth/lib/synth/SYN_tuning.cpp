@@ -0,0 +1,198 @@
+#include "SYN_tuning.h"
+
+#define SYN_TUNE_INC_ROW(n) \
+    synTuneNoteInc(n),     synTuneNoteInc(n + 1), synTuneNoteInc(n + 2), synTuneNoteInc(n + 3), \
+    synTuneNoteInc(n + 4), synTuneNoteInc(n + 5), synTuneNoteInc(n + 6), synTuneNoteInc(n + 7)
+
+// Equal temperament phase increments for all MIDI notes, calculated by the compiler
+static const float SYN_TUNE_EQUAL_INC[SYN_TUNE_NOTE_COUNT] = 
+{
+    SYN_TUNE_INC_ROW(0),   SYN_TUNE_INC_ROW(8),   SYN_TUNE_INC_ROW(16),  SYN_TUNE_INC_ROW(24),
+    SYN_TUNE_INC_ROW(32),  SYN_TUNE_INC_ROW(40),  SYN_TUNE_INC_ROW(48),  SYN_TUNE_INC_ROW(56),
+    SYN_TUNE_INC_ROW(64),  SYN_TUNE_INC_ROW(72),  SYN_TUNE_INC_ROW(80),  SYN_TUNE_INC_ROW(88),
+    SYN_TUNE_INC_ROW(96),  SYN_TUNE_INC_ROW(104), SYN_TUNE_INC_ROW(112), SYN_TUNE_INC_ROW(120)
+};
+
+SYN_tuning::SYN_tuning()
+{
+    for (size_t i = 0; i <= SYN_TUNE_EXP2_LEN; i++)
+    {
+        _exp2_table[i] = (float)pow(2.0, (double)i / SYN_TUNE_EXP2_LEN);
+    }
+
+    resetScale();
+}
+
+/**
+ * @brief Gets the oscillator phase increment for the note in the current tuning.
+ * 
+ * @param note_num  The MIDI note number (0-127)
+ * @return float    Oscillator table step per sample for an op frequency ratio of 1.0
+ */
+float SYN_tuning::getPhaseInc(uint8_t note_num)
+{
+    if (note_num >= SYN_TUNE_NOTE_COUNT) return 0;
+
+    return _note_inc[note_num];
+}
+
+/**
+ * @brief Gets the frequency of the note in Hz in the current tuning.
+ * 
+ * @param note_num  The MIDI note number (0-127)
+ * @return float    The note frequency in Hz.
+ */
+float SYN_tuning::getFrequency(uint8_t note_num)
+{
+    return getPhaseInc(note_num) * SYN_TUNE_HZ_PER_INC;
+}
+
+/**
+ * @brief Converts a pitch offset in semitones to a frequency multiplier using the exp2 table.
+ * 
+ * @param semitones  Pitch offset, may be fractional and/or negative.
+ * @return float     The frequency multiplier.  0 semitones = 1.0
+ */
+float SYN_tuning::semitonesToRatio(float semitones)
+{
+    float octaves = semitones * (1.0 / 12.0);
+    int   whole = (int)floor(octaves);
+    float pos = (octaves - whole) * SYN_TUNE_EXP2_LEN;
+    int   idx = (int)pos;
+
+    // A tiny negative octaves can round octaves - whole up to 1.0
+    if (idx > SYN_TUNE_EXP2_LEN - 1) idx = SYN_TUNE_EXP2_LEN - 1;
+    float frac = pos - idx;
+
+    float ratio = _exp2_table[idx] + (_exp2_table[idx + 1] - _exp2_table[idx]) * frac;
+    return ldexp(ratio, whole);
+}
+
+/**
+ * @brief Loads a Scala scale (.scl file contents) as the current tuning.
+ *        Scale degree 0 is mapped to note SYN_TUNE_SCL_REF_NOTE at its equal tempered frequency, 
+ *        and the last scale entry is used as the repeating period (normally 2/1).
+ * 
+ * @param scl_text  The text of the .scl file.
+ * @return true     Scale loaded.
+ * @return false    Invalid scale, the previous tuning is unchanged.
+ */
+bool SYN_tuning::loadScale(const char *scl_text)
+{
+    double  ratios[SYN_TUNE_MAX_DEGREES];
+    char    line[64];
+    size_t  line_len;
+    int     line_num = 0;  // non-comment lines only
+    long    degree_cnt = 0;
+    long    degree = 0;
+    const char *pos = scl_text;
+
+    if (scl_text == NULL) return false;
+
+    while (*pos != 0 && (degree_cnt == 0 || degree < degree_cnt))
+    {
+        // Copy out the next line
+        line_len = 0;
+        while (*pos != 0 && *pos != '\n')
+        {
+            if (line_len < sizeof(line) - 1 && *pos != '\r') line[line_len++] = *pos;
+            pos++;
+        }
+        if (*pos == '\n') pos++;
+        line[line_len] = 0;
+
+        if (line[0] == '!') continue;  // comment
+
+        if (line_num == 0)
+        {
+            // Description line, not used
+        }
+        else if (line_num == 1)
+        {
+            degree_cnt = atol(line);
+            if (degree_cnt < 1 || degree_cnt > SYN_TUNE_MAX_DEGREES) return false;
+        }
+        else
+        {
+            if (!parsePitch(line, &ratios[degree])) return false;
+            degree++;
+        }
+        line_num++;
+    }
+
+    if (degree_cnt == 0 || degree < degree_cnt) return false;
+
+    // Build the note table relative to the reference note
+    double period = ratios[degree_cnt - 1];
+    double ref_inc = synTuneNoteInc(SYN_TUNE_SCL_REF_NOTE);
+    long   offset, octave, step;
+
+    for (int note = 0; note < SYN_TUNE_NOTE_COUNT; note++)
+    {
+        offset = note - SYN_TUNE_SCL_REF_NOTE;
+        octave = (offset >= 0) ? offset / degree_cnt : -((-offset + degree_cnt - 1) / degree_cnt);
+        step = offset - octave * degree_cnt;
+
+        _note_inc[note] = (float)(ref_inc * pow(period, (double)octave) * (step == 0 ? 1.0 : ratios[step - 1]));
+    }
+
+    return true;
+}
+
+/**
+ * @brief Restores standard 12 tone equal temperament, A4 = 440 Hz.
+ */
+void SYN_tuning::resetScale()
+{
+    for (size_t i = 0; i < SYN_TUNE_NOTE_COUNT; i++)
+    {
+        _note_inc[i] = SYN_TUNE_EQUAL_INC[i];
+    }
+}
+
+//----- PRIVATE METHODS -----//
+
+/**
+ * @brief Parses a Scala pitch line.  Values with a period are cents, 
+ *        otherwise a ratio (3/2) or whole number (2).
+ * 
+ * @param line   The pitch line.  Anything after the value is ignored.
+ * @param ratio  The resulting frequency ratio.
+ * @return true  Valid pitch.
+ * @return false Invalid pitch.
+ */
+bool SYN_tuning::parsePitch(const char *line, double *ratio)
+{
+    const char *pos = line;
+    char *end;
+
+    const char *token_end;
+
+    while (*pos == ' ' || *pos == '\t') pos++;
+
+    // Only look for a period within the value itself, not in any trailing text
+    token_end = pos;
+    while (*token_end != 0 && *token_end != ' ' && *token_end != '\t') token_end++;
+
+    if (memchr(pos, '.', token_end - pos) != NULL)
+    {
+        double cents = strtod(pos, &end);
+        if (end == pos) return false;
+
+        *ratio = pow(2.0, cents / 1200.0);
+        return true;
+    }
+
+    long num = strtol(pos, &end, 10);
+    long den = 1;
+    if (end == pos || num <= 0) return false;
+
+    if (*end == '/')
+    {
+        den = strtol(end + 1, &end, 10);
+        if (den <= 0) return false;
+    }
+
+    *ratio = (double)num / (double)den;
+    return true;
+}
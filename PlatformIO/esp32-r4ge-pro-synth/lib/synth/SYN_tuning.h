@@ -0,0 +1,65 @@
+/**
+ * @file SYN_tuning.h
+ * @author Paul Pagel (https://twobittinker.com)
+ * @brief  Note tuning for all 128 MIDI notes.  
+ *         Converts note numbers directly to oscillator phase increments, 
+ *         so no pow() or division is needed when a note starts.
+ *         The equal temperament table is generated at compile time for SYN_SAMPLE_RATE.
+ *         Scala (.scl) scale files can be loaded to replace it with a microtuning.
+ * @version 0.1
+ * @date 2020-08-29
+ * 
+ * @copyright Copyright (c) 2020
+ * 
+ */
+
+#ifndef _SYN_TUNING_
+#define _SYN_TUNING_
+
+#include <Arduino.h>
+#include "SYN_common.h"
+#include "SYN_operator.h"
+
+#define SYN_TUNE_NOTE_COUNT    128
+#define SYN_TUNE_A4_NOTE        69
+#define SYN_TUNE_A4_FREQ     440.0
+#define SYN_TUNE_SEMITONE    1.0594630943592953  // 2^(1/12)
+#define SYN_TUNE_SCL_REF_NOTE   60               // Scale degree 0 is mapped to C4
+#define SYN_TUNE_MAX_DEGREES   128
+#define SYN_TUNE_EXP2_LEN      256               // Steps per octave in the exp2 lookup table
+#define SYN_TUNE_HZ_PER_INC    ((float)SYN_SAMPLE_RATE / SYN_OP_OSC_LEN)
+
+/**
+ * @brief Compile time integer power, used to build the equal temperament table.
+ */
+constexpr double synTunePow(double base, int exp)
+{
+    return exp == 0 ? 1.0 : (exp > 0 ? base * synTunePow(base, exp - 1) : synTunePow(base, exp + 1) / base);
+}
+
+/**
+ * @brief Compile time oscillator phase increment for an equal tempered MIDI note.
+ */
+constexpr float synTuneNoteInc(int note_num)
+{
+    return (float)(SYN_TUNE_A4_FREQ * synTunePow(SYN_TUNE_SEMITONE, note_num - SYN_TUNE_A4_NOTE) * SYN_OP_OSC_LEN / SYN_SAMPLE_RATE);
+}
+
+class SYN_tuning
+{
+  public:
+    SYN_tuning();
+    float getPhaseInc(uint8_t note_num);
+    float getFrequency(uint8_t note_num);
+    float semitonesToRatio(float semitones);
+    bool  loadScale(const char *scl_text);
+    void  resetScale();
+    
+  private:
+    bool  parsePitch(const char *line, double *ratio);
+
+    float _note_inc[SYN_TUNE_NOTE_COUNT];
+    float _exp2_table[SYN_TUNE_EXP2_LEN + 1];  // 2^(i/LEN), extra entry for interpolation
+};
+
+#endif // _SYN_TUNING_
@@ -0,0 +1,69 @@
+#include "TFT_group_lfo.h"
+
+TFT_group_lfo::TFT_group_lfo():TFT_group()
+{
+    _item_count = 0;
+    addLfoItems(1, 36);
+    addLfoItems(2, 122);
+
+    _items[0]->setSelected(true);
+}
+
+/**
+ * @brief Gets the LFO configuration from the control values.
+ * 
+ * @param lfo_num The one-based LFO number (1 or 2).
+ * @param lfo_cfg The configuration to fill.
+ */
+void TFT_group_lfo::getLfoConfig(uint8_t lfo_num, SYN_lfo_config_t *lfo_cfg)
+{
+    if (lfo_num < 1 || lfo_num > SYN_LFO_COUNT) return;
+
+    uint8_t first = (lfo_num - 1) * TFT_LFO_ITEM_CNT;
+
+    lfo_cfg->lfo_wave = (SYN_lfo_wave_type)_items[first + TFT_LFO1_WAVE]->getValue();
+    lfo_cfg->rate = (float)_items[first + TFT_LFO1_RATE]->getValue() / 10;  // 0.1 Hz steps
+    lfo_cfg->depth = scaleLevel(_items[first + TFT_LFO1_DPTH]->getValue());
+    lfo_cfg->dest = (SYN_lfo_dest_type)_items[first + TFT_LFO1_DEST]->getValue();
+    lfo_cfg->op_num = (uint8_t)_items[first + TFT_LFO1_OP]->getValue();
+}
+
+/**
+ * @brief Sets the control values from the LFO configuration.
+ * 
+ * @param lfo_num The one-based LFO number (1 or 2).
+ * @param lfo_cfg The configuration to display.
+ */
+void TFT_group_lfo::setLfoConfig(uint8_t lfo_num, SYN_lfo_config_t *lfo_cfg)
+{
+    if (lfo_num < 1 || lfo_num > SYN_LFO_COUNT) return;
+
+    uint8_t first = (lfo_num - 1) * TFT_LFO_ITEM_CNT;
+
+    _items[first + TFT_LFO1_WAVE]->setValue(lfo_cfg->lfo_wave);
+    _items[first + TFT_LFO1_RATE]->setValue((int16_t)(lfo_cfg->rate * 10));
+    _items[first + TFT_LFO1_DPTH]->setValue(unscaleLevel(lfo_cfg->depth));
+    _items[first + TFT_LFO1_DEST]->setValue(lfo_cfg->dest);
+    _items[first + TFT_LFO1_OP]->setValue(lfo_cfg->op_num);
+}
+
+//----- PRIVATE METHODS -----//
+
+void TFT_group_lfo::addLfoItems(uint8_t lfo_num, int16_t y)
+{
+    TFT_slider *wave = new TFT_slider(  0, y, "WAV");
+    TFT_slider *rate = new TFT_slider( 20, y, "RAT");
+    TFT_slider *dpth = new TFT_slider( 40, y, "DEP");
+    TFT_slider *dest = new TFT_slider( 60, y, "DST");
+    TFT_slider *op   = new TFT_slider( 80, y, "OP");
+
+    wave->setRange(0, SYN_LFO_WAVE_TYPE_COUNT - 1);
+    dest->setRange(0, SYN_LFO_DEST_TYPE_COUNT - 1);
+    op->setRange(0, 4);  // 0 = all operators, otherwise op 1-4
+
+    _items[_item_count++] = wave;
+    _items[_item_count++] = rate;
+    _items[_item_count++] = dpth;
+    _items[_item_count++] = dest;
+    _items[_item_count++] = op;
+}
@@ -0,0 +1,34 @@
+#ifndef _TFT_GROUP_LFO_
+#define _TFT_GROUP_LFO_
+
+#include "TFT_group.h"
+
+enum TFT_lfo_type
+{
+  TFT_LFO1_WAVE = 0,
+  TFT_LFO1_RATE = 1,
+  TFT_LFO1_DPTH = 2,
+  TFT_LFO1_DEST = 3,
+  TFT_LFO1_OP = 4,
+
+  TFT_LFO2_WAVE = 5,
+  TFT_LFO2_RATE = 6,
+  TFT_LFO2_DPTH = 7,
+  TFT_LFO2_DEST = 8,
+  TFT_LFO2_OP = 9
+};
+
+#define TFT_LFO_ITEM_CNT  5  // controls per LFO
+
+class TFT_group_lfo : public TFT_group
+{
+  public:
+    TFT_group_lfo();
+    void getLfoConfig(uint8_t lfo_num, SYN_lfo_config_t *lfo_cfg);
+    void setLfoConfig(uint8_t lfo_num, SYN_lfo_config_t *lfo_cfg);
+    
+  private:
+    void addLfoItems(uint8_t lfo_num, int16_t y);
+};
+
+#endif // _TFT_GROUP_LFO_
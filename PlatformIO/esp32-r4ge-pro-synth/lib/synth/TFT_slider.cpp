@@ -101,4 +101,6 @@ void TFT_slider::setRange(int16_t min_value, int16_t max_value)
 {
     _min = min_value;
     _max = max_value;
+    _scale_factor = (float)(_ht - TFT_SLDR_LBL_HT - TFT_SLDR_BTN_HT) / (float)(_max - _min);
+    _changed = true;
 }
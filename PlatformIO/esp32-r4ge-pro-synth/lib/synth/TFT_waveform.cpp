@@ -46,6 +46,9 @@ void TFT_waveform::draw(Adafruit_ILI9341 *tft, SYN_wave_type wave_type)
         case SYN_WAVE_CUSTOM:
             drawCustom(tft);
             break;
+        case SYN_WAVE_SAMPLE:
+            drawSample(tft);
+            break;
         default:
             drawSilence(tft);
             break; 
@@ -87,6 +90,9 @@ void TFT_waveform::drawName(Adafruit_ILI9341 *tft, SYN_wave_type wave_type)
         case SYN_WAVE_CUSTOM:
             tft->print("CUST");
             break;
+        case SYN_WAVE_SAMPLE:
+            tft->print("SMPL");
+            break;
         default:
             tft->print("----");
             break; 
@@ -188,3 +194,22 @@ void TFT_waveform::drawCustom(Adafruit_ILI9341 *tft)
     tft->setCursor((_x + _wd / 2) - 6, _ctr_y - 6); 
     tft->print("C"); // TODO: better symbol
 }
+
+/**
+ * @brief Draw a few cycles of a decaying wave, like a struck note recorded to a sample.
+ */
+void TFT_waveform::drawSample(Adafruit_ILI9341 *tft)
+{
+    double two_pi_scaled = 4 * 2 * PI / _wd;  // Four cycles across the width
+    float sample;
+    int16_t y = 0;
+    int16_t prev_y = _ctr_y;
+
+    for (int16_t i = 0; i < _wd; i++)
+    {
+        sample = _ht * (float)(exp(-3.0 * i / _wd) * sin((double)i * two_pi_scaled)) / 2;
+        y = _ctr_y + (int16_t)sample;
+        tft->drawLine(_x + i - (i > 0), prev_y, _x + i, y, _wave_color);  // Lines, so the steep first cycle is unbroken
+        prev_y = y;
+    }
+}
@@ -47,6 +47,7 @@ class TFT_waveform
     void drawMinor(Adafruit_ILI9341 *tft);
     void drawOct3(Adafruit_ILI9341 *tft);
     void drawCustom(Adafruit_ILI9341 *tft);
+    void drawSample(Adafruit_ILI9341 *tft);
 
 };
 
@@ -12,7 +12,9 @@ Requires:
  - A: play selected note    
  - B: next screen    
  - X: prev screen
- - Y: start/stop sequencer playback (pending)    
+ - Y: start/stop song playback (/SYNTH/SONGnnn.MID for the last loaded slot)
+      or the step sequencer if there is no song file
+ - MIDI in: notes, and Start/Stop/Clock run the step sequencer at the sender's tempo
 
 Copyright (c) 2020 Paul Pagel
 This is free software; see the license.txt file for more information.
@@ -29,10 +31,13 @@ There is no warranty; not even for merchantability or fitness for a particular p
 #include "SYN_common.h"
 #include "SYN_engine.h"
 #include "SYN_midi.h"
+#include "SYN_smf.h"
+#include <TLM_channel.h>
 #include "TFT_group_op12.h"
 #include "TFT_group_op34.h"
 #include "TFT_group_fltr.h"
 #include "TFT_group_seq.h"
+#include "TFT_group_lfo.h"
 #include "TFT_keyboard.h"
 #include "TFT_sd_grid.h"
 #include "TFT_select_wave.h"
@@ -50,19 +55,34 @@ There is no warranty; not even for merchantability or fitness for a particular p
 #define SD_TOUCH_X2 319
 #define SD_TOUCH_Y2  30
 
+#define PITCH_BEND_RANGE  2    // Semitones of bend at full joystick travel
+#define SONG_BEND_RANGE   2.0  // Semitones of bend at full MIDI pitch bend, the General MIDI default
+#define MIDI_CC_MOD_WHEEL   1
+#define MIDI_CC_RESET_ALL 121  // Reset All Controllers
+#define MIDI_CC_NOTES_OFF 123  // All Notes Off
+#define TUNING_MAX_BYTES  4096 // Largest Scala file that will be loaded
+#define SAMPLER_STATS_MS  5000 // Interval for reporting new sample prefetch misses
+#define SEQ_CLOCKS_PER_STEP  6 // MIDI clocks (24 per beat) per sequencer step, i.e. 16th notes
+#define SEQ_CLOCK_TIMEOUT_MS 500 // Without a clock for this long the sequencer goes back to its own tempo
+
 enum app_mode_type 
 {
   MODE_OP12,
   MODE_OP34,
   MODE_FLTR,
   MODE_STEP_SEQ,
+  MODE_LFO,
   MODE_SELECT_SD,
 };
 enum app_mode_type app_mode, prev_app_mode;
 
 const char* APP_FOLDER = "/SYNTH/";
 char cfg_filename[]    = "/SYNTH/SYN000.CFG";      
+char song_filename[]   = "/SYNTH/SONG000.MID";
+const char* TUNING_FILENAME = "/SYNTH/TUNING.SCL";
+const char* SAMPLE_FOLDER   = "/SYNTH/SMP";
 uint16_t    mic_index  = 1;
+uint16_t    cfg_index  = 0;  // Last loaded or saved config slot
 
 bool btn_was_pressed[8], btn_pressed[8], btn_released[8];
 bool btnSD_pressed, btnSD_released;
@@ -84,6 +104,7 @@ TFT_group_op12 op12_grp = TFT_group_op12();
 TFT_group_op34 op34_grp = TFT_group_op34();
 TFT_group_fltr fltr_grp = TFT_group_fltr();
 TFT_group_seq   seq_grp = TFT_group_seq();
+TFT_group_lfo   lfo_grp = TFT_group_lfo();
 TFT_keyboard keybrd = TFT_keyboard(0, 204, "OCT1");
 TFT_sd_grid sd_grid = TFT_sd_grid(0, 36, "SD");
 
@@ -92,18 +113,56 @@ SYN_op_config_t       op_cfg;
 SYN_filter_config_t   fltr_cfg;
 SYN_global_config_t   global_cfg = { .route = SYN_ROUTE_1234};
 SYN_sequence_config_t seq_cfg;
+SYN_lfo_config_t      lfo_cfg;
 //SYN_midi midi = SYN_midi();
 
 //SYN_played_note_type played_note[SYN_MAX_VOICES];
 //uint8_t note_idx = 0;
 uint8_t note_num = 69;  // A4, 440 Hz
 uint8_t prev_note_num = 69;
-float pitch_bend =  1.0; // No bend
+float pitch_bend =  0.0; // No bend (semitones)
 float mod_level  =  1.0; // No mod change
 
 bool     play_seq = false;
 uint64_t seq_note_start = 0; // time last sequence note played
 uint8_t  seq_idx;
+uint8_t  seq_clock_cnt = 0;  // MIDI clocks since the last step
+uint32_t seq_clock_ms = 0;   // When the last MIDI clock arrived, 0 if none
+uint8_t  seq_steps_due = 0;  // Steps the MIDI clock has made due that have not been played yet
+
+/*
+ * Streams MIDI file data from the SD card for the song player.
+ * Holds the SD lock for each access, the sample prefetch task shares the card.
+ */
+class SMF_sd_reader : public SYN_smf_reader
+{
+  public:
+    File file;
+    bool seek(uint32_t pos) 
+    { 
+      syn_eng.lockSD();
+      bool success = file.seek(pos);
+      syn_eng.unlockSD();
+      return success; 
+    }
+    int32_t read(uint8_t *buff, uint32_t len) 
+    { 
+      syn_eng.lockSD();
+      int32_t bytes_read = file.read(buff, len);
+      syn_eng.unlockSD();
+      return bytes_read; 
+    }
+};
+
+SYN_smf       smf;
+SMF_sd_reader smf_reader;
+bool          play_song = false;
+uint32_t      song_start = 0;  // Engine sample clock when song playback started
+float         song_bend = 0.0; // Song pitch bend (semitones), added to the joystick's
+float         song_mod  = 1.0; // Song mod wheel, multiplies the joystick's mod level
+
+ulong    sampler_stats_time = 0;
+uint32_t sampler_misses = 0;
 
 void  blinkLED(uint8_t count);
 void  playStartupSound();
@@ -114,6 +173,12 @@ void  handleSelectionSD();
 void  setFilename(uint16_t index);
 bool  loadConfigFile(uint16_t index);
 bool  saveConfigFile(uint16_t index);
+bool  loadTuningFile();
+bool  startSong(uint16_t index);
+void  stopSong();
+void  updateSong();
+void  sendSongEvents();
+void  checkSamplerStats();
 bool  initAudioI2S();
 void  playAudio();
 void  drawSD(bool present);
@@ -122,6 +187,7 @@ void  beginDisplayOp12();
 void  beginDisplayOp34();
 void  beginDisplayFltr();
 void  beginDisplayStepSeq();
+void  beginDisplayLfo();
 void  beginWavSelect();
 void  updateScreen();
 void  checkButtonPresses();
@@ -165,12 +231,54 @@ void handleNoteOff(byte channel, byte pitch, byte velocity)
   //Serial.print("NoteOff pitch: "); Serial.println(pitch);
 }
 
+/**
+ * @brief MIDI callback for Timing Clock messages, 24 per beat.
+ *        While they arrive the sequencer steps on the clock instead of its tempo.
+ */
+void handleClock()
+{
+  seq_clock_ms = millis();
+  if (++seq_clock_cnt >= SEQ_CLOCKS_PER_STEP)
+  {
+    seq_clock_cnt = 0;
+    if (seq_steps_due < 255) seq_steps_due++;  // Counted, so a slow loop() plays late rather than dropping steps
+  }
+}
+
+/**
+ * @brief MIDI callback for Start messages.  Starts the sequencer from the first step,
+ *        unless a song is playing.  The next clock is the first step.
+ */
+void handleStart()
+{
+  if (play_song) return;
+
+  seq_idx = 0;
+  seq_clock_ms = millis();  // Wait for the clock rather than the tempo
+  seq_clock_cnt = SEQ_CLOCKS_PER_STEP - 1;
+  seq_steps_due = 0;
+  play_seq = true;
+}
+
+/**
+ * @brief MIDI callback for Stop messages.
+ */
+void handleStop()
+{
+  if (play_seq)
+  {
+    play_seq = false;
+    syn_eng.allOff();
+  }
+}
+
 /*
  * Set up the board
  */
 void setup() 
 {
   Serial.begin(9600);
+  tlm_channel.begin(&Serial);
   Serial.println("ESP32 R4ge Pro Synth"); 
   delay(100);
 
@@ -210,6 +318,7 @@ void setup()
 
   if (sd_present)
   {
+    syn_eng.lockSD();
     if (!SD.exists(APP_FOLDER))
     {
       if (!SD.mkdir(APP_FOLDER))
@@ -218,6 +327,15 @@ void setup()
         Serial.println(F("Please create it manually on the SD card."));
       }
     }
+
+    loadTuningFile();
+    syn_eng.unlockSD();
+
+    uint8_t zone_cnt = syn_eng.loadSamples(SAMPLE_FOLDER);
+    if (zone_cnt > 0)
+    {
+      Serial.print(F("Sample zones loaded: ")); Serial.println(zone_cnt);
+    }
   }
 
   beginDisplayOp12();
@@ -226,6 +344,9 @@ void setup()
   // Set up MIDI (IN only)
   midi_in.setHandleNoteOn(handleNoteOn);  
   midi_in.setHandleNoteOff(handleNoteOff);
+  midi_in.setHandleClock(handleClock);
+  midi_in.setHandleStart(handleStart);
+  midi_in.setHandleStop(handleStop);
   midi_in.begin(MIDI_CHANNEL_OMNI);
   
   blinkLED(2);
@@ -328,13 +449,18 @@ void handleSelectionSD()
   int16_t slot_idx = sd_grid.getValue();
   bool success = true;
 
+  // The sample prefetch task shares the SD card
   if (action == TFT_SD_GRID_BTN_LOAD)
   {
+    syn_eng.lockSD();
     success = loadConfigFile(slot_idx);
+    syn_eng.unlockSD();
   }
   else if (action == TFT_SD_GRID_BTN_SAVE)
   {
+    syn_eng.lockSD();
     success = saveConfigFile(slot_idx);
+    syn_eng.unlockSD();
   }
   else 
   {
@@ -355,8 +481,12 @@ void setFilename(uint16_t index)
 	cfg_filename[10] = char(48 + (index % 1000) / 100);
 	cfg_filename[11] = char(48 + (index % 100) / 10);
 	cfg_filename[12] = char(48 + (index % 10));
+	cfg_index = index;
 }
 
+/*
+ * Call with the SD lock held.
+ */
 bool loadConfigFile(uint16_t index)
 {
   Serial.println(F("Loading synth config file: "));
@@ -418,18 +548,43 @@ bool loadConfigFile(uint16_t index)
   bytes_read = file.read((uint8_t *)&seq_cfg, sizeof(SYN_sequence_config_t));  
   seq_grp.setSeqConfig(&seq_cfg);
 
-  file.close();
-
-  // See if the final read succceeded
   if (bytes_read < sizeof(SYN_sequence_config_t))
   {
+    file.close();
     Serial.println(F("Error reading sequence from synth config file!"));
     return false;  // failure
   }
 
+  // LFOs (added in version 2).  Older files get LFOs that do nothing, rather than 
+  // keeping whatever the last patch had
+  for (uint8_t lfo_num = 1; lfo_num <= SYN_LFO_COUNT; lfo_num++)
+  {
+    if (hdr_cfg.version < 2)
+    {
+      SYN_lfo::getDefaultConfig(&lfo_cfg);
+    }
+    else
+    {
+      bytes_read = file.read((uint8_t *)&lfo_cfg, sizeof(SYN_lfo_config_t));  
+      if (bytes_read < sizeof(SYN_lfo_config_t))
+      {
+        file.close();
+        Serial.println(F("Error reading LFO from synth config file!"));
+        return false;  // failure
+      }
+    }
+    syn_eng.setLfoConfig(lfo_num, &lfo_cfg);
+    lfo_grp.setLfoConfig(lfo_num, &lfo_cfg);
+  }
+
+  file.close();
+
 	return true; 
 }
 
+/*
+ * Call with the SD lock held.
+ */
 bool saveConfigFile(uint16_t index)
 {
   Serial.println(F("Saving synth config file: "));
@@ -447,7 +602,7 @@ bool saveConfigFile(uint16_t index)
   // Save the config file header
   SYN_header_config_t hdr_cfg = {
     .header_id = SYN_CFG_HDR_SYN1,
-    .version = 1,
+    .version = 2,
     .reserved = 0
   };
   size_t   bytes_written;
@@ -481,12 +636,19 @@ bool saveConfigFile(uint16_t index)
   seq_grp.getSeqConfig(&seq_cfg);
   bytes_written = file.write((uint8_t *)&seq_cfg, sizeof(SYN_sequence_config_t));
 
+  // Save the LFO configurations
+  for (uint8_t lfo_num = 1; lfo_num <= SYN_LFO_COUNT; lfo_num++)
+  {
+    lfo_grp.getLfoConfig(lfo_num, &lfo_cfg);
+    bytes_written = file.write((uint8_t *)&lfo_cfg, sizeof(SYN_lfo_config_t));
+  }
+
   file.close();
 
   // See if the final write succceeded
-  if (bytes_written < sizeof(SYN_sequence_config_t))
+  if (bytes_written < sizeof(SYN_lfo_config_t))
   {
-    Serial.println(F("Error writing sequence to synth config file!"));
+    Serial.println(F("Error writing LFO to synth config file!"));
     return false;  // failure
   }
 
@@ -495,6 +657,200 @@ bool saveConfigFile(uint16_t index)
   return true; // success!
 }
 
+/*
+ * Loads the optional Scala microtuning file from the SD card.
+ * Standard equal temperament is used if there is no tuning file.
+ * Call with the SD lock held.
+ */
+bool loadTuningFile()
+{
+  if (!SD.exists(TUNING_FILENAME)) return false;
+
+  File file = SD.open(TUNING_FILENAME, FILE_READ);
+  if (!file)
+  {
+    Serial.println(F("Error opening tuning file!"));
+    return false;
+  }
+
+  size_t file_size = file.size();
+  if (file_size > TUNING_MAX_BYTES)
+  {
+    file.close();
+    Serial.println(F("Tuning file is too large!"));
+    return false;
+  }
+
+  char *scl_text = (char *)malloc(file_size + 1);
+  if (scl_text == NULL)
+  {
+    file.close();
+    return false;
+  }
+
+  size_t bytes_read = file.read((uint8_t *)scl_text, file_size);
+  scl_text[bytes_read] = 0;
+  file.close();
+
+  bool success = syn_eng.loadScale(scl_text);
+  free(scl_text);
+
+  Serial.println(success ? F("Tuning file loaded.") : F("Invalid tuning file!"));
+  return success;
+}
+
+/*
+ * Reports sample streaming statistics if there have been new prefetch misses.
+ */
+void checkSamplerStats()
+{
+  if (millis() - sampler_stats_time < SAMPLER_STATS_MS) return;
+  sampler_stats_time = millis();
+
+  SYN_sampler_stats_t stats;
+  syn_eng.getSamplerStats(&stats);
+  if (stats.misses == sampler_misses) return;
+  sampler_misses = stats.misses;
+
+  Serial.print(F("Sampler misses: "));   Serial.print(stats.misses);
+  Serial.print(F(" reads: "));           Serial.print(stats.reads);
+  Serial.print(F(" max read us: "));     Serial.print(stats.max_read_us);
+  Serial.print(F(" min headroom: "));    Serial.println(stats.min_headroom);
+}
+
+/*
+ * Starts streaming the song file that goes with the specified config slot.
+ * Returns false if there is no playable song file.
+ */
+bool startSong(uint16_t index)
+{
+  if (!sd_present) return false;
+
+  song_filename[11] = char(48 + (index % 1000) / 100);
+  song_filename[12] = char(48 + (index % 100) / 10);
+  song_filename[13] = char(48 + (index % 10));
+
+  syn_eng.lockSD();
+  bool exists = SD.exists(song_filename);
+  if (exists) smf_reader.file = SD.open(song_filename, FILE_READ);
+  syn_eng.unlockSD();
+  if (!exists) return false;
+  
+  if (!smf_reader.file)
+  {
+    Serial.println(F("Error opening song file!"));
+    return false;
+  }
+
+  SYN_smf_err err = smf.open(&smf_reader, SYN_SAMPLE_RATE);
+  if (err != SYN_SMF_ERR_OK)
+  {
+    syn_eng.lockSD();
+    smf_reader.file.close();
+    syn_eng.unlockSD();
+    Serial.print(F("Invalid song file, error: ")); Serial.println(err);
+    return false;
+  }
+
+  Serial.print(F("Playing song: ")); Serial.println(song_filename);
+  song_start = syn_eng.getSampleClock();
+  song_bend = 0.0;
+  song_mod = 1.0;
+  play_song = true;
+  return true;
+}
+
+void stopSong()
+{
+  smf.close();
+  syn_eng.lockSD();
+  smf_reader.file.close();
+  syn_eng.unlockSD();
+  play_song = false;
+
+  // Release the song's notes rather than cutting them off
+  syn_eng.allNotesOff();
+  song_bend = 0.0;
+  song_mod = 1.0;
+}
+
+/*
+ * Plays one engine block of the song.  The block is split at each event's time 
+ * on the engine's sample clock, so the song keeps time with the audio rather than 
+ * with loop(), and events start on their own sample (within SYN_ENG_MIN_LEN) 
+ * rather than on the next block boundary.
+ */
+void updateSong()
+{
+  uint32_t rendered = 0;
+
+  while (play_song && rendered < SYN_ENG_UPDATE_LEN)
+  {
+    sendSongEvents();
+    if (!play_song) break;
+
+    uint32_t length = SYN_ENG_UPDATE_LEN - rendered;
+    uint32_t sample_clock = syn_eng.getSampleClock() - song_start;
+    uint32_t next_time = smf.getNextTime();
+    if (next_time > sample_clock && next_time - sample_clock < length) length = next_time - sample_clock;
+    if (length < SYN_ENG_MIN_LEN) length = SYN_ENG_MIN_LEN;
+
+    syn_eng.update(length);
+    rendered += length;
+  }
+}
+
+/*
+ * Sends all song events that are due at the engine's sample clock to the synth engine.
+ */
+void sendSongEvents()
+{
+  SYN_smf_event_t event;
+  uint32_t sample_clock = syn_eng.getSampleClock() - song_start;
+
+  while (smf.getEvent(sample_clock, &event))
+  {
+    switch (event.type)
+    {
+      case SYN_SMF_EVENT_NOTE_ON:
+        syn_eng.noteOn(event.channel, event.data1, event.data2);
+        break;
+      case SYN_SMF_EVENT_NOTE_OFF:
+        syn_eng.noteOff(event.channel, event.data1);
+        break;
+      case SYN_SMF_EVENT_PITCH_BEND:
+        song_bend = event.bend * SONG_BEND_RANGE / 8192;
+        break;
+      case SYN_SMF_EVENT_CONTROL:
+        if (event.data1 == MIDI_CC_MOD_WHEEL)
+        {
+          song_mod = 1.0 + event.data2 / 127.0;  // Wheel down is no change, up doubles it
+        }
+        else if (event.data1 == MIDI_CC_RESET_ALL)
+        {
+          song_bend = 0.0;
+          song_mod = 1.0;
+        }
+        else if (event.data1 == MIDI_CC_NOTES_OFF)
+        {
+          syn_eng.allNotesOff();
+        }
+        break;
+    }
+  }
+  syn_eng.pitchBend(pitch_bend + song_bend);  // Now, rather than on the next loop()
+  syn_eng.modLevel(mod_level * song_mod);
+
+  if (!smf.getPlaying())
+  {
+    if (smf.getError() != SYN_SMF_ERR_OK)
+    {
+      Serial.print(F("Song stream error: ")); Serial.println(smf.getError());
+    }
+    stopSong();
+  }
+}
+
 /*
  * Draws the SD card status icon indicating if the card is present or not.
  */
@@ -564,6 +920,16 @@ void beginDisplayStepSeq()
   app_mode = MODE_STEP_SEQ;
 }
 
+void beginDisplayLfo()
+{
+  beginScreenDisplay();
+
+  tft.drawLine(0, MID_LINE, 319, MID_LINE, ILI9341_BLUE);   
+  lfo_grp.draw(&tft, true);
+
+  app_mode = MODE_LFO;
+}
+
 /*
  * Inital drawing and setup of the select screen
  */
@@ -596,6 +962,9 @@ void updateScreen()
       case MODE_STEP_SEQ:
         beginDisplayStepSeq();
         break;
+      case MODE_LFO:
+        beginDisplayLfo();
+        break;
       case MODE_SELECT_SD:
 		    beginSelect();
 		    break;
@@ -684,6 +1053,21 @@ void updateScreen()
       seq_grp.draw(&tft, false);
       break;
 
+    case MODE_LFO:
+      lfo_grp.handleButtons(btn_pressed[BTN_UP], btn_pressed[BTN_DOWN], btn_released[BTN_LEFT], btn_released[BTN_RIGHT]);
+      lfo_grp.handleTouch(touch_x, touch_y);
+      
+      if (lfo_grp.getChanged())
+      {
+        for (uint8_t lfo_num = 1; lfo_num <= SYN_LFO_COUNT; lfo_num++)
+        {
+          lfo_grp.getLfoConfig(lfo_num, &lfo_cfg);
+          syn_eng.setLfoConfig(lfo_num, &lfo_cfg);
+        }
+      }
+      lfo_grp.draw(&tft, false);
+      break;
+
     case MODE_SELECT_SD:
       sd_grid.handleButtons(btn_pressed[BTN_UP], btn_pressed[BTN_DOWN], btn_released[BTN_LEFT], btn_released[BTN_RIGHT]);
       if (sd_grid.handleTouch(touch_x, touch_y))
@@ -820,11 +1204,11 @@ void loop(void)
   midi_in.read();
   checkJoysticks();
 
-  pitch_bend = normalizeJoy(joy_y_left);
-  syn_eng.pitchBend(pitch_bend);
+  pitch_bend = (normalizeJoy(joy_y_left) - 1.0) * PITCH_BEND_RANGE;
+  syn_eng.pitchBend(pitch_bend + song_bend);
 
   mod_level = normalizeJoy(joy_x_left);
-  syn_eng.modLevel(mod_level);
+  syn_eng.modLevel(mod_level * song_mod);
 
   if (btn_pressed[BTN_A] && !btn_was_pressed[BTN_A])  // Play selected note
   {
@@ -861,22 +1245,36 @@ void loop(void)
 
   if (btn_released[BTN_Y])
   {
-    // Toggle sequence playback on and off
-    play_seq = !play_seq;
-
-    if (!play_seq) 
+    // Toggle song or sequence playback on and off
+    if (play_song)
     {
+      stopSong();
+    }
+    else if (play_seq)
+    {
+      play_seq = false;
       syn_eng.allOff();
     }
-    
+    else if (!startSong(cfg_index))
+    {
+      play_seq = true;
+    }
+  }
+
+  midi_in.read();
+  if (play_song)
+  {
+    updateSong();
   }
 
   midi_in.read();
   updateScreen();
 
   midi_in.read();
-  if (play_seq && (millis() - seq_note_start > seq_cfg.tempo))
+  bool ext_clock = (seq_clock_ms > 0 && millis() - seq_clock_ms < SEQ_CLOCK_TIMEOUT_MS);
+  if (play_seq && (ext_clock ? seq_steps_due > 0 : millis() - seq_note_start > seq_cfg.tempo))
   {
+    if (seq_steps_due > 0) seq_steps_due--;
     uint8_t idx = seq_cfg.note_idx[seq_idx];
     note_num = midi_note[idx].note_num;
     
@@ -895,7 +1293,8 @@ void loop(void)
 
   midi_in.read();
   
-  syn_eng.update(); 
+  if (!play_song) syn_eng.update();  // updateSong() renders the song's blocks
+  checkSamplerStats();
 
   digitalWrite(ESP_LED, LOW);
   //delay(10);
@@ -0,0 +1,20 @@
+#ifndef _HOST_ARDUINO_
+#define _HOST_ARDUINO_
+
+/*
+ * Minimal stand-in for the Arduino core so engine classes without hardware
+ * dependencies (SYN_tuning) build unchanged in the host tools.
+ * Add -Itools/host to the host build line.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifndef PI
+#define PI 3.1415926535897932384626433832795
+#endif
+
+#endif // _HOST_ARDUINO_
@@ -0,0 +1,194 @@
+/**
+ * @file smf_render.cpp
+ * @author Paul Pagel (https://twobittinker.com)
+ * @brief  Host tool that plays a Standard MIDI File through SYN_smf and renders it
+ *         to a 16-bit mono WAV file with a simple sine voice, for checking event
+ *         timing and track merging without the hardware.
+ *
+ *         Build from the project folder:
+ *           g++ -O2 -Ilib/synth tools/smf_render.cpp lib/synth/SYN_smf.cpp -o smf_render
+ *         Usage:
+ *           ./smf_render SONG000.MID out.wav
+ * @version 0.1
+ * @date 2020-08-29
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "SYN_smf.h"
+
+#define RENDER_SAMPLE_RATE  11025  // Matches SYN_SAMPLE_RATE
+#define RENDER_BLOCK_LEN       64  // Samples rendered between event polls
+#define RENDER_VOICES          16
+#define RENDER_TAIL_SEC       1.0  // Release tail rendered after the last event
+#define RENDER_RELEASE_SEC   0.15
+
+class FILE_reader : public SYN_smf_reader
+{
+  public:
+    FILE_reader(FILE *file) : _file(file) {}
+    bool    seek(uint32_t pos) { return fseek(_file, pos, SEEK_SET) == 0; }
+    int32_t read(uint8_t *buff, uint32_t len) { return fread(buff, 1, len, _file); }
+
+  private:
+    FILE *_file;
+};
+
+typedef struct
+{
+    bool    active;
+    bool    released;
+    uint8_t channel;
+    uint8_t note;
+    float   phase;
+    float   phase_inc;
+    float   amp;
+    float   level;
+} render_voice_t;
+
+static render_voice_t voice[RENDER_VOICES];
+static float bend_ratio[16];
+
+static void writeHeader(FILE *out, uint32_t sample_cnt)
+{
+    uint32_t data_len = sample_cnt * 2;
+    uint32_t riff_len = 36 + data_len;
+    uint32_t fmt_len = 16, rate = RENDER_SAMPLE_RATE, byte_rate = RENDER_SAMPLE_RATE * 2;
+    uint16_t pcm = 1, channels = 1, align = 2, bits = 16;
+
+    fwrite("RIFF", 1, 4, out);  fwrite(&riff_len, 4, 1, out);
+    fwrite("WAVEfmt ", 1, 8, out);
+    fwrite(&fmt_len, 4, 1, out);  fwrite(&pcm, 2, 1, out);
+    fwrite(&channels, 2, 1, out); fwrite(&rate, 4, 1, out);
+    fwrite(&byte_rate, 4, 1, out); fwrite(&align, 2, 1, out);
+    fwrite(&bits, 2, 1, out);
+    fwrite("data", 1, 4, out);  fwrite(&data_len, 4, 1, out);
+}
+
+static void handleEvent(SYN_smf_event_t *event)
+{
+    uint8_t v;
+
+    switch (event->type)
+    {
+        case SYN_SMF_EVENT_NOTE_ON:
+            for (v = 0; v < RENDER_VOICES && voice[v].active; v++);
+            if (v == RENDER_VOICES) v = 0;  // Steal the first voice
+            voice[v].active = true;
+            voice[v].released = false;
+            voice[v].channel = event->channel;
+            voice[v].note = event->data1;
+            voice[v].phase = 0;
+            voice[v].phase_inc = 2.0f * M_PI * 440.0f * powf(2.0f, (event->data1 - 69) / 12.0f) / RENDER_SAMPLE_RATE;
+            voice[v].amp = (event->data2 / 127.0f) * 0.2f;
+            voice[v].level = 1.0f;
+            break;
+
+        case SYN_SMF_EVENT_NOTE_OFF:
+            for (v = 0; v < RENDER_VOICES; v++)
+            {
+                if (voice[v].active && !voice[v].released &&
+                    voice[v].channel == event->channel && voice[v].note == event->data1)
+                {
+                    voice[v].released = true;
+                }
+            }
+            break;
+
+        case SYN_SMF_EVENT_PITCH_BEND:
+            bend_ratio[event->channel] = powf(2.0f, (event->bend / 8192.0f) * 2.0f / 12.0f);
+            break;
+
+        default:
+            break;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    SYN_smf smf;
+    SYN_smf_event_t event;
+    int16_t block[RENDER_BLOCK_LEN];
+    uint32_t sample_clock = 0, tail = 0, event_cnt = 0;
+    float release_step = 1.0f / (RENDER_RELEASE_SEC * RENDER_SAMPLE_RATE);
+
+    if (argc < 3)
+    {
+        printf("Usage: %s input.mid output.wav\n", argv[0]);
+        return 1;
+    }
+
+    FILE *in = fopen(argv[1], "rb");
+    FILE *out = fopen(argv[2], "wb");
+    if (in == NULL || out == NULL)
+    {
+        printf("Unable to open files.\n");
+        return 1;
+    }
+
+    FILE_reader reader(in);
+    SYN_smf_err err = smf.open(&reader, RENDER_SAMPLE_RATE);
+    if (err != SYN_SMF_ERR_OK)
+    {
+        printf("Unable to play MIDI file, error %d\n", err);
+        return 1;
+    }
+
+    for (uint8_t ch = 0; ch < 16; ch++) bend_ratio[ch] = 1.0f;
+    writeHeader(out, 0);
+
+    while (tail < RENDER_TAIL_SEC * RENDER_SAMPLE_RATE)
+    {
+        // Dispatch everything due before the end of this block
+        while (smf.getEvent(sample_clock + RENDER_BLOCK_LEN - 1, &event))
+        {
+            handleEvent(&event);
+            event_cnt++;
+        }
+
+        memset(block, 0, sizeof(block));
+        for (uint8_t v = 0; v < RENDER_VOICES; v++)
+        {
+            if (!voice[v].active) continue;
+
+            float inc = voice[v].phase_inc * bend_ratio[voice[v].channel];
+            for (uint16_t i = 0; i < RENDER_BLOCK_LEN; i++)
+            {
+                if (voice[v].released)
+                {
+                    voice[v].level -= release_step;
+                    if (voice[v].level <= 0)
+                    {
+                        voice[v].active = false;
+                        break;
+                    }
+                }
+                int32_t sample = block[i] + (int32_t)(sinf(voice[v].phase) * voice[v].amp * voice[v].level * 32767);
+                block[i] = sample > 32767 ? 32767 : (sample < -32768 ? -32768 : sample);
+                voice[v].phase += inc;
+                if (voice[v].phase > 2.0f * M_PI) voice[v].phase -= 2.0f * M_PI;
+            }
+        }
+
+        fwrite(block, sizeof(int16_t), RENDER_BLOCK_LEN, out);
+        sample_clock += RENDER_BLOCK_LEN;
+        if (!smf.getPlaying()) tail += RENDER_BLOCK_LEN;
+    }
+
+    if (smf.getError() != SYN_SMF_ERR_OK)
+    {
+        printf("Stream error %d\n", smf.getError());
+    }
+
+    fseek(out, 0, SEEK_SET);
+    writeHeader(out, sample_clock);
+    fclose(out);
+    fclose(in);
+
+    printf("%u events, %.2f sec rendered\n", event_cnt, (float)sample_clock / RENDER_SAMPLE_RATE);
+    return 0;
+}
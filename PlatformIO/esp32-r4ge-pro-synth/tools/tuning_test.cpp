@@ -0,0 +1,84 @@
+/**
+ * @file tuning_test.cpp
+ * @author Paul Pagel (https://twobittinker.com)
+ * @brief  Host test of SYN_tuning::semitonesToRatio() against pow().
+ *         Sweeps the bend range, then tries values just either side of 0 and of
+ *         every whole octave, where float rounding can put the table position at
+ *         the very end of the octave, e.g. a joystick resting just below centre
+ *         or an LFO sine crossing zero.
+ *         Returns non-zero if a ratio is off by more than MAX_REL_ERROR.
+ *         Reading past the end of the table only gives a wrong ratio if the entry
+ *         after it is garbage, so build with the bounds sanitizer to catch it.
+ *
+ *         Build and run from the project folder:
+ *           g++ -O1 -fsanitize=bounds-strict -fno-sanitize-recover=all -Itools/host -Ilib/synth \
+ *               tools/tuning_test.cpp lib/synth/SYN_tuning.cpp -o tuning_test && ./tuning_test
+ * @version 0.1
+ * @date 2020-08-29
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include "SYN_tuning.h"
+
+#define MAX_REL_ERROR  0.0001  // Linear interpolation over 1/256 octave is good to ~1e-5
+#define MAX_OCTAVES        4
+
+static SYN_tuning tuning;
+static double max_error = 0;
+static float  worst = 0;
+static int    checked = 0;
+
+static void checkRatio(float semitones)
+{
+    double expect = pow(2.0, semitones / 12.0);
+    double error = fabs(tuning.semitonesToRatio(semitones) - expect) / expect;
+
+    if (error > max_error || error != error)
+    {
+        max_error = (error != error ? INFINITY : error);
+        worst = semitones;
+    }
+    checked++;
+}
+
+int main()
+{
+    // Bend range
+    for (int i = -4800; i <= 4800; i++)
+    {
+        checkRatio(i * 0.01f);
+    }
+
+    // Just either side of 0
+    const float tiny[] = { FLT_MIN, 1e-30f, 1e-12f, 1e-9f, 1e-7f, 1e-6f, 1e-5f };
+    for (size_t i = 0; i < sizeof(tiny) / sizeof(tiny[0]); i++)
+    {
+        checkRatio(tiny[i]);
+        checkRatio(-tiny[i]);
+    }
+    checkRatio(-0.0f);
+
+    // Just either side of every whole octave
+    for (int oct = -MAX_OCTAVES; oct <= MAX_OCTAVES; oct++)
+    {
+        float s = oct * 12.0f;
+        float below = s, above = s;
+        for (int n = 0; n < 64; n++)
+        {
+            below = nextafterf(below, -INFINITY);
+            above = nextafterf(above, INFINITY);
+            checkRatio(below);
+            checkRatio(above);
+        }
+    }
+
+    printf("%d values, max relative error %.2e at %g semitones\n", checked, max_error, worst);
+    bool passed = (max_error <= MAX_REL_ERROR);
+    printf("%s\n", passed ? "PASSED" : "FAILED");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,208 @@
+#include "TLM_channel.h"
+#ifndef ARDUINO
+#include <time.h>
+#endif
+
+TLM_channel tlm_channel;
+
+static uint32_t tlmMicros()
+{
+#ifdef ARDUINO
+  return micros();
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+#endif
+}
+
+TLM_channel::TLM_channel()
+{
+  for (uint32_t i = 0; i < TLM_RING_LEN; i++)
+  {
+    _ring[i].seq.store(i, std::memory_order_relaxed);
+  }
+  _head.store(0, std::memory_order_relaxed);
+  _dropped.store(0, std::memory_order_relaxed);
+}
+
+#ifdef ARDUINO
+/**
+ * @brief Start the task that sends the queued records.
+ *
+ * @param out  Where the frames are written, usually Serial.  Text printed to the 
+ *             same port passes through tlm_decode unchanged.
+ * @return true if the task was started.
+ */
+bool TLM_channel::begin(Print *out)
+{
+  _out = out;
+  if (_task != NULL) return true;
+  return xTaskCreatePinnedToCore(drainTask, "tlm_drain", TLM_TASK_STACK, this, TLM_TASK_PRIORITY, &_task, TLM_TASK_CORE) == pdPASS;
+}
+#endif
+
+/**
+ * @brief Take the oldest record off the ring and frame it.  Only one task may read.
+ *        New drops are reported in a frame of their own before the next record.
+ *
+ * @param frame Receives the frame, at least TLM_FRAME_MAX bytes.
+ * @return uint16_t Frame length, 0 if nothing is waiting.
+ */
+uint16_t TLM_channel::readFrame(uint8_t *frame)
+{
+  tlm_record_t  drop_rec;
+  tlm_record_t *rec = &_ring[_tail & (TLM_RING_LEN - 1)];
+  uint32_t      dropped = _dropped.load(std::memory_order_relaxed);
+  bool          ready = (rec->seq.load(std::memory_order_acquire) == _tail + 1);
+
+  if (dropped != _dropped_sent)
+  {
+    drop_rec.time_us = tlmMicros();
+    drop_rec.tag = "TLM";
+    drop_rec.fmt = "%u records dropped";
+    drop_rec.level = TLM_LEVEL_WARN;
+    drop_rec.argc = 1;
+    drop_rec.types = TLM_ARG_UINT;
+    drop_rec.args[0] = dropped - _dropped_sent;
+    _dropped_sent = dropped;
+    rec = &drop_rec;
+  }
+  else if (!ready)
+  {
+    return 0;
+  }
+
+  uint16_t len = 2;
+  frame[0] = TLM_SYNC;
+  frame[len++] = (rec->level << 4) | rec->argc;
+  frame[len++] = rec->types;
+  memcpy(&frame[len], &rec->time_us, 4);
+  len += 4;
+
+  const char *text[2] = { rec->tag, rec->fmt };
+  uint8_t     max_len[2] = { TLM_MAX_TAG, TLM_MAX_FMT };
+  for (uint8_t t = 0; t < 2; t++)
+  {
+    uint8_t text_len = 0;
+    while (text_len < max_len[t] && text[t][text_len] != 0) text_len++;
+    frame[len++] = text_len;
+    memcpy(&frame[len], text[t], text_len);
+    len += text_len;
+  }
+  memcpy(&frame[len], rec->args, 4 * rec->argc);
+  len += 4 * rec->argc;
+
+  frame[1] = len - 2;
+  frame[len] = calcCRC(&frame[1], len - 1);
+  len++;
+
+  if (rec != &drop_rec)
+  {
+    // Hand the slot back to the writers for the next time around the ring
+    rec->seq.store(_tail + TLM_RING_LEN, std::memory_order_release);
+    _tail++;
+  }
+  _sent++;
+  return len;
+}
+
+/**
+ * @brief Get the number of records dropped because the ring was full.
+ */
+uint32_t TLM_channel::getDropped()
+{
+  return _dropped.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Get the number of frames sent, including the dropped record reports.
+ */
+uint32_t TLM_channel::getSent()
+{
+  return _sent;
+}
+
+//----- PRIVATE METHODS -----//
+
+/**
+ * @brief Claim the next free slot.  Each slot's seq says which ring position it is free 
+ *        for, so writers on any core only contend on _head and never wait for the reader.
+ *
+ * @return tlm_record_t* The slot to fill, or NULL if the ring is full.
+ */
+tlm_record_t *TLM_channel::reserve()
+{
+  uint32_t pos = _head.load(std::memory_order_relaxed);
+
+  while (true)
+  {
+    tlm_record_t *rec = &_ring[pos & (TLM_RING_LEN - 1)];
+    int32_t diff = (int32_t)(rec->seq.load(std::memory_order_acquire) - pos);
+
+    if (diff == 0)
+    {
+      if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+      {
+        rec->time_us = tlmMicros();
+        return rec;
+      }
+      // pos has been reloaded, try again
+    }
+    else if (diff < 0)
+    {
+      _dropped.fetch_add(1, std::memory_order_relaxed);
+      return NULL;
+    }
+    else
+    {
+      pos = _head.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+/**
+ * @brief Publish a filled slot to the reader.
+ */
+void TLM_channel::commit(tlm_record_t *rec)
+{
+  uint32_t pos = rec->seq.load(std::memory_order_relaxed);
+  rec->seq.store(pos + 1, std::memory_order_release);
+}
+
+uint8_t TLM_channel::calcCRC(const uint8_t *data, uint16_t len)
+{
+  uint8_t crc = 0;
+
+  for (uint16_t i = 0; i < len; i++)
+  {
+    crc ^= data[i];
+    for (uint8_t bit = 0; bit < 8; bit++)
+    {
+      crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : (crc << 1);
+    }
+  }
+  return crc;
+}
+
+#ifdef ARDUINO
+/**
+ * @brief Sends frames whenever there are any, then sleeps.  Writing may block 
+ *        at slow baud rates, but only this task waits.
+ */
+void TLM_channel::drainTask(void *param)
+{
+  TLM_channel *channel = (TLM_channel *)param;
+  uint8_t      frame[TLM_FRAME_MAX];
+  uint16_t     len;
+
+  while (true)
+  {
+    while ((len = channel->readFrame(frame)) > 0)
+    {
+      if (channel->_out != NULL) channel->_out->write(frame, len);
+    }
+    vTaskDelay(TLM_DRAIN_MS / portTICK_PERIOD_MS);
+  }
+}
+#endif
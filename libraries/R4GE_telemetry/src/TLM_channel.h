@@ -0,0 +1,190 @@
+/**
+ * @file TLM_channel.h
+ * @author Paul Pagel (https://twobittinker.com)
+ * @brief  Non-blocking binary log and telemetry channel, shared by the R4ge Pro apps.
+ *         A log call only copies the level, tag, format string pointer, time and up to 
+ *         TLM_MAX_ARGS numbers into a lock-free ring, so it is safe in audio loops, 
+ *         callbacks and from any task or core.  If the ring is full the record is 
+ *         counted as dropped instead of waiting.  A low priority task frames the 
+ *         records and writes them out, and tools/tlm_decode turns them back into text.
+ *         The tag and format must be string literals, and the arguments numbers (no %s).
+ *         Calls below TLM_LEVEL are compiled out.  Set it with a build flag, e.g. -DTLM_LEVEL=4
+ *
+ *         Arduino IDE:  copy or link this folder into the sketchbook libraries folder.
+ *         PlatformIO:   lib_extra_dirs = ../../libraries
+ * @version 0.1
+ * @date 2020-09-05
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#ifndef _TLM_CHANNEL_
+#define _TLM_CHANNEL_
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+
+#define TLM_LEVEL_NONE      0
+#define TLM_LEVEL_ERROR     1
+#define TLM_LEVEL_WARN      2
+#define TLM_LEVEL_INFO      3
+#define TLM_LEVEL_DEBUG     4
+#define TLM_LEVEL_VERBOSE   5
+
+#ifndef TLM_LEVEL
+#define TLM_LEVEL  TLM_LEVEL_INFO
+#endif
+
+#define TLM_RING_LEN       64  // Records waiting to be sent.  Must be power of 2
+#define TLM_MAX_ARGS        4
+#define TLM_MAX_TAG        15  // Longer tags and formats are cut short in the frame
+#define TLM_MAX_FMT       180
+#define TLM_FRAME_MAX     (8 + 1 + TLM_MAX_TAG + 1 + TLM_MAX_FMT + 4 * TLM_MAX_ARGS + 1)
+#define TLM_SYNC         0xA5  // First byte of each frame
+#define TLM_TASK_STACK   3072
+#define TLM_TASK_CORE       0  // Arduino loop() and the audio run on core 1
+#define TLM_TASK_PRIORITY   1  // Just above idle
+#define TLM_DRAIN_MS       20
+
+#define TLM_ARG_UINT        0  // Argument types, 2 bits each in tlm_record_t.types
+#define TLM_ARG_INT         1
+#define TLM_ARG_FLOAT       2
+
+/*
+ * Frame layout, multi-byte values little endian:
+ *   0      TLM_SYNC
+ *   1      length of bytes 2 up to the CRC
+ *   2      level << 4 | argument count
+ *   3      argument types, 2 bits each, first argument in the low bits
+ *   4-7    time in microseconds
+ *   8      tag length, then the tag
+ *          format length, then the format
+ *          arguments, 4 bytes each
+ *   last   CRC-8 (polynomial 0x07) of bytes 1 up to here
+ */
+
+typedef struct
+{
+  std::atomic<uint32_t> seq;   // Ring position the slot is ready for
+  uint32_t    time_us;
+  const char *tag;
+  const char *fmt;
+  uint8_t     level;
+  uint8_t     argc;
+  uint8_t     types;
+  uint32_t    args[TLM_MAX_ARGS];
+} tlm_record_t;
+
+class TLM_channel
+{
+  public:
+    TLM_channel();
+#ifdef ARDUINO
+    bool     begin(Print *out);
+#endif
+    uint16_t readFrame(uint8_t *frame);
+    uint32_t getDropped();
+    uint32_t getSent();
+
+    /*
+     * Queues a record.  Returns without waiting, the record is dropped if the ring is full.
+     */
+    template<typename... Args>
+    void log(uint8_t level, const char *tag, const char *fmt, Args... args)
+    {
+      static_assert(sizeof...(Args) <= TLM_MAX_ARGS, "Too many telemetry arguments");
+      tlm_record_t *rec = reserve();
+      if (rec == NULL) return;
+
+      rec->tag = tag;
+      rec->fmt = fmt;
+      rec->level = level;
+      rec->argc = sizeof...(Args);
+      rec->types = 0;
+      packArgs(rec, 0, args...);
+      commit(rec);
+    }
+
+  private:
+    tlm_record_t *reserve();
+    void     commit(tlm_record_t *rec);
+    static uint8_t calcCRC(const uint8_t *data, uint16_t len);
+#ifdef ARDUINO
+    static void drainTask(void *param);
+#endif
+
+    static void packArgs(tlm_record_t *rec, uint8_t idx) {}
+
+    template<typename T, typename... Args>
+    static void packArgs(tlm_record_t *rec, uint8_t idx, T value, Args... args)
+    {
+      static_assert(std::is_arithmetic<T>::value, "Telemetry arguments must be numbers");
+      if (std::is_floating_point<T>::value)
+      {
+        float f = (float)value;
+        memcpy(&rec->args[idx], &f, sizeof(f));
+        rec->types |= TLM_ARG_FLOAT << (idx * 2);
+      }
+      else if (std::is_signed<T>::value)
+      {
+        rec->args[idx] = (uint32_t)(int32_t)value;
+        rec->types |= TLM_ARG_INT << (idx * 2);
+      }
+      else
+      {
+        rec->args[idx] = (uint32_t)value;
+      }
+      packArgs(rec, idx + 1, args...);
+    }
+
+    tlm_record_t          _ring[TLM_RING_LEN];
+    std::atomic<uint32_t> _head;      // Next position to reserve
+    uint32_t              _tail = 0;  // Next position to send, only used by the reader
+    std::atomic<uint32_t> _dropped;
+    uint32_t              _dropped_sent = 0;  // Drops already reported in a frame
+    uint32_t              _sent = 0;
+#ifdef ARDUINO
+    Print                *_out = NULL;
+    TaskHandle_t          _task = NULL;
+#endif
+};
+
+extern TLM_channel tlm_channel;
+
+#if TLM_LEVEL >= TLM_LEVEL_ERROR
+#define TLM_ERROR(tag, ...)    tlm_channel.log(TLM_LEVEL_ERROR, tag, __VA_ARGS__)
+#else
+#define TLM_ERROR(tag, ...)    do {} while (0)
+#endif
+
+#if TLM_LEVEL >= TLM_LEVEL_WARN
+#define TLM_WARN(tag, ...)     tlm_channel.log(TLM_LEVEL_WARN, tag, __VA_ARGS__)
+#else
+#define TLM_WARN(tag, ...)     do {} while (0)
+#endif
+
+#if TLM_LEVEL >= TLM_LEVEL_INFO
+#define TLM_INFO(tag, ...)     tlm_channel.log(TLM_LEVEL_INFO, tag, __VA_ARGS__)
+#else
+#define TLM_INFO(tag, ...)     do {} while (0)
+#endif
+
+#if TLM_LEVEL >= TLM_LEVEL_DEBUG
+#define TLM_DEBUG(tag, ...)    tlm_channel.log(TLM_LEVEL_DEBUG, tag, __VA_ARGS__)
+#else
+#define TLM_DEBUG(tag, ...)    do {} while (0)
+#endif
+
+#if TLM_LEVEL >= TLM_LEVEL_VERBOSE
+#define TLM_VERBOSE(tag, ...)  tlm_channel.log(TLM_LEVEL_VERBOSE, tag, __VA_ARGS__)
+#else
+#define TLM_VERBOSE(tag, ...)  do {} while (0)
+#endif
+
+#endif // _TLM_CHANNEL_
@@ -0,0 +1,329 @@
+/*
+ * Host decoder for the R4GE_telemetry stream.
+ * Reads the serial output of a badge from a file or stdin and prints each frame as
+ *   [   12.345678] W I2S: I2S write timeout
+ * Bytes outside valid frames, such as boot messages and plain Serial prints, are 
+ * passed through as they are.  A frame with a bad CRC is treated as plain bytes 
+ * and the search for the next sync byte carries on after its first byte.
+ *
+ * Build from this folder:
+ *   g++ -std=c++11 -O2 -pthread -Isrc -o tlm_decode tools/tlm_decode.cpp src/TLM_channel.cpp
+ * Run:
+ *   stty -F /dev/ttyUSB0 115200 raw && ./tlm_decode /dev/ttyUSB0
+ *   ./tlm_decode -t    Self test: several threads log at once while the ring is 
+ *                      drained, then every record is decoded and checked.
+ */
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "TLM_channel.h"
+
+static const char LEVEL_CHARS[] = "-EWIDV";
+
+/*
+ * Formats the arguments of a frame with its format string.  Each conversion takes 
+ * the next argument, printed as the type it was logged as where the two differ.
+ */
+static std::string formatMessage(const std::string &fmt, uint8_t argc, uint8_t types, const uint8_t *args)
+{
+  std::string out;
+  uint8_t     arg = 0;
+  char        text[64];
+
+  for (size_t i = 0; i < fmt.size(); i++)
+  {
+    if (fmt[i] != '%')
+    {
+      out += fmt[i];
+      continue;
+    }
+    if (i + 1 < fmt.size() && fmt[i + 1] == '%')
+    {
+      out += '%';
+      i++;
+      continue;
+    }
+
+    // Flags, width and precision are kept, length modifiers are dropped
+    std::string spec = "%";
+    size_t j = i + 1;
+    while (j < fmt.size() && strchr("-+ #0123456789.", fmt[j])) spec += fmt[j++];
+    while (j < fmt.size() && strchr("hlLqjzt", fmt[j])) j++;
+    if (j >= fmt.size()) break;
+    char conv = fmt[j];
+    i = j;
+
+    if (arg >= argc)
+    {
+      out += "<?>";
+      continue;
+    }
+    uint32_t value;
+    memcpy(&value, &args[arg * 4], 4);
+    uint8_t type = (types >> (arg * 2)) & 3;
+    arg++;
+
+    float f;
+    memcpy(&f, &value, 4);
+    double  as_float = (type == TLM_ARG_FLOAT ? f : (type == TLM_ARG_INT ? (double)(int32_t)value : (double)value));
+    int64_t as_int   = (type == TLM_ARG_FLOAT ? (int64_t)f : (type == TLM_ARG_INT ? (int64_t)(int32_t)value : (int64_t)value));
+
+    if (strchr("fFeEgGaA", conv))
+    {
+      snprintf(text, sizeof(text), (spec + conv).c_str(), as_float);
+    }
+    else if (strchr("di", conv))
+    {
+      snprintf(text, sizeof(text), (spec + "lld").c_str(), (long long)as_int);
+    }
+    else if (strchr("uxXoc", conv))
+    {
+      snprintf(text, sizeof(text), (spec + conv).c_str(), (unsigned)as_int);
+    }
+    else
+    {
+      snprintf(text, sizeof(text), "<%%%c?>", conv);
+    }
+    out += text;
+  }
+  return out;
+}
+
+static uint8_t calcCRC(const uint8_t *data, uint16_t len)
+{
+  uint8_t crc = 0;
+
+  for (uint16_t i = 0; i < len; i++)
+  {
+    crc ^= data[i];
+    for (uint8_t bit = 0; bit < 8; bit++)
+    {
+      crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : (crc << 1);
+    }
+  }
+  return crc;
+}
+
+/*
+ * Stream decoder.  Bytes are added as they arrive and complete lines are returned.
+ */
+class Decoder
+{
+  public:
+    std::vector<std::string> lines;  // Decoded frames and passed through text
+    uint32_t frames = 0;
+    uint32_t bad_frames = 0;
+
+    void add(const uint8_t *data, size_t len)
+    {
+      _buff.insert(_buff.end(), data, data + len);
+      size_t pos = 0;
+
+      while (pos < _buff.size())
+      {
+        if (_buff[pos] != TLM_SYNC)
+        {
+          addText(_buff[pos++]);
+          continue;
+        }
+        if (pos + 2 > _buff.size()) break;  // Wait for the length
+        
+        size_t len = _buff[pos + 1];
+        if (pos + 2 + len + 1 > _buff.size()) break;  // Wait for the rest
+        
+        if (parseFrame(&_buff[pos], len))
+        {
+          pos += 2 + len + 1;
+        }
+        else
+        {
+          addText(_buff[pos++]);
+        }
+      }
+      _buff.erase(_buff.begin(), _buff.begin() + pos);
+    }
+
+    void flush()
+    {
+      for (uint8_t b : _buff) addText(b);
+      _buff.clear();
+      if (!_text.empty()) lines.push_back(_text);
+      _text.clear();
+    }
+
+  private:
+    void addText(uint8_t b)
+    {
+      if (b == '\n')
+      {
+        lines.push_back(_text);
+        _text.clear();
+      }
+      else if (b != '\r')
+      {
+        _text += (char)b;
+      }
+    }
+
+    bool parseFrame(const uint8_t *frame, size_t len)
+    {
+      if (len < 8 || calcCRC(&frame[1], len + 1) != frame[2 + len])
+      {
+        if (len >= 8) bad_frames++;
+        return false;
+      }
+
+      const uint8_t *end = &frame[2 + len];
+      const uint8_t *p = &frame[2];
+      uint8_t  level = p[0] >> 4;
+      uint8_t  argc = p[0] & 0x0F;
+      uint8_t  types = p[1];
+      uint32_t time_us;
+      memcpy(&time_us, &p[2], 4);
+      p += 6;
+
+      std::string text[2];
+      for (uint8_t t = 0; t < 2; t++)
+      {
+        if (p >= end || p + 1 + *p > end) return false;
+        text[t].assign((const char *)p + 1, *p);
+        p += 1 + *p;
+      }
+      if (argc > TLM_MAX_ARGS || p + argc * 4 != end) return false;
+
+      // Finish any text line the frame interrupted
+      if (!_text.empty()) 
+      {
+        lines.push_back(_text);
+        _text.clear();
+      }
+      
+      char prefix[48];
+      snprintf(prefix, sizeof(prefix), "[%12.6f] %c %s: ", time_us / 1e6, 
+               level < sizeof(LEVEL_CHARS) - 1 ? LEVEL_CHARS[level] : '?', text[0].c_str());
+      lines.push_back(prefix + formatMessage(text[1], argc, types, p));
+      frames++;
+      return true;
+    }
+
+    std::vector<uint8_t> _buff;
+    std::string _text;
+};
+
+/*
+ * Several writers log numbered records at once, with a reader draining the ring 
+ * slower than they write, so some records are dropped.  Every frame must decode, 
+ * each writer's records must arrive in order, and received plus dropped must add up.
+ */
+static int selfTest()
+{
+  const uint32_t WRITERS = 4, PER_WRITER = 20000;
+  TLM_channel   *channel = new TLM_channel();
+  std::vector<uint8_t> stream;
+  std::atomic<uint32_t> done(0);
+  uint8_t  frame[TLM_FRAME_MAX];
+  uint16_t len;
+
+  const char *junk = "ets Jun  8 2016 00:22:57\nrst:0x1 (POWERON_RESET)\n\xA5\x09 not a frame\n";
+  stream.insert(stream.end(), junk, junk + strlen(junk));
+
+  std::vector<std::thread> writers;
+  for (uint32_t w = 0; w < WRITERS; w++)
+  {
+    writers.emplace_back([&, w]()
+    {
+      for (uint32_t i = 0; i < PER_WRITER; i++)
+      {
+        channel->log(TLM_LEVEL_INFO, "TEST", "writer %u record %u gain %.2f delta %d", w, i, i * 0.25f, -(int32_t)i);
+        if (i % 16 == 15) std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+      done++;
+    });
+  }
+
+  while (done.load() < WRITERS)
+  {
+    if ((len = channel->readFrame(frame)) > 0) stream.insert(stream.end(), frame, frame + len);
+  }
+  for (auto &writer : writers) writer.join();
+  while ((len = channel->readFrame(frame)) > 0) stream.insert(stream.end(), frame, frame + len);
+
+  // Decode in uneven pieces, as a serial port would deliver it
+  Decoder decoder;
+  for (size_t pos = 0; pos < stream.size(); )
+  {
+    size_t piece = 1 + rand() % 97;
+    if (piece > stream.size() - pos) piece = stream.size() - pos;
+    decoder.add(&stream[pos], piece);
+    pos += piece;
+  }
+  decoder.flush();
+
+  uint32_t received = 0, dropped_reported = 0, errors = 0;
+  int32_t  last[WRITERS];
+  for (uint32_t w = 0; w < WRITERS; w++) last[w] = -1;
+
+  for (const std::string &line : decoder.lines)
+  {
+    unsigned w, i, dropped;
+    float    gain;
+    int      delta;
+    const char *msg = strstr(line.c_str(), "] ");
+    if (msg != NULL && sscanf(msg, "] I TEST: writer %u record %u gain %f delta %d", &w, &i, &gain, &delta) == 4)
+    {
+      if (w >= WRITERS || (int32_t)i <= last[w] || gain != i * 0.25f || delta != -(int)i) errors++;
+      else last[w] = i;
+      received++;
+    }
+    else if (msg != NULL && sscanf(msg, "] W TLM: %u records dropped", &dropped) == 1)
+    {
+      dropped_reported += dropped;
+    }
+    else if (line.find("TEST") != std::string::npos)
+    {
+      errors++;
+    }
+  }
+
+  printf("Frames %u, bad CRC %u, records %u, dropped %u (reported %u), out of order or wrong %u\n", 
+         decoder.frames, decoder.bad_frames, received, channel->getDropped(), dropped_reported, errors);
+  printf("Passed through: %s | %s | %s\n", decoder.lines[0].c_str(), decoder.lines[1].c_str(), decoder.lines[2].c_str());
+  
+  bool passed = errors == 0 && received + channel->getDropped() == WRITERS * PER_WRITER && 
+                dropped_reported == channel->getDropped() && decoder.lines[0] == "ets Jun  8 2016 00:22:57";
+  delete channel;
+  printf(passed ? "PASSED\n" : "FAILED\n");
+  return passed ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc > 1 && strcmp(argv[1], "-t") == 0) return selfTest();
+
+  FILE *in = (argc > 1 ? fopen(argv[1], "rb") : stdin);
+  if (in == NULL)
+  {
+    fprintf(stderr, "Usage: %s [serial log or device]   (stdin if none)\n", argv[0]);
+    return 1;
+  }
+
+  Decoder decoder;
+  uint8_t buff[256];
+  size_t  len;
+  while ((len = fread(buff, 1, sizeof(buff), in)) > 0)
+  {
+    decoder.add(buff, len);
+    for (const std::string &line : decoder.lines) puts(line.c_str());
+    decoder.lines.clear();
+    fflush(stdout);
+  }
+  decoder.flush();
+  for (const std::string &line : decoder.lines) puts(line.c_str());
+  
+  if (in != stdin) fclose(in);
+  return 0;
+}